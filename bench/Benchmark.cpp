@@ -0,0 +1,243 @@
+#include "Benchmark.h"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <new>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+// Every heap allocation in the benchmark binary goes through these, so the
+// harness can report allocations per event
+namespace {
+
+std::atomic<uint64_t> g_allocations{ 0 };
+std::atomic<uint64_t> g_allocatedBytes{ 0 };
+
+// Null on failure; the throwing operators turn that into bad_alloc
+void* CountedAllocate(std::size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    g_allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    return std::malloc(size ? size : 1);
+}
+
+// Released with AlignedFree, whatever the alignment
+void* CountedAllocateAligned(std::size_t size, std::align_val_t alignment) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    g_allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    std::size_t align = static_cast<std::size_t>(alignment);
+#ifdef _WIN32
+    return _aligned_malloc(size ? size : 1, align);
+#else
+    // aligned_alloc wants a size that is a multiple of the alignment
+    std::size_t rounded = (size + align - 1) / align * align;
+    return std::aligned_alloc(align, rounded ? rounded : align);
+#endif
+}
+
+void AlignedFree(void* block) {
+#ifdef _WIN32
+    _aligned_free(block);
+#else
+    std::free(block);
+#endif
+}
+
+void* OrThrow(void* block) {
+    if (!block) {
+        throw std::bad_alloc();
+    }
+    return block;
+}
+
+std::string JsonEscape(const std::string& text) {
+    std::string escaped;
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+        }
+        escaped += c;
+    }
+    return escaped;
+}
+
+} // namespace
+
+// Every form is replaced, so none of them is served by another allocator
+// and then released here
+void* operator new(std::size_t size) { return OrThrow(CountedAllocate(size)); }
+void* operator new[](std::size_t size) { return OrThrow(CountedAllocate(size)); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return CountedAllocate(size); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return CountedAllocate(size); }
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    return OrThrow(CountedAllocateAligned(size, alignment));
+}
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+    return OrThrow(CountedAllocateAligned(size, alignment));
+}
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return CountedAllocateAligned(size, alignment);
+}
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return CountedAllocateAligned(size, alignment);
+}
+void operator delete(void* block) noexcept { std::free(block); }
+void operator delete[](void* block) noexcept { std::free(block); }
+void operator delete(void* block, std::size_t) noexcept { std::free(block); }
+void operator delete[](void* block, std::size_t) noexcept { std::free(block); }
+void operator delete(void* block, const std::nothrow_t&) noexcept { std::free(block); }
+void operator delete[](void* block, const std::nothrow_t&) noexcept { std::free(block); }
+void operator delete(void* block, std::align_val_t) noexcept { AlignedFree(block); }
+void operator delete[](void* block, std::align_val_t) noexcept { AlignedFree(block); }
+void operator delete(void* block, std::size_t, std::align_val_t) noexcept { AlignedFree(block); }
+void operator delete[](void* block, std::size_t, std::align_val_t) noexcept { AlignedFree(block); }
+void operator delete(void* block, std::align_val_t, const std::nothrow_t&) noexcept { AlignedFree(block); }
+void operator delete[](void* block, std::align_val_t, const std::nothrow_t&) noexcept { AlignedFree(block); }
+
+BenchmarkState::BenchmarkState(uint64_t iterations, int64_t arg)
+    : m_iterations(iterations), m_arg(arg), m_itemsPerIteration(1), m_elapsed(0),
+      m_allocationsAtStart(0), m_bytesAtStart(0), m_allocations(0), m_bytes(0), m_expectNoAllocations(false) {
+}
+
+void BenchmarkState::Start() {
+    m_allocationsAtStart = g_allocations.load(std::memory_order_relaxed);
+    m_bytesAtStart = g_allocatedBytes.load(std::memory_order_relaxed);
+    m_start = std::chrono::steady_clock::now();
+}
+
+void BenchmarkState::Stop() {
+    m_elapsed += std::chrono::steady_clock::now() - m_start;
+    m_allocations += g_allocations.load(std::memory_order_relaxed) - m_allocationsAtStart;
+    m_bytes += g_allocatedBytes.load(std::memory_order_relaxed) - m_bytesAtStart;
+}
+
+BenchmarkRegistry& BenchmarkRegistry::Instance() {
+    static BenchmarkRegistry registry;
+    return registry;
+}
+
+void BenchmarkRegistry::Add(const std::string& name, Function function, std::vector<int64_t> args,
+                            const std::string& argName) {
+    m_entries.push_back({ name, std::move(function), std::move(args), argName });
+}
+
+BenchmarkResult BenchmarkRegistry::RunOne(const Entry& entry, int64_t arg, const std::string& name,
+                                          std::chrono::milliseconds minTime) const {
+    // Grow the iteration count until one run takes at least minTime
+    uint64_t iterations = 1;
+    std::string failure;
+    for (;;) {
+        BenchmarkState state(iterations, arg);
+        entry.function(state);
+        if (failure.empty()) {
+            failure = state.GetFailure();
+        }
+
+        auto elapsed = state.GetElapsed();
+        if (elapsed >= minTime || iterations >= 1000000000) {
+            BenchmarkResult result;
+            result.name = name;
+            result.arg = arg;
+            result.iterations = iterations;
+            result.items = iterations * state.GetItemsPerIteration();
+            double items = static_cast<double>(result.items);
+            result.nsPerItem = static_cast<double>(elapsed.count()) / items;
+            result.itemsPerSecond = elapsed.count() > 0 ? items * 1e9 / static_cast<double>(elapsed.count()) : 0.0;
+            result.allocationsPerItem = static_cast<double>(state.GetAllocations()) / items;
+            result.bytesPerItem = static_cast<double>(state.GetAllocatedBytes()) / items;
+            result.allocations = state.GetAllocations();
+            result.expectNoAllocations = state.GetExpectNoAllocations();
+            result.label = state.GetLabel();
+            result.failure = failure;
+            return result;
+        }
+
+        double scale = elapsed.count() > 0 ? 1.4 * static_cast<double>(minTime.count()) * 1e6 / elapsed.count() : 100.0;
+        scale = scale < 2.0 ? 2.0 : (scale > 100.0 ? 100.0 : scale);
+        iterations = static_cast<uint64_t>(static_cast<double>(iterations) * scale);
+    }
+}
+
+int BenchmarkRegistry::Run(int argc, char* argv[]) {
+    std::string filter;
+    std::string jsonPath;
+    std::chrono::milliseconds minTime(200);
+
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--filter") == 0 && hasValue) {
+            filter = argv[++i];
+        } else if (std::strcmp(argv[i], "--min-time") == 0 && hasValue) {
+            minTime = std::chrono::milliseconds(std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--json") == 0 && hasValue) {
+            jsonPath = argv[++i];
+        } else {
+            std::printf("Usage: SoundTrackerBench [--filter SUBSTRING] [--min-time MS] [--json FILE]\n");
+            return 2;
+        }
+    }
+
+    std::vector<BenchmarkResult> results;
+    int status = 0;
+    std::printf("%-52s %12s %14s %12s %12s\n", "Benchmark", "ns/event", "events/s", "allocs/event", "bytes/event");
+    for (const auto& entry : m_entries) {
+        for (int64_t arg : entry.args) {
+            std::string name = entry.argName.empty() ? entry.name
+                                                     : entry.name + "/" + entry.argName + "=" + std::to_string(arg);
+            if (!filter.empty() && name.find(filter) == std::string::npos) {
+                continue;
+            }
+            BenchmarkResult result = RunOne(entry, arg, name, minTime);
+            std::printf("%-52s %12.1f %14.0f %12.2f %12.1f%s%s\n", result.name.c_str(), result.nsPerItem,
+                        result.itemsPerSecond, result.allocationsPerItem, result.bytesPerItem,
+                        result.label.empty() ? "" : "  ", result.label.c_str());
+            if (result.expectNoAllocations && result.allocations > 0) {
+                std::printf("  FAILED: %llu allocations in %llu events; expected none in steady state\n",
+                            static_cast<unsigned long long>(result.allocations),
+                            static_cast<unsigned long long>(result.items));
+                status = 1;
+            }
+            if (!result.failure.empty()) {
+                std::printf("  FAILED: %s\n", result.failure.c_str());
+                status = 1;
+            }
+            std::fflush(stdout);
+            results.push_back(result);
+        }
+    }
+
+    if (!jsonPath.empty()) {
+        std::ofstream json(jsonPath);
+        if (!json.is_open()) {
+            std::fprintf(stderr, "Cannot write %s\n", jsonPath.c_str());
+            return 1;
+        }
+        char date[32] = "";
+        std::time_t now = std::time(nullptr);
+        std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+        json << "{\n  \"context\": {\"date\": \"" << date << "\", \"min_time_ms\": " << minTime.count()
+#ifdef NDEBUG
+             << ", \"build\": \"release\"},\n"
+#else
+             << ", \"build\": \"debug\"},\n"
+#endif
+             << "  \"benchmarks\": [\n";
+        for (size_t i = 0; i < results.size(); ++i) {
+            const auto& r = results[i];
+            json << "    {\"name\": \"" << JsonEscape(r.name) << "\", \"arg\": " << r.arg
+                 << ", \"iterations\": " << r.iterations << ", \"events\": " << r.items
+                 << ", \"ns_per_event\": " << r.nsPerItem << ", \"events_per_second\": " << r.itemsPerSecond
+                 << ", \"allocations_per_event\": " << r.allocationsPerItem
+                 << ", \"bytes_per_event\": " << r.bytesPerItem
+                 << ", \"expect_no_allocations\": " << (r.expectNoAllocations ? "true" : "false")
+                 << ", \"label\": \"" << JsonEscape(r.label) << "\""
+                 << ", \"failure\": \"" << JsonEscape(r.failure) << "\"}"
+                 << (i + 1 < results.size() ? ",\n" : "\n");
+        }
+        json << "  ]\n}\n";
+    }
+    return status;
+}
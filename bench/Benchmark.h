@@ -0,0 +1,106 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+
+// Small self-contained benchmark harness, so the suite builds wherever the
+// core library does. Each benchmark does its setup, then times a loop of
+// state.GetIterations() operations between Start and Stop. The harness grows
+// the iteration count until a run lasts long enough to measure, and counts
+// heap allocations made between Start and Stop. A benchmark that calls
+// ExpectNoAllocations fails the run if any are made, and one that calls Fail
+// (a wrong result, not a slow one) fails it too.
+class BenchmarkState {
+private:
+    uint64_t m_iterations;
+    int64_t m_arg;
+    uint64_t m_itemsPerIteration;
+    std::chrono::steady_clock::time_point m_start;
+    std::chrono::nanoseconds m_elapsed;
+    uint64_t m_allocationsAtStart;
+    uint64_t m_bytesAtStart;
+    uint64_t m_allocations;
+    uint64_t m_bytes;
+    bool m_expectNoAllocations;
+    std::string m_label;
+    std::string m_failure;
+
+public:
+    BenchmarkState(uint64_t iterations, int64_t arg);
+
+    uint64_t GetIterations() const { return m_iterations; }
+    int64_t GetArg() const { return m_arg; }
+
+    // Events handled by one iteration (e.g. rows in one export); rates and
+    // allocation counts are reported per item
+    void SetItemsPerIteration(uint64_t items) { m_itemsPerIteration = items; }
+
+    // Asserts a steady state: warm up before Start so buffers and pools
+    // have grown, then not one allocation may happen before Stop
+    void ExpectNoAllocations() { m_expectNoAllocations = true; }
+
+    // Free text printed after the result, e.g. a measured compression ratio
+    void SetLabel(const std::string& label) { m_label = label; }
+
+    // A behavior check went wrong; the first message is reported
+    void Fail(const std::string& message) {
+        if (m_failure.empty()) m_failure = message;
+    }
+
+    void Start();
+    void Stop();
+
+    uint64_t GetItemsPerIteration() const { return m_itemsPerIteration; }
+    std::chrono::nanoseconds GetElapsed() const { return m_elapsed; }
+    uint64_t GetAllocations() const { return m_allocations; }
+    uint64_t GetAllocatedBytes() const { return m_bytes; }
+    bool GetExpectNoAllocations() const { return m_expectNoAllocations; }
+    const std::string& GetLabel() const { return m_label; }
+    const std::string& GetFailure() const { return m_failure; }
+};
+
+struct BenchmarkResult {
+    std::string name;
+    int64_t arg;
+    uint64_t iterations;
+    uint64_t items;
+    double nsPerItem;
+    double itemsPerSecond;
+    double allocationsPerItem;
+    double bytesPerItem;
+    uint64_t allocations;
+    bool expectNoAllocations;
+    std::string label;
+    std::string failure;  // From the first run that called Fail
+};
+
+class BenchmarkRegistry {
+public:
+    using Function = std::function<void(BenchmarkState&)>;
+
+private:
+    struct Entry {
+        std::string name;
+        Function function;
+        std::vector<int64_t> args;
+        std::string argName;
+    };
+
+    std::vector<Entry> m_entries;
+
+    BenchmarkResult RunOne(const Entry& entry, int64_t arg, const std::string& name,
+                           std::chrono::milliseconds minTime) const;
+
+public:
+    static BenchmarkRegistry& Instance();
+
+    // Runs once per arg; the result is named "name/argName=arg" when argName is set
+    void Add(const std::string& name, Function function, std::vector<int64_t> args = { 0 },
+             const std::string& argName = "");
+
+    // Options: --filter SUBSTRING, --min-time MS, --json FILE (machine-readable results).
+    // Returns 1 if a benchmark broke its ExpectNoAllocations or failed a check.
+    int Run(int argc, char* argv[]);
+};
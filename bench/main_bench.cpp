@@ -0,0 +1,3009 @@
+#include "Benchmark.h"
+#include "../include/EventEnricher.h"
+#include "../include/EventChunk.h"
+#include "../include/EventStore.h"
+#include "../include/EventQuery.h"
+#include "../include/EventRing.h"
+#include "../include/EventViewModel.h"
+#include "../include/FingerprintIndex.h"
+#include "../include/LevelHistory.h"
+#include "../include/LevelSeries.h"
+#include "../include/SearchIndex.h"
+#include "../include/SpanTracer.h"
+#include "../include/SpectralAnalyzer.h"
+#include "../include/OnsetDetector.h"
+#include "../include/LoudnessMeter.h"
+#include "../include/SessionCoalescer.h"
+#include "../include/TimestampClock.h"
+#include "../include/TraceReplayer.h"
+#include "../include/EndpointPool.h"
+#include "../include/MeterGate.h"
+#include "../include/Metrics.h"
+#include "../include/RuleEngine.h"
+#include "../include/WavFile.h"
+#include "../include/Utf8.h"
+#include "../include/Logger.h"
+#include "../include/CsvReader.h"
+#include "../include/ArrowWriter.h"
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <sstream>
+#include <algorithm>
+#include <random>
+#include <thread>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+// Microbenchmarks for the hot paths behind AddAudioEvent, the ListView and
+// the logger. Win32 lookups are replaced by FakeProcessInfo, so the suite
+// runs anywhere; results are per event.
+
+namespace {
+
+const char* const PROCESS_NAMES[] = {
+    "chrome.exe", "Discord.exe", "Spotify.exe", "Teams.exe", "explorer.exe", "svchost.exe",
+    "TextInputHost.exe", "firefox.exe", "game.exe", "obs64.exe", "Zoom.exe", "vlc.exe"
+};
+const size_t PROCESS_COUNT = sizeof(PROCESS_NAMES) / sizeof(PROCESS_NAMES[0]);
+
+// Answers like SoundTracker would after its process cache is warm
+class FakeProcessInfo : public ProcessInfoProvider {
+public:
+    void GetProcessNameFromPID(DWORD processId, std::string& name) override {
+        name.assign(processId == 0 ? "Unknown" : PROCESS_NAMES[processId % PROCESS_COUNT]);
+    }
+    void GetProcessPathFromPID(DWORD processId, std::string& path) override {
+        path.clear();
+        if (processId != 0) {
+            path += "C:\\Program Files\\App\\";
+            path += PROCESS_NAMES[processId % PROCESS_COUNT];
+        }
+    }
+    void GetUSBDeviceInfo(DWORD processId, const std::string&, std::string& info) override {
+        info.assign(processId == 0 ? "USB: SanDisk Cruzer (Port 2)" : "");
+    }
+    void GetBrowserTabInfo(DWORD, const std::string& processName, std::string& info) override {
+        info.assign(processName == "chrome.exe" ? "Tab: \"YouTube - Best Music Mix\"" : "");
+    }
+};
+
+std::filesystem::path ScratchDirectory() {
+    std::filesystem::path directory = std::filesystem::temp_directory_path() / "soundtracker_bench";
+    std::error_code ec;
+    std::filesystem::create_directories(directory, ec);
+    return directory;
+}
+
+// count events from rotating processes, spaced so that none batch together
+std::vector<AudioEvent> MakeEvents(size_t count) {
+    FakeProcessInfo info;
+    EventEnricher enricher(info);
+    std::mt19937 random(42);
+    auto time = std::chrono::system_clock::now() - std::chrono::hours(1);
+    std::vector<AudioEvent> events;
+    events.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        time += std::chrono::milliseconds(1 + random() % 20);
+        DWORD processId = static_cast<DWORD>(1 + i % 97);
+        events.push_back(enricher.Enrich(processId, (random() % 100) / 100.0f, (random() % 100) / 100.0f, "", time));
+    }
+    return events;
+}
+
+void FillStore(EventStore& store, const std::vector<AudioEvent>& events) {
+    for (const auto& event : events) {
+        store.Add(event);
+    }
+}
+
+// Every field except the MFCCs, which follow from the others
+bool SameEvent(const AudioEvent& a, const AudioEvent& b) {
+    return a.timestamp == b.timestamp && a.processId == b.processId && a.eventCount == b.eventCount &&
+           a.volumeLevel == b.volumeLevel && a.peakLevel == b.peakLevel &&
+           a.momentaryLoudness == b.momentaryLoudness && a.shortTermLoudness == b.shortTermLoudness &&
+           a.isSystemSound == b.isSystemSound && a.duration_ms == b.duration_ms &&
+           a.processName == b.processName && a.processPath == b.processPath &&
+           a.soundDescription == b.soundDescription && a.sessionDisplayName == b.sessionDisplayName &&
+           a.usbDeviceInfo == b.usbDeviceInfo && a.browserTabInfo == b.browserTabInfo &&
+           a.soundLabel == b.soundLabel && a.endpointId == b.endpointId &&
+           a.features.frames == b.features.frames && a.features.rms == b.features.rms;
+}
+
+// Compares what CsvReader parsed with what Logger wrote; the log keeps
+// milliseconds and levels to a hundredth of a percent
+std::string CheckCsvRows(const std::vector<AudioEvent>& written, const std::vector<AudioEvent>& parsed) {
+    if (parsed.size() != written.size()) {
+        return "parsed " + std::to_string(parsed.size()) + " rows, wrote " + std::to_string(written.size());
+    }
+    for (size_t i = 0; i < written.size(); ++i) {
+        const auto& a = written[i];
+        const auto& b = parsed[i];
+        auto ms = [](std::chrono::system_clock::time_point t) {
+            return std::chrono::duration_cast<std::chrono::milliseconds>(t.time_since_epoch()).count();
+        };
+        bool same = ms(a.timestamp) == ms(b.timestamp) && a.eventCount == b.eventCount &&
+                    a.processId == b.processId && a.processName == b.processName &&
+                    a.processPath == b.processPath && a.soundDescription == b.soundDescription &&
+                    a.sessionDisplayName == b.sessionDisplayName &&
+                    std::fabs(a.volumeLevel - b.volumeLevel) < 1e-4f && std::fabs(a.peakLevel - b.peakLevel) < 1e-4f &&
+                    a.isSystemSound == b.isSystemSound && a.usbDeviceInfo == b.usbDeviceInfo &&
+                    a.browserTabInfo == b.browserTabInfo;
+        if (!same) {
+            return "row " + std::to_string(i) + " differs from what was logged";
+        }
+    }
+    return "";
+}
+
+void AppendUnits(std::u16string& out, const std::string& utf8) { AppendUtf16(out, utf8.data(), utf8.size()); }
+void AppendUnits(std::u32string& out, const std::string& utf8) { AppendUtf32(out, utf8.data(), utf8.size()); }
+
+// Reference conversions, a code point at a time, for checking Utf8.cpp
+void ReferenceUtf8(std::string& out, uint32_t cp) {
+    if (cp < 0x80) {
+        out += static_cast<char>(cp);
+    } else if (cp < 0x800) {
+        out += static_cast<char>(0xC0 | (cp >> 6));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        out += static_cast<char>(0xE0 | (cp >> 12));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (cp >> 18));
+        out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+}
+
+template <typename Unit>
+void ReferenceUnits(std::basic_string<Unit>& out, uint32_t cp) {
+    if (sizeof(Unit) == 2 && cp >= 0x10000) {
+        out += static_cast<Unit>(0xD800 + ((cp - 0x10000) >> 10));
+        out += static_cast<Unit>(0xDC00 + ((cp - 0x10000) & 0x3FF));
+    } else {
+        out += static_cast<Unit>(cp);
+    }
+}
+
+// Strict decoding where each malformed sequence costs one byte and becomes U+FFFD
+std::vector<uint32_t> ReferenceDecode(const std::string& utf8) {
+    std::vector<uint32_t> cps;
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(utf8.data());
+    size_t size = utf8.size();
+    for (size_t i = 0; i < size;) {
+        unsigned char lead = bytes[i];
+        size_t extra = lead >= 0xC2 && lead <= 0xDF ? 1 : lead >= 0xE0 && lead <= 0xEF ? 2 :
+                       lead >= 0xF0 && lead <= 0xF4 ? 3 : 0;
+        if (lead < 0x80 || extra == 0) {
+            cps.push_back(lead < 0x80 ? lead : 0xFFFD);
+            ++i;
+            continue;
+        }
+        uint32_t cp = lead & (0x3F >> extra);
+        bool valid = i + extra < size;
+        for (size_t k = 1; valid && k <= extra; ++k) {
+            valid = (bytes[i + k] & 0xC0) == 0x80;
+            cp = (cp << 6) | (bytes[i + k] & 0x3F);
+        }
+        const uint32_t MINIMUM[] = { 0, 0x80, 0x800, 0x10000 };
+        valid = valid && cp >= MINIMUM[extra] && cp <= 0x10FFFF && (cp < 0xD800 || cp > 0xDFFF);
+        cps.push_back(valid ? cp : 0xFFFD);
+        i += valid ? extra + 1 : 1;
+    }
+    return cps;
+}
+
+// Compares the transcoder with the reference on random text of one unit
+// width: valid text must round-trip exactly, malformed UTF-8 must decode as
+// the reference does, and lone surrogates must come out as U+FFFD. Returns
+// an empty string or what went wrong.
+template <typename Unit>
+std::string CheckUtf8(size_t inputs) {
+    std::mt19937 random(28);
+    for (size_t n = 0; n < inputs; ++n) {
+        // Lengths straddle the 16-byte blocks, and half the inputs are mostly ASCII
+        size_t length = random() % 70;
+        bool ascii = random() % 2 == 0;
+        std::basic_string<Unit> units;
+        std::string expected;
+        for (size_t k = 0; k < length; ++k) {
+            uint32_t kind = random() % 10;
+            uint32_t cp = ascii || kind < 6 ? random() % 0x80 : kind < 8 ? 0x80 + random() % 0x780 :
+                          kind < 9 ? 0x800 + random() % 0xF800 : 0x10000 + random() % 0x100000;
+            cp = cp >= 0xD800 && cp <= 0xDFFF ? 'A' : cp;
+            ReferenceUnits(units, cp);
+            ReferenceUtf8(expected, cp);
+        }
+        std::string utf8;
+        AppendUtf8(utf8, units.data(), units.size());
+        if (utf8 != expected) {
+            return "encoding differs from the reference";
+        }
+        std::basic_string<Unit> back;
+        AppendUnits(back, utf8);
+        if (back != units) {
+            return "valid text did not round-trip";
+        }
+
+        std::string malformed;
+        for (size_t k = 0; k < length; ++k) {
+            uint32_t kind = random() % 4;
+            malformed += static_cast<char>(kind == 0 ? random() % 256 : kind == 1 ? 0x80 | random() % 64 : random() % 128);
+        }
+        std::basic_string<Unit> decoded, reference;
+        AppendUnits(decoded, malformed);
+        for (uint32_t cp : ReferenceDecode(malformed)) {
+            ReferenceUnits(reference, cp);
+        }
+        if (decoded != reference) {
+            return "malformed UTF-8 decoded differently from the reference";
+        }
+
+        std::basic_string<Unit> lone;
+        for (size_t k = 0; k < length; ++k) {
+            lone += static_cast<Unit>(random() % 3 == 0 ? 0xD800 + random() % 0x800 : random() % 0x80);
+        }
+        std::string replaced;
+        AppendUtf8(replaced, lone.data(), lone.size());
+        for (uint32_t cp : ReferenceDecode(replaced)) {
+            if (cp >= 0xD800 && cp <= 0xDFFF) {
+                return "a surrogate reached UTF-8";
+            }
+        }
+    }
+    return "";
+}
+
+// 64k units to UTF-8 and back per iteration, after checking the transcoder
+// against the reference for the unit width. arg 1 makes every eighth
+// character non-ASCII (accents, CJK and emoji); results are per unit.
+template <typename Unit>
+void Utf8Transcode(BenchmarkState& state) {
+    static std::string failure = CheckUtf8<Unit>(100000);
+    if (!failure.empty()) {
+        state.Fail(failure);
+    }
+
+    const size_t UNITS = 64 * 1024;
+    const uint32_t OTHERS[] = { 0xE9, 0x4E2D, 0x1F50A };
+    std::basic_string<Unit> text;
+    for (size_t i = 0; text.size() < UNITS; ++i) {
+        ReferenceUnits(text, state.GetArg() % 2 && i % 8 == 7 ? OTHERS[i / 8 % 3] : 'a' + i % 26);
+    }
+    std::string utf8;
+    std::basic_string<Unit> back;
+    auto roundTrip = [&]() {
+        utf8.clear();
+        AppendUtf8(utf8, text.data(), text.size());
+        back.clear();
+        AppendUnits(back, utf8);
+    };
+    roundTrip();
+    state.SetItemsPerIteration(text.size());
+
+    state.ExpectNoAllocations();
+    state.Start();
+    for (uint64_t i = 0; i < state.GetIterations(); ++i) {
+        roundTrip();
+    }
+    state.Stop();
+    if (back != text) {
+        state.Fail("benchmark text did not round-trip");
+    }
+}
+
+// Enrichment plus batching, as AddAudioEvent does without logging. arg is the
+// number of processes taking turns; 1 means every sample batches, otherwise
+// every sample is a new event and the full store recycles evicted ones.
+void AddAudioEvent(BenchmarkState& state) {
+    FakeProcessInfo info;
+    EventEnricher enricher(info);
+    EventStore store(32 * 1024);
+    AudioEvent event;
+    const std::string sessionName;
+    DWORD processes = static_cast<DWORD>(state.GetArg());
+    auto time = std::chrono::system_clock::now();
+    uint64_t samples = 0;
+    auto sample = [&]() {
+        DWORD processId = 1 + static_cast<DWORD>(samples++ % processes);
+        enricher.Enrich(processId, 0.5f, 0.25f, sessionName, time, event);
+        store.Add(event);
+    };
+
+    // Cycle the store (about a hundred events) a few hundred times. A recycled
+    // buffer only grows when it meets a longer string, so every one of them
+    // needs many reuses before no event can outgrow it.
+    for (uint64_t i = 0; i < 20000; ++i) {
+        sample();
+    }
+    state.ExpectNoAllocations();
+    state.Start();
+    for (uint64_t i = 0; i < state.GetIterations(); ++i) {
+        sample();
+    }
+    state.Stop();
+}
+
+// Runs the reused-buffer path of Pipeline next to fresh copies: every
+// enriched event must equal one enriched into a new event, the small
+// store's recycled events must equal the same sequences in a store that
+// never recycles, and the log written from the reused line buffer must
+// read back as the events logged. Names, paths, USB and tab strings change
+// length between samples, so a stale tail left in a buffer shows up.
+std::string CheckBufferReuse() {
+    FakeProcessInfo info;
+    EventEnricher enricher(info);
+    EventStore store(32 * 1024);
+    EventStore reference(SIZE_MAX);
+    Logger logger(ScratchDirectory().wstring());
+    logger.Initialize();
+    std::vector<AudioEvent> logged;
+    AudioEvent event;
+    std::mt19937 random(5);
+    auto time = std::chrono::system_clock::now() - std::chrono::hours(2);
+    std::string error;
+
+    for (size_t i = 0; i < 20000 && error.empty(); ++i) {
+        time += std::chrono::seconds(random() % 30);
+        DWORD processId = static_cast<DWORD>(random() % 40);
+        float volume = (random() % 100) / 100.0f;
+        float peak = (random() % 100) / 100.0f;
+        std::string sessionName(random() % 24, 's');
+        enricher.Enrich(processId, volume, peak, sessionName, time, event);
+        if (!SameEvent(event, enricher.Enrich(processId, volume, peak, sessionName, time))) {
+            error = "sample " + std::to_string(i) + " enriched into a reused event differs";
+        }
+        reference.Add(event);
+        if (store.Add(event)) {
+            logger.LogEvent(event);
+            logged.push_back(event);
+        }
+    }
+    logger.Close();
+    std::wstring logPath = logger.GetCurrentLogPath();
+
+    if (error.empty()) {
+        EventDelta kept = store.ReadSince(0);
+        EventDelta all = reference.ReadSince(kept.firstSequence);
+        if (kept.events.size() != all.events.size() || kept.nextSequence != all.nextSequence) {
+            error = "store kept " + std::to_string(kept.events.size()) + " events, expected " +
+                    std::to_string(all.events.size());
+        }
+        for (size_t i = 0; i < kept.events.size() && error.empty(); ++i) {
+            if (!SameEvent(kept.events[i], all.events[i])) {
+                error = "recycled event " + std::to_string(kept.firstSequence + i) + " differs";
+            }
+        }
+    }
+    if (error.empty()) {
+        CsvReader reader(1);
+        std::vector<AudioEvent> parsed;
+        if (!reader.ReadFile(logPath, parsed)) {
+            error = "log did not read back";
+        } else {
+            error = CheckCsvRows(logged, parsed);
+        }
+    }
+    std::error_code ec;
+    std::filesystem::remove(std::filesystem::path(logPath), ec);
+    return error;
+}
+
+// The whole per-sample path of SoundTracker::AddAudioEvent: enrich into a
+// reused event, store, and log new events. arg as for AddAudioEvent.
+void Pipeline(BenchmarkState& state) {
+    FakeProcessInfo info;
+    EventEnricher enricher(info);
+    EventStore store(32 * 1024);
+    Logger logger(ScratchDirectory().wstring());
+    logger.Initialize();
+    AudioEvent event;
+    const std::string sessionName("Speakers");
+    DWORD processes = static_cast<DWORD>(state.GetArg());
+    auto time = std::chrono::system_clock::now();
+    uint64_t samples = 0;
+    auto sample = [&]() {
+        DWORD processId = 1 + static_cast<DWORD>(samples++ % processes);
+        enricher.Enrich(processId, 0.5f, 0.25f, sessionName, time, event);
+        if (store.Add(event)) {
+            logger.LogEvent(event);
+        }
+    };
+
+    for (uint64_t i = 0; i < 20000; ++i) {
+        sample();
+    }
+    state.ExpectNoAllocations();
+    state.Start();
+    for (uint64_t i = 0; i < state.GetIterations(); ++i) {
+        sample();
+    }
+    state.Stop();
+
+    logger.Close();
+    std::error_code ec;
+    std::filesystem::remove(std::filesystem::path(logger.GetCurrentLogPath()), ec);
+
+    static const std::string error = CheckBufferReuse();
+    if (!error.empty()) {
+        state.Fail("buffer reuse: " + error);
+    }
+}
+
+// Batching alone on pre-built events; arg as for AddAudioEvent
+void EventStoreAdd(BenchmarkState& state) {
+    auto events = MakeEvents(1024);
+    for (size_t i = 0; i < events.size(); ++i) {
+        events[i].processId = 1 + static_cast<DWORD>(i % state.GetArg());
+        events[i].timestamp = events[0].timestamp;
+    }
+    EventStore store;
+
+    state.Start();
+    for (uint64_t i = 0; i < state.GetIterations(); ++i) {
+        store.Add(events[i % events.size()]);
+    }
+    state.Stop();
+}
+
+// Range query over a full store of 100k events; arg is the events in range.
+// Unless sealed, every event stays uncompressed; sealed is the default,
+// where all but the newest one or two thousand are compressed chunks.
+void GetEvents(BenchmarkState& state, bool sealed) {
+    const size_t storeSize = 100000;
+    auto events = MakeEvents(storeSize);
+    EventStore store(SIZE_MAX);
+    store.SetSealing(sealed);
+    FillStore(store, events);
+    size_t inRange = static_cast<size_t>(state.GetArg());
+    auto start = events[storeSize - inRange].timestamp;
+    auto end = events.back().timestamp;
+    state.SetItemsPerIteration(inRange);
+
+    size_t total = 0;
+    state.Start();
+    for (uint64_t i = 0; i < state.GetIterations(); ++i) {
+        total += store.GetEvents(start, end).size();
+    }
+    state.Stop();
+    if (total != state.GetIterations() * inRange) {
+        state.Fail("GetEvents returned " + std::to_string(total) + " events");
+    }
+}
+
+// Compresses one chunk of events per iteration; the label gives the ratio
+// against AudioEventBytes
+void EventChunkEncode(BenchmarkState& state) {
+    auto events = MakeEvents(EventStore::CHUNK_EVENTS);
+    size_t encoded = 0;
+    state.SetItemsPerIteration(events.size());
+
+    state.Start();
+    for (uint64_t i = 0; i < state.GetIterations(); ++i) {
+        encoded = EventChunk::Encode(events.data(), events.size()).GetMemoryUsage();
+    }
+    state.Stop();
+
+    size_t uncompressed = 0;
+    for (const auto& event : events) {
+        uncompressed += AudioEventBytes(event);
+    }
+    char label[96];
+    std::snprintf(label, sizeof(label), "%.1f bytes/event encoded, %.1fx smaller",
+                  static_cast<double>(encoded) / events.size(), static_cast<double>(uncompressed) / encoded);
+    state.SetLabel(label);
+}
+
+// Decodes one whole chunk per iteration, as a range scan over sealed
+// events does; compare EventChunk.Copy for the same scan uncompressed
+void EventChunkDecode(BenchmarkState& state) {
+    auto events = MakeEvents(EventStore::CHUNK_EVENTS);
+    EventChunk chunk = EventChunk::Encode(events.data(), events.size());
+    auto start = events.front().timestamp;
+    auto end = events.back().timestamp;
+    state.SetItemsPerIteration(events.size());
+
+    size_t total = 0;
+    state.Start();
+    for (uint64_t i = 0; i < state.GetIterations(); ++i) {
+        std::vector<AudioEvent> out;
+        chunk.Decode(start, end, out);
+        total += out.size();
+    }
+    state.Stop();
+    if (total != state.GetIterations() * events.size()) {
+        state.Fail("EventChunk::Decode returned " + std::to_string(total) + " events");
+    }
+}
+
+void EventChunkCopy(BenchmarkState& state) {
+    auto events = MakeEvents(EventStore::CHUNK_EVENTS);
+    auto start = events.front().timestamp;
+    auto end = events.back().timestamp;
+    state.SetItemsPerIteration(events.size());
+
+    size_t total = 0;
+    state.Start();
+    for (uint64_t i = 0; i < state.GetIterations(); ++i) {
+        std::vector<AudioEvent> out;
+        for (const auto& event : events) {
+            if (event.timestamp >= start && event.timestamp <= end) {
+                out.push_back(event);
+            }
+        }
+        total += out.size();
+    }
+    state.Stop();
+    if (total != state.GetIterations() * events.size()) {
+        state.Fail("Copy returned " + std::to_string(total) + " events");
+    }
+}
+
+// count polls of one session every 20 ms, with a millisecond of jitter now
+// and then: mostly silence, with chimes that decay over half a second and
+// the odd volume change
+std::vector<LevelSample> MakeLevelSamples(size_t count) {
+    std::mt19937 random(42);
+    auto time = std::chrono::system_clock::now() - std::chrono::hours(1);
+    std::vector<LevelSample> samples;
+    samples.reserve(count);
+    float volume = 0.8f;
+    size_t chimeStart = 0;
+    bool chiming = false;
+    for (size_t i = 0; i < count; ++i) {
+        time += std::chrono::milliseconds(random() % 10 == 0 ? 19 + random() % 3 : 20);
+        if (random() % 2000 == 0) {
+            volume = (random() % 100) / 100.0f;
+        }
+        if (!chiming && random() % 100 == 0) {
+            chiming = true;
+            chimeStart = i;
+        }
+        float peak = 0.0f;
+        if (chiming) {
+            float age = static_cast<float>(i - chimeStart) * 0.02f;
+            peak = 0.9f * std::exp(-6.0f * age) * (0.9f + (random() % 1000) / 5000.0f);
+            chiming = age < 0.5f;
+        }
+        samples.push_back({ time, volume, peak });
+    }
+    return samples;
+}
+
+// Appends synthetic polls; the label gives the memory per sample against
+// the 16 bytes of a LevelSample
+void LevelSeriesAppend(BenchmarkState& state) {
+    auto samples = MakeLevelSamples(100000);
+    size_t bytes = 0;
+    state.SetItemsPerIteration(samples.size());
+
+    state.Start();
+    for (uint64_t i = 0; i < state.GetIterations(); ++i) {
+        LevelSeries series;
+        for (const auto& sample : samples) {
+            series.Append(sample.time, sample.volume, sample.peak);
+        }
+        bytes = series.GetMemoryUsage();
+    }
+    state.Stop();
+
+    double perSample = static_cast<double>(bytes) / static_cast<double>(samples.size());
+    char label[64];
+    std::snprintf(label, sizeof(label), "%.2f bytes/sample, %.1fx smaller", perSample,
+                  sizeof(LevelSample) / perSample);
+    state.SetLabel(label);
+}
+
+// Decodes the whole series; arg > 0 downsamples into that many buckets
+void LevelSeriesRead(BenchmarkState& state) {
+    auto samples = MakeLevelSamples(100000);
+    LevelSeries series;
+    for (const auto& sample : samples) {
+        series.Append(sample.time, sample.volume, sample.peak);
+    }
+    // Samples are kept to the millisecond
+    auto start = samples.front().time - std::chrono::milliseconds(1);
+    auto end = samples.back().time + std::chrono::milliseconds(1);
+    size_t buckets = static_cast<size_t>(state.GetArg());
+    state.SetItemsPerIteration(samples.size());
+
+    std::vector<LevelSample> out;
+    std::vector<LevelBucket> bucketsOut;
+    size_t total = 0;
+    state.Start();
+    for (uint64_t i = 0; i < state.GetIterations(); ++i) {
+        if (buckets == 0) {
+            out.clear();
+            series.Read(start, end, out);
+            total += out.size();
+        } else {
+            bucketsOut.clear();
+            series.ReadDownsampled(start, end, buckets, bucketsOut);
+            for (const auto& bucket : bucketsOut) {
+                total += bucket.samples;
+            }
+        }
+    }
+    state.Stop();
+    if (total != state.GetIterations() * samples.size()) {
+        state.Fail("LevelSeries read " + std::to_string(total) + " samples");
+    }
+}
+
+const uint32_t FIXTURE_RATE = 48000;
+
+// Ten seconds of a synthetic WAV fixture, written to disk and read back the
+// way a recorded one would be: 0 = a notification chime, 1 = noise bursts,
+// 2 = music (chords over a beat)
+std::vector<float> LoadFixture(int fixture) {
+    const double PI = 3.14159265358979323846;
+    std::vector<float> samples(FIXTURE_RATE * 10);
+    std::mt19937 random(7);
+    std::normal_distribution<float> noise(0.0f, 1.0f);
+    for (size_t i = 0; i < samples.size(); ++i) {
+        double t = static_cast<double>(i) / FIXTURE_RATE;
+        double value = 0.0;
+        if (fixture == 0) {
+            double since = std::fmod(t, 1.5);  // A two-note chime every 1.5 s
+            double note = since < 0.15 ? 880.0 : 1318.5;
+            for (int harmonic = 1; harmonic <= 3; ++harmonic) {
+                value += std::sin(2 * PI * note * harmonic * since) * std::exp(-4.0 * since) / harmonic;
+            }
+            value *= 0.4;
+        } else if (fixture == 1) {
+            value = std::fmod(t, 0.5) < 0.2 ? 0.2 * noise(random) : 0.0;
+        } else {
+            static const double CHORDS[4][3] = {
+                { 261.6, 329.6, 392.0 }, { 220.0, 261.6, 329.6 }, { 174.6, 220.0, 261.6 }, { 196.0, 246.9, 293.7 }
+            };
+            const double* chord = CHORDS[static_cast<size_t>(t / 2.0) % 4];
+            for (int note = 0; note < 3; ++note) {
+                value += 0.15 * std::sin(2 * PI * chord[note] * t * (1.0 + 0.002 * std::sin(2 * PI * 5 * t)));
+            }
+            double beat = std::fmod(t, 0.5);
+            value += 0.3 * noise(random) * std::exp(-40.0 * beat);
+        }
+        samples[i] = static_cast<float>(value);
+    }
+
+    std::filesystem::path path = ScratchDirectory() / ("fixture_" + std::to_string(fixture) + ".wav");
+    std::vector<float> loaded;
+    uint32_t sampleRate = 0;
+    if (!WriteWavFile(path.wstring(), samples.data(), samples.size(), FIXTURE_RATE) ||
+        !ReadWavFile(path.wstring(), loaded, sampleRate) || sampleRate != FIXTURE_RATE) {
+        std::fprintf(stderr, "Failed to round-trip %s\n", path.string().c_str());
+    }
+    return loaded;
+}
+
+// Known signals with known answers. A 1500 Hz sine falls exactly on bin 32
+// of a 48 kHz frame, so its RMS, zero crossings and centroid are exact.
+// The spectrum must match a double-precision DFT of the windowed frame,
+// scaling the signal may move only the first MFCC, a steady tone has no
+// flux while a jump to another tone has plenty, white noise sits near
+// half-Nyquist, and features cannot depend on how samples are packetized.
+std::string CheckSpectralFeatures() {
+    const double PI = 3.14159265358979323846;
+    const size_t N = SpectralAnalyzer::FRAME_SIZE;
+    char error[160];
+    auto tone = [&](double hz, double amplitude, size_t count) {
+        std::vector<float> samples(count);
+        for (size_t i = 0; i < count; ++i) {
+            samples[i] = static_cast<float>(amplitude * std::sin(2 * PI * hz * i / FIXTURE_RATE));
+        }
+        return samples;
+    };
+    auto analyze = [](const std::vector<float>& samples, size_t packet) {
+        SpectralAnalyzer analyzer(FIXTURE_RATE);
+        std::vector<SoundFeatures> frames;
+        for (size_t at = 0; at < samples.size(); at += packet) {
+            analyzer.Push(&samples[at], (std::min)(packet, samples.size() - at), frames);
+        }
+        return frames;
+    };
+
+    auto sine = analyze(tone(1500.0, 0.5, 8 * N), 480);
+    for (size_t i = 1; i < sine.size(); ++i) {
+        const SoundFeatures& f = sine[i];
+        if (std::fabs(f.rms - 0.5f / std::sqrt(2.0f)) > 1e-3f || std::fabs(f.zeroCrossingRate - 64.0f / (N - 1)) > 1.5f / (N - 1) ||
+            std::fabs(f.centroidHz - 1500.0f) > 15.0f || f.flux > 1e-3f) {
+            std::snprintf(error, sizeof(error), "1500 Hz sine frame %zu: rms %.4f zcr %.4f centroid %.1f flux %.4f", i,
+                          f.rms, f.zeroCrossingRate, f.centroidHz, f.flux);
+            return error;
+        }
+    }
+
+    std::mt19937 random(3);
+    std::normal_distribution<float> gaussian(0.0f, 0.1f);
+    std::vector<float> noise(16 * N);
+    for (auto& sample : noise) {
+        sample = gaussian(random);
+    }
+    SpectralAnalyzer analyzer(FIXTURE_RATE);
+    const std::vector<float>& spectrum = analyzer.ComputeSpectrum(noise.data());
+    double worst = 0.0, largest = 0.0;
+    for (size_t k = 0; k <= N / 2; ++k) {
+        double re = 0.0, im = 0.0;
+        for (size_t i = 0; i < N; ++i) {
+            double windowed = noise[i] * (0.5 - 0.5 * std::cos(2 * PI * i / N));
+            re += windowed * std::cos(2 * PI * k * i / N);
+            im -= windowed * std::sin(2 * PI * k * i / N);
+        }
+        double expected = 4.0 / N * std::sqrt(re * re + im * im);
+        worst = (std::max)(worst, std::fabs(spectrum[k] - expected));
+        largest = (std::max)(largest, expected);
+    }
+    if (worst > 1e-4 * largest) {
+        std::snprintf(error, sizeof(error), "spectrum differs from a DFT by %.2g of its peak", worst / largest);
+        return error;
+    }
+
+    auto white = analyze(noise, N);
+    double centroid = 0.0, zcr = 0.0;
+    for (const auto& f : white) {
+        centroid += f.centroidHz / white.size();
+        zcr += f.zeroCrossingRate / white.size();
+    }
+    if (std::fabs(centroid - FIXTURE_RATE / 4.0) > 0.05 * FIXTURE_RATE / 4.0 || std::fabs(zcr - 0.5) > 0.03) {
+        std::snprintf(error, sizeof(error), "white noise: centroid %.0f Hz, zcr %.3f", centroid, zcr);
+        return error;
+    }
+
+    std::vector<float> louder(noise);
+    for (auto& sample : louder) {
+        sample *= 4.0f;
+    }
+    auto scaled = analyze(louder, N);
+    float shift = static_cast<float>(2.0 * std::log(4.0) * std::sqrt(static_cast<double>(SpectralAnalyzer::MEL_BANDS)));
+    for (size_t i = 0; i < white.size(); ++i) {
+        if (std::fabs(scaled[i].mfcc[0] - white[i].mfcc[0] - shift) > 1e-2f) {
+            return "scaling the signal moved mfcc[0] by the wrong amount";
+        }
+        for (size_t c = 1; c < SoundFeatures::MFCC_COUNT; ++c) {
+            if (std::fabs(scaled[i].mfcc[c] - white[i].mfcc[c]) > 1e-2f) {
+                return "scaling the signal moved mfcc[" + std::to_string(c) + "]";
+            }
+        }
+    }
+
+    auto packeted = analyze(noise, 37);
+    if (packeted.size() != white.size()) {
+        return "37-sample packets gave " + std::to_string(packeted.size()) + " frames, whole frames " +
+               std::to_string(white.size());
+    }
+    for (size_t i = 0; i < white.size(); ++i) {
+        if (std::memcmp(&packeted[i], &white[i], sizeof(SoundFeatures)) != 0) {
+            return "frame " + std::to_string(i) + " depends on packet size";
+        }
+    }
+
+    std::vector<float> jump = tone(1500.0, 0.5, 4 * N);
+    std::vector<float> high = tone(6000.0, 0.5, 4 * N);
+    jump.insert(jump.end(), high.begin(), high.end());
+    float peakFlux = 0.0f;
+    for (const auto& f : analyze(jump, N)) {
+        peakFlux = (std::max)(peakFlux, f.flux);
+    }
+    if (peakFlux < 0.3f) {
+        std::snprintf(error, sizeof(error), "a 1.5 to 6 kHz jump peaked at flux %.3f", peakFlux);
+        return error;
+    }
+    return "";
+}
+
+// Features for a WAV fixture fed in 10 ms packets, as loopback capture
+// delivers them; results are per sample and the label is the share of one
+// core a 48 kHz stream costs
+void SpectralAnalyzerPush(BenchmarkState& state) {
+    std::vector<float> samples = LoadFixture(static_cast<int>(state.GetArg()));
+    const size_t PACKET = FIXTURE_RATE / 100;
+    SpectralAnalyzer analyzer(FIXTURE_RATE);
+    std::vector<SoundFeatures> frames;
+    frames.reserve(PACKET / SpectralAnalyzer::HOP_SIZE + 1);
+    auto stream = [&]() {
+        for (size_t at = 0; at + PACKET <= samples.size(); at += PACKET) {
+            frames.clear();
+            analyzer.Push(&samples[at], PACKET, frames);
+        }
+    };
+    stream();
+    state.SetItemsPerIteration(samples.size() / PACKET * PACKET);
+
+    state.ExpectNoAllocations();
+    state.Start();
+    for (uint64_t i = 0; i < state.GetIterations(); ++i) {
+        stream();
+    }
+    state.Stop();
+
+    double seconds = std::chrono::duration<double>(state.GetElapsed()).count();
+    double audioSeconds = static_cast<double>(state.GetIterations()) * (samples.size() / PACKET * PACKET) /
+                          FIXTURE_RATE;
+    char label[64];
+    std::snprintf(label, sizeof(label), "%.3f%% of a core per 48 kHz stream", 100.0 * seconds / audioSeconds);
+    state.SetLabel(label);
+
+    static const std::string error = CheckSpectralFeatures();
+    if (!error.empty()) {
+        state.Fail(error);
+    }
+}
+
+// A short notification-like sound, different for every id: two to four
+// decaying, slightly gliding notes with an overtone
+std::vector<float> MakeKnownSound(uint32_t id, uint32_t sampleRate) {
+    const double PI = 3.14159265358979323846;
+    std::mt19937 random(id * 77 + 1);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    int notes = 2 + id % 3;
+    double length = 0.25 + 0.1 * (id % 4);
+    std::vector<float> samples(static_cast<size_t>((length * notes * 0.6 + 0.1) * sampleRate));
+    for (int note = 0; note < notes; ++note) {
+        double frequency = 400.0 + uniform(random) * 3000.0;
+        double glide = (uniform(random) - 0.5) * 800.0;
+        double start = note * length * 0.6;
+        for (size_t i = static_cast<size_t>(start * sampleRate); i < samples.size(); ++i) {
+            double t = static_cast<double>(i) / sampleRate - start;
+            if (t > length) {
+                break;
+            }
+            double f = frequency + glide * t;
+            samples[i] += static_cast<float>(0.3 * std::sin(2 * PI * f * t) * std::exp(-5.0 * t) +
+                                             0.1 * std::sin(4 * PI * f * t) * std::exp(-8.0 * t));
+        }
+    }
+    return samples;
+}
+
+// Indexes arg synthetic sounds; results are per sound
+void FingerprintBuild(BenchmarkState& state) {
+    uint32_t count = static_cast<uint32_t>(state.GetArg());
+    std::vector<std::vector<float>> sounds;
+    for (uint32_t id = 0; id < count; ++id) {
+        sounds.push_back(MakeKnownSound(id, FIXTURE_RATE));
+    }
+    state.SetItemsPerIteration(count);
+
+    size_t hashes = 0;
+    state.Start();
+    for (uint64_t i = 0; i < state.GetIterations(); ++i) {
+        FingerprintIndex index;
+        for (uint32_t id = 0; id < count; ++id) {
+            index.AddSound("sound" + std::to_string(id), sounds[id].data(), sounds[id].size(), FIXTURE_RATE);
+        }
+        hashes = index.GetHashCount();
+    }
+    state.Stop();
+
+    char label[64];
+    std::snprintf(label, sizeof(label), "%.0f hashes/sound", static_cast<double>(hashes) / count);
+    state.SetLabel(label);
+}
+
+// Matches 1.5 s snippets of the music WAV fixture, each with one of arg
+// known sounds mixed in, resampled from 44.1 kHz; results are per snippet
+void FingerprintQuery(BenchmarkState& state) {
+    const uint32_t SNIPPET_RATE = 44100;
+    const size_t QUERIES = 20;
+    uint32_t count = static_cast<uint32_t>(state.GetArg());
+    FingerprintIndex index;
+    for (uint32_t id = 0; id < count; ++id) {
+        std::vector<float> sound = MakeKnownSound(id, FIXTURE_RATE);
+        index.AddSound("sound" + std::to_string(id), sound.data(), sound.size(), FIXTURE_RATE);
+    }
+
+    // The fixture is 48 kHz; dropping samples is close enough for a background
+    std::vector<float> music = LoadFixture(2);
+    std::vector<std::vector<float>> snippets(QUERIES);
+    std::vector<uint32_t> expected(QUERIES);
+    for (size_t q = 0; q < QUERIES; ++q) {
+        std::vector<float>& snippet = snippets[q];
+        snippet.resize(SNIPPET_RATE * 3 / 2);
+        size_t offset = q * FIXTURE_RATE / 4;
+        for (size_t i = 0; i < snippet.size(); ++i) {
+            snippet[i] = 0.5f * music[(offset + i * FIXTURE_RATE / SNIPPET_RATE) % music.size()];
+        }
+        expected[q] = static_cast<uint32_t>(q * count / QUERIES);
+        std::vector<float> sound = MakeKnownSound(expected[q], SNIPPET_RATE);
+        for (size_t i = 0; i < sound.size() && SNIPPET_RATE / 3 + i < snippet.size(); ++i) {
+            snippet[SNIPPET_RATE / 3 + i] += 0.5f * sound[i];
+        }
+    }
+    state.SetItemsPerIteration(QUERIES);
+
+    size_t recognized = 0;
+    FingerprintMatch match;
+    state.Start();
+    for (uint64_t i = 0; i < state.GetIterations(); ++i) {
+        recognized = 0;
+        for (size_t q = 0; q < QUERIES; ++q) {
+            if (index.Match(snippets[q].data(), snippets[q].size(), SNIPPET_RATE, match) &&
+                match.soundId == expected[q]) {
+                ++recognized;
+            }
+        }
+    }
+    state.Stop();
+
+    char label[64];
+    std::snprintf(label, sizeof(label), "%zu/%zu recognized", recognized, QUERIES);
+    state.SetLabel(label);
+}
+
+// Clicks of three levels over quiet noise, pushed in packets of random
+// size. Gaps are random but long enough for the envelope of a loud click to
+// release before a quiet one. Every click must be found within a
+// millisecond of its first sample, and nothing else may be.
+std::string CheckOnsetClicks() {
+    const double PI = 3.14159265358979323846;
+    std::mt19937 random(13);
+    std::normal_distribution<float> noise(0.0f, 0.0002f);
+    std::vector<float> samples(FIXTURE_RATE * 60);
+    for (float& sample : samples) {
+        sample = noise(random);
+    }
+    static const float LEVELS[] = { 0.5f, 0.1f, 0.02f };
+    std::vector<uint64_t> clicks;
+    for (uint64_t at = FIXTURE_RATE / 10; at + FIXTURE_RATE / 2 < samples.size();
+         at += FIXTURE_RATE * (250 + random() % 350) / 1000) {
+        float level = LEVELS[clicks.size() % 3];
+        for (size_t i = 0; i < FIXTURE_RATE / 200; ++i) {
+            samples[at + i] += static_cast<float>(level * std::exp(-static_cast<double>(i) / 48.0) *
+                                                  std::cos(2 * PI * 2000.0 * i / FIXTURE_RATE));
+        }
+        clicks.push_back(at);
+    }
+
+    OnsetDetector detector(FIXTURE_RATE);
+    std::vector<uint64_t> onsets;
+    for (size_t at = 0; at < samples.size();) {
+        size_t packet = (std::min)(static_cast<size_t>(1 + random() % 1500), samples.size() - at);
+        detector.Push(&samples[at], packet, onsets);
+        at += packet;
+    }
+
+    const uint64_t tolerance = FIXTURE_RATE / 1000;
+    if (onsets.size() != clicks.size()) {
+        return std::to_string(onsets.size()) + " onsets for " + std::to_string(clicks.size()) + " clicks";
+    }
+    for (size_t n = 0; n < clicks.size(); ++n) {
+        uint64_t error = onsets[n] > clicks[n] ? onsets[n] - clicks[n] : clicks[n] - onsets[n];
+        if (error > tolerance) {
+            char text[96];
+            std::snprintf(text, sizeof(text), "click %zu at level %.2f found %.2f ms off", n, LEVELS[n % 3],
+                          error * 1000.0 / FIXTURE_RATE);
+            return text;
+        }
+    }
+    return "";
+}
+
+// Known sounds at labeled positions over quiet noise (arg 0) or the music
+// WAV fixture (arg 1), fed in 10 ms packets; results are per sample and the
+// label is how many labeled onsets were found within 20 ms and how far off
+void OnsetDetectorPush(BenchmarkState& state) {
+    const size_t PACKET = FIXTURE_RATE / 100;
+    const size_t SOUNDS = 6;
+    std::vector<float> samples = LoadFixture(2);
+    std::mt19937 random(11);
+    std::normal_distribution<float> noise(0.0f, 1.0f);
+    for (float& sample : samples) {
+        sample = state.GetArg() == 0 ? 0.001f * noise(random) : 0.2f * sample;
+    }
+    std::vector<uint64_t> labeled;
+    for (size_t n = 0; n < SOUNDS; ++n) {
+        // Apart, off the beat and away from packet and hop boundaries
+        uint64_t at = FIXTURE_RATE / 4 + n * FIXTURE_RATE * 8 / 5 + n * 37;
+        std::vector<float> sound = MakeKnownSound(static_cast<uint32_t>(n), FIXTURE_RATE);
+        for (size_t i = 0; i < sound.size() && at + i < samples.size(); ++i) {
+            samples[at + i] += 1.5f * sound[i];
+        }
+        labeled.push_back(at);
+    }
+
+    OnsetDetector detector(FIXTURE_RATE);
+    std::vector<uint64_t> onsets;
+    onsets.reserve(samples.size() / (FIXTURE_RATE * OnsetDetector::MIN_GAP_MS / 1000) + 1);
+    auto stream = [&]() {
+        detector.Reset();
+        onsets.clear();
+        for (size_t at = 0; at + PACKET <= samples.size(); at += PACKET) {
+            detector.Push(&samples[at], PACKET, onsets);
+        }
+    };
+    stream();
+    state.SetItemsPerIteration(samples.size() / PACKET * PACKET);
+
+    state.ExpectNoAllocations();
+    state.Start();
+    for (uint64_t i = 0; i < state.GetIterations(); ++i) {
+        stream();
+    }
+    state.Stop();
+
+    size_t found = 0;
+    double totalError = 0.0;
+    double maxError = 0.0;
+    for (uint64_t at : labeled) {
+        double best = 1e9;
+        for (uint64_t onset : onsets) {
+            double error = std::fabs(static_cast<double>(onset) - static_cast<double>(at)) * 1000.0 / FIXTURE_RATE;
+            best = error < best ? error : best;
+        }
+        if (best <= 20.0) {
+            ++found;
+            totalError += best;
+            maxError = best > maxError ? best : maxError;
+        }
+    }
+    char label[96];
+    std::snprintf(label, sizeof(label), "%zu/%zu onsets, error mean %.2f ms max %.2f ms, %zu others", found,
+                  labeled.size(), found ? totalError / found : 0.0, maxError, onsets.size() - found);
+    state.SetLabel(label);
+
+    static const std::string error = CheckOnsetClicks();
+    if (found != labeled.size() || maxError > 1.0) {
+        state.Fail("labeled sounds: " + std::string(label));
+    } else if (!error.empty()) {
+        state.Fail("clicks: " + error);
+    }
+}
+
+struct LoudnessCase {
+    uint32_t channels;
+    std::vector<std::pair<double, std::vector<double>>> segments;  // Seconds, then dBFS per channel
+    double integrated;  // Expected LUFS, or 0 if the case does not give one
+    double range;       // Expected LU, or -1 if the case does not give one
+    double steady;      // Expected momentary and short-term LUFS at the end, or 0
+};
+
+// EBU Tech 3341 (cases 1-4 and 6) and Tech 3342 (cases 1-4), built from
+// 1 kHz sines, at 48 kHz, plus the BS.1770 reference: a full-scale 1 kHz
+// sine in one channel reads -3.01 LUFS. Returns how many land within the
+// tolerances, 0.1 LU for integrated, momentary and short-term loudness and
+// 1 LU for range, and describes each miss in failures.
+size_t LoudnessConformance(size_t& cases, std::string& failures) {
+    const double PI = 3.14159265358979323846;
+    const double SILENT = -1000.0;
+    const std::vector<double> s20 = { -20, -20 }, s23 = { -23, -23 }, s36 = { -36, -36 };
+    const LoudnessCase CASES[] = {
+        { 2, { { 20, s23 } }, -23, -1, -23 },
+        { 2, { { 20, { -33, -33 } } }, -33, -1, -33 },
+        { 2, { { 10, s36 }, { 60, s23 }, { 10, s36 } }, -23, -1, -36 },
+        { 2, { { 10, { -72, -72 } }, { 10, s36 }, { 60, s23 }, { 10, s36 }, { 10, { -72, -72 } } }, -23, -1, 0 },
+        { 6, { { 20, { -28, -28, -24, SILENT, -30, -30 } } }, -23, -1, -23 },
+        { 2, { { 20, s20 }, { 20, { -30, -30 } } }, 0, 10, -30 },
+        { 2, { { 20, s20 }, { 20, { -15, -15 } } }, 0, 5, -15 },
+        { 2, { { 20, { -40, -40 } }, { 20, s20 } }, 0, 20, -20 },
+        { 2, { { 20, { -50, -50 } }, { 20, { -35, -35 } }, { 20, s20 }, { 20, { -35, -35 } },
+               { 20, { -50, -50 } } }, 0, 15, -50 },
+        { 2, { { 20, { 0, SILENT } } }, -3.01, -1, -3.01 },
+    };
+    cases = sizeof(CASES) / sizeof(CASES[0]);
+    size_t passed = 0;
+    std::vector<float> samples;
+    for (const LoudnessCase& test : CASES) {
+        LoudnessMeter meter(FIXTURE_RATE, test.channels);
+        size_t position = 0;
+        for (const auto& segment : test.segments) {
+            size_t frames = static_cast<size_t>(segment.first * FIXTURE_RATE);
+            samples.assign(frames * test.channels, 0.0f);
+            for (size_t i = 0; i < frames; ++i) {
+                double sine = std::sin(2 * PI * 1000.0 * static_cast<double>(position + i) / FIXTURE_RATE);
+                for (uint32_t c = 0; c < test.channels; ++c) {
+                    samples[i * test.channels + c] = static_cast<float>(std::pow(10.0, segment.second[c] / 20.0) * sine);
+                }
+            }
+            meter.Push(samples.data(), frames);
+            position += frames;
+        }
+        double integrated = meter.GetStats().GetIntegrated();
+        double range = meter.GetStats().GetRange();
+        bool integratedOk = test.integrated == 0 || std::fabs(integrated - test.integrated) <= 0.1;
+        bool rangeOk = test.range < 0 || std::fabs(range - test.range) <= 1.0;
+        bool steadyOk = test.steady == 0 || (std::fabs(meter.GetMomentary() - test.steady) <= 0.1 &&
+                                             std::fabs(meter.GetShortTerm() - test.steady) <= 0.1);
+        if (integratedOk && rangeOk && steadyOk) {
+            ++passed;
+        } else {
+            char miss[160];
+            std::snprintf(miss, sizeof(miss), "%scase %zu: I %.2f LUFS, LRA %.2f LU, M %.2f, S %.2f",
+                          failures.empty() ? "" : "; ", static_cast<size_t>(&test - CASES) + 1, integrated,
+                          range, meter.GetMomentary(), meter.GetShortTerm());
+            failures += miss;
+        }
+    }
+    return passed;
+}
+
+// The K-weighting cascade and steps over the music WAV fixture copied to
+// arg channels, in 10 ms packets; results are per frame and the label is
+// the share of one core a 48 kHz stream costs and the conformance cases met
+void LoudnessMeterPush(BenchmarkState& state) {
+    uint32_t channels = static_cast<uint32_t>(state.GetArg());
+    std::vector<float> music = LoadFixture(2);
+    const size_t PACKET = FIXTURE_RATE / 100;
+    size_t frames = music.size() / PACKET * PACKET;
+    std::vector<float> samples(frames * channels);
+    for (size_t i = 0; i < frames; ++i) {
+        for (uint32_t c = 0; c < channels; ++c) {
+            samples[i * channels + c] = music[i];
+        }
+    }
+    LoudnessMeter meter(FIXTURE_RATE, channels);
+    auto stream = [&]() {
+        for (size_t at = 0; at < frames; at += PACKET) {
+            meter.Push(&samples[at * channels], PACKET);
+        }
+    };
+    stream();
+    state.SetItemsPerIteration(frames);
+
+    state.ExpectNoAllocations();
+    state.Start();
+    for (uint64_t i = 0; i < state.GetIterations(); ++i) {
+        stream();
+    }
+    state.Stop();
+
+    static size_t cases = 0;
+    static std::string failures;
+    static const size_t passed = LoudnessConformance(cases, failures);
+    double seconds = std::chrono::duration<double>(state.GetElapsed()).count();
+    double audioSeconds = static_cast<double>(state.GetIterations()) * frames / FIXTURE_RATE;
+    char label[96];
+    std::snprintf(label, sizeof(label), "%.3f%% of a core per 48 kHz stream, %zu/%zu conformance cases",
+                  100.0 * seconds / audioSeconds, passed, cases);
+    state.SetLabel(label);
+    if (passed != cases) {
+        state.Fail(failures);
+    }
+}
+
+// A volume slider dragged in 16 processes at once: each fires a burst of
+// callbacks (arg) between polls, and the window then closes. Results are
+// per callback; the label is how many reach the pipeline.
+void SessionCoalescerObserve(BenchmarkState& state) {
+    const DWORD PROCESSES = 16;
+    const uint32_t perBurst = static_cast<uint32_t>(state.GetArg());
+    SessionCoalescer coalescer;
+    std::vector<SessionBurst> bursts;
+    bursts.reserve(PROCESSES);
+    auto captured = TimestampClock::Capture();
+    auto window = [&]() {
+        for (uint32_t n = 0; n < perBurst; ++n) {
+            for (DWORD process = 1; process <= PROCESSES; ++process) {
+                coalescer.Observe(process * 4, 1, true, 0.01f * static_cast<float>(n % 100), 0.5f,
+                                  n == 0 ? TraceSource::Poll : TraceSource::VolumeChanged, captured);
+            }
+        }
+        bursts.clear();
+        coalescer.Drain(std::chrono::steady_clock::time_point::max(), bursts);
+    };
+    window();
+    state.SetItemsPerIteration(PROCESSES * perBurst);
+
+    state.ExpectNoAllocations();
+    state.Start();
+    for (uint64_t i = 0; i < state.GetIterations(); ++i) {
+        window();
+    }
+    state.Stop();
+
+    char label[64];
+    std::snprintf(label, sizeof(label), "%llu raw, %llu delivered",
+                  static_cast<unsigned long long>(coalescer.GetObservedCount()),
+                  static_cast<unsigned long long>(coalescer.GetDeliveredCount()));
+    state.SetLabel(label);
+
+    // Muting within a window must stick, and a state callback after it
+    // must not bring back the volume from before
+    SessionCoalescer check;
+    check.Observe(7, 0, true, 0.8f, 0.3f, TraceSource::Poll, captured);
+    check.Observe(7, 0, true, 0.0f, 0.0f, TraceSource::VolumeChanged, captured);
+    check.Observe(7, 0, false, 0.0f, 0.0f, TraceSource::StateChanged, captured);
+    check.Observe(9, 0, false, 0.0f, 0.0f, TraceSource::StateChanged, captured);
+    check.Observe(9, 0, true, 0.4f, 0.0f, TraceSource::VolumeChanged, captured);
+    bursts.clear();
+    check.Drain(std::chrono::steady_clock::time_point::max(), bursts);
+    if (bursts.size() != 2 || bursts[0].volume != 0.0f || bursts[0].count != 3 || bursts[1].volume != 0.4f) {
+        state.Fail("coalesced volume is not the latest one observed");
+    }
+}
+
+// Timestamp capture on the sample path: system_clock::now() (arg 0) against
+// a TimestampClock tick (arg 1) and the tick converted to wall time (arg 2)
+void TimestampCapture(BenchmarkState& state) {
+    const size_t BATCH = 1024;
+    uint64_t sink = 0;  // Unsigned, so summing epoch ticks may wrap
+    auto capture = [&]() {
+        for (size_t i = 0; i < BATCH; ++i) {
+            if (state.GetArg() == 0) {
+                sink += static_cast<uint64_t>(std::chrono::system_clock::now().time_since_epoch().count());
+            } else if (state.GetArg() == 1) {
+                sink += static_cast<uint64_t>(TimestampClock::Capture().time_since_epoch().count());
+            } else {
+                sink += static_cast<uint64_t>(TimestampClock::Instance().Now().time_since_epoch().count());
+            }
+        }
+    };
+    capture();
+    state.SetItemsPerIteration(BATCH);
+
+    state.ExpectNoAllocations();
+    state.Start();
+    for (uint64_t i = 0; i < state.GetIterations(); ++i) {
+        capture();
+    }
+    state.Stop();
+    state.SetLabel(sink != 0 ? "" : "clock read zero");
+}
+
+// Local time of event timestamps a few ms apart, as batching and the logger
+// need it: localtime (arg 0) against TimestampClock's cached offset (arg 1)
+void TimestampLocalTime(BenchmarkState& state) {
+    const size_t BATCH = 1024;
+    auto start = std::chrono::system_clock::now() - std::chrono::hours(1);
+    int sink = 0;
+    auto convert = [&]() {
+        for (size_t i = 0; i < BATCH; ++i) {
+            auto time = start + std::chrono::milliseconds(7 * i);
+            std::tm tm = {};
+            if (state.GetArg() == 0) {
+                std::time_t timeT = std::chrono::system_clock::to_time_t(time);
+#ifdef _WIN32
+                localtime_s(&tm, &timeT);
+#else
+                localtime_r(&timeT, &tm);
+#endif
+            } else {
+                TimestampClock::Instance().ToLocalTime(time, tm);
+            }
+            sink += tm.tm_min;
+        }
+    };
+    convert();
+    state.SetItemsPerIteration(BATCH);
+
+    state.ExpectNoAllocations();
+    state.Start();
+    for (uint64_t i = 0; i < state.GetIterations(); ++i) {
+        convert();
+    }
+    state.Stop();
+    state.SetLabel(sink >= 0 ? "" : "negative minute");
+}
+
+// Stands in for an endpoint's session poll: the calls into the audio
+// service are round trips that mostly wait
+class SimulatedEndpoint : public EndpointPoller {
+public:
+    void Poll() override {
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+};
+
+// Every endpoint polled once (a monitor tick), with a worker per endpoint
+// and back to back; results are per endpoint poll, and the label compares
+// the tick with the serial walk the single monitor thread used to do
+void EndpointPoolRound(BenchmarkState& state) {
+    size_t endpoints = static_cast<size_t>(state.GetArg());
+    EndpointPool pool([](const std::string&) { return std::unique_ptr<EndpointPoller>(new SimulatedEndpoint()); },
+                      std::chrono::microseconds(0));
+    std::vector<std::string> ids;
+    for (size_t i = 0; i < endpoints; ++i) {
+        ids.push_back("{0.0.0.00000000}.{endpoint-" + std::to_string(i) + "}");
+    }
+    pool.Sync(ids);
+    auto round = [&]() {
+        // Workers poll back to back, so rounds end one tick apart
+        uint64_t target = pool.GetRounds() + 1;
+        while (pool.GetRounds() < target) {
+            std::this_thread::sleep_for(std::chrono::microseconds(20));
+        }
+    };
+    round();
+    state.SetItemsPerIteration(endpoints);
+
+    auto start = std::chrono::steady_clock::now();
+    state.Start();
+    for (uint64_t i = 0; i < state.GetIterations(); ++i) {
+        round();
+    }
+    state.Stop();
+    double tickMicros = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() /
+                        static_cast<double>(state.GetIterations());
+    pool.Clear();
+
+    SimulatedEndpoint serial;
+    auto serialStart = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < endpoints; ++i) {
+        serial.Poll();
+    }
+    double serialMicros = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - serialStart).count();
+    char label[64];
+    std::snprintf(label, sizeof(label), "tick %.0f us, serial %.0f us", tickMicros, serialMicros);
+    state.SetLabel(label);
+}
+
+// Ten simulated minutes of 250 ms ticks on one endpoint: each session plays
+// a sound of up to three seconds now and then, and the endpoint's peak is the
+// loudest of them, as the device mix would be
+std::vector<float> SimulateSessionPeaks(size_t sessions, size_t ticks) {
+    std::mt19937 rng(48);
+    std::uniform_real_distribution<float> level(0.01f, 0.8f);
+    std::vector<float> peaks(sessions * ticks, 0.0f);
+    for (size_t session = 0; session < sessions; ++session) {
+        for (size_t tick = rng() % 400; tick < ticks; tick += 40 + rng() % (100 * sessions)) {
+            size_t length = 1 + rng() % 12;
+            for (size_t i = tick; i < (std::min)(ticks, tick + length); ++i) {
+                peaks[i * sessions + session] = level(rng);
+            }
+        }
+    }
+    return peaks;
+}
+
+// Ten minutes of polls through the gate into a LevelHistory, as
+// ProcessAudioSession does: read sessions append what they showed, gated
+// ones a zero-peak sample. Every session must then have one sample per
+// tick from its first read on, at the volume it was last read at, and
+// every sample must carry the peak the session really had.
+std::string CheckGatedLevels() {
+    const size_t SESSIONS = 8;
+    const size_t TICKS = 2400;
+    std::vector<float> peaks = SimulateSessionPeaks(SESSIONS, TICKS);
+    MeterGate gate;
+    LevelHistory levels;
+    auto start = std::chrono::system_clock::now() - std::chrono::hours(1);
+    TimestampClock::Tick now = TimestampClock::Capture();
+    std::vector<size_t> firstRead(SESSIONS, TICKS);
+    for (size_t tick = 0; tick < TICKS; ++tick) {
+        const float* row = &peaks[tick * SESSIONS];
+        now += std::chrono::milliseconds(250);
+        auto time = start + std::chrono::milliseconds(250) * tick;
+        gate.BeginTick(*std::max_element(row, row + SESSIONS), now);
+        for (size_t session = 0; session < SESSIONS; ++session) {
+            DWORD processId = static_cast<DWORD>(1000 + session);
+            if (gate.ShouldRead(processId, now)) {
+                gate.Report(processId, row[session], now);
+                levels.Append(processId, time, 0.25f + 0.05f * session, row[session]);
+                firstRead[session] = (std::min)(firstRead[session], tick);
+            } else {
+                levels.AppendSilence(processId, time);
+            }
+        }
+    }
+
+    std::vector<LevelSample> samples;
+    for (size_t session = 0; session < SESSIONS; ++session) {
+        samples.clear();
+        levels.Read(static_cast<DWORD>(1000 + session), start, start + std::chrono::hours(1), samples);
+        if (samples.size() != TICKS - firstRead[session]) {
+            return "session " + std::to_string(session) + " has " + std::to_string(samples.size()) +
+                   " level samples for " + std::to_string(TICKS - firstRead[session]) + " polls";
+        }
+        for (size_t i = 0; i < samples.size(); ++i) {
+            float peak = peaks[(firstRead[session] + i) * SESSIONS + session];
+            if (samples[i].peak != peak || samples[i].volume != 0.25f + 0.05f * session) {
+                return "session " + std::to_string(session) + " poll " + std::to_string(firstRead[session] + i) +
+                       " recorded the wrong level";
+            }
+        }
+    }
+    return "";
+}
+
+// One poll tick through the gate, endpoint meter first; results are per
+// session, and the label counts the session reads the gate saved and any
+// audible session it failed to read
+void MeterGateTick(BenchmarkState& state) {
+    size_t sessions = static_cast<size_t>(state.GetArg());
+    const size_t ticks = 2400;
+    std::vector<float> peaks = SimulateSessionPeaks(sessions, ticks);
+    MeterGate gate;
+    TimestampClock::Tick now = TimestampClock::Capture();
+    uint64_t missed = 0;
+    state.SetItemsPerIteration(sessions);
+
+    state.Start();
+    for (uint64_t i = 0; i < state.GetIterations(); ++i) {
+        const float* row = &peaks[(i % ticks) * sessions];
+        now += std::chrono::milliseconds(250);
+        gate.BeginTick(*std::max_element(row, row + sessions), now);
+        for (size_t session = 0; session < sessions; ++session) {
+            DWORD processId = static_cast<DWORD>(1000 + session);
+            if (gate.ShouldRead(processId, now)) {
+                gate.Report(processId, row[session], now);
+            } else if (row[session] > 0.001f) {
+                ++missed;
+            }
+        }
+    }
+    state.Stop();
+
+    // A session read is five calls: the volume interface, its volume and
+    // mute, the meter interface and its peak. The gate adds one a tick.
+    uint64_t total = gate.GetReadCount() + gate.GetSkippedCount();
+    int64_t callsSaved = static_cast<int64_t>(gate.GetSkippedCount() * 5) -
+                         static_cast<int64_t>(gate.GetEndpointReadCount());
+    char label[96];
+    std::snprintf(label, sizeof(label), "%.0f%% reads skipped, %.0f%% calls saved, %llu missed",
+                  total ? 100.0 * static_cast<double>(gate.GetSkippedCount()) / static_cast<double>(total) : 0.0,
+                  total ? 100.0 * static_cast<double>(callsSaved) / static_cast<double>(total * 5) : 0.0,
+                  static_cast<unsigned long long>(missed));
+    state.SetLabel(label);
+
+    static const std::string error = CheckGatedLevels();
+    if (missed > 0) {
+        state.Fail(std::to_string(missed) + " audible session reads skipped by the gate");
+    } else if (!error.empty()) {
+        state.Fail(error);
+    }
+}
+
+// A rule file of count rules over the bench's processes and as many others
+// that never play; every hundredth rule names no process at all
+std::string MakeRules(size_t count) {
+    const char* const words[] = { "beep", "chime", "alarm", "ding", "notification" };
+    std::string text;
+    for (size_t i = 0; i < count; ++i) {
+        std::string process = i % 3 == 0 ? PROCESS_NAMES[(i / 3) % PROCESS_COUNT] : "app" + std::to_string(i) + ".exe";
+        std::string word = words[i % 5];
+        if (i % 100 == 99) {
+            text += "notify when desc contains " + word + " and peak > 0.9\n";
+            continue;
+        }
+        switch (i % 4) {
+            case 0: text += "ignore when process = " + process + " and peak < 5%\n"; break;
+            case 1: text += "notify when process = " + process + " and count > 20 in 1s\n"; break;
+            case 2: text += "notify when process = " + process + " and peak > 0.9 and not system\n"; break;
+            default: text += "notify when process = " + process + " and (desc contains " + word +
+                             " or volume >= 0.95)\n"; break;
+        }
+    }
+    return text;
+}
+
+// Count rules weigh a coalesced burst by its events, and forget processes
+// that have gone quiet for longer than the window
+std::string CheckCountWindows() {
+    RuleEngine rules;
+    std::string error;
+    if (!rules.Load("notify \"chatter\" when process = svchost.exe and count > 5 in 10s\n"
+                    "notify when count > 100 in 1s\n", error)) {
+        return "count rules did not compile: " + error;
+    }
+    std::vector<uint32_t> fired;
+    AudioEvent event;
+    event.processName = "svchost.exe";
+    event.timestamp = std::chrono::system_clock::now();
+    event.eventCount = 3;
+    rules.Evaluate(event, fired);
+    event.timestamp += std::chrono::seconds(1);
+    rules.Evaluate(event, fired);
+    if (fired.size() != 1 || rules.GetRuleName(fired[0]) != "chatter") {
+        return "two bursts of 3 in a second fired " + std::to_string(fired.size()) + " rules, expected chatter";
+    }
+    fired.clear();
+    event.timestamp += std::chrono::seconds(20);
+    event.eventCount = 5;
+    rules.Evaluate(event, fired);
+    if (!fired.empty()) {
+        return "a burst of 5 fired a count > 5 rule";
+    }
+
+    // One sound each from 20000 processes, a millisecond apart: about a
+    // thousand are ever in the 1 s window
+    for (size_t i = 0; i < 20000; ++i) {
+        event.processName = "app" + std::to_string(i) + ".exe";
+        event.timestamp += std::chrono::milliseconds(1);
+        event.eventCount = 1;
+        rules.Evaluate(event, fired);
+    }
+    if (rules.GetWindowCount() > 5000) {
+        return "count rules hold " + std::to_string(rules.GetWindowCount()) + " windows for 20000 processes";
+    }
+    return "";
+}
+
+// Every event through arg rules, as the pipeline runs them before the store;
+// the label shows how far interning shrank the rules and what they did
+void RuleEngineEvaluate(BenchmarkState& state) {
+    static const std::string countError = CheckCountWindows();
+    if (!countError.empty()) {
+        state.Fail(countError);
+    }
+    auto events = MakeEvents(4096);
+    RuleEngine rules;
+    std::string error;
+    if (!rules.Load(MakeRules(static_cast<size_t>(state.GetArg())), error)) {
+        state.Fail("Rules did not compile: " + error);
+        return;
+    }
+    std::vector<uint32_t> fired;
+    uint64_t kept = 0;
+    uint64_t alerts = 0;
+
+    state.Start();
+    for (uint64_t i = 0; i < state.GetIterations(); ++i) {
+        fired.clear();
+        kept += rules.Evaluate(events[i % events.size()], fired) ? 1 : 0;
+        alerts += fired.size();
+    }
+    state.Stop();
+    char label[96];
+    std::snprintf(label, sizeof(label), "%zu nodes for %zu terms, %.0f%% ignored, %.2f alerts/event",
+                  rules.GetNodeCount(), rules.GetTermCount(),
+                  100.0 - 100.0 * static_cast<double>(kept) / static_cast<double>(state.GetIterations()),
+                  static_cast<double>(alerts) / static_cast<double>(state.GetIterations()));
+    state.SetLabel(label);
+}
+
+// Ten million synthetic events, a day and a bit of them, sealed into chunks
+// once and shared by every EventQuery run
+const std::vector<EventChunk>& QueryChunks() {
+    static std::vector<EventChunk> chunks;
+    if (chunks.empty()) {
+        const size_t total = 10000000;
+        auto events = MakeEvents(EventStore::CHUNK_EVENTS);
+        auto span = events.back().timestamp - events.front().timestamp + std::chrono::milliseconds(10);
+        std::mt19937 random(50);
+        chunks.reserve(total / EventStore::CHUNK_EVENTS + 1);
+        for (size_t done = 0; done < total; done += events.size()) {
+            for (auto& event : events) {
+                if (!chunks.empty()) {
+                    event.timestamp += span;
+                }
+                event.peakLevel = static_cast<float>(random() % 10001) / 10000.0f;
+            }
+            chunks.push_back(EventChunk::Encode(events.data(), (std::min)(events.size(), total - done)));
+        }
+    }
+    return chunks;
+}
+
+// Millisecond buckets over a hundred days, grouped by one of 2000 pids, so
+// a batch spans far more than 2^32 bucket and pid groups; every row must
+// come back as its own group with the right bucket and pid
+std::string CheckWideGroups() {
+    std::mt19937 random(11);
+    auto start = std::chrono::system_clock::now() - std::chrono::hours(24 * 100);
+    std::vector<AudioEvent> events(4000);
+    std::map<std::pair<int64_t, std::string>, double> expected;
+    for (size_t i = 0; i < events.size(); ++i) {
+        auto offset = std::chrono::milliseconds(static_cast<int64_t>(i) * 2160000 + random() % 1000);
+        events[i].timestamp = std::chrono::time_point_cast<std::chrono::milliseconds>(start + offset);
+        events[i].processId = static_cast<DWORD>(1 + random() % 2000);
+        events[i].processName = "app.exe";
+        int64_t bucket = std::chrono::duration_cast<std::chrono::milliseconds>(
+            events[i].timestamp.time_since_epoch()).count();
+        expected[{ bucket, std::to_string(events[i].processId) }] += 1.0;
+    }
+
+    EventQuery query;
+    query.group = QueryGroup::Pid;
+    query.bucket = std::chrono::milliseconds(1);
+    query.AddMeasure(QueryAggregate::Count);
+    EventQueryExecutor executor(query);
+    executor.AddRows(events.data(), events.size());
+    QueryResult result = executor.Run();
+    if (result.rows.size() != expected.size()) {
+        return "wide groups: " + std::to_string(result.rows.size()) + " rows, expected " +
+               std::to_string(expected.size());
+    }
+    for (const auto& row : result.rows) {
+        int64_t bucket = std::chrono::duration_cast<std::chrono::milliseconds>(row.bucket.time_since_epoch()).count();
+        auto found = expected.find({ bucket, row.group });
+        if (found == expected.end() || row.values.empty() || row.values[0] != found->second) {
+            return "wide groups: pid " + row.group + " in bucket " + std::to_string(bucket) + " was not expected";
+        }
+    }
+    return "";
+}
+
+float ColumnValue(const AudioEvent& event, EventColumns::Value column) {
+    switch (column) {
+        case EventColumns::Value::Events: return static_cast<float>(event.eventCount);
+        case EventColumns::Value::Duration: return static_cast<float>(event.duration_ms);
+        case EventColumns::Value::Volume: return event.volumeLevel;
+        case EventColumns::Value::Peak: return event.peakLevel;
+        case EventColumns::Value::Momentary: return event.momentaryLoudness;
+        default: return event.shortTermLoudness;
+    }
+}
+
+// The query worked out row by row, the obvious way
+std::map<std::pair<int64_t, std::string>, std::vector<double>> ReferenceQuery(const std::vector<AudioEvent>& events,
+                                                                              const EventQuery& query) {
+    auto folded = [](std::string text) {
+        std::transform(text.begin(), text.end(), text.begin(),
+                       [](char c) { return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c; });
+        return text;
+    };
+    const int64_t bucketTicks = std::chrono::duration_cast<std::chrono::system_clock::duration>(query.bucket).count();
+    const uint32_t levelBins = static_cast<uint32_t>(std::floor(1.0f / query.binWidth + 1e-4f)) + 1;
+    std::map<std::pair<int64_t, std::string>, std::vector<const AudioEvent*>> groups;
+    for (const auto& event : events) {
+        bool named = query.processes.empty();
+        for (const auto& process : query.processes) {
+            named = named || folded(process) == folded(event.processName);
+        }
+        if (!named || event.timestamp < query.start || event.timestamp > query.end ||
+            event.peakLevel < query.minPeak || event.peakLevel > query.maxPeak ||
+            (query.excludeSystemSounds && event.isSystemSound)) {
+            continue;
+        }
+        int64_t ticks = event.timestamp.time_since_epoch().count();
+        int64_t bucket = bucketTicks > 0 ? (ticks >= 0 ? ticks / bucketTicks : (ticks + 1) / bucketTicks - 1) : 0;
+        std::string group;
+        switch (query.group) {
+            case QueryGroup::None: break;
+            case QueryGroup::Process: group = event.processName; break;
+            case QueryGroup::Pid: group = std::to_string(event.processId); break;
+            case QueryGroup::Sound: group = event.soundLabel; break;
+            case QueryGroup::Endpoint: group = event.endpointId; break;
+            case QueryGroup::SystemSound: group = event.isSystemSound ? "yes" : "no"; break;
+            default: {
+                float level = query.group == QueryGroup::PeakLevel ? event.peakLevel : event.volumeLevel;
+                float bin = (std::max)(level, 0.0f) * (1.0f / query.binWidth) + 1e-4f;
+                uint32_t dim = (std::min)(static_cast<uint32_t>(bin), levelBins - 1);
+                char text[16];
+                std::snprintf(text, sizeof(text), "%.4f", static_cast<double>(dim) * query.binWidth);
+                group = text;
+                break;
+            }
+        }
+        groups[{ bucketTicks > 0 ? bucket * bucketTicks : INT64_MIN, group }].push_back(&event);
+    }
+
+    std::map<std::pair<int64_t, std::string>, std::vector<double>> rows;
+    for (const auto& group : groups) {
+        std::vector<double>& values = rows[group.first];
+        for (const auto& measure : query.measures) {
+            std::vector<float> column;
+            double sum = 0.0;
+            for (const AudioEvent* event : group.second) {
+                column.push_back(ColumnValue(*event, measure.column));
+                sum += column.back();
+            }
+            std::sort(column.begin(), column.end());
+            size_t rank = static_cast<size_t>(std::ceil(measure.quantile * static_cast<double>(column.size())));
+            switch (measure.aggregate) {
+                case QueryAggregate::Count: values.push_back(static_cast<double>(column.size())); break;
+                case QueryAggregate::Sum: values.push_back(sum); break;
+                case QueryAggregate::Min: values.push_back(column.front()); break;
+                case QueryAggregate::Max: values.push_back(column.back()); break;
+                case QueryAggregate::Mean: values.push_back(sum / static_cast<double>(column.size())); break;
+                case QueryAggregate::Quantile: values.push_back(column[rank > 0 ? rank - 1 : 0]); break;
+            }
+        }
+    }
+    return rows;
+}
+
+std::string CompareQuery(const char* what, const QueryResult& result,
+                         const std::map<std::pair<int64_t, std::string>, std::vector<double>>& expected) {
+    if (result.rows.size() != expected.size()) {
+        return std::string(what) + ": " + std::to_string(result.rows.size()) + " rows, expected " +
+               std::to_string(expected.size());
+    }
+    for (const auto& row : result.rows) {
+        int64_t bucket = row.bucket == (std::chrono::system_clock::time_point::min)()
+                             ? INT64_MIN : row.bucket.time_since_epoch().count();
+        auto found = expected.find({ bucket, row.group });
+        if (found == expected.end() || found->second.size() != row.values.size()) {
+            return std::string(what) + ": unexpected group " + row.group;
+        }
+        for (size_t m = 0; m < row.values.size(); ++m) {
+            // Sums differ from the reference only in the order they were added
+            double want = found->second[m];
+            if (std::fabs(row.values[m] - want) > 1e-9 * (std::max)(1.0, std::fabs(want))) {
+                char text[160];
+                std::snprintf(text, sizeof(text), "%s: group %s measure %zu is %.9g, expected %.9g", what,
+                              row.group.c_str(), m, row.values[m], want);
+                return text;
+            }
+        }
+    }
+    return "";
+}
+
+// Filters, time buckets, every kind of group and every aggregate against
+// ReferenceQuery, on 1 and 4 threads, both through the executor over
+// chunks plus loose rows and through a store spread over every tier
+std::string CheckQueryAggregates() {
+    const size_t count = 12000;
+    auto events = MakeEvents(count);
+    std::mt19937 random(23);
+    for (auto& event : events) {
+        // Whole steps of 1/10000, which chunks keep exactly
+        event.peakLevel = static_cast<float>(random() % 10001) / 10000.0f;
+        event.volumeLevel = static_cast<float>(random() % 10001) / 10000.0f;
+        event.isSystemSound = random() % 5 == 0;
+        event.eventCount = 1 + random() % 4;
+        event.duration_ms = random() % 500;
+    }
+    const auto first = events.front().timestamp;
+    const auto middle = events[count / 2].timestamp;
+
+    std::vector<EventQuery> queries(5);
+    queries[0].processes = { "CHROME.EXE", "spotify.exe" };
+    queries[0].group = QueryGroup::Process;
+    queries[0].bucket = std::chrono::seconds(10);
+    queries[0].AddMeasure(QueryAggregate::Count);
+    queries[0].AddMeasure(QueryAggregate::Sum, EventColumns::Value::Peak);
+    queries[0].AddMeasure(QueryAggregate::Min, EventColumns::Value::Peak);
+    queries[0].AddMeasure(QueryAggregate::Max, EventColumns::Value::Volume);
+    queries[0].AddMeasure(QueryAggregate::Mean, EventColumns::Value::Volume);
+    queries[0].AddMeasure(QueryAggregate::Quantile, EventColumns::Value::Peak, 0.5);
+    queries[0].AddMeasure(QueryAggregate::Quantile, EventColumns::Value::Peak, 0.99);
+    queries[1].group = QueryGroup::Pid;
+    queries[1].minPeak = 0.2f;
+    queries[1].maxPeak = 0.8f;
+    queries[1].excludeSystemSounds = true;
+    queries[1].AddMeasure(QueryAggregate::Count);
+    queries[1].AddMeasure(QueryAggregate::Sum, EventColumns::Value::Events);
+    queries[1].AddMeasure(QueryAggregate::Quantile, EventColumns::Value::Volume, 0.9);
+    queries[2].start = first + std::chrono::seconds(7);
+    queries[2].end = middle;
+    queries[2].group = QueryGroup::PeakLevel;
+    queries[2].binWidth = 0.05f;
+    queries[2].bucket = std::chrono::seconds(30);
+    queries[2].AddMeasure(QueryAggregate::Count);
+    queries[2].AddMeasure(QueryAggregate::Min, EventColumns::Value::Peak);
+    queries[2].AddMeasure(QueryAggregate::Max, EventColumns::Value::Peak);
+    queries[3].group = QueryGroup::VolumeLevel;
+    queries[3].AddMeasure(QueryAggregate::Count);
+    queries[3].AddMeasure(QueryAggregate::Mean, EventColumns::Value::Peak);
+    queries[4].group = QueryGroup::SystemSound;
+    queries[4].bucket = std::chrono::milliseconds(1500);
+    queries[4].AddMeasure(QueryAggregate::Count);
+    queries[4].AddMeasure(QueryAggregate::Sum, EventColumns::Value::Duration);
+    queries[4].AddMeasure(QueryAggregate::Quantile, EventColumns::Value::Duration, 0.0);
+
+    // All but the last few hundred events in chunks
+    std::vector<EventChunk> chunks;
+    size_t chunked = 0;
+    for (; chunked + EventStore::CHUNK_EVENTS <= count - 300; chunked += EventStore::CHUNK_EVENTS) {
+        chunks.push_back(EventChunk::Encode(&events[chunked], EventStore::CHUNK_EVENTS));
+    }
+    std::filesystem::path spill = ScratchDirectory() / "query_spill";
+    std::error_code ec;
+    std::filesystem::remove_all(spill, ec);
+    EventStore store(64 * 1024);
+    store.OpenSpill(spill.wstring(), UINT64_MAX);
+    FillStore(store, events);
+    if (store.GetSpilledEventCount() == 0) {
+        return "query check: nothing spilled";
+    }
+
+    std::string error;
+    for (size_t q = 0; q < queries.size() && error.empty(); ++q) {
+        auto expected = ReferenceQuery(events, queries[q]);
+        for (size_t threads : { 1, 4 }) {
+            EventQuery query = queries[q];
+            query.threads = threads;
+            EventQueryExecutor executor(query);
+            for (const auto& chunk : chunks) {
+                executor.AddChunk(chunk);
+            }
+            executor.AddRows(&events[chunked], count - chunked);
+            std::string what = "query " + std::to_string(q) + " on " + std::to_string(threads) + " threads";
+            error = CompareQuery(what.c_str(), executor.Run(), expected);
+            if (error.empty()) {
+                what += " over the store";
+                error = CompareQuery(what.c_str(), store.Query(query), expected);
+            }
+            if (!error.empty()) {
+                break;
+            }
+        }
+    }
+    store.CloseSpill();
+    return error;
+}
+
+// One full scan of the ten million events per iteration, with every thread;
+// arg 0 counts events per process per minute, 1 is a histogram of one
+// process's peaks, 2 is peak quantiles per process
+void EventQueryScan(BenchmarkState& state) {
+    static const std::string error = CheckWideGroups() + CheckQueryAggregates();
+    const auto& chunks = QueryChunks();
+    EventQuery query;
+    switch (state.GetArg()) {
+        case 0:
+            query.group = QueryGroup::Process;
+            query.bucket = std::chrono::minutes(1);
+            query.AddMeasure(QueryAggregate::Count);
+            break;
+        case 1:
+            query.processes = { "chrome.exe" };
+            query.group = QueryGroup::PeakLevel;
+            query.binWidth = 0.05f;
+            query.AddMeasure(QueryAggregate::Count);
+            break;
+        default:
+            query.group = QueryGroup::Process;
+            query.AddMeasure(QueryAggregate::Quantile, EventColumns::Value::Peak, 0.5);
+            query.AddMeasure(QueryAggregate::Quantile, EventColumns::Value::Peak, 0.99);
+            query.AddMeasure(QueryAggregate::Mean);
+            break;
+    }
+    EventQueryExecutor executor(query);
+    size_t rows = 0;
+    for (const auto& chunk : chunks) {
+        executor.AddChunk(chunk);
+        rows += chunk.GetCount();
+    }
+    state.SetItemsPerIteration(rows);
+
+    QueryResult result;
+    state.Start();
+    for (uint64_t i = 0; i < state.GetIterations(); ++i) {
+        result = executor.Run();
+    }
+    state.Stop();
+    if (!error.empty()) {
+        state.Fail(error);
+    }
+    if (result.rowsScanned != rows) {
+        state.Fail("EventQuery scanned " + std::to_string(result.rowsScanned) + " of " + std::to_string(rows) + " rows");
+    }
+    char label[96];
+    std::snprintf(label, sizeof(label), "%u threads, %zu groups, %.1f%% of rows matched",
+                  (std::max)(std::thread::hardware_concurrency(), 1u), result.rows.size(),
+                  100.0 * static_cast<double>(result.rowsMatched) / static_cast<double>(rows));
+    state.SetLabel(label);
+}
+
+// New events into a full store with the default budget that spills the
+// rest to disk, segment writes included
+void EventStoreAddSpilling(BenchmarkState& state) {
+    auto events = MakeEvents(4096);
+    EventStore store;
+    store.OpenSpill((ScratchDirectory() / "spill").wstring(), UINT64_MAX);
+    auto time = events.back().timestamp;
+    uint64_t added = 0;
+    auto add = [&]() {
+        AudioEvent& event = events[added++ % events.size()];
+        time += std::chrono::milliseconds(1);
+        event.timestamp = time;
+        store.Add(event);
+    };
+
+    while (store.GetSpilledEventCount() == 0) {
+        add();
+    }
+    state.Start();
+    for (uint64_t i = 0; i < state.GetIterations(); ++i) {
+        add();
+    }
+    state.Stop();
+    store.CloseSpill();
+}
+
+// Range query over 100k events of which all but the newest few thousand
+// have spilled to disk; arg is the events in range
+void GetEventsSpilled(BenchmarkState& state) {
+    const size_t storeSize = 100000;
+    auto events = MakeEvents(storeSize);
+    EventStore store(1024 * 1024);
+    store.OpenSpill((ScratchDirectory() / "spill").wstring(), UINT64_MAX);
+    FillStore(store, events);
+    size_t inRange = static_cast<size_t>(state.GetArg());
+    auto start = events[storeSize - inRange].timestamp;
+    auto end = events.back().timestamp;
+    state.SetItemsPerIteration(inRange);
+
+    size_t total = 0;
+    state.Start();
+    for (uint64_t i = 0; i < state.GetIterations(); ++i) {
+        total += store.GetEvents(start, end).size();
+    }
+    state.Stop();
+    if (total != state.GetIterations() * inRange) {
+        state.Fail("GetEvents across tiers returned " + std::to_string(total) + " events");
+    }
+    store.CloseSpill();
+}
+
+// The ring keeps microseconds
+std::vector<AudioEvent> MakeRingEvents(size_t count) {
+    auto events = MakeEvents(count);
+    for (auto& event : events) {
+        event.timestamp = std::chrono::time_point_cast<std::chrono::microseconds>(event.timestamp);
+    }
+    return events;
+}
+
+std::string CheckRecovered(const char* what, const std::vector<AudioEvent>& recovered,
+                           const std::vector<AudioEvent>& expected) {
+    if (recovered.size() != expected.size()) {
+        return std::string(what) + ": recovered " + std::to_string(recovered.size()) + " events, expected " +
+               std::to_string(expected.size());
+    }
+    for (size_t i = 0; i < expected.size(); ++i) {
+        if (!SameEvent(recovered[i], expected[i])) {
+            return std::string(what) + ": event " + std::to_string(i) + " differs after reopening";
+        }
+    }
+    return "";
+}
+
+// A batched update that grows the record is appended and the old record
+// retired, so a restart loads the event once. Then a header-only event
+// record with a huge payload size is written at the tail, as a torn or
+// corrupt file might hold; a restart must skip it, keep what came before,
+// and append the next update rather than rewrite it.
+std::string CheckRingRecovery() {
+    // Layout from EventRing.cpp: a 64-byte file header with the logical
+    // write cursor at offset 32, then the data area
+    const size_t TAIL_OFFSET = 32;
+    const size_t DATA_OFFSET = 64;
+    std::filesystem::path path = ScratchDirectory() / "ring_check.bin";
+    std::filesystem::remove(path);
+    auto events = MakeRingEvents(3);
+
+    EventRing ring;
+    if (!ring.Open(path.wstring(), 64 * 1024)) {
+        return "cannot open " + path.string();
+    }
+    ring.Append(events[0]);
+    ring.Append(events[1]);
+    // A label grows the payload even without capture fields
+    events[1].eventCount = 4;
+    events[1].soundLabel = "doorbell";
+    ring.UpdateLast(events[1]);
+    ring.Close();
+    ring.Open(path.wstring(), 64 * 1024);
+    std::string error = CheckRecovered("retired update", ring.Recover(SIZE_MAX), { events[0], events[1] });
+    ring.Close();
+    if (!error.empty()) {
+        return error;
+    }
+
+    {
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        uint64_t tail = 0;
+        file.seekg(TAIL_OFFSET);
+        file.read(reinterpret_cast<char*>(&tail), sizeof(tail));
+        const uint16_t type = 1;
+        const uint32_t payloadSize = 0x7fffffff, length = 16;
+        char record[16] = {};
+        std::memcpy(record, &type, sizeof(type));
+        std::memcpy(record + 4, &payloadSize, sizeof(payloadSize));
+        std::memcpy(record + 12, &length, sizeof(length));
+        file.seekp(static_cast<std::streamoff>(DATA_OFFSET + tail));
+        file.write(record, sizeof(record));
+        tail += sizeof(record);
+        file.seekp(TAIL_OFFSET);
+        file.write(reinterpret_cast<const char*>(&tail), sizeof(tail));
+        if (!file) {
+            return "cannot corrupt " + path.string();
+        }
+    }
+    ring.Open(path.wstring(), 64 * 1024);
+    error = CheckRecovered("corrupt tail", ring.Recover(SIZE_MAX), { events[0], events[1] });
+    if (!error.empty()) {
+        return error;
+    }
+    ring.UpdateLast(events[2]);
+    ring.Close();
+    ring.Open(path.wstring(), 64 * 1024);
+    return CheckRecovered("update after a corrupt tail", ring.Recover(SIZE_MAX), events);
+}
+
+// Warm restart: Open and Recover over a ring holding a million events
+void EventRingRecover(BenchmarkState& state) {
+    static const std::string error = CheckRingRecovery();
+    const size_t count = 1000000;
+    const uint64_t capacity = 256ull * 1024 * 1024;  // About 150 bytes an event
+    std::filesystem::path path = ScratchDirectory() / "ring_1m.bin";
+    static std::vector<AudioEvent> events;
+    if (events.empty()) {
+        events = MakeRingEvents(count);
+        std::filesystem::remove(path);
+        EventRing ring;
+        ring.Open(path.wstring(), capacity);
+        for (const auto& event : events) {
+            ring.Append(event);
+        }
+    }
+    state.SetItemsPerIteration(count);
+
+    std::vector<AudioEvent> recovered;
+    state.Start();
+    for (uint64_t i = 0; i < state.GetIterations(); ++i) {
+        EventRing ring;
+        ring.Open(path.wstring(), capacity);
+        recovered = ring.Recover(SIZE_MAX);
+    }
+    state.Stop();
+    if (!error.empty()) {
+        state.Fail(error);
+    }
+    std::string roundTrip = CheckRecovered("1M ring", recovered, events);
+    if (!roundTrip.empty()) {
+        state.Fail(roundTrip);
+    }
+}
+
+// Bucket bounds for values either side of each power of two, then the
+// summary of 1..1022 recorded once each. Only SoundTracker itself records
+// CallbackToStore, so nothing else in the bench lands in that histogram.
+std::string CheckMetricsHistogram() {
+    for (uint64_t value = 0; value < 16; ++value) {
+        if (MetricsRegistry::BucketValue(MetricsRegistry::BucketIndex(value)) != value) {
+            return "value " + std::to_string(value) + " is not in its own bucket";
+        }
+    }
+    for (size_t bit = 4; bit < MetricsRegistry::MAX_VALUE_BITS; ++bit) {
+        uint64_t power = uint64_t(1) << bit;
+        for (uint64_t value : { power - 1, power, power + 1, power + power / 3 }) {
+            uint64_t bound = MetricsRegistry::BucketValue(MetricsRegistry::BucketIndex(value));
+            if (bound < value || bound - value > value / 16) {
+                return "value " + std::to_string(value) + " lands in a bucket up to " + std::to_string(bound);
+            }
+        }
+    }
+    if (MetricsRegistry::BucketIndex(32) != 32 || MetricsRegistry::BucketValue(32) != 33 ||
+        MetricsRegistry::BucketIndex(uint64_t(1) << 50) != MetricsRegistry::BUCKET_COUNT - 1 ||
+        MetricsRegistry::BucketIndex(UINT64_MAX) != MetricsRegistry::BUCKET_COUNT - 1) {
+        return "bucket index out of place";
+    }
+
+    auto& registry = MetricsRegistry::Instance();
+    if (registry.Snapshot().Get(MetricHistogram::CallbackToStore).count != 0) {
+        return "CallbackToStore already has samples";
+    }
+    for (uint64_t value = 1; value <= 1022; ++value) {
+        MetricsRegistry::Record(MetricHistogram::CallbackToStore, value);
+    }
+    HistogramSummary summary = registry.Snapshot().Get(MetricHistogram::CallbackToStore);
+    // Each percentile is the top of the bucket holding its rank: 511 ends
+    // 496-511, 920 is in 896-927, and 1012 and 1021 are in 992-1023, capped
+    // at the max
+    if (summary.count != 1022 || summary.mean != 511.5 || summary.max != 1022 || summary.p50 != 511 ||
+        summary.p90 != 927 || summary.p99 != 1022 || summary.p999 != 1022) {
+        return "summary of 1..1022 is count " + std::to_string(summary.count) + ", p50 " +
+               std::to_string(summary.p50) + ", p90 " + std::to_string(summary.p90) + ", p99 " +
+               std::to_string(summary.p99) + ", p999 " + std::to_string(summary.p999) + ", max " +
+               std::to_string(summary.max);
+    }
+    return "";
+}
+
+// Recording a latency and bumping a counter, as each pipeline stage does
+void MetricsRecord(BenchmarkState& state) {
+    static const std::string error = CheckMetricsHistogram();
+    const size_t BATCH = 1024;
+    auto record = [&]() {
+        for (size_t i = 0; i < BATCH; ++i) {
+            MetricsRegistry::Record(MetricHistogram::StoreLockWait, 50 + i * 37);
+            MetricsRegistry::Count(MetricCounter::EventsLogged);
+        }
+    };
+    record();  // The thread's metrics block is allocated on first use
+    state.SetItemsPerIteration(BATCH);
+
+    state.ExpectNoAllocations();
+    state.Start();
+    for (uint64_t i = 0; i < state.GetIterations(); ++i) {
+        record();
+    }
+    state.Stop();
+    if (!error.empty()) {
+        state.Fail(error);
+    }
+}
+
+size_t CountOccurrences(const std::string& text, const std::string& pattern) {
+    size_t count = 0;
+    for (size_t pos = text.find(pattern); pos != std::string::npos; pos = text.find(pattern, pos + 1)) {
+        ++count;
+    }
+    return count;
+}
+
+// A thread that laps its ring and exits must leave its newest spans in the
+// dump: all but the slot a live owner could be rewriting, the last with its
+// argument and exact duration
+std::string CheckChromeTrace() {
+    SpanTracer& tracer = SpanTracer::Instance();  // Sets the origin the spans are timed from
+    std::thread worker([]() {
+        SpanTracer::SetThreadName("bench \"check\"");
+        auto begin = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < SpanTracer::RING_SPANS + 100; ++i) {
+            SpanTracer::Record("bench.lap", begin, begin + std::chrono::microseconds(1));
+        }
+        SpanTracer::Record("bench.last", begin, begin + std::chrono::nanoseconds(2500), "events", 7);
+    });
+    worker.join();
+
+    std::filesystem::path path = ScratchDirectory() / "spans.json";
+    if (!tracer.WriteChromeTrace(path.wstring())) {
+        return "could not write the trace";
+    }
+    std::ifstream file(path, std::ios::binary);
+    std::string json((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (CountOccurrences(json, "\"name\":\"bench \\\"check\\\"\"") != 1) {
+        return "thread name missing from the trace";
+    }
+    size_t laps = CountOccurrences(json, "\"name\":\"bench.lap\"");
+    if (laps != SpanTracer::RING_SPANS - 2) {
+        return "trace kept " + std::to_string(laps) + " of the lapped spans, expected " +
+               std::to_string(SpanTracer::RING_SPANS - 2);
+    }
+    size_t last = json.find("\"name\":\"bench.last\"");
+    std::string span = last == std::string::npos ? "" : json.substr(last, json.find('\n', last) - last);
+    if (span.find(",\"dur\":2.500,\"args\":{\"events\":7}}") == std::string::npos) {
+        return "newest span missing or wrong in the trace: " + span;
+    }
+    return "";
+}
+
+// A traced scope on the pipeline path, with the tracer off (arg 0) and on
+// (arg 1)
+void SpanTracerRecord(BenchmarkState& state) {
+    const size_t BATCH = 1024;
+    bool enabled = state.GetArg() != 0;
+    if (enabled) {
+        SpanTracer::Instance().Enable();
+    }
+    static const std::string error = CheckChromeTrace();
+    auto trace = [&]() {
+        for (size_t i = 0; i < BATCH; ++i) {
+            TRACE_SPAN_ARG("bench.span", "index", i);
+        }
+    };
+    trace();  // The thread's ring is allocated on its first span
+    state.SetItemsPerIteration(BATCH);
+
+    state.ExpectNoAllocations();
+    state.Start();
+    for (uint64_t i = 0; i < state.GetIterations(); ++i) {
+        trace();
+    }
+    state.Stop();
+    SpanTracer::Instance().Disable();
+    if (!error.empty()) {
+        state.Fail(error);
+    }
+}
+
+// Samples as a recorder would capture them: timestamps to the microsecond
+// the trace keeps, and every eighth event followed by a repeat that batches
+// into it
+std::vector<TraceSample> MakeTraceSamples(size_t count) {
+    std::vector<TraceSample> samples;
+    samples.reserve(count + count / 8);
+    std::vector<AudioEvent> events = MakeEvents(count);
+    for (size_t i = 0; i < count; ++i) {
+        TraceSample sample;
+        sample.source = static_cast<TraceSource>(i % 3);
+        sample.event = events[i];
+        sample.event.timestamp = std::chrono::time_point_cast<std::chrono::microseconds>(events[i].timestamp);
+        sample.event.isSystemSound = i % 5 == 0;
+        sample.enrichMicros = static_cast<uint32_t>(i % 40);
+        samples.push_back(sample);
+        if (i % 8 == 7) {
+            sample.event.timestamp += std::chrono::microseconds(1);
+            sample.event.eventCount = 3;
+            samples.push_back(sample);
+        }
+    }
+    return samples;
+}
+
+bool WriteTrace(const std::filesystem::path& path, const std::vector<TraceSample>& samples) {
+    TraceWriter writer;
+    if (!writer.Open(path.wstring())) {
+        return false;
+    }
+    for (const auto& sample : samples) {
+        writer.Record(sample);
+    }
+    writer.Close();
+    return true;
+}
+
+// Replaying a trace must leave the store as adding its samples directly does
+std::string CheckReplay() {
+    std::vector<TraceSample> samples = MakeTraceSamples(20000);
+    std::filesystem::path path = ScratchDirectory() / "replay_check.trace";
+    if (!WriteTrace(path, samples)) {
+        return "could not write the trace";
+    }
+
+    EventStore expected;
+    ReplayStats direct;
+    for (const auto& sample : samples) {
+        ++(expected.Add(sample.event) ? direct.added : direct.batched);
+        direct.enrichMicros += sample.enrichMicros;
+    }
+
+    EventStore store;
+    ReplayStats stats;
+    TraceReplayer replayer;
+    replayer.SetSpeed(0.0);
+    if (!replayer.Replay(path.wstring(), store, stats)) {
+        return "could not replay the trace";
+    }
+    if (stats.samples != samples.size() || stats.added != direct.added || stats.batched != direct.batched ||
+        stats.enrichMicros != direct.enrichMicros || stats.truncated ||
+        stats.traceSpan != samples.back().event.timestamp - samples.front().event.timestamp) {
+        return "replayed " + std::to_string(stats.samples) + " samples as " + std::to_string(stats.added) +
+               " added and " + std::to_string(stats.batched) + " batched, expected " +
+               std::to_string(direct.added) + " and " + std::to_string(direct.batched);
+    }
+
+    auto all = [](const EventStore& s) {
+        return s.GetEvents(std::chrono::system_clock::time_point::min(), std::chrono::system_clock::time_point::max());
+    };
+    std::vector<AudioEvent> want = all(expected);
+    std::vector<AudioEvent> got = all(store);
+    if (got.size() != want.size()) {
+        return "store holds " + std::to_string(got.size()) + " events after replay, expected " +
+               std::to_string(want.size());
+    }
+    for (size_t i = 0; i < want.size(); ++i) {
+        if (!SameEvent(got[i], want[i])) {
+            return "event " + std::to_string(i) + " differs after replay";
+        }
+    }
+    return "";
+}
+
+// A recorded session replayed back to back through batching and the store
+void TraceReplayerReplay(BenchmarkState& state) {
+    static const std::string error = CheckReplay();
+    const size_t count = 100000;
+    std::filesystem::path path = ScratchDirectory() / "replay.trace";
+    static bool written = false;
+    if (!written) {
+        written = WriteTrace(path, MakeTraceSamples(count));
+    }
+    state.SetItemsPerIteration(count + count / 8);
+
+    ReplayStats stats;
+    TraceReplayer replayer;
+    replayer.SetSpeed(0.0);
+    state.Start();
+    for (uint64_t i = 0; i < state.GetIterations(); ++i) {
+        EventStore store;
+        replayer.Replay(path.wstring(), store, stats);
+    }
+    state.Stop();
+    if (!error.empty()) {
+        state.Fail(error);
+    }
+    if (stats.samples != count + count / 8) {
+        state.Fail("replayed " + std::to_string(stats.samples) + " samples");
+    }
+}
+
+// arg picks the classification path: 0 known app, 1 keyboard, 2 unknown app, 3 system
+void GetSoundDescription(BenchmarkState& state) {
+    static const char* const NAMES[] = { "Spotify.exe", "TextInputHost.exe", "game.exe", "" };
+    std::string name = NAMES[state.GetArg()];
+    DWORD processId = state.GetArg() == 3 ? 0 : 1234;
+
+    size_t length = 0;
+    state.Start();
+    for (uint64_t i = 0; i < state.GetIterations(); ++i) {
+        length += EventEnricher::GetSoundDescription(processId, name).size();
+    }
+    state.Stop();
+    if (length == 0) {
+        state.Fail("GetSoundDescription returned nothing");
+    }
+}
+
+void LoggerLogEvent(BenchmarkState& state) {
+    auto events = MakeEvents(1024);
+    Logger logger(ScratchDirectory().wstring());
+    logger.Initialize();
+    for (const auto& event : events) {
+        logger.LogEvent(event);
+    }
+
+    state.ExpectNoAllocations();
+    state.Start();
+    for (uint64_t i = 0; i < state.GetIterations(); ++i) {
+        logger.LogEvent(events[i % events.size()]);
+    }
+    state.Stop();
+
+    logger.Close();
+    std::error_code ec;
+    std::filesystem::remove(std::filesystem::path(logger.GetCurrentLogPath()), ec);
+}
+
+// A large log written by Logger, held in memory for CsvReader; some rows
+// carry commas, quotes and line breaks so chunk boundaries land inside
+// quoted fields
+struct CsvFixture {
+    std::vector<AudioEvent> events;
+    std::string bytes;
+};
+
+const CsvFixture& LoggedCsv() {
+    static CsvFixture fixture = [] {
+        CsvFixture result;
+        result.events = MakeEvents(200000);
+        for (size_t i = 0; i < result.events.size(); ++i) {
+            auto& event = result.events[i];
+            event.sessionDisplayName = "Session " + std::to_string(i % 13);
+            if (i % 7 == 0) {
+                event.processPath = "C:\\Games\\Big, Bad\\" + event.processName;
+            }
+            if (i % 11 == 0) {
+                event.browserTabInfo = "Tab: \"News\"\nLive, " + std::to_string(i);
+            }
+        }
+
+        Logger logger(ScratchDirectory().wstring());
+        logger.Initialize();
+        for (const auto& event : result.events) {
+            logger.LogEvent(event);
+        }
+        logger.Close();
+        std::filesystem::path path(logger.GetCurrentLogPath());
+        std::ifstream input(path, std::ios::binary);
+        result.bytes.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+        input.close();
+        std::error_code ec;
+        std::filesystem::remove(path, ec);
+        return result;
+    }();
+    return fixture;
+}
+
+// Parses the whole log per iteration, split into arg chunks; reported per row
+void CsvReaderParse(BenchmarkState& state) {
+    const auto& fixture = LoggedCsv();
+    CsvReader reader(static_cast<unsigned>(state.GetArg()));
+    std::vector<AudioEvent> parsed;
+    state.SetItemsPerIteration(fixture.events.size());
+
+    bool ok = true;
+    state.Start();
+    for (uint64_t i = 0; i < state.GetIterations(); ++i) {
+        parsed.clear();
+        ok = reader.Parse(fixture.bytes.data(), fixture.bytes.size(), parsed) && ok;
+    }
+    state.Stop();
+
+    double seconds = std::chrono::duration<double>(state.GetElapsed()).count();
+    char label[64];
+    std::snprintf(label, sizeof(label), "%.0f MB/s",
+                  seconds > 0 ? fixture.bytes.size() * static_cast<double>(state.GetIterations()) / seconds / 1e6 : 0.0);
+    state.SetLabel(label);
+
+    if (!ok) {
+        state.Fail("CsvReader rejected the log header");
+    } else if (reader.GetRejectedRows() != 0) {
+        state.Fail(std::to_string(reader.GetRejectedRows()) + " rows rejected");
+    } else {
+        std::string error = CheckCsvRows(fixture.events, parsed);
+        if (!error.empty()) {
+            state.Fail(error);
+        }
+    }
+}
+
+// Just enough of a flatbuffer reader to walk ArrowWriter's metadata; every
+// read is bounds checked and a bad one clears Ok
+class FlatReader {
+private:
+    const std::string& m_bytes;
+    bool m_ok;
+
+public:
+    explicit FlatReader(const std::string& bytes) : m_bytes(bytes), m_ok(true) {}
+
+    bool Ok() const { return m_ok; }
+
+    template <typename T>
+    T Read(size_t at) {
+        T value{};
+        if (at > m_bytes.size() || m_bytes.size() - at < sizeof(T)) {
+            m_ok = false;
+            return value;
+        }
+        std::memcpy(&value, m_bytes.data() + at, sizeof(T));
+        return value;
+    }
+
+    // Root table of the flatbuffer starting at start
+    size_t Root(size_t start) { return start + Read<uint32_t>(start); }
+
+    // Where a table's field is stored, or 0 if it was left out
+    size_t Field(size_t table, uint16_t slot) {
+        size_t vtable = static_cast<size_t>(static_cast<int64_t>(table) - Read<int32_t>(table));
+        uint16_t vtableSize = Read<uint16_t>(vtable);
+        if (4u + 2u * slot >= vtableSize) {
+            return 0;
+        }
+        uint16_t offset = Read<uint16_t>(vtable + 4 + 2u * slot);
+        return offset ? table + offset : 0;
+    }
+
+    template <typename T>
+    T Scalar(size_t table, uint16_t slot, T otherwise = T()) {
+        size_t at = Field(table, slot);
+        return at ? Read<T>(at) : otherwise;
+    }
+
+    // The table, vector or string a field refers to
+    size_t Ref(size_t table, uint16_t slot) {
+        size_t at = Field(table, slot);
+        if (!at) {
+            m_ok = false;
+            return 0;
+        }
+        return at + Read<uint32_t>(at);
+    }
+
+    size_t Length(size_t vector) { return Read<uint32_t>(vector); }
+
+    size_t Element(size_t vector, size_t i) { return vector + 4 + 4 * i + Read<uint32_t>(vector + 4 + 4 * i); }
+
+    std::string String(size_t at) {
+        uint32_t length = Read<uint32_t>(at);
+        if (!m_ok || m_bytes.size() - at - 4 < length) {
+            m_ok = false;
+            return "";
+        }
+        return m_bytes.substr(at + 4, length);
+    }
+};
+
+// Writes 10000 events in batches of 4096 and reads the file back through
+// its footer: the schema's names and types, the batch and row counts, the
+// pids (a typed column) and the process names (a dictionary column)
+std::string CheckArrowFile() {
+    static const char* const NAMES[] = { "timestamp", "eventCount", "processId", "processName", "processPath",
+                                         "description", "sessionName", "volumeLevel", "peakLevel", "isSystemSound",
+                                         "usbDevice", "browserTab", "soundLabel", "momentaryLoudness",
+                                         "shortTermLoudness", "endpointId" };
+    const uint8_t TYPE_INT = 2, HEADER_DICTIONARY_BATCH = 2, HEADER_RECORD_BATCH = 3;
+    const size_t rows = 10000, batchRows = 4096;
+    auto events = MakeEvents(rows);
+    std::ostringstream out;
+    if (!ArrowWriter(batchRows).Write(events, out)) {
+        return "arrow: write failed";
+    }
+    const std::string bytes = out.str();
+    if (bytes.size() < 24 || bytes.compare(0, 6, "ARROW1") != 0 || bytes.compare(bytes.size() - 6, 6, "ARROW1") != 0) {
+        return "arrow: no ARROW1 magic";
+    }
+
+    FlatReader file(bytes);
+    size_t footerLength = static_cast<size_t>(file.Read<int32_t>(bytes.size() - 10));
+    if (footerLength > bytes.size() - 18) {
+        return "arrow: footer length " + std::to_string(footerLength) + " is past the file";
+    }
+    size_t footer = file.Root(bytes.size() - 10 - footerLength);
+    size_t fields = file.Ref(file.Ref(footer, 1), 1);
+    if (file.Length(fields) != 16) {
+        return "arrow: schema has " + std::to_string(file.Length(fields)) + " fields, expected 16";
+    }
+    for (size_t i = 0; i < 16; ++i) {
+        std::string name = file.String(file.Ref(file.Element(fields, i), 0));
+        if (name != NAMES[i]) {
+            return "arrow: field " + std::to_string(i) + " is named " + name + ", expected " + NAMES[i];
+        }
+    }
+    size_t pidField = file.Element(fields, 2);
+    size_t pidType = file.Ref(pidField, 3);
+    if (file.Scalar<uint8_t>(pidField, 2) != TYPE_INT || file.Scalar<int32_t>(pidType, 0) != 32 ||
+        file.Scalar<uint8_t>(pidType, 1) != 0) {
+        return "arrow: processId is not an unsigned 32-bit integer";
+    }
+    if (file.Scalar<int64_t>(file.Ref(file.Element(fields, 3), 4), 0, -1) != 0) {
+        return "arrow: processName is not dictionary 0";
+    }
+
+    // Block i of a footer vector: its message table, and where its body starts
+    auto message = [&](size_t blocks, size_t i, size_t& body) {
+        size_t block = blocks + 4 + 24 * i;
+        size_t offset = static_cast<size_t>(file.Read<int64_t>(block));
+        body = offset + static_cast<size_t>(file.Read<int32_t>(block + 8));
+        if (file.Read<uint32_t>(offset) != 0xFFFFFFFF) {
+            body = 0;
+        }
+        return file.Root(offset + 8);
+    };
+    // Absolute position of buffer i of a record batch
+    auto buffer = [&](size_t batch, size_t body, size_t i, size_t& length) {
+        size_t at = file.Ref(batch, 2) + 4 + 16 * i;
+        length = static_cast<size_t>(file.Read<int64_t>(at + 8));
+        return body + static_cast<size_t>(file.Read<int64_t>(at));
+    };
+
+    size_t body = 0, length = 0, dataLength = 0;
+    size_t dictionary = message(file.Ref(footer, 2), 0, body);
+    size_t dictionaryHeader = file.Ref(dictionary, 2);
+    if (!body || file.Scalar<uint8_t>(dictionary, 1) != HEADER_DICTIONARY_BATCH ||
+        file.Scalar<int64_t>(dictionaryHeader, 0, -1) != 0) {
+        return "arrow: the first dictionary block is not dictionary 0";
+    }
+    size_t dictionaryBatch = file.Ref(dictionaryHeader, 1);
+    size_t nameCount = static_cast<size_t>(file.Scalar<int64_t>(dictionaryBatch, 0));
+    size_t offsets = buffer(dictionaryBatch, body, 1, length);
+    size_t data = buffer(dictionaryBatch, body, 2, dataLength);
+    if (length < 4 * (nameCount + 1) || nameCount > rows) {
+        return "arrow: dictionary 0 offsets are short";
+    }
+    std::vector<std::string> names;
+    for (size_t i = 0; i < nameCount && file.Ok(); ++i) {
+        size_t from = static_cast<size_t>(file.Read<int32_t>(offsets + 4 * i));
+        size_t to = static_cast<size_t>(file.Read<int32_t>(offsets + 4 * i + 4));
+        if (from > to || to > dataLength) {
+            return "arrow: dictionary 0 offsets are out of order";
+        }
+        names.push_back(bytes.substr(data + from, to - from));
+    }
+
+    size_t batches = file.Ref(footer, 3);
+    if (file.Length(batches) != (rows + batchRows - 1) / batchRows) {
+        return "arrow: " + std::to_string(file.Length(batches)) + " record batches for " + std::to_string(rows) +
+               " rows of " + std::to_string(batchRows);
+    }
+    size_t row = 0;
+    for (size_t b = 0; b < file.Length(batches) && file.Ok(); ++b) {
+        size_t batchMessage = message(batches, b, body);
+        size_t batch = file.Ref(batchMessage, 2);
+        size_t count = static_cast<size_t>(file.Scalar<int64_t>(batch, 0));
+        if (!body || file.Scalar<uint8_t>(batchMessage, 1) != HEADER_RECORD_BATCH || count > rows - row) {
+            return "arrow: block " + std::to_string(b) + " is not a record batch of the rows left";
+        }
+        // Two buffers a column, validity then values
+        size_t pids = buffer(batch, body, 2 * 2 + 1, length);
+        if (length < 4 * count) {
+            return "arrow: processId buffer is short";
+        }
+        size_t codes = buffer(batch, body, 3 * 2 + 1, length);
+        if (length < 4 * count) {
+            return "arrow: processName buffer is short";
+        }
+        for (size_t i = 0; i < count; ++i, ++row) {
+            uint32_t pid = file.Read<uint32_t>(pids + 4 * i);
+            size_t code = static_cast<size_t>(file.Read<int32_t>(codes + 4 * i));
+            if (pid != events[row].processId || code >= names.size() || names[code] != events[row].processName) {
+                return "arrow: row " + std::to_string(row) + " reads back differently";
+            }
+        }
+    }
+    if (!file.Ok()) {
+        return "arrow: metadata points outside the file";
+    }
+    if (row != rows) {
+        return "arrow: batches hold " + std::to_string(row) + " rows, expected " + std::to_string(rows);
+    }
+    return "";
+}
+
+// One export of arg events per iteration
+void ExportEvents(BenchmarkState& state, LogFormat format, const char* extension) {
+    auto events = MakeEvents(static_cast<size_t>(state.GetArg()));
+    std::filesystem::path output = ScratchDirectory() / (std::string("export.") + extension);
+    Logger logger(ScratchDirectory().wstring());
+    state.SetItemsPerIteration(events.size());
+
+    state.Start();
+    for (uint64_t i = 0; i < state.GetIterations(); ++i) {
+        logger.ExportEvents(events, output.wstring(), format);
+    }
+    state.Stop();
+    if (format == LogFormat::ARROW) {
+        static const std::string error = CheckArrowFile();
+        if (!error.empty()) {
+            state.Fail(error);
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::remove(output, ec);
+}
+
+// 1M stored events from 301 distinct processes, with the search index
+// built over them once; the index build time is kept for the label
+struct SearchFixture {
+    EventStore store;
+    std::vector<AudioEvent> events;  // Store order, sequence = firstSequence + position
+    uint64_t firstSequence;
+    SearchIndex index;
+    double buildMs;
+
+    SearchFixture() : store(SIZE_MAX), firstSequence(0), index(2000000), buildMs(0.0) {
+        std::vector<std::string> names(PROCESS_NAMES, PROCESS_NAMES + PROCESS_COUNT);
+        while (names.size() < 301) {
+            names.push_back("app" + std::to_string(names.size()) + ".exe");
+        }
+        std::mt19937 random(11);
+        auto time = std::chrono::system_clock::now() - std::chrono::hours(24);
+        AudioEvent event;
+        event.soundDescription = "Application sound";
+        size_t previous = names.size();
+        for (size_t i = 0; i < 1000000; ++i) {
+            size_t name = random() % names.size();
+            name = name == previous ? (name + 1) % names.size() : name;  // Never batch
+            previous = name;
+            time += std::chrono::milliseconds(10);
+            event.timestamp = time;
+            event.processId = static_cast<DWORD>(1000 + name);
+            event.processName = names[name];
+            event.processPath = "C:\\Program Files\\" + names[name];
+            store.Add(event);
+        }
+        EventDelta delta = store.ReadSince(0);
+        events = std::move(delta.events);
+        firstSequence = delta.firstSequence;
+
+        auto start = std::chrono::steady_clock::now();
+        index.Sync(store);
+        buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+};
+
+SearchFixture& Searchable() {
+    static SearchFixture fixture;
+    return fixture;
+}
+
+const char* const SEARCH_QUERIES[] = { "chrome", "/^chr/", "process:app1" };
+
+// Sequences a filter over every event finds, as the old filter did
+std::vector<uint64_t> ScanMatches(const SearchFixture& fixture, const SearchQuery& query) {
+    std::vector<uint64_t> matches;
+    for (size_t i = 0; i < fixture.events.size(); ++i) {
+        if (query.Matches(fixture.events[i])) {
+            matches.push_back(fixture.firstSequence + i);
+        }
+    }
+    return matches;
+}
+
+void SetQueryLabel(BenchmarkState& state, const char* prefix) {
+    double ms = std::chrono::duration<double, std::milli>(state.GetElapsed()).count() /
+                static_cast<double>(state.GetIterations());
+    char label[96];
+    std::snprintf(label, sizeof(label), "%s %.2f ms/query", prefix, ms);
+    state.SetLabel(label);
+}
+
+// One indexed query over 1M events per iteration; reported per stored event.
+// Fails unless the index finds exactly what a scan with Matches finds.
+void SearchIndexFind(BenchmarkState& state) {
+    auto& fixture = Searchable();
+    SearchQuery query;
+    query.Parse(SEARCH_QUERIES[state.GetArg()]);
+    state.SetItemsPerIteration(fixture.events.size());
+
+    std::vector<uint64_t> found;
+    state.Start();
+    for (uint64_t i = 0; i < state.GetIterations(); ++i) {
+        found = fixture.index.Find(query);
+    }
+    state.Stop();
+
+    char prefix[48];
+    std::snprintf(prefix, sizeof(prefix), "build %.0f ms,", fixture.buildMs);
+    SetQueryLabel(state, prefix);
+    std::vector<uint64_t> expected = ScanMatches(fixture, query);
+    if (expected.empty() || found != expected) {
+        state.Fail("index found " + std::to_string(found.size()) + " events, a scan " +
+                   std::to_string(expected.size()));
+    }
+}
+
+// The same queries answered by SearchQuery::Matches over every event
+void SearchQueryScan(BenchmarkState& state) {
+    auto& fixture = Searchable();
+    SearchQuery query;
+    query.Parse(SEARCH_QUERIES[state.GetArg()]);
+    state.SetItemsPerIteration(fixture.events.size());
+
+    size_t found = 0;
+    state.Start();
+    for (uint64_t i = 0; i < state.GetIterations(); ++i) {
+        for (const auto& event : fixture.events) {
+            found += query.Matches(event) ? 1 : 0;
+        }
+    }
+    state.Stop();
+
+    SetQueryLabel(state, "scan");
+    if (found == 0) {
+        state.Fail("scan matched nothing");
+    }
+}
+
+// One UpdateListView tick after a new event: index and view model catch up
+// with the store. arg 1 applies a filter that matches a twelfth of events.
+void ListViewTick(BenchmarkState& state) {
+    auto events = MakeEvents(20000);
+    EventStore store;
+    SearchIndex index;
+    EventViewModel viewModel;
+    viewModel.AttachIndex(&index);
+    viewModel.SetFilter(state.GetArg() ? "spotify" : "");
+    std::vector<RowDiff> diffs;
+    auto windowStart = (std::chrono::system_clock::time_point::min)();
+
+    FillStore(store, std::vector<AudioEvent>(events.begin(), events.begin() + 5000));
+    index.Sync(store);
+    viewModel.Sync(store, windowStart, diffs);
+
+    state.Start();
+    for (uint64_t i = 0; i < state.GetIterations(); ++i) {
+        store.Add(events[5000 + i % 15000]);
+        index.Sync(store);
+        diffs.clear();
+        viewModel.Sync(store, windowStart, diffs);
+    }
+    state.Stop();
+}
+
+// Typing in the filter box: the view model is rebuilt from a store of arg
+// events, answered by the search index. Reported per stored event.
+void ListViewFilterChange(BenchmarkState& state) {
+    size_t count = static_cast<size_t>(state.GetArg());
+    EventStore store(SIZE_MAX);
+    FillStore(store, MakeEvents(count));
+    SearchIndex index(count);
+    index.Sync(store);
+    EventViewModel viewModel;
+    viewModel.AttachIndex(&index);
+    std::vector<RowDiff> diffs;
+    auto windowStart = (std::chrono::system_clock::time_point::min)();
+    state.SetItemsPerIteration(count);
+
+    state.Start();
+    for (uint64_t i = 0; i < state.GetIterations(); ++i) {
+        viewModel.SetFilter(i % 2 ? "spotify" : "discord");
+        diffs.clear();
+        viewModel.Sync(store, windowStart, diffs);
+    }
+    state.Stop();
+}
+
+// A ListView row as the view last drew it; stale rows are fetched again
+struct ShownRow {
+    bool stale;
+    AudioEvent event;
+};
+
+// Applies diffs the way the owner-data ListView does: counts move with
+// Insert and Remove, Update and Reset mark rows to redraw, and only those
+// are read back from the model
+void ApplyDiffs(std::deque<ShownRow>& shown, const std::vector<RowDiff>& diffs, const EventViewModel& model) {
+    for (const auto& diff : diffs) {
+        auto at = shown.begin() + static_cast<ptrdiff_t>(diff.index);
+        switch (diff.kind) {
+        case RowDiff::Kind::Insert:
+            shown.insert(at, diff.count, ShownRow{ true, AudioEvent() });
+            break;
+        case RowDiff::Kind::Update:
+            for (size_t i = 0; i < diff.count; ++i) {
+                at[static_cast<ptrdiff_t>(i)].stale = true;
+            }
+            break;
+        case RowDiff::Kind::Remove:
+            shown.erase(at, at + static_cast<ptrdiff_t>(diff.count));
+            break;
+        case RowDiff::Kind::Reset:
+            shown.assign(diff.count, ShownRow{ true, AudioEvent() });
+            break;
+        }
+    }
+    for (size_t i = 0; i < shown.size() && i < model.GetRowCount(); ++i) {
+        if (shown[i].stale) {
+            shown[i] = { false, model.GetRow(i) };
+        }
+    }
+}
+
+// Random adds, batched updates, filter changes, window expiry and store
+// clears, synced in small groups. After every Sync the rows rebuilt from
+// the diffs must equal what a fresh model builds from the store.
+std::string CheckDiffReplay(size_t steps) {
+    static const char* const FILTERS[] = { "", "spotify", "discord", "sound:ding" };
+    FakeProcessInfo info;
+    EventEnricher enricher(info);
+    std::mt19937 random(7);
+    EventStore store(SIZE_MAX);
+    SearchIndex index;
+    EventViewModel model;
+    model.AttachIndex(&index);
+    std::deque<ShownRow> shown;
+    std::vector<RowDiff> diffs;
+    std::string filter;
+    auto time = std::chrono::system_clock::now() - std::chrono::hours(24);
+    auto windowStart = time;
+
+    for (size_t step = 0; step < steps; ++step) {
+        size_t ops = 1 + random() % 4;
+        for (size_t op = 0; op < ops; ++op) {
+            uint32_t roll = random() % 100;
+            if (roll < 75) {
+                // Mostly a few processes within a minute, so many batch
+                time += std::chrono::milliseconds(random() % 20000);
+                DWORD processId = static_cast<DWORD>(1 + random() % 4);
+                AudioEvent event = enricher.Enrich(processId, (random() % 100) / 100.0f,
+                                                   (random() % 100) / 100.0f, "", time);
+                event.momentaryLoudness = -40.0f + static_cast<float>(random() % 30);
+                event.features.frames = random() % 3;
+                event.soundLabel = random() % 4 == 0 ? "ding" : "";
+                store.Add(event);
+            } else if (roll < 85) {
+                filter = FILTERS[random() % 4];
+                model.SetFilter(filter);
+            } else if (roll < 95) {
+                windowStart += std::chrono::milliseconds(random() % 120000);
+            } else if (roll < 97) {
+                store.Clear();
+            } else {
+                index.Sync(store);
+            }
+        }
+
+        diffs.clear();
+        model.Sync(store, windowStart, diffs);
+        ApplyDiffs(shown, diffs, model);
+
+        EventViewModel reference;
+        std::vector<RowDiff> ignored;
+        reference.SetFilter(filter);
+        reference.Sync(store, windowStart, ignored);
+        if (shown.size() != reference.GetRowCount()) {
+            return "step " + std::to_string(step) + ": diffs leave " + std::to_string(shown.size()) +
+                   " rows, a rebuild has " + std::to_string(reference.GetRowCount());
+        }
+        for (size_t i = 0; i < shown.size(); ++i) {
+            if (!SameEvent(shown[i].event, reference.GetRow(i))) {
+                return "step " + std::to_string(step) + ": row " + std::to_string(i) + " differs from a rebuild";
+            }
+        }
+    }
+    return "";
+}
+
+// A view model that has never synced rebuilds from a store of 100k events
+void ViewModelRebuild(BenchmarkState& state) {
+    static const std::string error = CheckDiffReplay(5000);
+    static EventStore store(SIZE_MAX);
+    if (store.GetEventCount() == 0) {
+        FillStore(store, MakeEvents(100000));
+    }
+    std::vector<RowDiff> diffs;
+    auto windowStart = (std::chrono::system_clock::time_point::min)();
+    state.SetItemsPerIteration(store.GetEventCount());
+
+    size_t rows = 0;
+    state.Start();
+    for (uint64_t i = 0; i < state.GetIterations(); ++i) {
+        EventViewModel model;
+        diffs.clear();
+        model.Sync(store, windowStart, diffs);
+        rows += model.GetRowCount();
+    }
+    state.Stop();
+
+    if (!error.empty()) {
+        state.Fail("diff replay: " + error);
+    } else if (rows != store.GetEventCount() * state.GetIterations()) {
+        state.Fail("rebuild dropped rows");
+    }
+}
+
+// One Sync per new event against 100k shown rows; every other event batches
+// into the previous one, and the window slides so the row count holds
+void ViewModelSync(BenchmarkState& state) {
+    auto events = MakeEvents(100000);
+    const auto spacing = std::chrono::milliseconds(10);
+    auto time = events.front().timestamp;
+    for (auto& event : events) {
+        event.timestamp = time;
+        time += spacing;
+    }
+    EventStore store(SIZE_MAX);
+    FillStore(store, events);
+    EventViewModel model;
+    std::vector<RowDiff> diffs;
+    auto windowStart = events.front().timestamp;
+    model.Sync(store, windowStart, diffs);
+
+    AudioEvent event = events.back();
+    time = event.timestamp;
+    size_t updates = 0;
+    state.Start();
+    for (uint64_t i = 0; i < state.GetIterations(); ++i) {
+        if (i % 2 == 0) {
+            time += spacing;
+            windowStart += spacing;
+            event.processId = static_cast<DWORD>(200 + (i / 2) % 2);
+        }
+        event.timestamp = time;
+        event.peakLevel = static_cast<float>(i % 100) / 100.0f;
+        store.Add(event);
+        diffs.clear();
+        model.Sync(store, windowStart, diffs);
+        for (const auto& diff : diffs) {
+            updates += diff.kind == RowDiff::Kind::Update ? 1 : 0;
+        }
+    }
+    state.Stop();
+
+    if (model.GetRowCount() != events.size()) {
+        state.Fail(std::to_string(model.GetRowCount()) + " rows shown, expected " + std::to_string(events.size()));
+    } else if (updates != state.GetIterations() / 2) {
+        state.Fail(std::to_string(updates) + " batched updates redrawn of " +
+                   std::to_string(state.GetIterations() / 2));
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    auto& registry = BenchmarkRegistry::Instance();
+    registry.Add("Utf8.Transcode.UTF16", Utf8Transcode<char16_t>, { 0, 1 }, "mixed");
+    registry.Add("Utf8.Transcode.UTF32", Utf8Transcode<char32_t>, { 0, 1 }, "mixed");
+    registry.Add("AddAudioEvent", AddAudioEvent, { 1, 16 }, "processes");
+    registry.Add("Pipeline", Pipeline, { 1, 16 }, "processes");
+    registry.Add("EventStore.Add", EventStoreAdd, { 1, 16 }, "processes");
+    registry.Add("EventStore.GetEvents", [](BenchmarkState& s) { GetEvents(s, false); },
+                 { 100, 10000, 100000 }, "inRange");
+    registry.Add("EventStore.GetEvents.Sealed", [](BenchmarkState& s) { GetEvents(s, true); },
+                 { 100, 10000, 100000 }, "inRange");
+    registry.Add("EventChunk.Encode", EventChunkEncode);
+    registry.Add("EventChunk.Decode", EventChunkDecode);
+    registry.Add("EventChunk.Copy", EventChunkCopy);
+    registry.Add("LevelSeries.Append", LevelSeriesAppend);
+    registry.Add("LevelSeries.Read", LevelSeriesRead, { 0, 1000 }, "buckets");
+    registry.Add("SpectralAnalyzer.Push", SpectralAnalyzerPush, { 0, 1, 2 }, "fixture");
+    registry.Add("FingerprintIndex.Build", FingerprintBuild, { 100, 1000 }, "sounds");
+    registry.Add("FingerprintIndex.Match", FingerprintQuery, { 100, 1000 }, "sounds");
+    registry.Add("OnsetDetector.Push", OnsetDetectorPush, { 0, 1 }, "background");
+    registry.Add("LoudnessMeter.Push", LoudnessMeterPush, { 2, 6 }, "channels");
+    registry.Add("SessionCoalescer.Observe", SessionCoalescerObserve, { 1, 32 }, "burst");
+    registry.Add("TimestampClock.Capture", TimestampCapture, { 0, 1, 2 }, "clock");
+    registry.Add("TimestampClock.ToLocalTime", TimestampLocalTime, { 0, 1 }, "cached");
+    registry.Add("EndpointPool.Round", EndpointPoolRound, { 1, 16, 64 }, "endpoints");
+    registry.Add("MeterGate.Tick", MeterGateTick, { 4, 16 }, "sessions");
+    registry.Add("RuleEngine.Evaluate", RuleEngineEvaluate, { 10, 1000, 10000 }, "rules");
+    registry.Add("EventQuery.Scan", EventQueryScan, { 0, 1, 2 }, "query");
+    registry.Add("EventStore.Add.Spilling", EventStoreAddSpilling);
+    registry.Add("EventStore.GetEvents.Spilled", GetEventsSpilled, { 100, 10000, 100000 }, "inRange");
+    registry.Add("EventRing.Recover", EventRingRecover);
+    registry.Add("Metrics.Record", MetricsRecord);
+    registry.Add("SpanTracer.Record", SpanTracerRecord, { 0, 1 }, "enabled");
+    registry.Add("TraceReplayer.Replay", TraceReplayerReplay);
+    registry.Add("GetSoundDescription", GetSoundDescription, { 0, 1, 2, 3 }, "path");
+    registry.Add("Logger.LogEvent", LoggerLogEvent);
+    registry.Add("Logger.ExportEvents.CSV", [](BenchmarkState& s) { ExportEvents(s, LogFormat::CSV, "csv"); },
+                 { 1000, 10000 }, "events");
+    registry.Add("Logger.ExportEvents.JSON", [](BenchmarkState& s) { ExportEvents(s, LogFormat::JSON, "json"); },
+                 { 1000, 10000 }, "events");
+    registry.Add("Logger.ExportEvents.TEXT", [](BenchmarkState& s) { ExportEvents(s, LogFormat::TEXT, "txt"); },
+                 { 1000, 10000 }, "events");
+    registry.Add("Logger.ExportEvents.ARROW", [](BenchmarkState& s) { ExportEvents(s, LogFormat::ARROW, "arrow"); },
+                 { 1000, 10000 }, "events");
+    registry.Add("CsvReader.Parse", CsvReaderParse, { 1, 2, 4, 8 }, "chunks");
+    registry.Add("SearchIndex.Find", SearchIndexFind, { 0, 1, 2 }, "query");
+    registry.Add("SearchQuery.Matches", SearchQueryScan, { 0, 1, 2 }, "query");
+    registry.Add("ListView.Tick", ListViewTick, { 0, 1 }, "filter");
+    registry.Add("ListView.FilterChange", ListViewFilterChange, { 10000, 100000 }, "events");
+    registry.Add("EventViewModel.Rebuild", ViewModelRebuild);
+    registry.Add("EventViewModel.Sync", ViewModelSync);
+    return registry.Run(argc, argv);
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <ostream>
+#include "AudioEvent.h"
+
+// Writes events as an Apache Arrow IPC file (metadata version V5) that
+// pyarrow, DuckDB, Polars etc. can open directly.
+// The flatbuffer metadata is encoded by hand so no Arrow library is needed.
+// Timestamps, PIDs, counts and levels are native typed columns; the
+// repeated string columns are dictionary-encoded.
+class ArrowWriter {
+private:
+    size_t m_batchRows;
+
+public:
+    static const size_t DEFAULT_BATCH_ROWS = 64 * 1024;
+
+    explicit ArrowWriter(size_t batchRows = DEFAULT_BATCH_ROWS);
+
+    // Writes a complete IPC file; record batches hold at most batchRows rows
+    bool Write(const std::vector<AudioEvent>& events, std::ostream& out);
+    bool WriteFile(const std::vector<AudioEvent>& events, const std::wstring& outputPath);
+
+    size_t GetBatchRows() const { return m_batchRows; }
+};
\ No newline at end of file
@@ -1,23 +1,88 @@
 #pragma once
+#include <cstdint>
+#ifdef _WIN32
 #define NOMINMAX  // Prevent Windows.h from defining min/max macros
 #include <windows.h>
+#else
+typedef uint32_t DWORD;  // Lets portable tooling (exporters, readers) build off Windows
+#endif
 #include <string>
 #include <chrono>
+#include <initializer_list>
+
+// ITU-R BS.1770 absolute gate; loudness at or below it is silence, or was not measured
+const float LOUDNESS_FLOOR_LUFS = -70.0f;
+
+// Spectral summary of what the default output played around an event; only
+// filled in while loopback feature capture runs (see SpectralAnalyzer)
+struct SoundFeatures {
+    static const size_t MFCC_COUNT = 13;
+
+    uint32_t frames = 0;            // Analysis frames averaged in; 0 = no features
+    float rms = 0.0f;               // Signal level, 0.0 - 1.0 full scale
+    float centroidHz = 0.0f;        // Spectral "brightness"
+    float flux = 0.0f;              // Spectral change from frame to frame, 0.0 - 1.4
+    float zeroCrossingRate = 0.0f;  // Sign changes per sample, 0.0 - 1.0
+    float mfcc[MFCC_COUNT] = {};    // Mel-frequency cepstral coefficients
+};
+
+// Folds from into into as a frame-weighted mean
+inline void MergeSoundFeatures(SoundFeatures& into, const SoundFeatures& from) {
+    if (from.frames == 0) {
+        return;
+    }
+    float total = static_cast<float>(into.frames) + static_cast<float>(from.frames);
+    float a = static_cast<float>(into.frames) / total;
+    float b = static_cast<float>(from.frames) / total;
+    into.rms = into.rms * a + from.rms * b;
+    into.centroidHz = into.centroidHz * a + from.centroidHz * b;
+    into.flux = into.flux * a + from.flux * b;
+    into.zeroCrossingRate = into.zeroCrossingRate * a + from.zeroCrossingRate * b;
+    for (size_t i = 0; i < SoundFeatures::MFCC_COUNT; ++i) {
+        into.mfcc[i] = into.mfcc[i] * a + from.mfcc[i] * b;
+    }
+    into.frames += from.frames;
+}
 
 // Separate header for AudioEvent to avoid circular dependencies
-// This struct represents a single audio event captured by the tracker
+// This struct represents a single audio event captured by the tracker.
+// Strings are UTF-8; convert with Utf8ToWide only where Win32 needs wide text.
 struct AudioEvent {
     std::chrono::system_clock::time_point timestamp;  // When the sound occurred
     DWORD processId = 0;                              // Process ID making the sound
-    std::wstring processName;                         // Executable name (e.g., "Discord.exe")
-    std::wstring processPath;                         // Full path to executable
-    std::wstring soundDescription;                    // Human-readable description
-    std::wstring sessionDisplayName;                  // Audio session display name
+    std::string processName;                          // Executable name (e.g., "Discord.exe")
+    std::string processPath;                          // Full path to executable
+    std::string soundDescription;                     // Human-readable description
+    std::string sessionDisplayName;                   // Audio session display name
     float volumeLevel = 0.0f;                         // Current volume (0.0 - 1.0)
     float peakLevel = 0.0f;                           // Peak audio level (0.0 - 1.0)
+    float momentaryLoudness = LOUDNESS_FLOOR_LUFS;    // LUFS over the 400 ms before, if captured
+    float shortTermLoudness = LOUDNESS_FLOOR_LUFS;    // LUFS over the 3 s before, if captured
     bool isSystemSound = false;                       // True if Windows system sound
     DWORD duration_ms = 0;                            // Duration in milliseconds
     DWORD eventCount = 1;                             // Number of events batched (same millisecond)
-    std::wstring usbDeviceInfo;                       // USB device information if applicable
-    std::wstring browserTabInfo;                      // Browser tab title if applicable
-};
\ No newline at end of file
+    std::string usbDeviceInfo;                        // USB device information if applicable
+    std::string browserTabInfo;                       // Browser tab title if applicable
+    SoundFeatures features;                           // Loopback spectral features, if captured
+    std::string soundLabel;                           // Known sound recognized by fingerprint, if any
+    std::string endpointId;                           // Render endpoint (IMMDevice id) it played on, if known
+};
+
+// True if loopback capture measured the loudness around the event, and it was not silence
+inline bool HasLoudness(const AudioEvent& event) {
+    return event.momentaryLoudness > LOUDNESS_FLOOR_LUFS || event.shortTermLoudness > LOUDNESS_FLOOR_LUFS;
+}
+
+// Memory an event holds: the struct plus string buffers too long for the
+// small-string optimization. Used for the store's byte budget.
+inline size_t AudioEventBytes(const AudioEvent& event) {
+    size_t bytes = sizeof(AudioEvent);
+    for (const std::string* field : { &event.processName, &event.processPath, &event.soundDescription,
+                                      &event.sessionDisplayName, &event.usbDeviceInfo, &event.browserTabInfo,
+                                      &event.soundLabel, &event.endpointId }) {
+        if (field->capacity() > std::string().capacity()) {
+            bytes += field->capacity() + 1;
+        }
+    }
+    return bytes;
+}
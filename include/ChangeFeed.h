@@ -0,0 +1,56 @@
+#pragma once
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <condition_variable>
+
+// Wakes subscribers when a revision number advances. Each subscriber is
+// called at most maxFramesPerSecond times a second, from one dispatch thread,
+// with the newest revision; bursts in between coalesce into a single call.
+// Callbacks should only schedule a pull of the delta (e.g. post a message),
+// never block. Nothing runs and no thread exists until someone subscribes.
+class ChangeFeed {
+public:
+    using Callback = std::function<void(uint64_t revision)>;
+
+private:
+    struct Subscriber {
+        uint64_t id;
+        Callback callback;
+        std::chrono::steady_clock::duration minInterval;
+        std::chrono::steady_clock::time_point lastCall;
+        uint64_t notified;  // Revision passed to the last call
+    };
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::vector<Subscriber> m_subscribers;
+    uint64_t m_revision;
+    uint64_t m_nextId;
+    uint64_t m_calling;  // Subscriber whose callback is running, or 0
+    bool m_stopping;
+    std::thread m_thread;
+
+    void DispatchThreadProc();
+
+public:
+    static const unsigned DEFAULT_MAX_FPS = 30;
+
+    ChangeFeed();
+    ~ChangeFeed();
+
+    ChangeFeed(const ChangeFeed&) = delete;
+    ChangeFeed& operator=(const ChangeFeed&) = delete;
+
+    // Returns an id for Unsubscribe; never 0. A new subscriber is first called
+    // on the next Publish.
+    uint64_t Subscribe(Callback callback, unsigned maxFramesPerSecond = DEFAULT_MAX_FPS);
+    // The callback is not running and will not run again once this returns
+    void Unsubscribe(uint64_t id);
+
+    // Cheap when nothing is subscribed; older revisions are ignored
+    void Publish(uint64_t revision);
+};
@@ -0,0 +1,30 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "AudioEvent.h"
+#include "EventStore.h"
+
+// Reads sound_log_*.csv files written by Logger back into events.
+// The body is split into one chunk per thread; a SIMD quote count per chunk
+// tells each thread whether its chunk starts inside a quoted field, so every
+// chunk can find its first row boundary and parse independently.
+class CsvReader {
+private:
+    unsigned m_threads;
+    size_t m_rejectedRows;
+
+public:
+    // threads == 0 uses one per hardware thread
+    explicit CsvReader(unsigned threads = 0);
+
+    // Parses a whole log held in memory; rows are returned in file order.
+    // Fails only when the header does not match the log schema.
+    bool Parse(const char* data, size_t size, std::vector<AudioEvent>& events);
+
+    // Maps the file read-only and parses it
+    bool ReadFile(const std::wstring& path, std::vector<AudioEvent>& events);
+    bool ReadFile(const std::wstring& path, EventStore& store);
+
+    // Malformed rows skipped by the last Parse/ReadFile
+    size_t GetRejectedRows() const { return m_rejectedRows; }
+};
@@ -0,0 +1,52 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+
+// Polls one audio endpoint: its session manager and whatever per-session
+// state it keeps. Made, polled and destroyed on its worker's thread, so COM
+// objects it holds never cross threads.
+class EndpointPoller {
+public:
+    virtual ~EndpointPoller() {}
+    virtual void Poll() = 0;
+};
+
+// One polling thread per endpoint, so a slow or wedged device only delays
+// its own sessions and a tick costs the slowest endpoint rather than all of
+// them together. Each worker polls, then sleeps out the rest of its
+// interval. Sync starts and stops workers as endpoints come and go; a
+// worker stuck inside a device call holds up only its own removal.
+class EndpointPool {
+public:
+    // May return null for an endpoint that cannot be opened; its worker then idles
+    typedef std::function<std::unique_ptr<EndpointPoller>(const std::string& endpointId)> Factory;
+
+private:
+    struct Worker;
+
+    Factory m_factory;
+    std::chrono::microseconds m_interval;
+    mutable std::mutex m_mutex;  // Guards m_workers; Sync and Clear run one at a time
+    std::vector<std::unique_ptr<Worker>> m_workers;
+
+    static void StopWorkers(std::vector<std::unique_ptr<Worker>>& workers);
+
+public:
+    EndpointPool(Factory factory, std::chrono::microseconds interval);
+    ~EndpointPool();
+
+    // Polls exactly these endpoints from now on
+    void Sync(const std::vector<std::string>& endpointIds);
+    void Clear();
+
+    size_t GetWorkerCount() const;
+    // Polls finished by the endpoint polled least; rises by one each time
+    // every endpoint has been polled again
+    uint64_t GetRounds() const;
+};
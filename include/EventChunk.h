@@ -0,0 +1,47 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <cstdint>
+#include "AudioEvent.h"
+#include "EventColumns.h"
+
+// Immutable, compressed run of events, oldest first, for the bulk of the
+// store that is rarely read. Timestamps are delta-of-delta coded, PIDs and
+// strings go through per-chunk dictionaries and are referred to by varint
+// ids, and both levels and the system flag are bit-packed into 32 bits, so
+// an event takes a couple of dozen bytes instead of several hundred. Nothing
+// is decoded until a query touches the chunk. Levels are kept to 0.01%, the
+// precision the CSV log records; spectral features and loudness, where an
+// event has them, are kept exactly. Copies share the bytes, so a reader can
+// take its own copy of a chunk under a lock and decode it outside.
+class EventChunk {
+private:
+    std::shared_ptr<const std::vector<uint8_t>> m_data;  // Null until encoded or loaded
+    std::chrono::system_clock::time_point m_first;  // Earliest and latest timestamps
+    std::chrono::system_clock::time_point m_last;
+    uint32_t m_count;
+
+public:
+    EventChunk();
+
+    static EventChunk Encode(const AudioEvent* events, size_t count);
+    // Takes bytes from GetData, e.g. read back from a spill segment.
+    // Returns false if the header is malformed.
+    bool Load(std::vector<uint8_t> data);
+
+    // Appends the events in [startTime, endTime]; strings are only built for those
+    void Decode(const std::chrono::system_clock::time_point& startTime,
+                const std::chrono::system_clock::time_point& endTime, std::vector<AudioEvent>& out) const;
+    // Appends the events from index on
+    void DecodeFrom(size_t index, std::vector<AudioEvent>& out) const;
+    // Every event as columns for a query; no strings are built, the batch's
+    // dictionaries point into this chunk. Stops at the first malformed byte.
+    void DecodeColumns(EventColumns& columns) const;
+
+    size_t GetCount() const { return m_count; }
+    std::chrono::system_clock::time_point GetFirstTime() const { return m_first; }
+    std::chrono::system_clock::time_point GetLastTime() const { return m_last; }
+    const std::vector<uint8_t>& GetData() const;
+    size_t GetMemoryUsage() const { return sizeof(EventChunk) + (m_data ? m_data->capacity() : 0); }
+};
@@ -0,0 +1,55 @@
+#pragma once
+#include <vector>
+#include <string_view>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+#include "AudioEvent.h"
+
+// One batch of events laid out column by column for analytical queries (see
+// EventQuery): numbers in flat arrays that kernels sweep a column at a time,
+// strings as codes into the batch's own dictionaries. Dictionary entries
+// point into the chunk or events the batch was filled from, which must
+// outlive it. Buffers are kept from batch to batch.
+struct EventColumns {
+    enum class Value : uint8_t {
+        Events,     // eventCount
+        Duration,   // duration_ms
+        Volume,
+        Peak,
+        Momentary,  // LUFS
+        ShortTerm,
+        Count
+    };
+    enum class Text : uint8_t {
+        Process,
+        Sound,
+        Endpoint,
+        Count
+    };
+    static const size_t VALUE_COUNT = static_cast<size_t>(Value::Count);
+    static const size_t TEXT_COUNT = static_cast<size_t>(Text::Count);
+
+    size_t count = 0;
+    int64_t firstTicks = 0;  // Earliest and latest timestamps, system_clock ticks
+    int64_t lastTicks = 0;
+    std::vector<int64_t> ticks;
+    std::vector<float> values[VALUE_COUNT];
+    std::vector<uint8_t> systemSound;
+    std::vector<uint32_t> pidCodes;  // Into pids
+    std::vector<DWORD> pids;
+    std::vector<uint32_t> codes[TEXT_COUNT];
+    std::vector<std::string_view> dictionaries[TEXT_COUNT];
+
+    void Clear();
+    void Resize(size_t rows);
+    // From events in memory, e.g. the store's newest, not yet sealed
+    void FromRows(const AudioEvent* events, size_t rows);
+
+    std::vector<float>& Get(Value value) { return values[static_cast<size_t>(value)]; }
+    const std::vector<float>& Get(Value value) const { return values[static_cast<size_t>(value)]; }
+
+private:
+    std::unordered_map<std::string_view, uint32_t> m_lookup;  // Dictionary building scratch
+    std::unordered_map<DWORD, uint32_t> m_pidLookup;
+};
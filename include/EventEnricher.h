@@ -0,0 +1,40 @@
+#pragma once
+#include <string>
+#include <chrono>
+#include "AudioEvent.h"
+
+// Lookups AddAudioEvent needs from the OS. SoundTracker answers them with
+// Win32 calls; benchmarks and tools plug in fakes. Each lookup replaces the
+// contents of its output string (empty when there is no answer), so buffers
+// are reused from one event to the next.
+class ProcessInfoProvider {
+public:
+    virtual ~ProcessInfoProvider() = default;
+
+    virtual void GetProcessNameFromPID(DWORD processId, std::string& name) = 0;
+    virtual void GetProcessPathFromPID(DWORD processId, std::string& path) = 0;
+    virtual void GetUSBDeviceInfo(DWORD processId, const std::string& processName, std::string& info) = 0;
+    virtual void GetBrowserTabInfo(DWORD processId, const std::string& processName, std::string& info) = 0;
+};
+
+// Turns a raw session sample into the event that is stored and logged
+class EventEnricher {
+private:
+    ProcessInfoProvider& m_provider;
+
+public:
+    explicit EventEnricher(ProcessInfoProvider& provider) : m_provider(provider) {}
+
+    // Human-readable description of what is making the sound
+    static std::string GetSoundDescription(DWORD processId, const std::string& processName);
+    static void AppendSoundDescription(DWORD processId, const std::string& processName, std::string& out);
+
+    AudioEvent Enrich(DWORD processId, float volume, float peak, const std::string& sessionName,
+                      const std::chrono::system_clock::time_point& timestamp) const;
+
+    // Overwrites every field of event. Reusing one event per thread keeps
+    // the string buffers, so once they have grown enrichment does not
+    // allocate.
+    void Enrich(DWORD processId, float volume, float peak, const std::string& sessionName,
+                const std::chrono::system_clock::time_point& timestamp, AudioEvent& event) const;
+};
@@ -0,0 +1,105 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+#include "AudioEvent.h"
+#include "EventChunk.h"
+#include "EventColumns.h"
+
+// What rows are grouped by, besides the time bucket
+enum class QueryGroup : uint8_t {
+    None,
+    Process,      // Process name
+    Pid,
+    Sound,        // Recognized sound label
+    Endpoint,
+    SystemSound,  // "yes" or "no"
+    PeakLevel,    // Bins of binWidth, a histogram of peaks
+    VolumeLevel
+};
+
+enum class QueryAggregate : uint8_t {
+    Count,  // Rows; the column is ignored
+    Sum,
+    Min,
+    Max,
+    Mean,
+    Quantile
+};
+
+struct QueryMeasure {
+    QueryAggregate aggregate;
+    EventColumns::Value column;
+    double quantile;  // 0.0 - 1.0, for Quantile
+};
+
+// An analytical query over stored events, e.g. events per process per
+// minute over the last day:
+//   query.start = now - 24h; query.group = QueryGroup::Process;
+//   query.bucket = std::chrono::minutes(1); query.AddMeasure(QueryAggregate::Count);
+// or a histogram of chrome.exe's peaks:
+//   query.processes = { "chrome.exe" }; query.group = QueryGroup::PeakLevel;
+//   query.binWidth = 0.05; query.AddMeasure(QueryAggregate::Count);
+struct EventQuery {
+    // Filter
+    std::chrono::system_clock::time_point start = (std::chrono::system_clock::time_point::min)();
+    std::chrono::system_clock::time_point end = (std::chrono::system_clock::time_point::max)();
+    std::vector<std::string> processes;  // Any of these, ignoring ASCII case; empty for all
+    float minPeak = 0.0f;                // Inclusive
+    float maxPeak = 1.0f;
+    bool excludeSystemSounds = false;
+
+    // Grouping; buckets are multiples of bucket since the epoch (UTC), 0 for none
+    QueryGroup group = QueryGroup::None;
+    float binWidth = 0.1f;
+    std::chrono::milliseconds bucket{ 0 };
+
+    std::vector<QueryMeasure> measures;
+    size_t threads = 0;  // 0 for one per hardware thread
+
+    void AddMeasure(QueryAggregate aggregate, EventColumns::Value column = EventColumns::Value::Peak,
+                    double quantile = 0.5) {
+        measures.push_back({ aggregate, column, quantile });
+    }
+};
+
+struct QueryRow {
+    std::chrono::system_clock::time_point bucket;  // Start; min() when not bucketed
+    std::string group;                             // Empty for QueryGroup::None
+    std::vector<double> values;                    // One per measure
+};
+
+struct QueryResult {
+    std::vector<QueryRow> rows;  // By bucket, then group (levels and pids numerically)
+    uint64_t rowsScanned = 0;
+    uint64_t rowsMatched = 0;
+    uint64_t chunksSkipped = 0;  // Pruned by time range without decoding
+};
+
+// Runs an EventQuery column at a time. Each chunk, or slice of in-memory
+// rows, is decoded into an EventColumns batch; filters build a selection
+// mask with SIMD kernels, group ids are computed over whole columns and
+// aggregates are scattered into a dense per-batch table that is folded into
+// per-thread results, merged at the end. Chunks are shared out among
+// threads as they finish. Sources are not copied and must outlive Run.
+class EventQueryExecutor {
+private:
+    struct Source {
+        const EventChunk* chunk;
+        const AudioEvent* rows;
+        size_t count;
+    };
+
+    EventQuery m_query;
+    std::vector<Source> m_sources;
+
+public:
+    explicit EventQueryExecutor(const EventQuery& query);
+
+    void AddChunk(const EventChunk& chunk);
+    void AddRows(const AudioEvent* events, size_t count);
+
+    QueryResult Run() const;
+};
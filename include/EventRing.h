@@ -0,0 +1,57 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "AudioEvent.h"
+
+// Memory-mapped ring of recent events, persisted to a file so the history
+// survives a stop or crash. Records never straddle the end of the ring,
+// end with their own length so recovery can walk back from the write cursor,
+// and carry a CRC32 so a torn or corrupt record is dropped, not decoded.
+class EventRing {
+private:
+    struct Header;
+
+#ifdef _WIN32
+    HANDLE m_file;
+    HANDLE m_mapping;
+#else
+    int m_file;
+#endif
+    uint8_t* m_view;
+    uint64_t m_mappedSize;
+    Header* m_header;
+    uint8_t* m_data;
+    uint64_t m_lastRecord;  // Logical position of the newest event record
+    std::vector<uint8_t> m_scratch;
+
+    bool Map(const std::wstring& path, uint64_t size);
+    void Unmap();
+    void Reset(uint64_t capacity);
+    void EvictUntil(uint64_t newTail);
+    void WriteRecord(uint64_t position, uint16_t type, const std::vector<uint8_t>& payload,
+                     uint64_t length);
+
+public:
+    EventRing();
+    ~EventRing();
+
+    // Opens or creates the ring file. A file with a different capacity or
+    // layout is reinitialized.
+    bool Open(const std::wstring& path, uint64_t capacityBytes);
+    void Close();
+    bool IsOpen() const { return m_view != nullptr; }
+
+    // Checksums and decodes the newest records, oldest first, until the
+    // decoded events hold maxBytes of memory (see AudioEventBytes)
+    std::vector<AudioEvent> Recover(size_t maxBytes);
+
+    void Append(const AudioEvent& event);
+    // Rewrites the newest record in place (batched count/level updates). An
+    // update that no longer fits is appended and the old record retired.
+    void UpdateLast(const AudioEvent& event);
+    void Clear();
+
+    uint64_t GetRecordCount() const;
+    uint64_t GetCapacity() const;
+};
\ No newline at end of file
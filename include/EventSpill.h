@@ -0,0 +1,61 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <deque>
+#include <chrono>
+#include <cstdint>
+#include "AudioEvent.h"
+#include "EventChunk.h"
+
+// Disk tier behind EventStore. When the store passes its memory budget the
+// oldest events are written out here as immutable segment files, one
+// EventChunk each. Only the time range of each segment stays in memory, so
+// a range query reads just the segments it overlaps. Not thread safe;
+// EventStore guards it with a spill mutex apart from its event mutex.
+class EventSpill {
+private:
+    struct Segment {
+        std::wstring path;
+        std::chrono::system_clock::time_point first;  // Earliest and latest timestamps in the file
+        std::chrono::system_clock::time_point last;
+        size_t events;
+        uint64_t bytes;
+    };
+
+    std::wstring m_directory;
+    uint64_t m_maxBytes;
+    uint64_t m_diskBytes;
+    size_t m_eventCount;
+    uint64_t m_nextSegment;
+    std::deque<Segment> m_segments;  // Oldest first
+    bool m_open;
+
+    void RemoveOldest();
+    bool LoadSegment(const Segment& segment, EventChunk& chunk) const;
+
+public:
+    EventSpill();
+    ~EventSpill();
+
+    // Segments left in directory by an earlier run are deleted: the ring and
+    // the CSV logs already hold that history. Past maxBytes on disk the
+    // oldest segments are deleted too.
+    bool Open(const std::wstring& directory, uint64_t maxBytes);
+    void Close();  // Deletes the segments
+    bool IsOpen() const { return m_open; }
+
+    // Writes the chunk as one new segment
+    bool Write(const EventChunk& chunk);
+    // Appends spilled events in [startTime, endTime], oldest segment first
+    void Read(const std::chrono::system_clock::time_point& startTime,
+              const std::chrono::system_clock::time_point& endTime, std::vector<AudioEvent>& out) const;
+    // Appends the segments overlapping [startTime, endTime] still encoded,
+    // for queries that read them a column at a time
+    void ReadChunks(const std::chrono::system_clock::time_point& startTime,
+                    const std::chrono::system_clock::time_point& endTime, std::vector<EventChunk>& out) const;
+    void Clear();
+
+    size_t GetEventCount() const { return m_eventCount; }
+    uint64_t GetDiskUsage() const { return m_diskBytes; }
+    size_t GetSegmentCount() const { return m_segments.size(); }
+};
@@ -0,0 +1,116 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <memory>
+#include <chrono>
+#include "AudioEvent.h"
+#include "EventChunk.h"
+#include "EventRing.h"
+#include "EventSpill.h"
+#include "EventQuery.h"
+#include "ChangeFeed.h"
+
+// Incremental read result; see EventStore::ReadSince
+struct EventDelta {
+    uint64_t epoch;          // Changes when the store is cleared, recovered or merged into
+    uint64_t firstSequence;  // Sequence number of events[0]
+    uint64_t nextSequence;   // Sequence the next appended event will get
+    std::vector<AudioEvent> events;
+};
+
+// Recent-event store shared by the monitor, GUI and exporters.
+// Batches repeats from the same process and recognized sound within a
+// minute and, when a ring file is attached, mirrors every change into it so
+// the history can be recovered on the next start without re-parsing CSV logs.
+// Memory is bounded by a byte budget rather than an event count, since an
+// event with a long path and tab title costs many times a system beep. Only
+// the newest events stay as AudioEvents; older ones are sealed, CHUNK_EVENTS
+// at a time, into compressed EventChunks that are decoded only when a read
+// reaches them. Past the budget the oldest tenth is dropped, or written to
+// the spill tier when one is attached, and reads span all three tiers.
+class EventStore {
+private:
+    struct SealedChunk {
+        uint64_t firstSequence;
+        EventChunk chunk;
+    };
+
+    mutable std::mutex m_mutex;
+    std::vector<AudioEvent> m_events;
+    std::deque<SealedChunk> m_sealed;  // Older than m_events, oldest first
+    std::vector<AudioEvent> m_spare;   // Evicted events, reused by Add so their strings keep their buffers
+    size_t m_maxBytes;
+    size_t m_bytes;           // AudioEventBytes summed over m_events
+    size_t m_sealedBytes;     // EventChunk::GetMemoryUsage summed over m_sealed
+    size_t m_sealedEvents;
+    bool m_sealing;
+    std::unique_ptr<EventRing> m_ring;
+    // Segment writes happen under m_spillMutex alone, so file I/O never
+    // holds up Add. Whoever needs both takes m_spillMutex first.
+    mutable std::mutex m_spillMutex;
+    EventSpill m_spill;
+    std::vector<EventChunk> m_spillQueue;  // Evicted by Trim, not yet written; guarded by m_mutex
+    uint64_t m_nextSequence;  // Appended events are numbered; m_events.back() is m_nextSequence - 1
+    uint64_t m_epoch;
+    uint64_t m_revision;      // Bumped by every change, including batched count updates
+    ChangeFeed m_changes;
+
+    void Changed();
+    void Trim();
+    void Seal(size_t index);
+    void Recycle(size_t count);
+    void WriteSpill();
+
+public:
+    static const size_t DEFAULT_MAX_BYTES = 8 * 1024 * 1024;
+    static const size_t CHUNK_EVENTS = 1024;
+
+    explicit EventStore(size_t maxBytes = DEFAULT_MAX_BYTES);
+
+    // Takes effect at once; lowering it evicts or spills the oldest events
+    void SetMaxBytes(size_t maxBytes);
+    size_t GetMaxBytes() const;
+    // On by default; off keeps every retained event uncompressed
+    void SetSealing(bool enabled);
+
+    // Attaches a persistent ring and loads as much as fits the budget
+    bool OpenRing(const std::wstring& path, uint64_t capacityBytes);
+    void CloseRing();
+
+    // Attaches a disk tier for events past the budget; see EventSpill
+    bool OpenSpill(const std::wstring& directory, uint64_t maxDiskBytes);
+    void CloseSpill();
+
+    // Returns false when the event was batched into the previous one
+    bool Add(const AudioEvent& event);
+    // Merges already-batched events (e.g. from an old CSV log) by timestamp,
+    // then trims to the budget. Imported events are not written to the ring.
+    void Import(std::vector<AudioEvent> events);
+    void Clear();
+
+    // Spans every tier, oldest first
+    std::vector<AudioEvent> GetEvents(const std::chrono::system_clock::time_point& startTime,
+                                      const std::chrono::system_clock::time_point& endTime) const;
+    // Runs an analytical query over every tier without materializing
+    // events: chunks are read column by column and pruned by time range.
+    // The store is locked only to take copies; the scan runs unlocked.
+    QueryResult Query(const EventQuery& query) const;
+    // Copies the retained events numbered sequence and later. Batching
+    // updates the newest event in place, so readers that want count bumps
+    // ask again from the newest sequence they have already seen. Leading
+    // sealed chunks that end before notBefore are skipped without decoding,
+    // so firstSequence can be later than asked.
+    EventDelta ReadSince(uint64_t sequence, const std::chrono::system_clock::time_point& notBefore =
+                                                std::chrono::system_clock::time_point::min()) const;
+    size_t GetEventCount() const;
+    // Approximate heap held by retained events, strings included
+    size_t GetMemoryUsage() const;
+    size_t GetSpilledEventCount() const;
+    uint64_t GetSpillDiskUsage() const;
+
+    uint64_t GetRevision() const;
+    // Subscribers are woken with the new revision after any change
+    ChangeFeed& GetChangeFeed() { return m_changes; }
+};
\ No newline at end of file
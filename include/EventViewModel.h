@@ -0,0 +1,69 @@
+#pragma once
+#include <deque>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include "AudioEvent.h"
+#include "EventStore.h"
+#include "SearchIndex.h"
+
+// One change to the displayed rows. Display row 0 is the newest event.
+// Diffs must be applied in the order they are emitted.
+struct RowDiff {
+    enum class Kind {
+        Insert,   // count rows inserted at index
+        Update,   // count rows at index changed in place (batched count bump)
+        Remove,   // count rows removed at index
+        Reset     // Everything changed; index is 0, count is the new row count
+    };
+    Kind kind;
+    size_t index;
+    size_t count;
+};
+
+// Platform-neutral model behind the event ListView. Keeps a cursor into the
+// EventStore and turns what changed since the last Sync into row diffs, so
+// the view never has to rebuild and only formats the rows it shows.
+class EventViewModel {
+private:
+    struct Row {
+        uint64_t sequence;
+        AudioEvent event;
+    };
+
+    std::deque<Row> m_rows;        // Oldest first; display order is reversed
+    uint64_t m_epoch;
+    uint64_t m_nextSequence;       // First store sequence not yet read
+    uint64_t m_firstVisible;       // Events before this were cleared from view
+    bool m_synced;
+    bool m_resetPending;
+    std::string m_filterText;
+    SearchQuery m_query;           // Empty shows everything
+    const SearchIndex* m_index;    // Optional; answers the query on rebuilds
+
+    void Rebuild(const EventStore& store, const std::chrono::system_clock::time_point& windowStart,
+                 std::vector<RowDiff>& diffs);
+
+public:
+    EventViewModel();
+
+    // Brings the rows up to date with the store, dropping rows older than
+    // windowStart. Appends the resulting diffs to diffs.
+    void Sync(const EventStore& store, const std::chrono::system_clock::time_point& windowStart,
+              std::vector<RowDiff>& diffs);
+
+    // Filter box text in SearchQuery syntax; a change makes the next Sync
+    // emit a Reset. New events are matched against the parsed query directly.
+    void SetFilter(const std::string& filter);
+
+    // Rebuilds look matching events up in the index instead of testing each
+    // one, when the index is synced to the same store state
+    void AttachIndex(const SearchIndex* index) { m_index = index; }
+
+    // Hides the current rows; only events added after this are shown
+    void Clear(std::vector<RowDiff>& diffs);
+
+    size_t GetRowCount() const { return m_rows.size(); }
+    const AudioEvent& GetRow(size_t displayIndex) const { return m_rows[m_rows.size() - 1 - displayIndex].event; }
+};
@@ -0,0 +1,73 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+#include "SpectralAnalyzer.h"
+
+// Best match for a snippet; see FingerprintIndex::Match
+struct FingerprintMatch {
+    uint32_t soundId = 0;
+    std::string name;
+    uint32_t matchedHashes = 0;  // Snippet hashes agreeing on the best time offset
+    uint32_t queryHashes = 0;    // Hashes the snippet produced
+    float offsetSeconds = 0.0f;  // Where in the known sound the snippet starts; negative if before it
+};
+
+// Landmark fingerprints of known sounds ("the Teams ping") in an inverted
+// index. Audio is resampled to SAMPLE_RATE and the strongest spectral peak
+// of each octave band in each frame becomes a landmark. Every landmark is
+// paired with the next few after it, and the two frequencies and their time
+// gap hash to 24 bits. A snippet matches a sound when enough of its hashes
+// occur in that sound at one consistent time offset, which holds up under
+// other audio mixed in and level changes. Not thread safe.
+class FingerprintIndex {
+private:
+    struct Peak {
+        uint32_t frame;
+        uint32_t bin;
+    };
+    struct Landmark {
+        uint32_t hash;
+        uint32_t frame;
+    };
+    struct Posting {
+        uint32_t soundId;
+        uint32_t frame;
+    };
+
+    SpectralAnalyzer m_analyzer;
+    std::vector<std::string> m_names;
+    std::unordered_map<uint32_t, std::vector<Posting>> m_postings;  // Hash -> where it occurs
+    size_t m_postingCount;
+
+    // Scratch reused from call to call
+    std::vector<float> m_resampled;
+    std::vector<Peak> m_peaks;
+    std::vector<Landmark> m_landmarks;
+    std::vector<uint64_t> m_votes;      // Sound id and offset of every hash hit
+
+    void Extract(const float* samples, size_t count, uint32_t sampleRate);
+
+public:
+    static const uint32_t SAMPLE_RATE = 16000;
+    static const size_t HOP_SIZE = 256;      // 16 ms between frames
+    static const uint32_t MIN_MATCHES = 12;  // Fewer agreeing hashes are not a match
+
+    FingerprintIndex();
+
+    // Returns the new sound's id. Sounds shorter than one frame (64 ms)
+    // produce no hashes and can never match.
+    uint32_t AddSound(const std::string& name, const float* samples, size_t count, uint32_t sampleRate);
+    // Adds every .wav file in directory, named after the file without its
+    // extension. Returns the number added.
+    size_t AddDirectory(const std::wstring& directory);
+
+    // Returns false if no sound reaches MIN_MATCHES
+    bool Match(const float* samples, size_t count, uint32_t sampleRate, FingerprintMatch& match);
+
+    size_t GetSoundCount() const { return m_names.size(); }
+    size_t GetHashCount() const { return m_postingCount; }
+    const std::string& GetName(uint32_t soundId) const { return m_names[soundId]; }
+    void Clear();
+};
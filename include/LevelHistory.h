@@ -0,0 +1,44 @@
+#pragma once
+#include <vector>
+#include <mutex>
+#include <unordered_map>
+#include "AudioEvent.h"
+#include "LevelSeries.h"
+
+// Volume and peak history of every audio session polled, by process ID,
+// under one byte budget. Past the budget the oldest block of whichever
+// session has the oldest is dropped. Thread safe.
+class LevelHistory {
+private:
+    mutable std::mutex m_mutex;
+    std::unordered_map<DWORD, LevelSeries> m_series;
+    size_t m_maxBytes;
+    size_t m_bytes;  // LevelSeries::GetMemoryUsage summed over m_series
+
+    void Trim();
+
+public:
+    static const size_t DEFAULT_MAX_BYTES = 4 * 1024 * 1024;
+
+    explicit LevelHistory(size_t maxBytes = DEFAULT_MAX_BYTES);
+
+    void SetMaxBytes(size_t maxBytes);
+
+    // Returns false if time is older than the session's last sample
+    bool Append(DWORD processId, const std::chrono::system_clock::time_point& time, float volume, float peak);
+    // A zero-peak sample at the session's last volume, for a poll that did
+    // not read its meter. Returns false if the session has no samples.
+    bool AppendSilence(DWORD processId, const std::chrono::system_clock::time_point& time);
+
+    // Return false if the session has no samples; see LevelSeries
+    bool Read(DWORD processId, const std::chrono::system_clock::time_point& startTime,
+              const std::chrono::system_clock::time_point& endTime, std::vector<LevelSample>& out) const;
+    bool ReadDownsampled(DWORD processId, const std::chrono::system_clock::time_point& startTime,
+                         const std::chrono::system_clock::time_point& endTime, size_t bucketCount,
+                         std::vector<LevelBucket>& out) const;
+
+    std::vector<DWORD> GetProcessIds() const;
+    size_t GetSampleCount() const;
+    size_t GetMemoryUsage() const;
+    void Clear();
+};
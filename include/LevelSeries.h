@@ -0,0 +1,89 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <chrono>
+#include <cstdint>
+
+struct LevelSample {
+    std::chrono::system_clock::time_point time;
+    float volume;
+    float peak;
+};
+
+// Summary of the samples in one slice of a downsampled read
+struct LevelBucket {
+    std::chrono::system_clock::time_point start;
+    uint32_t samples;  // 0 when nothing was recorded in the slice; the levels are then 0
+    float maxVolume;
+    float minPeak;
+    float maxPeak;
+    float meanPeak;
+};
+
+// Volume and peak samples of one audio session, compressed as in Facebook's
+// Gorilla: timestamps are delta-of-delta coded, so a steady poll costs one
+// bit each, and each level is XORed with the previous one, so a repeat
+// costs one bit and a change only its meaningful bits. Samples go into
+// blocks of BLOCK_SAMPLES, which range reads skip or decode whole.
+// Timestamps are kept to the millisecond; levels are exact. Not thread
+// safe; see LevelHistory.
+class LevelSeries {
+public:
+    static const size_t BLOCK_SAMPLES = 1024;
+
+private:
+    struct Block {
+        std::vector<uint64_t> words;  // Bit stream, most significant bit first
+        size_t bitCount = 0;
+        int64_t firstTime = 0;        // Milliseconds since the epoch
+        int64_t lastTime = 0;
+        uint32_t count = 0;
+        bool sealed = false;          // Full, or cut short by a long gap
+    };
+
+    // Encoder state after the last sample of the newest block
+    struct Encoder {
+        int64_t time = 0;
+        int64_t delta = 0;
+        uint32_t volume = 0;
+        uint32_t peak = 0;
+        int volumeLeading = -1;  // Meaningful-bit window of the last XOR, -1 before one is written
+        int volumeTrailing = 0;
+        int peakLeading = -1;
+        int peakTrailing = 0;
+    };
+
+    std::deque<Block> m_blocks;  // Oldest first; only the last one is appended to
+    Encoder m_encoder;
+    size_t m_sampleCount;
+    size_t m_bytes;              // Heap held by the blocks
+
+    template <typename Visit> void DecodeBlock(const Block& block, Visit&& visit) const;
+    void Seal();
+
+public:
+    LevelSeries();
+
+    // Returns false, keeping nothing, if time is older than the last sample
+    bool Append(const std::chrono::system_clock::time_point& time, float volume, float peak);
+
+    // Appends the samples in [startTime, endTime], oldest first
+    void Read(const std::chrono::system_clock::time_point& startTime,
+              const std::chrono::system_clock::time_point& endTime, std::vector<LevelSample>& out) const;
+    // Splits [startTime, endTime) into bucketCount equal slices and appends
+    // one summary per slice, e.g. one per pixel column of a plot
+    void ReadDownsampled(const std::chrono::system_clock::time_point& startTime,
+                         const std::chrono::system_clock::time_point& endTime, size_t bucketCount,
+                         std::vector<LevelBucket>& out) const;
+
+    // Frees the oldest block; returns the bytes freed
+    size_t DropOldestBlock();
+    bool IsEmpty() const { return m_sampleCount == 0; }
+    // Volume of the newest sample appended; 0 before the first
+    float GetLastVolume() const;
+    std::chrono::system_clock::time_point GetOldestTime() const;
+
+    size_t GetSampleCount() const { return m_sampleCount; }
+    size_t GetBlockCount() const { return m_blocks.size(); }
+    size_t GetMemoryUsage() const { return sizeof(LevelSeries) + m_bytes; }
+};
@@ -9,7 +9,8 @@
 enum class LogFormat {
     CSV,
     JSON,
-    TEXT
+    TEXT,
+    ARROW   // Apache Arrow IPC file for analytics tools
 };
 
 class Logger {
@@ -17,11 +18,19 @@ private:
     std::wstring m_basePath;
     std::wstring m_currentLogPath;
     std::mutex m_fileMutex;
-    std::ofstream m_currentLog;  // Changed to regular ofstream for UTF-8
+    std::ofstream m_currentLog;  // Event strings are UTF-8, written as-is
+    size_t m_arrowBatchRows;     // Rows per Arrow record batch on export
+    std::string m_line;          // Reused for every logged line, so logging does not allocate
     
-    std::wstring FormatTimestamp(const std::chrono::system_clock::time_point& time);
-    std::wstring SanitizeForCSV(const std::wstring& input);
-    std::string WideToUTF8(const std::wstring& wide);
+    std::string FormatTimestamp(const std::chrono::system_clock::time_point& time);
+    std::string SanitizeForCSV(const std::string& input);
+    // The value as a quoted JSON string, with quotes, backslashes and control characters escaped
+    static std::string QuoteForJSON(const std::string& value);
+    
+    // Append in place; shared by the live log and CSV export
+    static void AppendTimestamp(std::string& out, const std::chrono::system_clock::time_point& time);
+    static void AppendCsvField(std::string& out, const std::string& value);
+    static void AppendCsvRow(std::string& out, const AudioEvent& event);  // Without the line end
     
 public:
     Logger(const std::wstring& logDirectory);
@@ -29,7 +38,7 @@ public:
     
     bool Initialize();
     void LogEvent(const AudioEvent& event);
-    void LogRawData(const std::wstring& data);
+    void LogRawData(const std::string& data);
     
     bool ExportEvents(const std::vector<AudioEvent>& events, 
                      const std::wstring& outputPath,
@@ -37,5 +46,7 @@ public:
     
     void Close();
     
+    void SetArrowBatchRows(size_t rows) { m_arrowBatchRows = rows; }
+    
     std::wstring GetCurrentLogPath() const { return m_currentLogPath; }
 };
\ No newline at end of file
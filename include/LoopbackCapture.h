@@ -0,0 +1,76 @@
+#pragma once
+#define NOMINMAX  // Prevent Windows.h from defining min/max macros
+#include <windows.h>
+#include <vector>
+#include <deque>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <future>
+#include <memory>
+#include <string>
+#include "AudioEvent.h"
+#include "SpectralAnalyzer.h"
+#include "FingerprintIndex.h"
+#include "OnsetDetector.h"
+#include "LoudnessMeter.h"
+
+// Captures what the default render endpoint plays through WASAPI loopback
+// and runs it through a SpectralAnalyzer on its own thread, keeping the
+// last second of frame features. With a sound library set, the last second
+// of audio is also fingerprinted four times a second and matched against
+// it. Onsets are detected on the same stream and kept with wall-clock times
+// taken from the packets' capture timestamps, and a LoudnessMeter follows
+// its BS.1770 loudness over all channels. Loopback hears the endpoint mix,
+// not one session, so features, labels, onsets and loudness describe
+// whatever was audible around an event.
+class LoopbackCapture {
+private:
+    struct TimedFrame {
+        std::chrono::steady_clock::time_point time;
+        SoundFeatures features;
+    };
+
+    std::atomic<bool> m_running;
+    std::thread m_thread;
+    mutable std::mutex m_mutex;
+    std::deque<TimedFrame> m_frames;  // Oldest first, guarded by m_mutex
+    std::string m_label;              // Last sound recognized, guarded by m_mutex
+    std::chrono::steady_clock::time_point m_labelTime;
+    std::deque<std::chrono::system_clock::time_point> m_onsets;  // Oldest first, guarded by m_mutex
+    float m_momentaryLoudness;        // Guarded by m_mutex
+    float m_shortTermLoudness;
+    std::mutex m_libraryMutex;        // Held while the capture thread matches
+    std::unique_ptr<FingerprintIndex> m_library;
+
+    void CaptureLoop(std::promise<bool>* started);
+    void Recognize(const std::vector<float>& recent, uint32_t sampleRate);
+
+public:
+    LoopbackCapture();
+    ~LoopbackCapture();
+
+    // Returns false if the default endpoint cannot be opened for loopback
+    bool Start();
+    void Stop();
+    bool IsRunning() const { return m_running; }
+
+    // Merges the audible (not silent) frames of the last quarter second into
+    // features. Returns false, leaving features alone, if there were none.
+    bool GetRecentFeatures(SoundFeatures& features) const;
+
+    // Known sounds to recognize; replaces the previous library, if any
+    void SetSoundLibrary(std::unique_ptr<FingerprintIndex> library);
+    // Label of the known sound recognized within the last second. Returns
+    // false, leaving label alone, if there was none.
+    bool GetRecentSoundLabel(std::string& label) const;
+
+    // Earliest onset at or after since, within the last second. Returns
+    // false, leaving onset alone, if there was none.
+    bool GetFirstOnsetSince(std::chrono::system_clock::time_point since,
+                            std::chrono::system_clock::time_point& onset) const;
+
+    // Momentary and short-term loudness of the output, in LUFS
+    void GetLoudness(float& momentary, float& shortTerm) const;
+};
@@ -0,0 +1,83 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "AudioEvent.h"
+
+// Integrated loudness and loudness range over a stream of 400 ms gating
+// blocks and 3 s short-term values, kept in histograms of 0.1 LU bins so
+// memory stays fixed however long the stream runs. Gating follows ITU-R
+// BS.1770-4 (absolute -70 LUFS, relative -10 LU) and the range EBU Tech
+// 3342 (relative -20 LU, 10th to 95th percentile).
+class LoudnessStats {
+public:
+    static const size_t BINS = 800;  // LOUDNESS_FLOOR_LUFS up to +10 LUFS
+
+private:
+    std::vector<uint32_t> m_blockCounts;     // Gating blocks per bin
+    std::vector<double> m_blockEnergy;       // Their summed mean squares
+    std::vector<uint32_t> m_shortTermCounts;
+    std::vector<double> m_shortTermEnergy;
+
+public:
+    LoudnessStats();
+
+    // Values at or below LOUDNESS_FLOOR_LUFS are gated out
+    void AddBlock(float lufs);
+    void AddShortTerm(float lufs);
+    void Clear();
+
+    // LOUDNESS_FLOOR_LUFS until a block passes the gates
+    float GetIntegrated() const;
+    // LU between the 10th and 95th percentile of gated short-term values
+    float GetRange() const;
+};
+
+// ITU-R BS.1770 loudness of interleaved float PCM: each channel runs
+// through the two-stage K-weighting filter, mean squares are taken over
+// 100 ms steps and weighted per channel (LFE left out, surrounds +1.5 dB
+// in 5.1 and 7.1 order), and every step updates the momentary (400 ms) and
+// short-term (3 s) loudness and feeds LoudnessStats. The filter runs in
+// double precision on two channels at a time with SSE2 or NEON where
+// available, with a scalar fallback. Not thread safe.
+class LoudnessMeter {
+public:
+    static const uint32_t STEPS_PER_SECOND = 10;
+    static const size_t MOMENTARY_STEPS = 4;
+    static const size_t SHORT_TERM_STEPS = 30;
+
+private:
+    uint32_t m_sampleRate;
+    uint32_t m_channels;
+    size_t m_lanes;                  // Channels rounded up to a multiple of two
+    size_t m_stepSize;               // Frames per step
+    size_t m_stepFilled;
+    double m_coefficients[10];       // b0, b1, b2, a1, a2 of each stage
+    std::vector<double> m_state;     // Two delays per stage per lane, laid out lane pair by lane pair
+    std::vector<double> m_weights;   // Per lane; 0 for padding
+    std::vector<double> m_energy;    // Per lane, over the current step
+    std::vector<double> m_input;     // Up to a step of frames, lane by lane within each
+    double m_steps[SHORT_TERM_STEPS];  // Weighted mean square of the last steps, circular
+    size_t m_nextStep;
+    uint64_t m_stepCount;
+    float m_momentary;
+    float m_shortTerm;
+    LoudnessStats m_stats;
+
+    void FinishStep();
+
+public:
+    LoudnessMeter(uint32_t sampleRate, uint32_t channels);
+
+    void Push(const float* interleaved, size_t frames);
+    void Reset();
+
+    // LUFS as of the last completed step, never below LOUDNESS_FLOOR_LUFS
+    float GetMomentary() const { return m_momentary; }
+    float GetShortTerm() const { return m_shortTerm; }
+    // Integrated loudness and range since construction or Reset
+    const LoudnessStats& GetStats() const { return m_stats; }
+
+    uint32_t GetSampleRate() const { return m_sampleRate; }
+    uint32_t GetChannels() const { return m_channels; }
+};
@@ -0,0 +1,44 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <utility>
+#include "AudioEvent.h"
+#include "TimestampClock.h"
+
+// Decides, tick by tick, which of an endpoint's sessions are worth reading
+// volume and peak meter from. The endpoint's own peak meter is read first:
+// while the device plays anything every session is read, and while it is
+// silent only sessions heard within the hold-off are, so their last quiet
+// sample is not lost. A silent device then costs one meter call a tick
+// instead of several per session. Sessions are keyed by process, as
+// everywhere else in the tracker. Owned by one endpoint's poller; not
+// thread safe.
+class MeterGate {
+public:
+    static const uint32_t DEFAULT_HOLD_OFF_MS = 1000;
+
+private:
+    float m_threshold;
+    std::chrono::milliseconds m_holdOff;
+    bool m_open;                                              // The endpoint is audible this tick
+    std::vector<std::pair<DWORD, TimestampClock::Tick>> m_held;  // Sessions heard lately, until when
+    uint64_t m_reads;
+    uint64_t m_skipped;
+    uint64_t m_endpointReads;
+
+public:
+    // Peaks at or below threshold are silence, as for events
+    explicit MeterGate(float threshold = 0.001f, uint32_t holdOffMilliseconds = DEFAULT_HOLD_OFF_MS);
+
+    // Starts a tick with the endpoint's peak
+    void BeginTick(float endpointPeak, TimestampClock::Tick now);
+    // Whether to read the session this tick; counts the answer
+    bool ShouldRead(DWORD processId, TimestampClock::Tick now);
+    // What a session read showed; audible sessions are held open
+    void Report(DWORD processId, float peak, TimestampClock::Tick now);
+
+    bool IsOpen() const { return m_open; }
+    uint64_t GetReadCount() const { return m_reads; }
+    uint64_t GetSkippedCount() const { return m_skipped; }
+    uint64_t GetEndpointReadCount() const { return m_endpointReads; }
+};
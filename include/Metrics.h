@@ -0,0 +1,170 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <condition_variable>
+
+// Pipeline metrics. Counters and histograms are kept per thread and summed
+// when a snapshot is taken, so recording is a couple of uncontended stores.
+// Build with SOUNDTRACKER_METRICS undefined and the METRICS_* macros below
+// compile to nothing; snapshots then come back empty.
+
+enum class MetricCounter : uint32_t {
+    SamplesReceived,   // Samples reaching AddAudioEvent
+    SamplesCoalesced,  // Samples folded into their session's open burst before the store
+    EventsAdded,       // New events appended to the store
+    EventsBatched,     // Samples folded into the previous event
+    EventsDropped,     // Samples lost to an exception in the pipeline
+    EventsEvicted,     // Old events trimmed from the store to stay within its byte budget
+    EventsSpilled,     // Evicted events written to the store's disk tier
+    EventsSealed,      // Events compressed into the store's sealed chunks
+    EventsLogged,
+    SessionMetersRead,     // Session volume and peak reads made with the endpoint audible or in hold-off
+    SessionMetersSkipped,  // Session reads skipped because the endpoint was silent
+    EventsIgnored,         // Events dropped by an ignore rule
+    RuleAlerts,            // Notify rules fired
+    Count
+};
+
+enum class MetricHistogram : uint32_t {
+    CallbackToStore,    // Sample arrival until the store holds it (ns)
+    EnrichProcessName,  // Per-provider lookup times (ns)
+    EnrichProcessPath,
+    EnrichDescription,
+    EnrichUsb,
+    EnrichBrowserTab,
+    StoreLockWait,      // Waiting for the EventStore mutex in Add (ns)
+    LoggerLockWait,     // Waiting for the log file mutex (ns)
+    LoggerWrite,        // Formatting, writing and flushing one log line (ns)
+    EndpointPoll,       // One endpoint's session poll (ns)
+    Count
+};
+
+enum class MetricGauge : uint32_t {
+    StoreEvents,
+    StoreMemoryBytes,
+    StoreSpilledEvents,
+    StoreSpillBytes,   // Disk used by spill segments
+    LevelSamples,      // Volume and peak samples in the level history
+    LevelMemoryBytes,
+    LoggerQueueDepth,  // Threads inside Logger::LogEvent, waiting or writing
+    Count
+};
+
+// Histograms use log-linear buckets (HDR style): 16 linear sub-buckets per
+// power of two, so a value is placed within 6.25% of its true size. Values
+// past 2^40 ns (18 minutes) land in the last bucket.
+struct HistogramSummary {
+    uint64_t count = 0;
+    double mean = 0.0;
+    uint64_t p50 = 0;
+    uint64_t p90 = 0;
+    uint64_t p99 = 0;
+    uint64_t p999 = 0;
+    uint64_t max = 0;
+};
+
+struct MetricsSnapshot {
+    std::chrono::system_clock::time_point time;
+    uint64_t counters[static_cast<size_t>(MetricCounter::Count)] = {};
+    HistogramSummary histograms[static_cast<size_t>(MetricHistogram::Count)];
+    int64_t gauges[static_cast<size_t>(MetricGauge::Count)] = {};
+    int64_t gaugeMaxima[static_cast<size_t>(MetricGauge::Count)] = {};  // High-water marks
+
+    uint64_t Get(MetricCounter counter) const { return counters[static_cast<size_t>(counter)]; }
+    const HistogramSummary& Get(MetricHistogram histogram) const { return histograms[static_cast<size_t>(histogram)]; }
+    int64_t Get(MetricGauge gauge) const { return gauges[static_cast<size_t>(gauge)]; }
+
+    std::string ToJson() const;
+};
+
+class MetricsRegistry {
+public:
+    static const size_t SUB_BUCKET_BITS = 4;
+    static const size_t MAX_VALUE_BITS = 40;
+    static const size_t BUCKET_COUNT = (MAX_VALUE_BITS - SUB_BUCKET_BITS + 1) << SUB_BUCKET_BITS;
+
+    struct ThreadMetrics;
+
+private:
+    std::mutex m_mutex;                 // Guards m_threads and m_retired
+    std::mutex m_collectorMutex;        // Held while collectors run; never taken with m_mutex
+    std::vector<ThreadMetrics*> m_threads;
+    ThreadMetrics* m_retired;  // Totals of threads that have exited
+    std::atomic<int64_t> m_gauges[static_cast<size_t>(MetricGauge::Count)];
+    std::atomic<int64_t> m_gaugeMaxima[static_cast<size_t>(MetricGauge::Count)];
+    std::vector<std::pair<uint64_t, std::function<void()>>> m_collectors;
+    uint64_t m_nextCollector;
+
+    MetricsRegistry();
+    static ThreadMetrics& Local();
+
+public:
+    ~MetricsRegistry();
+
+    static MetricsRegistry& Instance();
+
+    static void Count(MetricCounter counter, uint64_t amount = 1);
+    static void Record(MetricHistogram histogram, uint64_t value);
+    static void SetGauge(MetricGauge gauge, int64_t value);
+    static void AddGauge(MetricGauge gauge, int64_t delta);
+
+    static size_t BucketIndex(uint64_t value);
+    static uint64_t BucketValue(size_t index);  // Largest value the bucket holds
+
+    // Collectors refresh gauges that are cheaper to read than to track
+    // (e.g. store memory) and run at the start of every Snapshot
+    uint64_t AddCollector(std::function<void()> collector);
+    void RemoveCollector(uint64_t id);
+
+    MetricsSnapshot Snapshot();
+
+    // Called by each thread's metrics block on first use and on thread exit
+    void Register(ThreadMetrics* metrics);
+    void Retire(ThreadMetrics* metrics);
+};
+
+// Writes a snapshot to a JSON file every interval, replacing it atomically
+class MetricsReporter {
+private:
+    std::wstring m_path;
+    std::chrono::milliseconds m_interval;
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    bool m_running;
+
+    void ReportThreadProc();
+
+public:
+    MetricsReporter();
+    ~MetricsReporter();
+
+    bool Start(const std::wstring& path, std::chrono::milliseconds interval);
+    void Stop();
+    bool WriteSnapshot();
+};
+
+#ifdef SOUNDTRACKER_METRICS
+#define METRICS_COUNT(counter, amount) MetricsRegistry::Count(MetricCounter::counter, amount)
+#define METRICS_RECORD(histogram, value) MetricsRegistry::Record(MetricHistogram::histogram, value)
+#define METRICS_GAUGE_SET(gauge, value) MetricsRegistry::SetGauge(MetricGauge::gauge, value)
+#define METRICS_GAUGE_ADD(gauge, delta) MetricsRegistry::AddGauge(MetricGauge::gauge, delta)
+// Declares a start time; METRICS_TIMER_RECORD records the nanoseconds since
+#define METRICS_TIMER_START(name) const auto name = std::chrono::steady_clock::now()
+#define METRICS_TIMER_RECORD(histogram, name) \
+    MetricsRegistry::Record(MetricHistogram::histogram, static_cast<uint64_t>( \
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - name).count()))
+#else
+#define METRICS_COUNT(counter, amount) ((void)0)
+#define METRICS_RECORD(histogram, value) ((void)0)
+#define METRICS_GAUGE_SET(gauge, value) ((void)0)
+#define METRICS_GAUGE_ADD(gauge, delta) ((void)0)
+#define METRICS_TIMER_START(name) ((void)0)
+#define METRICS_TIMER_RECORD(histogram, name) ((void)0)
+#endif
@@ -0,0 +1,50 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Streaming onset detection over mono PCM by energy-envelope peak picking.
+// The stream is cut into hops of about 2 ms and a peak envelope follows it
+// from hop to hop. A hop whose envelope rises RISE_DB above the mean of the
+// HISTORY_HOPS before it, and is louder than FLOOR_DB, is an onset unless
+// one was found within MIN_GAP_MS. The onset is then placed at the first
+// sample of that hop or the one before that stands out from the background,
+// so it lands within a millisecond or so of where the sound starts. Not
+// thread safe.
+class OnsetDetector {
+public:
+    static const uint32_t HOPS_PER_SECOND = 500;
+    static const size_t HISTORY_HOPS = 10;   // 20 ms of background
+    static const int RISE_DB = 10;
+    static const int FLOOR_DB = -55;
+    static const uint32_t MIN_GAP_MS = 50;
+
+private:
+    uint32_t m_sampleRate;
+    size_t m_hopSize;
+    std::vector<float> m_hop;       // Current hop, filled up to m_filled
+    std::vector<float> m_previous;  // Hop before it
+    size_t m_filled;
+    float m_levels[HISTORY_HOPS];   // dB of the last hops, circular
+    size_t m_nextLevel;
+    float m_envelope;               // Peak envelope at the end of the last hop
+    float m_release;                // Envelope decay per hop
+    uint64_t m_position;            // Samples pushed since construction or Reset
+    uint64_t m_lastOnset;
+    bool m_hasOnset;
+
+    void AnalyzeHop(std::vector<uint64_t>& onsets);
+
+public:
+    explicit OnsetDetector(uint32_t sampleRate);
+
+    // Appends the stream positions (samples since construction or Reset) of
+    // the onsets these samples complete. An onset is reported once the hop
+    // it rises in is complete, so at most one hop (2 ms) after it.
+    void Push(const float* samples, size_t count, std::vector<uint64_t>& onsets);
+    void Reset();
+
+    uint64_t GetPosition() const { return m_position; }
+    uint32_t GetSampleRate() const { return m_sampleRate; }
+    size_t GetHopSize() const { return m_hopSize; }
+};
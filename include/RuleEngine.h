@@ -0,0 +1,132 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <unordered_map>
+#include "AudioEvent.h"
+
+// What a matching rule does to an event
+enum class RuleAction : uint8_t {
+    Ignore,  // Drop the event before the store and the log
+    Notify   // Raise an alert naming the rule
+};
+
+// Per-event rules, one per line:
+//   ignore when process = Spotify.exe and peak < 5%
+//   notify "svchost chatter" when process = svchost.exe and count > 5 in 10s
+//   notify when (sound contains chime or desc contains alarm) and not system
+// String fields: process, path, desc, session, sound, endpoint, usb, tab;
+// compared with = != or contains, ignoring ASCII case. Number fields: pid,
+// volume, peak (0.0 - 1.0, or a percentage), momentary and shortterm (LUFS),
+// duration (ms) and events; compared with = != < <= > >=. system is true
+// for Windows system sounds. "count OP N in WINDOW" (ms, s, m or h) counts
+// the process's sounds that met the rest of the rule over the trailing
+// window, a coalesced event counting as its events, and may only be and-ed
+// at the top. A notify with a count fires
+// once, then again after its window has passed. # starts a comment.
+//
+// Rules are compiled once, at load, into one flat DAG of predicate nodes:
+// equal comparisons and sub-expressions are interned, so a term that a
+// thousand rules share is evaluated once per event. Rules that require an
+// exact string (process = X) are indexed by it, so an event only visits the
+// rules naming its process plus those that name none. Ignore rules run
+// first; an ignored event reaches no notify rule and no notify count.
+// Evaluate is not thread safe; it is meant for the one thread delivering
+// events.
+class RuleEngine {
+public:
+    enum class Field : uint8_t {
+        Process, Path, Description, Session, Sound, Endpoint, Usb, Tab,  // Strings
+        Pid, Volume, Peak, Momentary, ShortTerm, Duration, Events,       // Numbers
+        System,
+        Count
+    };
+
+private:
+    enum class Op : uint8_t {
+        Equal, Contains,                        // Strings, case folded
+        Less, LessEqual, Greater, GreaterEqual, NumberEqual,
+        IsTrue,                                 // system
+        And, Or, Not                            // Over m_children ranges
+    };
+
+    struct Node {
+        Op op;
+        Field field;
+        uint32_t first;       // And, Or, Not: children in m_children
+        uint32_t count;
+        double number;
+        std::string text;     // Folded
+    };
+
+    struct Window {
+        std::vector<int64_t> times;    // Milliseconds, ascending; times[head..] are in the window
+        std::vector<uint32_t> counts;  // Sounds at each time
+        size_t head = 0;
+        uint64_t total = 0;            // counts[head..] summed
+        int64_t lastFired = INT64_MIN;
+    };
+
+    struct Rule {
+        std::string name;
+        RuleAction action;
+        uint32_t root;             // Everything but the count
+        bool counted;
+        Op countOp;
+        uint32_t countLimit;
+        int64_t windowMs;
+        bool perProcess;           // Counts by process name; else one process is all it sees
+        uint64_t fires;
+        Window window;
+        std::unordered_map<std::string, Window> windows;  // By process name
+        size_t sweepAt;            // Windows held before idle ones are dropped
+    };
+
+    std::vector<Node> m_nodes;          // Children before parents
+    std::vector<uint32_t> m_children;
+    std::vector<Rule> m_rules;          // Ignore rules first, each kind in file order
+    size_t m_terms;                     // Comparisons and operators as written
+
+    // Anchored rules by the folded string they require, per string field
+    std::unordered_map<std::string, std::vector<uint32_t>> m_anchors[static_cast<size_t>(Field::Pid)];
+    std::vector<uint32_t> m_unanchored;
+
+    // Per-event evaluation state, reused from event to event
+    const AudioEvent* m_event;
+    uint32_t m_generation;
+    std::vector<uint32_t> m_nodeGeneration;
+    std::vector<uint8_t> m_nodeValue;
+    std::string m_folded[static_cast<size_t>(Field::Pid)];
+    uint32_t m_foldedGeneration[static_cast<size_t>(Field::Pid)];
+    std::vector<uint32_t> m_candidates;
+    std::vector<uint32_t> m_merged;
+
+    friend class RuleCompiler;
+
+    const std::string& Folded(Field field);
+    bool EvaluateNode(uint32_t node);
+    bool Fire(Rule& rule);
+
+public:
+    RuleEngine();
+
+    // Compiles rules from text, replacing any loaded before. On a syntax
+    // error nothing is replaced and error names the line.
+    bool Load(const std::string& text, std::string& error);
+    bool LoadFile(const std::wstring& path, std::string& error);
+
+    // Runs the rules on an event; false if an ignore rule drops it. Notify
+    // rules that fire are appended to fired by index.
+    bool Evaluate(const AudioEvent& event, std::vector<uint32_t>& fired);
+
+    size_t GetRuleCount() const { return m_rules.size(); }
+    const std::string& GetRuleName(size_t rule) const { return m_rules[rule].name; }
+    RuleAction GetRuleAction(size_t rule) const { return m_rules[rule].action; }
+    uint64_t GetFireCount(size_t rule) const { return m_rules[rule].fires; }
+    // Compiled nodes against the comparisons and operators they came from
+    size_t GetNodeCount() const { return m_nodes.size(); }
+    size_t GetTermCount() const { return m_terms; }
+    // Per-process count windows held, over all rules
+    size_t GetWindowCount() const;
+};
@@ -0,0 +1,116 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <regex>
+#include <chrono>
+#include <cstdint>
+#include <unordered_map>
+#include "AudioEvent.h"
+#include "EventStore.h"
+
+// Filter box query. Whitespace-separated terms must all match:
+//   chrome            process name, description or sound label contains "chrome"
+//   process:chrome    process name only; also path:, desc:, sound:
+//   pid:1234          exact process ID
+//   /^chr.*e$/        regex on process name, description or sound label; also process:/.../
+//   after:10:30  before:2025-06-01  after:2025-06-01T08:00  last:5m
+// Text and regex matching ignore ASCII case. Double quotes group spaces
+// into one term. A term that fails to parse is matched as plain text.
+class SearchQuery {
+public:
+    enum class Field {
+        Any,          // Process name, description or sound label
+        Process,
+        Path,
+        Description,
+        Sound,        // Label of a sound recognized by fingerprint
+        Pid
+    };
+
+    struct Term {
+        Field field;
+        std::string text;                     // Case-folded needle
+        std::shared_ptr<const std::regex> regex;
+        DWORD pid;
+    };
+
+private:
+    std::vector<Term> m_terms;
+    std::chrono::system_clock::time_point m_after;
+    std::chrono::system_clock::time_point m_before;
+
+    bool ParseTime(const std::string& value, const std::chrono::system_clock::time_point& now,
+                   std::chrono::system_clock::time_point& time) const;
+    void AddTerm(const std::string& token, const std::chrono::system_clock::time_point& now);
+
+public:
+    SearchQuery();
+
+    // now anchors relative terms such as last:5m and time-only after:/before:
+    void Parse(const std::string& text,
+               const std::chrono::system_clock::time_point& now = std::chrono::system_clock::now());
+
+    bool IsEmpty() const;
+    bool Matches(const AudioEvent& event) const;
+
+    const std::vector<Term>& GetTerms() const { return m_terms; }
+    const std::chrono::system_clock::time_point& GetAfter() const { return m_after; }
+    const std::chrono::system_clock::time_point& GetBefore() const { return m_before; }
+};
+
+// Search index over the event store, kept current by Sync like the view
+// model. Each text field interns its strings case-folded, so a process that
+// sounds a thousand times is indexed once: a trigram index over the distinct
+// strings finds candidates, and per-string postings list the events that use
+// them. Queries touch distinct strings and postings instead of every event.
+class SearchIndex {
+private:
+    struct FieldIndex {
+        std::unordered_map<std::string, uint32_t> ids;       // Original text -> string id
+        std::vector<std::string> originals;
+        std::vector<std::string> folded;
+        std::vector<std::vector<uint64_t>> postings;         // String id -> event sequences
+        std::unordered_map<uint32_t, std::vector<uint32_t>> trigrams;  // Trigram -> string ids
+
+        uint32_t Intern(const std::string& text);
+        // Re-interns the strings retained events still use, once most are unused
+        void Compact();
+    };
+
+    FieldIndex m_process;
+    FieldIndex m_path;
+    FieldIndex m_description;
+    FieldIndex m_sound;
+    std::unordered_map<DWORD, std::vector<uint64_t>> m_pids;
+    std::vector<int64_t> m_timestamps;  // Milliseconds, indexed by sequence - m_firstSequence
+    uint64_t m_firstSequence;           // Sequence of m_timestamps[0]
+    uint64_t m_nextSequence;
+    uint64_t m_epoch;
+    bool m_synced;
+    size_t m_maxEvents;
+
+    void Reset();
+    void Add(uint64_t sequence, const AudioEvent& event);
+    void Evict();
+    void FindText(const FieldIndex& field, const SearchQuery::Term& term, uint64_t from,
+                  std::vector<uint64_t>& out) const;
+
+public:
+    static const size_t DEFAULT_MAX_EVENTS = 1000000;
+
+    explicit SearchIndex(size_t maxEvents = DEFAULT_MAX_EVENTS);
+
+    // Indexes events appended since the last call; rebuilds after the store
+    // is cleared, recovered or merged into
+    void Sync(const EventStore& store);
+
+    // Ascending sequences of indexed events at or after fromSequence that
+    // match the query. An empty query matches every indexed event.
+    std::vector<uint64_t> Find(const SearchQuery& query, uint64_t fromSequence = 0) const;
+
+    uint64_t GetEpoch() const { return m_epoch; }
+    uint64_t GetFirstSequence() const { return m_firstSequence; }
+    uint64_t GetNextSequence() const { return m_nextSequence; }
+    size_t GetEventCount() const { return m_timestamps.size(); }
+};
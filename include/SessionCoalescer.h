@@ -0,0 +1,67 @@
+#pragma once
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <condition_variable>
+#include "AudioEvent.h"
+#include "TraceFile.h"
+#include "TimestampClock.h"
+
+// One session's observations collapsed over a window; see SessionCoalescer
+struct SessionBurst {
+    DWORD processId = 0;
+    uint32_t endpoint = 0;   // Caller's endpoint index; a process on two endpoints has two bursts
+    float volume = 0.0f;     // Latest known, 0 until an observation carries one
+    float peak = 0.0f;       // Highest seen
+    uint32_t count = 0;      // Observations folded in
+    TraceSource source = TraceSource::Poll;      // Poll if the poll saw it, else the latest callback
+    TimestampClock::Tick captured;  // First observation
+    TimestampClock::Tick due;       // When the window closes
+};
+
+// Collapses the poll's and the session callbacks' observations of each
+// session, keyed by process and endpoint, into one burst per window before anything is
+// enriched, stored or logged: dragging a volume slider or a flapping
+// session state fires hundreds of callbacks a second. The first observation
+// opens the window and the burst is due when it closes, so a burst is
+// delivered at most one window late. Thread safe.
+class SessionCoalescer {
+private:
+    mutable std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::chrono::milliseconds m_window;
+    std::vector<SessionBurst> m_open;  // At most one per session; few enough to scan
+    bool m_stopped;
+    std::atomic<uint64_t> m_observed;
+    std::atomic<uint64_t> m_delivered;
+
+    // Caller holds m_mutex; m_open is not empty
+    std::chrono::steady_clock::time_point EarliestDue() const;
+
+public:
+    SessionCoalescer();
+
+    // 0 delivers every observation on its own
+    void SetWindow(uint32_t milliseconds);
+    uint32_t GetWindow() const;
+
+    // Folds an observation into its session's open burst, or opens one.
+    // hasVolume is false for observations that carry no volume, such as
+    // state callbacks; a known volume of 0 (muted) still replaces the last.
+    void Observe(DWORD processId, uint32_t endpoint, bool hasVolume, float volume, float peak, TraceSource source,
+                 TimestampClock::Tick captured);
+    // Moves the bursts due by now into out, earliest first
+    void Drain(std::chrono::steady_clock::time_point now, std::vector<SessionBurst>& out);
+    // Blocks until a burst is due, then drains. After Stop, drains every
+    // open burst and returns false.
+    bool Wait(std::vector<SessionBurst>& out);
+    void Stop();
+    // Accepts observations again after Stop
+    void Restart();
+
+    // Observations received, and bursts they were collapsed into
+    uint64_t GetObservedCount() const { return m_observed; }
+    uint64_t GetDeliveredCount() const { return m_delivered; }
+};
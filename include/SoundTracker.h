@@ -13,6 +13,7 @@
 #include <atomic>
 #include <memory>
 #include <unordered_map>
+#include <functional>
 
 #pragma comment(lib, "ole32.lib")
 #pragma comment(lib, "winmm.lib")
@@ -20,6 +21,18 @@
 
 // Include the separated AudioEvent structure
 #include "AudioEvent.h"
+#include "Logger.h"
+#include "EventStore.h"
+#include "LevelHistory.h"
+#include "LoopbackCapture.h"
+#include "TraceFile.h"
+#include "SessionCoalescer.h"
+#include "EndpointPool.h"
+#include "MeterGate.h"
+#include "RuleEngine.h"
+#include "EventEnricher.h"
+#include "Metrics.h"
+#include "SpanTracer.h"
 
 // Custom implementation of IAudioSessionEvents interface
 class CSoundTrackerAudioSessionEvents : public IAudioSessionEvents {
@@ -27,8 +40,9 @@ public:
     LONG _cRef;
     class SoundTracker* _pTracker;
     DWORD _processId;
+    uint32_t _endpoint;  // The tracker's index for the session's endpoint
 
-    CSoundTrackerAudioSessionEvents(class SoundTracker* pTracker, DWORD processId);
+    CSoundTrackerAudioSessionEvents(class SoundTracker* pTracker, DWORD processId, uint32_t endpoint);
     ~CSoundTrackerAudioSessionEvents();
 
     // IUnknown methods
@@ -46,31 +60,51 @@ public:
     HRESULT STDMETHODCALLTYPE OnSessionDisconnected(AudioSessionDisconnectReason DisconnectReason);
 };
 
-class SoundTracker {
+// Answers the enricher's process lookups with Win32 calls
+class SoundTracker : private ProcessInfoProvider {
 private:
     std::atomic<bool> m_running;
-    std::thread m_monitorThread;
-    std::mutex m_logMutex;
-    std::mutex m_cacheMutex;  // Separate mutex for process cache to avoid deadlock
-    std::vector<AudioEvent> m_events;
+    std::thread m_monitorThread;   // Keeps m_endpoints in step with the active render endpoints
+    EndpointPool m_endpoints;      // A polling worker per endpoint
+    std::vector<std::string> m_endpointIds;  // Interned endpoint ids; index 0 is unknown ("")
+    std::mutex m_endpointMutex;
+    std::thread m_coalesceThread;  // Delivers coalesced samples to the pipeline
+    SessionCoalescer m_coalescer;
+    std::mutex m_cacheMutex;  // Guards the process cache and session names; separate to avoid deadlock
+    EventStore m_store;       // Recent events, persisted to a memory-mapped ring
+    EventStore m_history;     // Rows imported from old sound_log CSV files
+    LevelHistory m_levels;    // Volume and peak of every polled session, for plotting
+    LoopbackCapture m_loopback;  // Spectral features of the output mix, when enabled
+    RuleEngine m_rules;       // Ignore and notify rules, run on each sample before the store
+    std::function<void(const std::string& rule, const AudioEvent& event)> m_alertCallback;
+    std::mutex m_rulesMutex;  // Guards m_rules and m_alertCallback
+    std::unordered_map<DWORD, LoudnessStats> m_processLoudness;  // From each process's polled events
+    mutable std::mutex m_loudnessMutex;
     IMMDeviceEnumerator* m_pEnumerator;
-    std::unordered_map<DWORD, std::wstring> m_processCache;
-    std::unordered_map<DWORD, std::wstring> m_sessionNames;  // Store session display names
+    std::unordered_map<DWORD, std::string> m_processCache;   // UTF-8 process names
+    std::unordered_map<DWORD, std::string> m_sessionNames;   // Store session display names (UTF-8)
     std::chrono::system_clock::time_point m_startTime;
     std::wstring m_logFilePath;
     std::unique_ptr<class Logger> m_logger;  // Single logger instance for efficiency
-    
-    // Store active audio session events for proper cleanup
-    std::vector<std::pair<IAudioSessionControl2*, CSoundTrackerAudioSessionEvents*>> m_activeEvents;
-    std::mutex m_eventsMutex;
+    TraceWriter m_trace;                     // Samples for offline replay, when recording
+    EventEnricher m_enricher;
+    MetricsReporter m_metricsReporter;       // logs\metrics.json while tracking
+    uint64_t m_metricsCollector;
+
+    // Polls one endpoint's sessions and owns their event registrations
+    class EndpointSessionPoller;
 
     void MonitorAudioSessions();
-    void ProcessAudioSession(IAudioSessionControl2* pSessionControl);
-    std::wstring GetProcessNameFromPID(DWORD processId);
-    std::wstring GetProcessPathFromPID(DWORD processId);
-    std::wstring GetSoundDescription(DWORD processId, const std::wstring& processName);
-    std::wstring GetUSBDeviceInfo(DWORD processId, const std::wstring& processName);
-    std::wstring GetBrowserTabInfo(DWORD processId, const std::wstring& processName);
+    std::unique_ptr<EndpointPoller> OpenEndpoint(const std::string& endpointId);
+    uint32_t InternEndpoint(const std::string& endpointId);
+    void DeliverCoalesced();
+    void DeliverBurst(const SessionBurst& burst);
+    void ProcessAudioSession(IAudioSessionControl2* pSessionControl, uint32_t endpoint, MeterGate& gate,
+                             TimestampClock::Tick now);
+    void GetProcessNameFromPID(DWORD processId, std::string& name) override;
+    void GetProcessPathFromPID(DWORD processId, std::string& path) override;
+    void GetUSBDeviceInfo(DWORD processId, const std::string& processName, std::string& info) override;
+    void GetBrowserTabInfo(DWORD processId, const std::string& processName, std::string& info) override;
     void LogEvent(const AudioEvent& event);
     float GetPeakMeterValue(IAudioSessionControl2* pSessionControl);
 
@@ -83,15 +117,71 @@ public:
     void Stop();
     bool IsRunning() const { return m_running; }
     
-    void AddAudioEvent(DWORD processId, float volume, float peak);
+    // Cheap enough for COM callback threads: samples are coalesced per
+    // process (see SessionCoalescer) and enriched on a thread of their own
+    void AddAudioEvent(DWORD processId, float volume, float peak,
+                       TraceSource source = TraceSource::Poll, uint32_t endpoint = 0);
+    // Window over which a process's samples collapse into one; 0 turns
+    // coalescing off
+    void SetCoalesceWindow(uint32_t milliseconds) { m_coalescer.SetWindow(milliseconds); }
+    uint32_t GetCoalesceWindow() const { return m_coalescer.GetWindow(); }
+    // Raw samples received, and coalesced samples delivered to the pipeline
+    uint64_t GetRawSampleCount() const { return m_coalescer.GetObservedCount(); }
+    uint64_t GetCoalescedSampleCount() const { return m_coalescer.GetDeliveredCount(); }
+    
+    // Records every coalesced sample reaching the pipeline, with its
+    // enrichment results, for replay through TraceReplayer
+    bool StartTraceRecording(const std::wstring& tracePath) { return m_trace.Open(tracePath); }
+    void StopTraceRecording() { m_trace.Close(); }
     bool ExportLogs(const std::wstring& outputPath, 
                    const std::chrono::system_clock::time_point& startTime,
-                   const std::chrono::system_clock::time_point& endTime);
+                   const std::chrono::system_clock::time_point& endTime,
+                   LogFormat format = LogFormat::CSV);
     
     std::vector<AudioEvent> GetEvents(const std::chrono::system_clock::time_point& startTime,
                                      const std::chrono::system_clock::time_point& endTime);
     
-    size_t GetEventCount() const { return m_events.size(); }
+    // Loads an old sound_log_*.csv for comparison; kept apart from live events
+    bool ImportLog(const std::wstring& logPath);
+    std::vector<AudioEvent> GetHistoricalEvents(const std::chrono::system_clock::time_point& startTime,
+                                                const std::chrono::system_clock::time_point& endTime);
+    
+    // Tags new events with spectral features and loudness of what the default
+    // output was playing (see LoopbackCapture). Returns false if capture
+    // cannot start.
+    bool EnableFeatureCapture(bool enable);
+    bool IsFeatureCaptureEnabled() const { return m_loopback.IsRunning(); }
+    // Labels events with the known sound playing, by fingerprint, from the
+    // .wav files in directory (named after the files). Needs feature capture.
+    // Returns false if no file could be read.
+    bool LoadSoundLibrary(const std::wstring& directory);
+    // Integrated loudness (LUFS) and loudness range (LU) of the output while
+    // the process was audible, gathered from the loudness of its polled
+    // events. Needs feature capture. Returns false if there is none yet.
+    bool GetProcessLoudness(DWORD processId, float& integrated, float& range) const;
+    
+    // Compiles rules (see RuleEngine) from a file, replacing any loaded
+    // before; on a syntax error keeps them and says why in error
+    bool LoadRules(const std::wstring& path, std::string& error);
+    // Called on the pipeline thread for each notify rule that fires; should
+    // only hand the alert off, as the pipeline waits for it
+    void SetAlertCallback(std::function<void(const std::string& rule, const AudioEvent& event)> callback);
+    
+    size_t GetEventCount() const { return m_store.GetEventCount(); }
+    const EventStore& GetEventStore() const { return m_store; }
+    const LevelHistory& GetLevelHistory() const { return m_levels; }
+    // Memory for recent events; older events spill to disk (logs\spill)
+    void SetStoreBudget(size_t maxBytes) { m_store.SetMaxBytes(maxBytes); }
+    
+    // Calls callback from a background thread, at most maxFramesPerSecond
+    // times a second, after events are added, batched, cleared or recovered.
+    // The callback gets the store revision and should only schedule a pull
+    // (see EventStore::ReadSince). Returns an id for Unsubscribe.
+    uint64_t Subscribe(ChangeFeed::Callback callback,
+                       unsigned maxFramesPerSecond = ChangeFeed::DEFAULT_MAX_FPS) {
+        return m_store.GetChangeFeed().Subscribe(std::move(callback), maxFramesPerSecond);
+    }
+    void Unsubscribe(uint64_t subscription) { m_store.GetChangeFeed().Unsubscribe(subscription); }
     std::chrono::system_clock::time_point GetStartTime() const { return m_startTime; }
     std::wstring GetCurrentLogPath() const;
 };
\ No newline at end of file
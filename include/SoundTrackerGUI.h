@@ -1,11 +1,12 @@
 #pragma once
 #include "SoundTracker.h"
+#include "EventViewModel.h"
 #include <windows.h>
 #include <commctrl.h>
 #include <shellapi.h>
 #include <string>
-#include <thread>
 #include <atomic>
+#include <mutex>
 
 #pragma comment(lib, "comctl32.lib")
 #pragma comment(lib, "shell32.lib")
@@ -21,11 +22,14 @@
 #define ID_MENU_RESTORE        2001
 #define ID_MENU_EXIT           2002
 #define ID_MENU_START_STOP     2003
+#define ID_MENU_SAVE_SPANS     2004
 #define ID_CHECKBOX_FILTER     1008
 #define ID_EDIT_FILTER         1009
 
 // Window messages
 #define WM_TRAYICON (WM_USER + 1)
+#define WM_EVENTS_CHANGED (WM_USER + 2)  // Posted by the event store subscription
+#define WM_RULE_ALERT (WM_USER + 3)      // Posted when a notify rule fires
 
 class SoundTrackerGUI {
 private:
@@ -48,15 +52,21 @@ private:
     // Sound tracker
     std::unique_ptr<SoundTracker> m_tracker;
     std::atomic<bool> m_isTracking;
-    std::thread m_updateThread;
-    std::atomic<bool> m_updateThreadRunning;
+    uint64_t m_subscription;
+    std::atomic<bool> m_updatePosted;  // A WM_EVENTS_CHANGED is queued and not yet handled
+    std::mutex m_alertMutex;           // Guards the alerts below, queued by the pipeline thread
+    std::wstring m_pendingAlert;       // Latest alert not yet shown
+    unsigned m_pendingAlerts;          // Alerts since the last one shown
     
     // GUI state
     int m_lastEventCount;
     std::chrono::system_clock::time_point m_lastUpdateTime;
     bool m_filterEnabled;
-    std::wstring m_filterText;
+    EventViewModel m_viewModel;       // Rows behind the owner-data ListView
+    SearchIndex m_searchIndex;        // Answers filter changes without a scan
+    std::vector<RowDiff> m_rowDiffs;  // Reused between updates
     WNDPROC m_originalStatusProc;
+    std::wstring m_spanTracePath;     // Set when span tracing is on
     
     // Window procedures
     static LRESULT CALLBACK WindowProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam);
@@ -73,10 +83,11 @@ private:
     
     // GUI updates
     void UpdateListView();
+    void ShowRecoveredEvents();
     void UpdateStatusBar();
     void UpdateButtonStates();
-    void AddEventToListView(const AudioEvent& event);
-    void ClearListView();
+    void ApplyRowDiffs();
+    void FormatCell(const AudioEvent& event, int column, LPWSTR text, int maxLength);
     std::wstring FormatDuration(DWORD milliseconds);
     std::wstring FormatVolume(float level);
     
@@ -85,20 +96,30 @@ private:
     void OnClear();
     void OnFilterChanged();
     void OnListViewClick();
+    void OnGetDispInfo(NMLVDISPINFO* info);
     void OnStatusBarClick();
     void OnTrayIcon(LPARAM lParam);
+    void OnRuleAlert();
     void ShowTrayMenu();
+    void SaveSpanTrace();
     void MinimizeToTray();
     void RestoreFromTray();
     
-    // Update thread
-    void UpdateThreadProc();
-    
 public:
     SoundTrackerGUI();
     ~SoundTrackerGUI();
     
     bool Initialize(HINSTANCE hInstance);
     int Run();
+    
+    // Captures a replayable trace of every sample (see TraceReplayer)
+    bool StartTraceRecording(const std::wstring& tracePath) { return m_tracker->StartTraceRecording(tracePath); }
+    void SetStoreBudget(size_t maxBytes) { m_tracker->SetStoreBudget(maxBytes); }
+    void SetCoalesceWindow(uint32_t milliseconds) { m_tracker->SetCoalesceWindow(milliseconds); }
+    bool EnableFeatureCapture(bool enable) { return m_tracker->EnableFeatureCapture(enable); }
+    bool LoadSoundLibrary(const std::wstring& directory) { return m_tracker->LoadSoundLibrary(directory); }
+    bool LoadRules(const std::wstring& path, std::string& error) { return m_tracker->LoadRules(path, error); }
+    // Records pipeline spans, saved to tracePath from the tray menu and on exit
+    void StartSpanTracing(const std::wstring& tracePath);
     void Cleanup();
 };
\ No newline at end of file
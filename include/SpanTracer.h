@@ -0,0 +1,100 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// Timeline of pipeline activity for one-off investigations, written as
+// Chrome trace-event JSON (opens in Perfetto or chrome://tracing). Off by
+// default; while off a span costs one relaxed load. While on, each thread
+// appends finished spans to its own fixed ring without locking, keeping the
+// most recent RING_SPANS per thread, so it can be left running and dumped
+// whenever something looks slow.
+class SpanTracer {
+public:
+    static const size_t RING_SPANS = 1 << 15;
+    static const size_t MAX_RETIRED_THREADS = 16;  // Rings of exited threads kept for the dump
+
+    struct ThreadRing;
+
+private:
+    static inline std::atomic<bool> s_enabled{ false };  // Static so the disabled check needs no Instance()
+    std::mutex m_mutex;  // Guards the ring lists, not the rings
+    std::vector<ThreadRing*> m_threads;
+    std::vector<ThreadRing*> m_retired;
+    uint32_t m_nextThreadId;
+    std::chrono::steady_clock::time_point m_origin;
+
+    SpanTracer();
+    static ThreadRing* Local();
+
+public:
+    ~SpanTracer();
+
+    static SpanTracer& Instance();
+    static bool IsEnabled() { return s_enabled.load(std::memory_order_relaxed); }
+
+    void Enable();
+    void Disable();  // Recorded spans are kept for WriteChromeTrace
+
+    // name and argName must be string literals (only the pointers are kept).
+    // argName may be null when the span has no argument.
+    static void Record(const char* name, std::chrono::steady_clock::time_point begin,
+                       std::chrono::steady_clock::time_point end, const char* argName = nullptr, int64_t arg = 0);
+
+    // Labels the calling thread's track in the timeline; cheap, and may be
+    // called before the tracer is enabled
+    static void SetThreadName(const std::string& name);
+
+    // Safe while other threads keep recording; spans overwritten during the
+    // dump are skipped
+    bool WriteChromeTrace(const std::wstring& path);
+
+    // Called by each thread's ring on first use and on thread exit
+    void Register(ThreadRing* ring);
+    void Retire(ThreadRing* ring);
+};
+
+// Times the enclosing scope when the tracer is enabled
+class ScopedSpan {
+private:
+    const char* m_name;
+    const char* m_argName;
+    int64_t m_arg;
+    bool m_active;
+    std::chrono::steady_clock::time_point m_begin;
+
+public:
+    explicit ScopedSpan(const char* name, const char* argName = nullptr, int64_t arg = 0)
+        : m_name(name), m_argName(argName), m_arg(arg), m_active(SpanTracer::IsEnabled()) {
+        if (m_active) {
+            m_begin = std::chrono::steady_clock::now();
+        }
+    }
+
+    ~ScopedSpan() {
+        if (m_active) {
+            SpanTracer::Record(m_name, m_begin, std::chrono::steady_clock::now(), m_argName, m_arg);
+        }
+    }
+
+    ScopedSpan(const ScopedSpan&) = delete;
+    ScopedSpan& operator=(const ScopedSpan&) = delete;
+};
+
+// std::unique_lock that records the wait for its mutex as a span
+class TracedLock : public std::unique_lock<std::mutex> {
+public:
+    TracedLock(std::mutex& mutex, const char* name) : std::unique_lock<std::mutex>(mutex, std::defer_lock) {
+        ScopedSpan span(name);
+        lock();
+    }
+};
+
+#define TRACE_SPAN_CONCAT2(a, b) a##b
+#define TRACE_SPAN_CONCAT(a, b) TRACE_SPAN_CONCAT2(a, b)
+#define TRACE_SPAN(name) ScopedSpan TRACE_SPAN_CONCAT(traceSpan_, __LINE__)(name)
+#define TRACE_SPAN_ARG(name, argName, arg) \
+    ScopedSpan TRACE_SPAN_CONCAT(traceSpan_, __LINE__)(name, argName, static_cast<int64_t>(arg))
@@ -0,0 +1,51 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include "AudioEvent.h"
+
+// Streaming feature extraction from mono PCM: splits the stream into
+// FRAME_SIZE frames with half-frame hops, windows each with a Hann window
+// and computes RMS, zero-crossing rate, spectral centroid and flux, and
+// MFCCs over MEL_BANDS mel filters. The FFT and the spectrum loops use SSE2
+// or NEON where available, with a scalar fallback. Not thread safe.
+class SpectralAnalyzer {
+public:
+    static const size_t FRAME_SIZE = 1024;
+    static const size_t HOP_SIZE = FRAME_SIZE / 2;
+    static const size_t MEL_BANDS = 26;
+
+private:
+    struct MelFilter {
+        size_t firstBin;
+        std::vector<float> weights;
+    };
+
+    uint32_t m_sampleRate;
+    std::vector<float> m_pending;      // Samples not yet analyzed, at most one frame
+    std::vector<float> m_window;       // Hann window
+    std::vector<uint32_t> m_bitReverse;
+    std::vector<float> m_twiddleRe;    // Per stage, contiguous; see Fft
+    std::vector<float> m_twiddleIm;
+    std::vector<float> m_re;           // FFT work buffers
+    std::vector<float> m_im;
+    std::vector<float> m_magnitude;    // FRAME_SIZE / 2 + 1 bins
+    std::vector<float> m_previous;     // Last frame's normalized magnitudes, for flux
+    std::vector<MelFilter> m_melFilters;
+    std::vector<float> m_dct;          // MFCC_COUNT x MEL_BANDS
+
+    void Fft();
+    void AnalyzeFrame(const float* frame, SoundFeatures& features);
+
+public:
+    explicit SpectralAnalyzer(uint32_t sampleRate);
+
+    // Appends one SoundFeatures (frames = 1) per frame completed by these samples
+    void Push(const float* samples, size_t count, std::vector<SoundFeatures>& frames);
+    void Reset();
+
+    // Magnitude spectrum (FRAME_SIZE / 2 + 1 bins) of one Hann-windowed frame,
+    // valid until the next call. Leaves the streaming state alone.
+    const std::vector<float>& ComputeSpectrum(const float* frame);
+
+    uint32_t GetSampleRate() const { return m_sampleRate; }
+};
@@ -0,0 +1,50 @@
+#pragma once
+#include <chrono>
+#include <ctime>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+
+// Event timestamps in two steps: the hot path captures a steady_clock tick,
+// which is cheap and never runs backwards, and the tick becomes wall time
+// later through an anchor (tick, wall time) recalibrated every second. When
+// the wall clock steps back, wall times slew at half speed until they catch
+// up, so converted ticks keep their order across the jump; forward steps
+// are taken at once. Local time comes from a cached UTC offset, refreshed
+// only when a quarter hour boundary is crossed, instead of a localtime()
+// call per event. Thread safe.
+class TimestampClock {
+public:
+    typedef std::chrono::steady_clock::time_point Tick;
+
+private:
+    typedef std::chrono::system_clock::duration WallDuration;
+
+    std::mutex m_calibrateMutex;
+    // Anchor, written under m_calibrateMutex and read as a seqlock
+    std::atomic<uint32_t> m_sequence;
+    std::atomic<int64_t> m_anchorTick;  // All three in WallDuration units
+    std::atomic<int64_t> m_offset;      // Wall minus tick
+    std::atomic<int64_t> m_debt;        // Backward step still being slewed away at the anchor
+    // Quarter hour key, UTC offset in seconds and DST flag, packed
+    std::atomic<int64_t> m_localOffset;
+
+    TimestampClock();
+
+    void CalibrateLocked();
+    void LoadAnchor(int64_t& anchorTick, int64_t& offset, int64_t& debt) const;
+    int64_t ToWallCount(int64_t tick, int64_t anchorTick, int64_t offset, int64_t debt) const;
+
+public:
+    static TimestampClock& Instance();
+
+    static Tick Capture() { return std::chrono::steady_clock::now(); }
+
+    std::chrono::system_clock::time_point ToWall(Tick tick);
+    std::chrono::system_clock::time_point Now() { return ToWall(Capture()); }
+    // Re-reads the wall clock; ToWall calls it once the anchor is a second old
+    void Calibrate();
+
+    // Like localtime_r, without its lock or time zone lookup
+    void ToLocalTime(std::chrono::system_clock::time_point time, std::tm& tm);
+};
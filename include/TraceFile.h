@@ -0,0 +1,77 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <mutex>
+#include <fstream>
+#include <cstdint>
+#include <unordered_map>
+#include "AudioEvent.h"
+
+// What delivered a sample to SoundTracker::AddAudioEvent
+enum class TraceSource : uint8_t {
+    Poll,           // Peak meter read by the session poll loop
+    VolumeChanged,  // IAudioSessionEvents::OnSimpleVolumeChanged
+    StateChanged    // IAudioSessionEvents::OnStateChanged (session became active)
+};
+
+// One sample as it reached the pipeline: the enriched event before batching
+// (its eventCount is the samples coalesced into it), and how long the
+// process, USB and browser tab lookups took
+struct TraceSample {
+    TraceSource source = TraceSource::Poll;
+    AudioEvent event;
+    uint32_t enrichMicros = 0;
+};
+
+// Writes samples to a compact trace file. Each distinct string is written
+// once per field and referred to by id afterwards, and timestamps are varint
+// deltas, so a typical sample takes about two dozen bytes. Record may be
+// called from several threads; samples keep the order Record was called in.
+class TraceWriter {
+public:
+    static const size_t FIELD_COUNT = 7;  // Interned AudioEvent string fields
+
+private:
+    mutable std::mutex m_mutex;
+    std::ofstream m_file;
+    std::vector<uint8_t> m_buffer;
+    std::unordered_map<std::string, uint32_t> m_strings[FIELD_COUNT];
+    int64_t m_lastMicros;
+    uint64_t m_sampleCount;
+
+    uint32_t StringId(size_t field, const std::string& value);
+    void FlushBuffer();
+
+public:
+    TraceWriter();
+    ~TraceWriter();
+
+    bool Open(const std::wstring& path);
+    void Close();
+    bool IsOpen() const;
+
+    // Does nothing while no trace is open
+    void Record(const TraceSample& sample);
+    uint64_t GetSampleCount() const;
+};
+
+// Reads a trace written by TraceWriter, one sample at a time
+class TraceReader {
+private:
+    std::vector<uint8_t> m_data;
+    size_t m_pos;
+    int64_t m_lastMicros;
+    std::vector<std::string> m_strings[TraceWriter::FIELD_COUNT];
+    size_t m_fieldCount;  // Fields per sample in this trace's version
+    bool m_truncated;
+
+public:
+    TraceReader();
+
+    bool Open(const std::wstring& path);
+
+    // False at the end of the trace. A trace cut short (e.g. the recorder
+    // crashed) ends at its last complete sample; see IsTruncated.
+    bool Next(TraceSample& sample);
+    bool IsTruncated() const { return m_truncated; }
+};
@@ -0,0 +1,41 @@
+#pragma once
+#include <string>
+#include <chrono>
+#include <cstdint>
+#include "EventStore.h"
+#include "Logger.h"
+#include "TraceFile.h"
+#include "RuleEngine.h"
+
+struct ReplayStats {
+    uint64_t samples = 0;
+    uint64_t added = 0;            // Samples that became new events
+    uint64_t batched = 0;          // Samples folded into the previous event
+    uint64_t ignored = 0;          // Samples an ignore rule dropped
+    uint64_t alerts = 0;           // Notify rules fired
+    uint64_t enrichMicros = 0;     // Lookup time the recorder measured, summed
+    std::chrono::microseconds traceSpan{0};      // Virtual time from first to last sample
+    std::chrono::nanoseconds wallTime{0};
+    std::chrono::nanoseconds pipelineTime{0};    // Spent in batching, store and logger
+    bool truncated = false;
+};
+
+// Feeds a recorded trace through batching, the store and the logger on a
+// virtual clock. Events keep their recorded timestamps, so batching and the
+// log match the original session. Speed 1 releases samples at the pace they
+// were recorded, speed N at N times that pace, and speed 0 back to back.
+class TraceReplayer {
+private:
+    double m_speed;
+    Logger* m_logger;  // Optional; receives the events the store did not batch
+    RuleEngine* m_rules;  // Optional; run on each sample before the store
+
+public:
+    TraceReplayer();
+
+    void SetSpeed(double speed) { m_speed = speed; }
+    void SetLogger(Logger* logger) { m_logger = logger; }
+    void SetRules(RuleEngine* rules) { m_rules = rules; }
+
+    bool Replay(const std::wstring& tracePath, EventStore& store, ReplayStats& stats);
+};
@@ -0,0 +1,23 @@
+#pragma once
+#include <string>
+
+// UTF-8 <-> wide transcoding for the edges where Win32 wants wide strings.
+// Event strings are UTF-8 everywhere else, so logging and export copy bytes
+// without converting. wchar_t is UTF-16 on Windows and UTF-32 elsewhere;
+// both are handled. Runs of ASCII are converted 16 bytes at a time with
+// SSE2 or NEON; invalid input (unpaired surrogates, malformed UTF-8)
+// becomes U+FFFD instead of failing.
+
+void AppendUtf8(std::string& out, const wchar_t* wide, size_t length);
+void AppendWide(std::wstring& out, const char* utf8, size_t length);
+
+// The same conversions with explicit UTF-16 and UTF-32 units, whatever the
+// width of wchar_t
+void AppendUtf8(std::string& out, const char16_t* utf16, size_t length);
+void AppendUtf8(std::string& out, const char32_t* utf32, size_t length);
+void AppendUtf16(std::u16string& out, const char* utf8, size_t length);
+void AppendUtf32(std::u32string& out, const char* utf8, size_t length);
+
+std::string WideToUtf8(const std::wstring& wide);
+std::string WideToUtf8(const wchar_t* wide);
+std::wstring Utf8ToWide(const std::string& utf8);
\ No newline at end of file
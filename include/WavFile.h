@@ -0,0 +1,12 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// Minimal RIFF WAVE I/O for feature fixtures and offline analysis. Reads
+// 16, 24 and 32-bit PCM and 32-bit float, downmixed to mono in [-1, 1].
+// Return false if the file cannot be opened or is not such a WAVE file.
+bool ReadWavFile(const std::wstring& path, std::vector<float>& mono, uint32_t& sampleRate);
+
+// Writes mono 16-bit PCM, clipping samples to [-1, 1]
+bool WriteWavFile(const std::wstring& path, const float* samples, size_t count, uint32_t sampleRate);
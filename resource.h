@@ -13,4 +13,5 @@
 #define IDC_START_TIME          1007
 #define IDC_END_DATE            1008
 #define IDC_END_TIME            1009
+#define IDC_FORMAT_ARROW        1010
 #define IDC_STATIC              -1
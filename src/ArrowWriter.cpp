@@ -0,0 +1,524 @@
+#include "../include/ArrowWriter.h"
+#include <fstream>
+#include <filesystem>
+#include <unordered_map>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+
+namespace {
+
+// Minimal flatbuffers builder. Like the reference implementation it grows
+// the buffer back to front, so bytes are kept reversed until Finish().
+// Assumes a little-endian host, which covers every Windows target.
+class FlatBuilder {
+public:
+    typedef uint32_t Ref;  // Distance of an object from the end of the buffer
+
+    FlatBuilder() : m_minAlign(1), m_tableStart(0) {}
+
+    Ref Size() const { return static_cast<Ref>(m_rev.size()); }
+
+    void Prep(size_t align, size_t additional) {
+        m_minAlign = (std::max)(m_minAlign, align);
+        size_t pad = (~(m_rev.size() + additional) + 1) & (align - 1);
+        m_rev.insert(m_rev.end(), pad, 0);
+    }
+
+    template <typename T>
+    void PushRaw(T value) {
+        uint8_t bytes[sizeof(T)];
+        std::memcpy(bytes, &value, sizeof(T));
+        for (size_t i = sizeof(T); i > 0; --i) {
+            m_rev.push_back(bytes[i - 1]);
+        }
+    }
+
+    template <typename T>
+    void AddScalar(T value) {
+        Prep(sizeof(T), 0);
+        PushRaw(value);
+    }
+
+    void AddRef(Ref target) {
+        Prep(sizeof(uint32_t), 0);
+        PushRaw<uint32_t>(Size() + sizeof(uint32_t) - target);
+    }
+
+    Ref CreateString(const std::string& s) {
+        Prep(sizeof(uint32_t), s.size() + 1);
+        m_rev.push_back(0);
+        m_rev.insert(m_rev.end(), s.rbegin(), s.rend());
+        PushRaw<uint32_t>(static_cast<uint32_t>(s.size()));
+        return Size();
+    }
+
+    // Vector elements must be pushed last to first between these calls
+    void StartVector(size_t elemSize, size_t count, size_t align) {
+        Prep(sizeof(uint32_t), elemSize * count);
+        Prep(align, elemSize * count);
+    }
+
+    Ref EndVector(size_t count) {
+        PushRaw<uint32_t>(static_cast<uint32_t>(count));
+        return Size();
+    }
+
+    Ref CreateRefVector(const std::vector<Ref>& refs) {
+        StartVector(sizeof(uint32_t), refs.size(), sizeof(uint32_t));
+        for (size_t i = refs.size(); i > 0; --i) {
+            AddRef(refs[i - 1]);
+        }
+        return EndVector(refs.size());
+    }
+
+    // Tables cannot nest: build strings, vectors and child tables first
+    void StartTable() {
+        m_fields.clear();
+        m_tableStart = Size();
+    }
+
+    template <typename T>
+    void AddField(uint16_t slot, T value) {
+        AddScalar(value);
+        m_fields.push_back(std::make_pair(slot, Size()));
+    }
+
+    void AddFieldRef(uint16_t slot, Ref target) {
+        AddRef(target);
+        m_fields.push_back(std::make_pair(slot, Size()));
+    }
+
+    Ref EndTable() {
+        AddScalar<int32_t>(0);  // Offset to the vtable, patched below
+        Ref table = Size();
+
+        uint16_t slots = 0;
+        for (const auto& field : m_fields) {
+            slots = (std::max)(slots, static_cast<uint16_t>(field.first + 1));
+        }
+        std::vector<uint16_t> vtable(slots, 0);
+        for (const auto& field : m_fields) {
+            vtable[field.first] = static_cast<uint16_t>(table - field.second);
+        }
+
+        for (size_t i = slots; i > 0; --i) {
+            PushRaw<uint16_t>(vtable[i - 1]);
+        }
+        PushRaw<uint16_t>(static_cast<uint16_t>(table - m_tableStart));
+        PushRaw<uint16_t>(static_cast<uint16_t>((slots + 2) * sizeof(uint16_t)));
+
+        Patch<int32_t>(table, static_cast<int32_t>(Size() - table));
+        return table;
+    }
+
+    std::vector<uint8_t> Finish(Ref root) {
+        Prep(m_minAlign, sizeof(uint32_t));
+        AddRef(root);
+        return std::vector<uint8_t>(m_rev.rbegin(), m_rev.rend());
+    }
+
+private:
+    std::vector<uint8_t> m_rev;
+    size_t m_minAlign;
+    Ref m_tableStart;
+    std::vector<std::pair<uint16_t, Ref>> m_fields;
+
+    template <typename T>
+    void Patch(Ref position, T value) {
+        uint8_t bytes[sizeof(T)];
+        std::memcpy(bytes, &value, sizeof(T));
+        for (size_t i = 0; i < sizeof(T); ++i) {
+            m_rev[position - 1 - i] = bytes[i];
+        }
+    }
+};
+
+typedef FlatBuilder::Ref Ref;
+
+// Enum values from the Arrow Schema.fbs / Message.fbs definitions
+const int16_t METADATA_V5 = 4;
+const uint8_t TYPE_INT = 2;
+const uint8_t TYPE_FLOATING_POINT = 3;
+const uint8_t TYPE_UTF8 = 5;
+const uint8_t TYPE_BOOL = 6;
+const uint8_t TYPE_TIMESTAMP = 10;
+const uint8_t HEADER_SCHEMA = 1;
+const uint8_t HEADER_DICTIONARY_BATCH = 2;
+const uint8_t HEADER_RECORD_BATCH = 3;
+const int16_t PRECISION_SINGLE = 1;
+const int16_t TIME_UNIT_MILLISECOND = 1;
+
+enum class ColumnKind { Timestamp, UInt32, Float32, Bool, Dictionary };
+
+struct ColumnDef {
+    const char* name;
+    ColumnKind kind;
+};
+
+// CSV log column order, then the sound label, loudness and endpoint; string columns map to dictionaries 0-7
+const ColumnDef COLUMNS[] = {
+    { "timestamp",         ColumnKind::Timestamp },
+    { "eventCount",        ColumnKind::UInt32 },
+    { "processId",         ColumnKind::UInt32 },
+    { "processName",       ColumnKind::Dictionary },
+    { "processPath",       ColumnKind::Dictionary },
+    { "description",       ColumnKind::Dictionary },
+    { "sessionName",       ColumnKind::Dictionary },
+    { "volumeLevel",       ColumnKind::Float32 },
+    { "peakLevel",         ColumnKind::Float32 },
+    { "isSystemSound",     ColumnKind::Bool },
+    { "usbDevice",         ColumnKind::Dictionary },
+    { "browserTab",        ColumnKind::Dictionary },
+    { "soundLabel",        ColumnKind::Dictionary },
+    { "momentaryLoudness", ColumnKind::Float32 },
+    { "shortTermLoudness", ColumnKind::Float32 },
+    { "endpointId",        ColumnKind::Dictionary },
+};
+const size_t DICTIONARY_COUNT = 8;
+
+const std::string& DictionaryValue(const AudioEvent& event, size_t dictionaryId) {
+    switch (dictionaryId) {
+        case 0: return event.processName;
+        case 1: return event.processPath;
+        case 2: return event.soundDescription;
+        case 3: return event.sessionDisplayName;
+        case 4: return event.usbDeviceInfo;
+        case 5: return event.browserTabInfo;
+        case 6: return event.soundLabel;
+        default: return event.endpointId;
+    }
+}
+
+// Message body: 8-byte aligned buffers plus the node/buffer descriptors
+struct BodyBuilder {
+    std::vector<uint8_t> bytes;
+    std::vector<std::pair<int64_t, int64_t>> nodes;    // length, null count
+    std::vector<std::pair<int64_t, int64_t>> buffers;  // offset, length
+
+    void AddNode(size_t length) {
+        nodes.push_back(std::make_pair(static_cast<int64_t>(length), 0));
+    }
+
+    void AddBuffer(const void* data, size_t length) {
+        buffers.push_back(std::make_pair(static_cast<int64_t>(bytes.size()),
+                                         static_cast<int64_t>(length)));
+        if (length > 0) {
+            const uint8_t* p = static_cast<const uint8_t*>(data);
+            bytes.insert(bytes.end(), p, p + length);
+        }
+        bytes.resize((bytes.size() + 7) & ~static_cast<size_t>(7), 0);
+    }
+
+    // Non-nullable column: empty validity buffer followed by the values
+    void AddColumn(size_t rows, const void* data, size_t length) {
+        AddNode(rows);
+        AddBuffer(nullptr, 0);
+        AddBuffer(data, length);
+    }
+};
+
+struct Block {
+    int64_t offset;
+    int32_t metaDataLength;
+    int64_t bodyLength;
+};
+
+Ref BuildIntType(FlatBuilder& fb, int32_t bitWidth, bool isSigned) {
+    fb.StartTable();
+    fb.AddField<int32_t>(0, bitWidth);
+    fb.AddField<uint8_t>(1, isSigned ? 1 : 0);
+    return fb.EndTable();
+}
+
+Ref BuildField(FlatBuilder& fb, const ColumnDef& column, int64_t dictionaryId) {
+    Ref name = fb.CreateString(column.name);
+    Ref type = 0;
+    Ref dictionary = 0;
+    uint8_t typeType = 0;
+
+    switch (column.kind) {
+        case ColumnKind::Timestamp: {
+            Ref timezone = fb.CreateString("UTC");
+            fb.StartTable();
+            fb.AddField<int16_t>(0, TIME_UNIT_MILLISECOND);
+            fb.AddFieldRef(1, timezone);
+            type = fb.EndTable();
+            typeType = TYPE_TIMESTAMP;
+            break;
+        }
+        case ColumnKind::UInt32:
+            type = BuildIntType(fb, 32, false);
+            typeType = TYPE_INT;
+            break;
+        case ColumnKind::Float32:
+            fb.StartTable();
+            fb.AddField<int16_t>(0, PRECISION_SINGLE);
+            type = fb.EndTable();
+            typeType = TYPE_FLOATING_POINT;
+            break;
+        case ColumnKind::Bool:
+            fb.StartTable();
+            type = fb.EndTable();
+            typeType = TYPE_BOOL;
+            break;
+        case ColumnKind::Dictionary: {
+            fb.StartTable();
+            type = fb.EndTable();
+            typeType = TYPE_UTF8;
+            Ref indexType = BuildIntType(fb, 32, true);
+            fb.StartTable();
+            fb.AddField<int64_t>(0, dictionaryId);
+            fb.AddFieldRef(1, indexType);
+            fb.AddField<uint8_t>(2, 0);  // isOrdered
+            dictionary = fb.EndTable();
+            break;
+        }
+    }
+
+    Ref children = fb.CreateRefVector(std::vector<Ref>());
+    fb.StartTable();
+    fb.AddFieldRef(0, name);
+    fb.AddField<uint8_t>(1, 0);  // nullable
+    fb.AddField<uint8_t>(2, typeType);
+    fb.AddFieldRef(3, type);
+    if (dictionary) {
+        fb.AddFieldRef(4, dictionary);
+    }
+    fb.AddFieldRef(5, children);
+    return fb.EndTable();
+}
+
+Ref BuildSchema(FlatBuilder& fb) {
+    std::vector<Ref> fields;
+    int64_t dictionaryId = 0;
+    for (const auto& column : COLUMNS) {
+        bool isDictionary = column.kind == ColumnKind::Dictionary;
+        fields.push_back(BuildField(fb, column, isDictionary ? dictionaryId++ : -1));
+    }
+    Ref fieldVector = fb.CreateRefVector(fields);
+
+    fb.StartTable();
+    fb.AddField<int16_t>(0, 0);  // Little endian
+    fb.AddFieldRef(1, fieldVector);
+    return fb.EndTable();
+}
+
+Ref BuildRecordBatch(FlatBuilder& fb, size_t rows, const BodyBuilder& body) {
+    // Structs are written last field first
+    fb.StartVector(16, body.nodes.size(), 8);
+    for (size_t i = body.nodes.size(); i > 0; --i) {
+        fb.PushRaw<int64_t>(body.nodes[i - 1].second);
+        fb.PushRaw<int64_t>(body.nodes[i - 1].first);
+    }
+    Ref nodes = fb.EndVector(body.nodes.size());
+
+    fb.StartVector(16, body.buffers.size(), 8);
+    for (size_t i = body.buffers.size(); i > 0; --i) {
+        fb.PushRaw<int64_t>(body.buffers[i - 1].second);
+        fb.PushRaw<int64_t>(body.buffers[i - 1].first);
+    }
+    Ref buffers = fb.EndVector(body.buffers.size());
+
+    fb.StartTable();
+    fb.AddField<int64_t>(0, static_cast<int64_t>(rows));
+    fb.AddFieldRef(1, nodes);
+    fb.AddFieldRef(2, buffers);
+    return fb.EndTable();
+}
+
+Ref BuildBlockVector(FlatBuilder& fb, const std::vector<Block>& blocks) {
+    fb.StartVector(24, blocks.size(), 8);
+    for (size_t i = blocks.size(); i > 0; --i) {
+        fb.PushRaw<int64_t>(blocks[i - 1].bodyLength);
+        fb.PushRaw<int32_t>(0);  // Struct padding
+        fb.PushRaw<int32_t>(blocks[i - 1].metaDataLength);
+        fb.PushRaw<int64_t>(blocks[i - 1].offset);
+    }
+    return fb.EndVector(blocks.size());
+}
+
+std::vector<uint8_t> FinishMessage(FlatBuilder& fb, uint8_t headerType, Ref header, size_t bodyLength) {
+    fb.StartTable();
+    fb.AddField<int16_t>(0, METADATA_V5);
+    fb.AddField<uint8_t>(1, headerType);
+    fb.AddFieldRef(2, header);
+    fb.AddField<int64_t>(3, static_cast<int64_t>(bodyLength));
+    return fb.Finish(fb.EndTable());
+}
+
+// Encapsulated message: continuation marker, metadata size, flatbuffer
+// padded to 8 bytes, then the body. Returns the block describing it.
+Block WriteMessage(std::ostream& out, int64_t& position,
+                   const std::vector<uint8_t>& metadata, const std::vector<uint8_t>& body) {
+    static const char padding[8] = { 0 };
+    size_t padded = (metadata.size() + 7) & ~static_cast<size_t>(7);
+    uint32_t continuation = 0xFFFFFFFF;
+    int32_t size = static_cast<int32_t>(padded);
+
+    out.write(reinterpret_cast<const char*>(&continuation), sizeof(continuation));
+    out.write(reinterpret_cast<const char*>(&size), sizeof(size));
+    out.write(reinterpret_cast<const char*>(metadata.data()), metadata.size());
+    out.write(padding, padded - metadata.size());
+    if (!body.empty()) {
+        out.write(reinterpret_cast<const char*>(body.data()), body.size());
+    }
+
+    Block block = { position, static_cast<int32_t>(8 + padded), static_cast<int64_t>(body.size()) };
+    position += block.metaDataLength + block.bodyLength;
+    return block;
+}
+
+} // namespace
+
+ArrowWriter::ArrowWriter(size_t batchRows)
+    : m_batchRows(batchRows > 0 ? batchRows : DEFAULT_BATCH_ROWS) {
+}
+
+bool ArrowWriter::Write(const std::vector<AudioEvent>& events, std::ostream& out) {
+    // Build the dictionaries up front; the file format does not allow
+    // replacing a dictionary between batches
+    std::vector<std::string> dictionaries[DICTIONARY_COUNT];
+    std::vector<int32_t> indices[DICTIONARY_COUNT];
+    std::unordered_map<std::string, int32_t> lookup[DICTIONARY_COUNT];
+
+    for (size_t d = 0; d < DICTIONARY_COUNT; ++d) {
+        indices[d].reserve(events.size());
+    }
+    for (const auto& event : events) {
+        for (size_t d = 0; d < DICTIONARY_COUNT; ++d) {
+            const std::string& value = DictionaryValue(event, d);
+            auto it = lookup[d].find(value);
+            if (it == lookup[d].end()) {
+                it = lookup[d].emplace(value, static_cast<int32_t>(dictionaries[d].size())).first;
+                dictionaries[d].push_back(value);
+            }
+            indices[d].push_back(it->second);
+        }
+    }
+
+    out.write("ARROW1\0\0", 8);
+    int64_t position = 8;
+
+    {
+        FlatBuilder fb;
+        Ref schema = BuildSchema(fb);
+        WriteMessage(out, position, FinishMessage(fb, HEADER_SCHEMA, schema, 0), std::vector<uint8_t>());
+    }
+
+    std::vector<Block> dictionaryBlocks;
+    for (size_t d = 0; d < DICTIONARY_COUNT; ++d) {
+        std::vector<int32_t> offsets(1, 0);
+        std::string data;
+        for (const auto& value : dictionaries[d]) {
+            data += value;
+            offsets.push_back(static_cast<int32_t>(data.size()));
+        }
+
+        BodyBuilder body;
+        body.AddNode(dictionaries[d].size());
+        body.AddBuffer(nullptr, 0);
+        body.AddBuffer(offsets.data(), offsets.size() * sizeof(int32_t));
+        body.AddBuffer(data.data(), data.size());
+
+        FlatBuilder fb;
+        Ref batch = BuildRecordBatch(fb, dictionaries[d].size(), body);
+        fb.StartTable();
+        fb.AddField<int64_t>(0, static_cast<int64_t>(d));
+        fb.AddFieldRef(1, batch);
+        fb.AddField<uint8_t>(2, 0);  // isDelta
+        Ref header = fb.EndTable();
+        dictionaryBlocks.push_back(WriteMessage(out, position,
+            FinishMessage(fb, HEADER_DICTIONARY_BATCH, header, body.bytes.size()), body.bytes));
+    }
+
+    // Stream the rows out in record batches of at most m_batchRows
+    std::vector<Block> batchBlocks;
+    std::vector<int64_t> timestamps;
+    std::vector<uint32_t> counts, pids;
+    std::vector<float> volumes, peaks, momentary, shortTerm;
+    std::vector<uint8_t> systemBits;
+
+    for (size_t start = 0; start < events.size(); start += m_batchRows) {
+        size_t rows = (std::min)(m_batchRows, events.size() - start);
+
+        timestamps.assign(rows, 0);
+        counts.assign(rows, 0);
+        pids.assign(rows, 0);
+        volumes.assign(rows, 0.0f);
+        peaks.assign(rows, 0.0f);
+        momentary.assign(rows, 0.0f);
+        shortTerm.assign(rows, 0.0f);
+        systemBits.assign((rows + 7) / 8, 0);
+
+        for (size_t i = 0; i < rows; ++i) {
+            const auto& event = events[start + i];
+            timestamps[i] = std::chrono::duration_cast<std::chrono::milliseconds>(
+                event.timestamp.time_since_epoch()).count();
+            counts[i] = event.eventCount > 0 ? event.eventCount : 1;
+            pids[i] = event.processId;
+            volumes[i] = event.volumeLevel;
+            peaks[i] = event.peakLevel;
+            momentary[i] = event.momentaryLoudness;
+            shortTerm[i] = event.shortTermLoudness;
+            if (event.isSystemSound) {
+                systemBits[i / 8] |= static_cast<uint8_t>(1 << (i % 8));
+            }
+        }
+
+        // Buffers in COLUMNS order
+        BodyBuilder body;
+        body.AddColumn(rows, timestamps.data(), rows * sizeof(int64_t));
+        body.AddColumn(rows, counts.data(), rows * sizeof(uint32_t));
+        body.AddColumn(rows, pids.data(), rows * sizeof(uint32_t));
+        for (size_t d = 0; d < 4; ++d) {
+            body.AddColumn(rows, indices[d].data() + start, rows * sizeof(int32_t));
+        }
+        body.AddColumn(rows, volumes.data(), rows * sizeof(float));
+        body.AddColumn(rows, peaks.data(), rows * sizeof(float));
+        body.AddColumn(rows, systemBits.data(), systemBits.size());
+        body.AddColumn(rows, indices[4].data() + start, rows * sizeof(int32_t));
+        body.AddColumn(rows, indices[5].data() + start, rows * sizeof(int32_t));
+        body.AddColumn(rows, indices[6].data() + start, rows * sizeof(int32_t));
+        body.AddColumn(rows, momentary.data(), rows * sizeof(float));
+        body.AddColumn(rows, shortTerm.data(), rows * sizeof(float));
+        body.AddColumn(rows, indices[7].data() + start, rows * sizeof(int32_t));
+
+        FlatBuilder fb;
+        Ref batch = BuildRecordBatch(fb, rows, body);
+        batchBlocks.push_back(WriteMessage(out, position,
+            FinishMessage(fb, HEADER_RECORD_BATCH, batch, body.bytes.size()), body.bytes));
+    }
+
+    // End-of-stream marker, then the footer that indexes every block
+    const uint32_t endOfStream[2] = { 0xFFFFFFFF, 0 };
+    out.write(reinterpret_cast<const char*>(endOfStream), sizeof(endOfStream));
+
+    FlatBuilder fb;
+    Ref schema = BuildSchema(fb);
+    Ref dictionaryVector = BuildBlockVector(fb, dictionaryBlocks);
+    Ref batchVector = BuildBlockVector(fb, batchBlocks);
+    fb.StartTable();
+    fb.AddField<int16_t>(0, METADATA_V5);
+    fb.AddFieldRef(1, schema);
+    fb.AddFieldRef(2, dictionaryVector);
+    fb.AddFieldRef(3, batchVector);
+    std::vector<uint8_t> footer = fb.Finish(fb.EndTable());
+
+    int32_t footerLength = static_cast<int32_t>(footer.size());
+    out.write(reinterpret_cast<const char*>(footer.data()), footer.size());
+    out.write(reinterpret_cast<const char*>(&footerLength), sizeof(footerLength));
+    out.write("ARROW1", 6);
+
+    return out.good();
+}
+
+bool ArrowWriter::WriteFile(const std::vector<AudioEvent>& events, const std::wstring& outputPath) {
+    std::ofstream output(std::filesystem::path(outputPath), std::ios::out | std::ios::binary);
+    if (!output.is_open()) {
+        return false;
+    }
+    bool ok = Write(events, output);
+    output.close();
+    return ok && !output.fail();
+}
\ No newline at end of file
@@ -0,0 +1,102 @@
+#include "../include/ChangeFeed.h"
+#include "../include/SpanTracer.h"
+#include <algorithm>
+
+ChangeFeed::ChangeFeed() : m_revision(0), m_nextId(1), m_calling(0), m_stopping(false) {
+}
+
+ChangeFeed::~ChangeFeed() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+uint64_t ChangeFeed::Subscribe(Callback callback, unsigned maxFramesPerSecond) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Subscriber subscriber;
+    subscriber.id = m_nextId++;
+    subscriber.callback = std::move(callback);
+    subscriber.minInterval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::seconds(1)) / (std::max)(maxFramesPerSecond, 1u);
+    subscriber.lastCall = std::chrono::steady_clock::time_point();
+    subscriber.notified = m_revision;
+    m_subscribers.push_back(std::move(subscriber));
+
+    if (!m_thread.joinable()) {
+        m_thread = std::thread(&ChangeFeed::DispatchThreadProc, this);
+    }
+    return m_subscribers.back().id;
+}
+
+void ChangeFeed::Unsubscribe(uint64_t id) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_subscribers.erase(std::remove_if(m_subscribers.begin(), m_subscribers.end(),
+                                       [id](const Subscriber& s) { return s.id == id; }),
+                        m_subscribers.end());
+
+    // Wait out a call in progress, unless this is that call unsubscribing itself
+    if (std::this_thread::get_id() != m_thread.get_id()) {
+        m_wake.wait(lock, [this, id] { return m_calling != id; });
+    }
+}
+
+void ChangeFeed::Publish(uint64_t revision) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (revision <= m_revision) {
+        return;
+    }
+    m_revision = revision;
+    if (!m_subscribers.empty()) {
+        m_wake.notify_all();
+    }
+}
+
+void ChangeFeed::DispatchThreadProc() {
+    SpanTracer::SetThreadName("ChangeFeed");
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_stopping) {
+        auto now = std::chrono::steady_clock::now();
+        auto nextWake = (std::chrono::steady_clock::time_point::max)();
+        Subscriber* due = nullptr;
+        for (auto& subscriber : m_subscribers) {
+            if (subscriber.notified >= m_revision) {
+                continue;
+            }
+            auto allowed = subscriber.lastCall + subscriber.minInterval;
+            if (allowed <= now) {
+                due = &subscriber;
+                break;
+            }
+            nextWake = (std::min)(nextWake, allowed);
+        }
+
+        if (!due) {
+            if (nextWake == (std::chrono::steady_clock::time_point::max)()) {
+                m_wake.wait(lock);
+            } else {
+                m_wake.wait_until(lock, nextWake);
+            }
+            continue;
+        }
+
+        // Call without the lock so publishers never wait on a subscriber
+        due->notified = m_revision;
+        due->lastCall = now;
+        m_calling = due->id;
+        Callback callback = due->callback;
+        uint64_t revision = m_revision;
+        lock.unlock();
+        {
+            TRACE_SPAN_ARG("ChangeFeed callback", "revision", revision);
+            callback(revision);
+        }
+        lock.lock();
+        m_calling = 0;
+        m_wake.notify_all();
+    }
+}
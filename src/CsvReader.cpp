@@ -0,0 +1,536 @@
+#include "../include/CsvReader.h"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <iterator>
+#include <thread>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CSV_USE_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#define CSV_USE_NEON
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+// Must match the header Logger::Initialize writes. CSV exports append a
+// Duration(ms) column, which is accepted and ignored.
+const char LOG_HEADER[] = "Timestamp,EventCount,ProcessID,ProcessName,ProcessPath,Description,"
+                          "SessionName,VolumeLevel,PeakLevel,IsSystemSound,USBDevice,BrowserTab";
+const size_t MIN_CHUNK_BYTES = 1024 * 1024;  // Smaller bodies are parsed on one thread
+
+inline unsigned CountTrailingZeros(unsigned mask) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return index;
+#else
+    return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+}
+
+// First ',', '"' or '\n' in [p, end), or end
+const char* FindSpecial(const char* p, const char* end) {
+#if defined(CSV_USE_SSE2)
+    const __m128i comma = _mm_set1_epi8(',');
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i newline = _mm_set1_epi8('\n');
+    while (end - p >= 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i hits = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, comma), _mm_cmpeq_epi8(v, quote)),
+                                    _mm_cmpeq_epi8(v, newline));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(hits));
+        if (mask != 0) {
+            return p + CountTrailingZeros(mask);
+        }
+        p += 16;
+    }
+#elif defined(CSV_USE_NEON)
+    const uint8x16_t comma = vdupq_n_u8(',');
+    const uint8x16_t quote = vdupq_n_u8('"');
+    const uint8x16_t newline = vdupq_n_u8('\n');
+    while (end - p >= 16) {
+        uint8x16_t v = vld1q_u8(reinterpret_cast<const uint8_t*>(p));
+        uint8x16_t hits = vorrq_u8(vorrq_u8(vceqq_u8(v, comma), vceqq_u8(v, quote)), vceqq_u8(v, newline));
+        if (vmaxvq_u8(hits) != 0) {
+            break;  // Locate it with the scalar loop below
+        }
+        p += 16;
+    }
+#endif
+    while (p < end && *p != ',' && *p != '"' && *p != '\n') {
+        ++p;
+    }
+    return p;
+}
+
+struct ChunkCounts {
+    size_t quotes;
+    size_t newlines;  // Upper bound on the rows starting in the chunk
+};
+
+ChunkCounts CountQuotesAndNewlines(const char* p, const char* end) {
+    ChunkCounts counts = { 0, 0 };
+#if defined(CSV_USE_SSE2)
+    // Per-byte counters (cmpeq yields -1 per hit) summed before they overflow
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i zero = _mm_setzero_si128();
+    while (end - p >= 16) {
+        __m128i quoteCounters = zero;
+        __m128i newlineCounters = zero;
+        for (int i = 0; i < 255 && end - p >= 16; ++i, p += 16) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            quoteCounters = _mm_sub_epi8(quoteCounters, _mm_cmpeq_epi8(v, quote));
+            newlineCounters = _mm_sub_epi8(newlineCounters, _mm_cmpeq_epi8(v, newline));
+        }
+        __m128i quoteSums = _mm_sad_epu8(quoteCounters, zero);
+        __m128i newlineSums = _mm_sad_epu8(newlineCounters, zero);
+        counts.quotes += static_cast<size_t>(_mm_cvtsi128_si32(quoteSums)) +
+                         static_cast<size_t>(_mm_cvtsi128_si32(_mm_srli_si128(quoteSums, 8)));
+        counts.newlines += static_cast<size_t>(_mm_cvtsi128_si32(newlineSums)) +
+                           static_cast<size_t>(_mm_cvtsi128_si32(_mm_srli_si128(newlineSums, 8)));
+    }
+#elif defined(CSV_USE_NEON)
+    const uint8x16_t quote = vdupq_n_u8('"');
+    const uint8x16_t newline = vdupq_n_u8('\n');
+    const uint8x16_t one = vdupq_n_u8(1);
+    while (end - p >= 16) {
+        uint8x16_t v = vld1q_u8(reinterpret_cast<const uint8_t*>(p));
+        counts.quotes += vaddvq_u8(vandq_u8(vceqq_u8(v, quote), one));
+        counts.newlines += vaddvq_u8(vandq_u8(vceqq_u8(v, newline), one));
+        p += 16;
+    }
+#endif
+    for (; p < end; ++p) {
+        counts.quotes += (*p == '"');
+        counts.newlines += (*p == '\n');
+    }
+    return counts;
+}
+
+// Position just past the next newline that is outside quotes, or end
+const char* NextRow(const char* p, const char* end, bool inQuotes) {
+    while (p < end) {
+        if (inQuotes) {
+            const char* q = static_cast<const char*>(std::memchr(p, '"', end - p));
+            if (!q) {
+                return end;
+            }
+            p = q + 1;
+            inQuotes = false;
+            continue;
+        }
+        p = FindSpecial(p, end);
+        if (p == end) {
+            return end;
+        }
+        if (*p == '\n') {
+            return p + 1;
+        }
+        if (*p == '"') {
+            inQuotes = true;
+        }
+        ++p;
+    }
+    return end;
+}
+
+// Converts local wall-clock time to a time point. mktime is slow and takes a
+// lock, so the result is cached per local hour; rows within one hour only
+// add minutes, seconds and milliseconds.
+class LocalTimeCache {
+private:
+    int64_t m_hourKey;
+    std::time_t m_hourStart;
+
+public:
+    LocalTimeCache() : m_hourKey(-1), m_hourStart(0) {}
+
+    bool Convert(int year, int month, int day, int hour, int minute, int second, int millis,
+                 std::chrono::system_clock::time_point& out) {
+        int64_t key = ((static_cast<int64_t>(year) * 16 + month) * 32 + day) * 32 + hour;
+        if (key != m_hourKey) {
+            std::tm tm = {};
+            tm.tm_year = year - 1900;
+            tm.tm_mon = month - 1;
+            tm.tm_mday = day;
+            tm.tm_hour = hour;
+            tm.tm_isdst = -1;
+            std::time_t start = std::mktime(&tm);
+            if (start == static_cast<std::time_t>(-1)) {
+                return false;
+            }
+            m_hourKey = key;
+            m_hourStart = start;
+        }
+        out = std::chrono::system_clock::from_time_t(m_hourStart) +
+              std::chrono::seconds(minute * 60 + second) + std::chrono::milliseconds(millis);
+        return true;
+    }
+};
+
+// Parses the rows of one chunk. Each row is consumed up to and including its
+// newline, so the cursor always sits on a row boundary.
+class RowParser {
+private:
+    const char* m_p;
+    const char* m_end;
+    LocalTimeCache m_time;
+
+    // Bounds of an unquoted field; the cursor stops on the delimiter
+    bool Field(const char*& begin, const char*& finish) {
+        if (m_p < m_end && *m_p == '"') {
+            return false;
+        }
+        begin = m_p;
+        m_p = FindSpecial(m_p, m_end);
+        finish = m_p;
+        return m_p == m_end || *m_p != '"';
+    }
+
+    bool StringField(std::string& value) {
+        if (m_p < m_end && *m_p == '"') {
+            // Quoted by SanitizeForCSV: "" inside stands for one quote
+            ++m_p;
+            value.clear();
+            for (;;) {
+                const char* q = static_cast<const char*>(std::memchr(m_p, '"', m_end - m_p));
+                if (!q) {
+                    return false;
+                }
+                value.append(m_p, q);
+                m_p = q + 1;
+                if (m_p < m_end && *m_p == '"') {
+                    value += '"';
+                    ++m_p;
+                    continue;
+                }
+                return true;
+            }
+        }
+        const char* begin;
+        const char* finish;
+        if (!Field(begin, finish)) {
+            return false;
+        }
+        if (finish > begin && finish[-1] == '\r') {
+            --finish;
+        }
+        value.assign(begin, finish);
+        return true;
+    }
+
+    template <typename T>
+    bool NumberField(T& value) {
+        const char* begin;
+        const char* finish;
+        if (!Field(begin, finish)) {
+            return false;
+        }
+        auto result = std::from_chars(begin, finish, value);
+        return result.ec == std::errc() && result.ptr == finish;
+    }
+
+    // "12.34%" -> 0.1234
+    bool LevelField(float& value) {
+        const char* begin;
+        const char* finish;
+        if (!Field(begin, finish) || finish == begin || finish[-1] != '%') {
+            return false;
+        }
+        float percent = 0.0f;
+        auto result = std::from_chars(begin, finish - 1, percent);
+        if (result.ec != std::errc() || result.ptr != finish - 1) {
+            return false;
+        }
+        value = percent / 100.0f;
+        return true;
+    }
+
+    bool Digits(const char*& p, int count, int& value) {
+        value = 0;
+        for (int i = 0; i < count; ++i, ++p) {
+            unsigned digit = static_cast<unsigned>(*p - '0');
+            if (digit > 9) {
+                return false;
+            }
+            value = value * 10 + static_cast<int>(digit);
+        }
+        return true;
+    }
+
+    // "YYYY-MM-DD HH:MM:SS.mmm" in local time, as FormatTimestamp writes it
+    bool TimestampField(std::chrono::system_clock::time_point& value) {
+        const char* begin;
+        const char* finish;
+        if (!Field(begin, finish) || finish - begin != 23) {
+            return false;
+        }
+        int year, month, day, hour, minute, second, millis;
+        const char* p = begin;
+        bool ok = Digits(p, 4, year) && *p++ == '-' && Digits(p, 2, month) && *p++ == '-' &&
+                  Digits(p, 2, day) && *p++ == ' ' && Digits(p, 2, hour) && *p++ == ':' &&
+                  Digits(p, 2, minute) && *p++ == ':' && Digits(p, 2, second) && *p++ == '.' &&
+                  Digits(p, 3, millis);
+        return ok && m_time.Convert(year, month, day, hour, minute, second, millis, value);
+    }
+
+    bool Comma() {
+        if (m_p < m_end && *m_p == ',') {
+            ++m_p;
+            return true;
+        }
+        return false;
+    }
+
+    // Accepts the end of the row, skipping any extra trailing columns
+    bool EndOfRow() {
+        if (m_p < m_end && *m_p == '\r') {
+            ++m_p;
+        }
+        if (m_p == m_end || *m_p == '\n') {
+            m_p = m_p == m_end ? m_end : m_p + 1;
+            return true;
+        }
+        if (*m_p == ',') {
+            m_p = NextRow(m_p, m_end, false);
+            return true;
+        }
+        return false;
+    }
+
+    bool Row(AudioEvent& event) {
+        std::string isSystemSound;
+        bool ok = TimestampField(event.timestamp) && Comma() &&
+                  NumberField(event.eventCount) && Comma() &&
+                  NumberField(event.processId) && Comma() &&
+                  StringField(event.processName) && Comma() &&
+                  StringField(event.processPath) && Comma() &&
+                  StringField(event.soundDescription) && Comma() &&
+                  StringField(event.sessionDisplayName) && Comma() &&
+                  LevelField(event.volumeLevel) && Comma() &&
+                  LevelField(event.peakLevel) && Comma() &&
+                  StringField(isSystemSound) && Comma() &&
+                  StringField(event.usbDeviceInfo) && Comma() &&
+                  StringField(event.browserTabInfo) && EndOfRow();
+        event.isSystemSound = isSystemSound == "Yes";
+        return ok;
+    }
+
+public:
+    RowParser(const char* begin, const char* end) : m_p(begin), m_end(end) {}
+
+    size_t ParseAll(std::vector<AudioEvent>& events, size_t rowsHint) {
+        size_t rejected = 0;
+        events.reserve(events.size() + rowsHint);
+        while (m_p < m_end) {
+            const char* rowStart = m_p;
+            events.emplace_back();
+            if (!Row(events.back())) {
+                events.pop_back();
+                // Blank lines are not rows; anything else is counted
+                if (!(*rowStart == '\n' || (*rowStart == '\r' && rowStart + 1 < m_end && rowStart[1] == '\n'))) {
+                    ++rejected;
+                }
+                m_p = NextRow(rowStart, m_end, false);
+            }
+        }
+        return rejected;
+    }
+};
+
+// Read-only view of a whole file
+class MappedFile {
+private:
+#ifdef _WIN32
+    HANDLE m_file;
+    HANDLE m_mapping;
+#else
+    int m_file;
+#endif
+    const char* m_view;
+    size_t m_size;
+
+public:
+    MappedFile()
+#ifdef _WIN32
+        : m_file(INVALID_HANDLE_VALUE), m_mapping(nullptr),
+#else
+        : m_file(-1),
+#endif
+          m_view(nullptr), m_size(0) {}
+
+    ~MappedFile() {
+#ifdef _WIN32
+        if (m_view) UnmapViewOfFile(m_view);
+        if (m_mapping) CloseHandle(m_mapping);
+        if (m_file != INVALID_HANDLE_VALUE) CloseHandle(m_file);
+#else
+        if (m_view) munmap(const_cast<char*>(m_view), m_size);
+        if (m_file >= 0) close(m_file);
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool Open(const std::wstring& path) {
+#ifdef _WIN32
+        // The logger may still be appending to today's file
+        m_file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                             NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+        if (m_file == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+        LARGE_INTEGER fileSize = {};
+        if (!GetFileSizeEx(m_file, &fileSize) || fileSize.QuadPart == 0) {
+            return false;
+        }
+        m_size = static_cast<size_t>(fileSize.QuadPart);
+        m_mapping = CreateFileMappingW(m_file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (!m_mapping) {
+            return false;
+        }
+        m_view = static_cast<const char*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+#else
+        m_file = open(std::filesystem::path(path).string().c_str(), O_RDONLY);
+        if (m_file < 0) {
+            return false;
+        }
+        struct stat st = {};
+        if (fstat(m_file, &st) != 0 || st.st_size == 0) {
+            return false;
+        }
+        m_size = static_cast<size_t>(st.st_size);
+        void* view = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_file, 0);
+        m_view = view == MAP_FAILED ? nullptr : static_cast<const char*>(view);
+        if (m_view) {
+            madvise(view, m_size, MADV_SEQUENTIAL);
+        }
+#endif
+        return m_view != nullptr;
+    }
+
+    const char* Data() const { return m_view; }
+    size_t Size() const { return m_size; }
+};
+
+} // namespace
+
+CsvReader::CsvReader(unsigned threads) : m_threads(threads), m_rejectedRows(0) {
+    if (m_threads == 0) {
+        m_threads = (std::max)(std::thread::hardware_concurrency(), 1u);
+    }
+}
+
+bool CsvReader::Parse(const char* data, size_t size, std::vector<AudioEvent>& events) {
+    m_rejectedRows = 0;
+    const char* p = data;
+    const char* end = data + size;
+
+    // UTF-8 BOM written by Logger::Initialize
+    if (size >= 3 && std::memcmp(p, "\xEF\xBB\xBF", 3) == 0) {
+        p += 3;
+    }
+    size_t headerLength = sizeof(LOG_HEADER) - 1;
+    if (static_cast<size_t>(end - p) < headerLength || std::memcmp(p, LOG_HEADER, headerLength) != 0) {
+        return false;
+    }
+    const char* body = NextRow(p, end, false);
+
+    // Split the body into chunks; chunk i starts inside quotes if an odd
+    // number of quotes precede it
+    size_t chunkCount = (std::min)(static_cast<size_t>(m_threads),
+                                   (std::max)(static_cast<size_t>(end - body) / MIN_CHUNK_BYTES, static_cast<size_t>(1)));
+    std::vector<const char*> bounds(chunkCount + 1);
+    for (size_t i = 0; i <= chunkCount; ++i) {
+        bounds[i] = body + (end - body) * i / chunkCount;
+    }
+
+    std::vector<ChunkCounts> counts(chunkCount);
+    std::vector<std::vector<AudioEvent>> results(chunkCount);
+    std::vector<size_t> rejected(chunkCount, 0);
+
+    auto runParallel = [chunkCount](auto&& work) {
+        std::vector<std::thread> workers;
+        for (size_t i = 1; i < chunkCount; ++i) {
+            workers.emplace_back(work, i);
+        }
+        work(0);
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    };
+
+    runParallel([&](size_t i) {
+        counts[i] = CountQuotesAndNewlines(bounds[i], bounds[i + 1]);
+    });
+
+    // A row belongs to the chunk its first byte falls in
+    std::vector<char> startsInQuotes(chunkCount, 0);
+    for (size_t i = 1; i < chunkCount; ++i) {
+        startsInQuotes[i] = startsInQuotes[i - 1] ^ static_cast<char>(counts[i - 1].quotes & 1);
+    }
+    std::vector<const char*> rowStarts(chunkCount + 1, end);
+    rowStarts[0] = body;
+    runParallel([&](size_t i) {
+        if (i > 0) {
+            // The byte before the chunk may be the newline ending a row
+            rowStarts[i] = bounds[i][-1] == '\n' && !startsInQuotes[i]
+                ? bounds[i]
+                : NextRow(bounds[i], end, startsInQuotes[i] != 0);
+        }
+    });
+    runParallel([&](size_t i) {
+        RowParser parser(rowStarts[i], rowStarts[i + 1]);
+        rejected[i] = parser.ParseAll(results[i], counts[i].newlines + 1);
+    });
+
+    size_t total = events.size();
+    for (size_t i = 0; i < chunkCount; ++i) {
+        total += results[i].size();
+        m_rejectedRows += rejected[i];
+    }
+    if (events.empty() && chunkCount == 1) {
+        events.swap(results[0]);
+        return true;
+    }
+    events.reserve(total);
+    for (auto& chunk : results) {
+        std::move(chunk.begin(), chunk.end(), std::back_inserter(events));
+        std::vector<AudioEvent>().swap(chunk);
+    }
+    return true;
+}
+
+bool CsvReader::ReadFile(const std::wstring& path, std::vector<AudioEvent>& events) {
+    MappedFile file;
+    if (!file.Open(path)) {
+        return false;
+    }
+    return Parse(file.Data(), file.Size(), events);
+}
+
+bool CsvReader::ReadFile(const std::wstring& path, EventStore& store) {
+    std::vector<AudioEvent> events;
+    if (!ReadFile(path, events)) {
+        return false;
+    }
+    store.Import(std::move(events));
+    return true;
+}
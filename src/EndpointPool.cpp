@@ -0,0 +1,112 @@
+#include "../include/EndpointPool.h"
+#include "../include/Metrics.h"
+#include "../include/SpanTracer.h"
+#include <atomic>
+#include <thread>
+#include <condition_variable>
+#include <algorithm>
+
+struct EndpointPool::Worker {
+    std::string endpointId;
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+    std::atomic<uint64_t> polls{ 0 };
+
+    void Run(const Factory& factory, std::chrono::microseconds interval, size_t index) {
+        SpanTracer::SetThreadName("Endpoint " + std::to_string(index));
+        std::unique_ptr<EndpointPoller> poller = factory(endpointId);
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!stopping) {
+            auto tickStart = std::chrono::steady_clock::now();
+            if (poller) {
+                lock.unlock();
+                poller->Poll();
+                ++polls;
+                METRICS_TIMER_RECORD(EndpointPoll, tickStart);
+                if (SpanTracer::IsEnabled()) {
+                    SpanTracer::Record("EndpointTick", tickStart, std::chrono::steady_clock::now());
+                }
+                lock.lock();
+            }
+            wake.wait_until(lock, tickStart + interval, [this]() { return stopping; });
+        }
+        lock.unlock();
+        // Released here, on the thread that made it
+        poller.reset();
+    }
+};
+
+EndpointPool::EndpointPool(Factory factory, std::chrono::microseconds interval)
+    : m_factory(std::move(factory)), m_interval(interval) {
+}
+
+EndpointPool::~EndpointPool() {
+    Clear();
+}
+
+void EndpointPool::StopWorkers(std::vector<std::unique_ptr<Worker>>& workers) {
+    // Signal all first, so they wind down together
+    for (auto& worker : workers) {
+        std::lock_guard<std::mutex> lock(worker->mutex);
+        worker->stopping = true;
+        worker->wake.notify_one();
+    }
+    for (auto& worker : workers) {
+        worker->thread.join();
+    }
+    workers.clear();
+}
+
+void EndpointPool::Sync(const std::vector<std::string>& endpointIds) {
+    std::vector<std::unique_ptr<Worker>> gone;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (size_t i = 0; i < m_workers.size();) {
+            if (std::find(endpointIds.begin(), endpointIds.end(), m_workers[i]->endpointId) == endpointIds.end()) {
+                gone.push_back(std::move(m_workers[i]));
+                m_workers.erase(m_workers.begin() + static_cast<ptrdiff_t>(i));
+            } else {
+                ++i;
+            }
+        }
+        for (const std::string& endpointId : endpointIds) {
+            bool running = std::any_of(m_workers.begin(), m_workers.end(),
+                                       [&](const std::unique_ptr<Worker>& worker) {
+                                           return worker->endpointId == endpointId;
+                                       });
+            if (!running) {
+                std::unique_ptr<Worker> worker(new Worker());
+                worker->endpointId = endpointId;
+                worker->thread = std::thread(&Worker::Run, worker.get(), std::cref(m_factory), m_interval,
+                                             m_workers.size());
+                m_workers.push_back(std::move(worker));
+            }
+        }
+    }
+    StopWorkers(gone);
+}
+
+void EndpointPool::Clear() {
+    std::vector<std::unique_ptr<Worker>> gone;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        gone.swap(m_workers);
+    }
+    StopWorkers(gone);
+}
+
+size_t EndpointPool::GetWorkerCount() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_workers.size();
+}
+
+uint64_t EndpointPool::GetRounds() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    uint64_t rounds = UINT64_MAX;
+    for (const auto& worker : m_workers) {
+        rounds = (std::min)(rounds, worker->polls.load());
+    }
+    return m_workers.empty() ? 0 : rounds;
+}
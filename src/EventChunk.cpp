@@ -0,0 +1,427 @@
+#include "../include/EventChunk.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iterator>
+#include <string_view>
+#include <unordered_map>
+
+namespace {
+
+const size_t FIELD_COUNT = 8;
+const size_t HEADER_SIZE = 20;  // Event count, first and last timestamp ticks
+
+// Layout after the header: the PID dictionary, one string dictionary per
+// field (count, then length-prefixed strings), then per event the zigzagged
+// delta-of-delta of its timestamp in system_clock ticks, its PID's index,
+// count, duration, the packed levels and one dictionary index per field.
+// Integers are varints. Ticks keep a decoded event comparing exactly as it
+// did before encoding.
+std::string AudioEvent::* const STRING_FIELDS[FIELD_COUNT] = {
+    &AudioEvent::processName,
+    &AudioEvent::processPath,
+    &AudioEvent::soundDescription,
+    &AudioEvent::sessionDisplayName,
+    &AudioEvent::usbDeviceInfo,
+    &AudioEvent::browserTabInfo,
+    &AudioEvent::soundLabel,
+    &AudioEvent::endpointId
+};
+
+// Levels are 0.0 - 1.0 in steps of 1/10000, 14 bits each; bit 28 is isSystemSound.
+// Bit 29 says the levels are followed by the event's SoundFeatures: the frame
+// count as a varint, then its floats as they are. Bit 30 says the momentary
+// and short-term loudness follow those, as floats.
+const float LEVEL_STEPS = 10000.0f;
+const int LEVEL_BITS = 14;
+const uint32_t LEVEL_MASK = (1u << LEVEL_BITS) - 1;
+const uint32_t SYSTEM_SOUND_BIT = 1u << (2 * LEVEL_BITS);
+const uint32_t FEATURES_BIT = 1u << (2 * LEVEL_BITS + 1);
+const uint32_t LOUDNESS_BIT = 1u << (2 * LEVEL_BITS + 2);
+const size_t FEATURE_FLOATS = 4 + SoundFeatures::MFCC_COUNT;
+
+uint32_t PackLevel(float level) {
+    if (!(level > 0.0f)) return 0;
+    return static_cast<uint32_t>(std::lround((std::min)(level, 1.0f) * LEVEL_STEPS));
+}
+
+uint32_t PackLevels(const AudioEvent& event) {
+    return PackLevel(event.volumeLevel) | (PackLevel(event.peakLevel) << LEVEL_BITS) |
+           (event.isSystemSound ? SYSTEM_SOUND_BIT : 0) | (event.features.frames > 0 ? FEATURES_BIT : 0) |
+           (HasLoudness(event) ? LOUDNESS_BIT : 0);
+}
+
+template <typename T>
+void Put(std::vector<uint8_t>& out, T value) {
+    size_t at = out.size();
+    out.resize(at + sizeof(T));
+    std::memcpy(&out[at], &value, sizeof(T));
+}
+
+void PutVarint(std::vector<uint8_t>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+uint64_t ZigZag(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+int64_t UnZigZag(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+int64_t Ticks(const std::chrono::system_clock::time_point& time) {
+    return static_cast<int64_t>(time.time_since_epoch().count());
+}
+
+std::chrono::system_clock::time_point FromTicks(int64_t ticks) {
+    return std::chrono::system_clock::time_point(std::chrono::system_clock::duration(ticks));
+}
+
+// Bounds-checked reader over a chunk
+struct ChunkReader {
+    const uint8_t* data;
+    size_t size;
+    size_t pos;
+
+    template <typename T>
+    bool Get(T& value) {
+        if (size - pos < sizeof(T)) return false;
+        std::memcpy(&value, data + pos, sizeof(T));
+        pos += sizeof(T);
+        return true;
+    }
+
+    bool GetVarint(uint64_t& value) {
+        value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (pos >= size) return false;
+            uint8_t byte = data[pos++];
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) return true;
+        }
+        return false;
+    }
+};
+
+void PutFeatures(std::vector<uint8_t>& out, const SoundFeatures& features) {
+    PutVarint(out, features.frames);
+    const float values[] = {
+        features.rms, features.centroidHz, features.flux, features.zeroCrossingRate
+    };
+    for (float value : values) {
+        Put<float>(out, value);
+    }
+    for (float value : features.mfcc) {
+        Put<float>(out, value);
+    }
+}
+
+bool GetFeatures(ChunkReader& reader, SoundFeatures& features) {
+    uint64_t frames = 0;
+    if (!reader.GetVarint(frames) || reader.size - reader.pos < FEATURE_FLOATS * sizeof(float)) {
+        return false;
+    }
+    features.frames = static_cast<uint32_t>(frames);
+    reader.Get(features.rms);
+    reader.Get(features.centroidHz);
+    reader.Get(features.flux);
+    reader.Get(features.zeroCrossingRate);
+    for (float& value : features.mfcc) {
+        reader.Get(value);
+    }
+    return true;
+}
+
+// Walks every row and materializes those keep(index, timestamp) accepts.
+// Stops quietly at the first malformed byte.
+template <typename Keep>
+void DecodeRows(const std::vector<uint8_t>& data, uint32_t count, Keep keep, std::vector<AudioEvent>& out) {
+    if (data.size() < HEADER_SIZE) return;
+    ChunkReader reader = { data.data(), data.size(), sizeof(uint32_t) };
+    int64_t ticks = 0;
+    reader.Get(ticks);  // The earliest timestamp, which the deltas start from
+    reader.pos = HEADER_SIZE;
+
+    std::vector<uint64_t> processIds;
+    uint64_t size = 0;
+    bool valid = reader.GetVarint(size) && size <= reader.size - reader.pos;
+    for (uint64_t i = 0; i < size && valid; ++i) {
+        uint64_t processId = 0;
+        valid = reader.GetVarint(processId);
+        processIds.push_back(processId);
+    }
+    std::vector<std::string_view> strings[FIELD_COUNT];
+    for (size_t field = 0; field < FIELD_COUNT && valid; ++field) {
+        valid = reader.GetVarint(size) && size <= reader.size - reader.pos;
+        for (uint64_t i = 0; i < size && valid; ++i) {
+            uint64_t length = 0;
+            valid = reader.GetVarint(length) && length <= reader.size - reader.pos;
+            if (valid) {
+                strings[field].emplace_back(reinterpret_cast<const char*>(reader.data + reader.pos),
+                                            static_cast<size_t>(length));
+                reader.pos += static_cast<size_t>(length);
+            }
+        }
+    }
+
+    int64_t delta = 0;
+    for (uint32_t i = 0; i < count && valid; ++i) {
+        uint64_t deltaOfDelta = 0, processIndex = 0, eventCount = 0, duration = 0;
+        uint32_t levels = 0;
+        uint64_t fieldIds[FIELD_COUNT];
+        SoundFeatures features;
+        float momentary = LOUDNESS_FLOOR_LUFS, shortTerm = LOUDNESS_FLOOR_LUFS;
+        valid = reader.GetVarint(deltaOfDelta) && reader.GetVarint(processIndex) &&
+                processIndex < processIds.size() && reader.GetVarint(eventCount) &&
+                reader.GetVarint(duration) && reader.Get(levels) &&
+                (!(levels & FEATURES_BIT) || GetFeatures(reader, features)) &&
+                (!(levels & LOUDNESS_BIT) || (reader.Get(momentary) && reader.Get(shortTerm)));
+        for (size_t field = 0; field < FIELD_COUNT && valid; ++field) {
+            valid = reader.GetVarint(fieldIds[field]) && fieldIds[field] < strings[field].size();
+        }
+        if (!valid) {
+            break;
+        }
+
+        delta += UnZigZag(deltaOfDelta);
+        ticks += delta;
+        auto timestamp = FromTicks(ticks);
+        if (!keep(i, timestamp)) {
+            continue;
+        }
+        out.emplace_back();
+        AudioEvent& event = out.back();
+        event.timestamp = timestamp;
+        event.processId = static_cast<DWORD>(processIds[static_cast<size_t>(processIndex)]);
+        event.eventCount = static_cast<DWORD>(eventCount);
+        event.duration_ms = static_cast<DWORD>(duration);
+        event.volumeLevel = static_cast<float>(levels & LEVEL_MASK) / LEVEL_STEPS;
+        event.peakLevel = static_cast<float>((levels >> LEVEL_BITS) & LEVEL_MASK) / LEVEL_STEPS;
+        event.momentaryLoudness = momentary;
+        event.shortTermLoudness = shortTerm;
+        event.isSystemSound = (levels & SYSTEM_SOUND_BIT) != 0;
+        event.features = features;
+        for (size_t field = 0; field < FIELD_COUNT; ++field) {
+            event.*STRING_FIELDS[field] = strings[field][static_cast<size_t>(fieldIds[field])];
+        }
+    }
+}
+
+// Fields of STRING_FIELDS a query can filter or group on, by EventColumns::Text
+const size_t COLUMN_FIELDS[EventColumns::TEXT_COUNT] = { 0, 6, 7 };
+
+} // namespace
+
+EventChunk::EventChunk() : m_count(0) {
+}
+
+const std::vector<uint8_t>& EventChunk::GetData() const {
+    static const std::vector<uint8_t> empty;
+    return m_data ? *m_data : empty;
+}
+
+EventChunk EventChunk::Encode(const AudioEvent* events, size_t count) {
+    EventChunk chunk;
+    if (count == 0) {
+        return chunk;
+    }
+
+    // Dictionaries come first so a reader can resolve indexes as it goes;
+    // the views point into events, which outlive this call
+    std::unordered_map<DWORD, uint32_t> processIndexes;
+    std::vector<DWORD> processIds;
+    std::unordered_map<std::string_view, uint32_t> ids[FIELD_COUNT];
+    std::vector<std::string_view> strings[FIELD_COUNT];
+    std::vector<uint32_t> rowIds(count * (FIELD_COUNT + 1));
+    chunk.m_first = events[0].timestamp;
+    chunk.m_last = events[0].timestamp;
+    for (size_t i = 0; i < count; ++i) {
+        const AudioEvent& event = events[i];
+        auto process = processIndexes.try_emplace(event.processId, static_cast<uint32_t>(processIds.size()));
+        if (process.second) {
+            processIds.push_back(event.processId);
+        }
+        rowIds[i * (FIELD_COUNT + 1)] = process.first->second;
+        for (size_t field = 0; field < FIELD_COUNT; ++field) {
+            std::string_view value(event.*STRING_FIELDS[field]);
+            auto inserted = ids[field].try_emplace(value, static_cast<uint32_t>(strings[field].size()));
+            if (inserted.second) {
+                strings[field].push_back(value);
+            }
+            rowIds[i * (FIELD_COUNT + 1) + 1 + field] = inserted.first->second;
+        }
+        chunk.m_first = (std::min)(chunk.m_first, event.timestamp);
+        chunk.m_last = (std::max)(chunk.m_last, event.timestamp);
+    }
+
+    // Built in a reused buffer, then copied out at its exact size
+    static thread_local std::vector<uint8_t> buffer;
+    buffer.clear();
+    Put<uint32_t>(buffer, static_cast<uint32_t>(count));
+    Put<int64_t>(buffer, Ticks(chunk.m_first));
+    Put<int64_t>(buffer, Ticks(chunk.m_last));
+    PutVarint(buffer, processIds.size());
+    for (DWORD processId : processIds) {
+        PutVarint(buffer, processId);
+    }
+    for (const auto& table : strings) {
+        PutVarint(buffer, table.size());
+        for (std::string_view value : table) {
+            PutVarint(buffer, value.size());
+            buffer.insert(buffer.end(), value.begin(), value.end());
+        }
+    }
+    // Deltas start from the earliest timestamp, so in-order chunks begin small
+    int64_t lastTicks = Ticks(chunk.m_first);
+    int64_t lastDelta = 0;
+    for (size_t i = 0; i < count; ++i) {
+        const AudioEvent& event = events[i];
+        int64_t ticks = Ticks(event.timestamp);
+        int64_t delta = ticks - lastTicks;
+        PutVarint(buffer, ZigZag(delta - lastDelta));
+        PutVarint(buffer, rowIds[i * (FIELD_COUNT + 1)]);
+        PutVarint(buffer, event.eventCount);
+        PutVarint(buffer, event.duration_ms);
+        Put<uint32_t>(buffer, PackLevels(event));
+        if (event.features.frames > 0) {
+            PutFeatures(buffer, event.features);
+        }
+        if (HasLoudness(event)) {
+            Put<float>(buffer, event.momentaryLoudness);
+            Put<float>(buffer, event.shortTermLoudness);
+        }
+        for (size_t field = 0; field < FIELD_COUNT; ++field) {
+            PutVarint(buffer, rowIds[i * (FIELD_COUNT + 1) + 1 + field]);
+        }
+        lastTicks = ticks;
+        lastDelta = delta;
+    }
+
+    chunk.m_data = std::make_shared<const std::vector<uint8_t>>(buffer.begin(), buffer.end());
+    chunk.m_count = static_cast<uint32_t>(count);
+    return chunk;
+}
+
+bool EventChunk::Load(std::vector<uint8_t> data) {
+    ChunkReader reader = { data.data(), data.size(), 0 };
+    uint32_t count = 0;
+    int64_t first = 0, last = 0;
+    if (!reader.Get(count) || !reader.Get(first) || !reader.Get(last)) {
+        return false;
+    }
+    m_data = std::make_shared<const std::vector<uint8_t>>(std::move(data));
+    m_count = count;
+    m_first = FromTicks(first);
+    m_last = FromTicks(last);
+    return true;
+}
+
+void EventChunk::Decode(const std::chrono::system_clock::time_point& startTime,
+                        const std::chrono::system_clock::time_point& endTime, std::vector<AudioEvent>& out) const {
+    if (m_count == 0 || m_last < startTime || m_first > endTime) {
+        return;
+    }
+    DecodeRows(*m_data, m_count, [&](uint32_t, const std::chrono::system_clock::time_point& timestamp) {
+        return timestamp >= startTime && timestamp <= endTime;
+    }, out);
+}
+
+void EventChunk::DecodeFrom(size_t index, std::vector<AudioEvent>& out) const {
+    if (index >= m_count) {
+        return;
+    }
+    DecodeRows(*m_data, m_count, [&](uint32_t i, const std::chrono::system_clock::time_point&) {
+        return i >= index;
+    }, out);
+}
+
+void EventChunk::DecodeColumns(EventColumns& columns) const {
+    columns.Clear();
+    if (m_count == 0 || m_data->size() < HEADER_SIZE) {
+        return;
+    }
+    columns.Resize(m_count);
+    columns.firstTicks = Ticks(m_first);
+    columns.lastTicks = Ticks(m_last);
+    ChunkReader reader = { m_data->data(), m_data->size(), HEADER_SIZE };
+    int64_t ticks = columns.firstTicks;
+
+    uint64_t size = 0;
+    bool valid = reader.GetVarint(size) && size <= reader.size - reader.pos;
+    for (uint64_t i = 0; i < size && valid; ++i) {
+        uint64_t processId = 0;
+        valid = reader.GetVarint(processId);
+        columns.pids.push_back(static_cast<DWORD>(processId));
+    }
+    size_t dictionarySizes[FIELD_COUNT] = {};
+    for (size_t field = 0; field < FIELD_COUNT && valid; ++field) {
+        const size_t* column = std::find(std::begin(COLUMN_FIELDS), std::end(COLUMN_FIELDS), field);
+        valid = reader.GetVarint(size) && size <= reader.size - reader.pos;
+        dictionarySizes[field] = static_cast<size_t>(size);
+        for (uint64_t i = 0; i < size && valid; ++i) {
+            uint64_t length = 0;
+            valid = reader.GetVarint(length) && length <= reader.size - reader.pos;
+            if (valid && column != std::end(COLUMN_FIELDS)) {
+                columns.dictionaries[column - std::begin(COLUMN_FIELDS)].emplace_back(
+                    reinterpret_cast<const char*>(reader.data + reader.pos), static_cast<size_t>(length));
+            }
+            reader.pos += valid ? static_cast<size_t>(length) : 0;
+        }
+    }
+
+    // Rows are varint coded one after another, so this walk is row by row;
+    // everything after it runs on the columns
+    float* eventCounts = columns.Get(EventColumns::Value::Events).data();
+    float* durations = columns.Get(EventColumns::Value::Duration).data();
+    float* volumes = columns.Get(EventColumns::Value::Volume).data();
+    float* peaks = columns.Get(EventColumns::Value::Peak).data();
+    float* momentaries = columns.Get(EventColumns::Value::Momentary).data();
+    float* shortTerms = columns.Get(EventColumns::Value::ShortTerm).data();
+    int64_t delta = 0;
+    uint32_t row = 0;
+    for (; row < m_count && valid; ++row) {
+        uint64_t deltaOfDelta = 0, processIndex = 0, eventCount = 0, duration = 0;
+        uint32_t levels = 0;
+        float momentary = LOUDNESS_FLOOR_LUFS, shortTerm = LOUDNESS_FLOOR_LUFS;
+        valid = reader.GetVarint(deltaOfDelta) && reader.GetVarint(processIndex) &&
+                processIndex < columns.pids.size() && reader.GetVarint(eventCount) && reader.GetVarint(duration) &&
+                reader.Get(levels);
+        if (valid && (levels & FEATURES_BIT)) {
+            uint64_t frames = 0;
+            valid = reader.GetVarint(frames) && reader.size - reader.pos >= FEATURE_FLOATS * sizeof(float);
+            reader.pos += valid ? FEATURE_FLOATS * sizeof(float) : 0;
+        }
+        if (valid && (levels & LOUDNESS_BIT)) {
+            valid = reader.Get(momentary) && reader.Get(shortTerm);
+        }
+        for (size_t field = 0, column = 0; field < FIELD_COUNT && valid; ++field) {
+            uint64_t id = 0;
+            valid = reader.GetVarint(id) && id < dictionarySizes[field];
+            if (valid && column < EventColumns::TEXT_COUNT && COLUMN_FIELDS[column] == field) {
+                columns.codes[column++][row] = static_cast<uint32_t>(id);
+            }
+        }
+        if (!valid) {
+            break;
+        }
+        delta += UnZigZag(deltaOfDelta);
+        ticks += delta;
+        columns.ticks[row] = ticks;
+        columns.pidCodes[row] = static_cast<uint32_t>(processIndex);
+        eventCounts[row] = static_cast<float>(eventCount);
+        durations[row] = static_cast<float>(duration);
+        volumes[row] = static_cast<float>(levels & LEVEL_MASK) / LEVEL_STEPS;
+        peaks[row] = static_cast<float>((levels >> LEVEL_BITS) & LEVEL_MASK) / LEVEL_STEPS;
+        momentaries[row] = momentary;
+        shortTerms[row] = shortTerm;
+        columns.systemSound[row] = (levels & SYSTEM_SOUND_BIT) != 0 ? 1 : 0;
+    }
+    if (row < m_count) {
+        columns.Resize(row);
+    }
+}
@@ -0,0 +1,79 @@
+#include "../include/EventColumns.h"
+#include <algorithm>
+
+namespace {
+
+std::string AudioEvent::* const TEXT_FIELDS[EventColumns::TEXT_COUNT] = {
+    &AudioEvent::processName,
+    &AudioEvent::soundLabel,
+    &AudioEvent::endpointId
+};
+
+}  // namespace
+
+void EventColumns::Clear() {
+    count = 0;
+    firstTicks = 0;
+    lastTicks = 0;
+    pids.clear();
+    for (auto& dictionary : dictionaries) {
+        dictionary.clear();
+    }
+}
+
+void EventColumns::Resize(size_t rows) {
+    count = rows;
+    ticks.resize(rows);
+    for (auto& column : values) {
+        column.resize(rows);
+    }
+    systemSound.resize(rows);
+    pidCodes.resize(rows);
+    for (auto& column : codes) {
+        column.resize(rows);
+    }
+}
+
+void EventColumns::FromRows(const AudioEvent* events, size_t rows) {
+    Clear();
+    Resize(rows);
+    if (rows == 0) {
+        return;
+    }
+    firstTicks = events[0].timestamp.time_since_epoch().count();
+    lastTicks = firstTicks;
+    for (size_t i = 0; i < rows; ++i) {
+        const AudioEvent& event = events[i];
+        int64_t time = event.timestamp.time_since_epoch().count();
+        ticks[i] = time;
+        firstTicks = (std::min)(firstTicks, time);
+        lastTicks = (std::max)(lastTicks, time);
+        values[static_cast<size_t>(Value::Events)][i] = static_cast<float>(event.eventCount);
+        values[static_cast<size_t>(Value::Duration)][i] = static_cast<float>(event.duration_ms);
+        values[static_cast<size_t>(Value::Volume)][i] = event.volumeLevel;
+        values[static_cast<size_t>(Value::Peak)][i] = event.peakLevel;
+        values[static_cast<size_t>(Value::Momentary)][i] = event.momentaryLoudness;
+        values[static_cast<size_t>(Value::ShortTerm)][i] = event.shortTermLoudness;
+        systemSound[i] = event.isSystemSound ? 1 : 0;
+    }
+
+    m_pidLookup.clear();
+    for (size_t i = 0; i < rows; ++i) {
+        auto inserted = m_pidLookup.try_emplace(events[i].processId, static_cast<uint32_t>(pids.size()));
+        if (inserted.second) {
+            pids.push_back(events[i].processId);
+        }
+        pidCodes[i] = inserted.first->second;
+    }
+    for (size_t text = 0; text < TEXT_COUNT; ++text) {
+        m_lookup.clear();
+        for (size_t i = 0; i < rows; ++i) {
+            std::string_view value(events[i].*TEXT_FIELDS[text]);
+            auto inserted = m_lookup.try_emplace(value, static_cast<uint32_t>(dictionaries[text].size()));
+            if (inserted.second) {
+                dictionaries[text].push_back(value);
+            }
+            codes[text][i] = inserted.first->second;
+        }
+    }
+}
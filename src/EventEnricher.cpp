@@ -0,0 +1,141 @@
+#include "../include/EventEnricher.h"
+#include "../include/Metrics.h"
+#include "../include/SpanTracer.h"
+#include <unordered_map>
+
+std::string EventEnricher::GetSoundDescription(DWORD processId, const std::string& processName) {
+    std::string description;
+    AppendSoundDescription(processId, processName, description);
+    return description;
+}
+
+void EventEnricher::AppendSoundDescription(DWORD processId, const std::string& processName, std::string& out) {
+    // System sounds - including USB device sounds
+    if (processId == 0) {
+        out += "Windows System Sound (USB/Device Connect)";
+        return;
+    }
+    if (processId == 4) {
+        out += "Windows Kernel System Sound";
+        return;
+    }
+    
+    // Common applications and system processes; built once, looked up per event
+    static const std::unordered_map<std::string, const char*> knownApps = {
+        {"chrome.exe", "Google Chrome Browser"},
+        {"firefox.exe", "Mozilla Firefox Browser"},
+        {"msedge.exe", "Microsoft Edge Browser"},
+        {"Discord.exe", "Discord Voice/Message"},
+        {"Teams.exe", "Microsoft Teams"},
+        {"Spotify.exe", "Spotify Music"},
+        {"slack.exe", "Slack Notification"},
+        {"outlook.exe", "Outlook Email Notification"},
+        {"explorer.exe", "Windows Explorer/System Sound"},
+        {"svchost.exe", "Windows Service/System Sound"},
+        {"audiodg.exe", "Windows Audio Device Graph"},
+        {"RuntimeBroker.exe", "Windows Runtime Broker"},
+        {"SearchApp.exe", "Windows Search"},
+        {"ShellExperienceHost.exe", "Windows Shell Experience"},
+        {"SystemSettings.exe", "Windows Settings"},
+        {"UserNotificationBroker.exe", "Windows Notifications"},
+        {"csrss.exe", "Windows Client/Server Runtime"},
+        {"dwm.exe", "Desktop Window Manager"},
+        {"winlogon.exe", "Windows Logon Process"},
+        {"services.exe", "Windows Services Controller"},
+        {"lsass.exe", "Local Security Authority"},
+        {"System", "Windows System Process"},
+        {"TextInputHost.exe", "Windows Text Input (Keyboard)"},
+        {"ctfmon.exe", "CTF Loader (Keyboard/Language)"},
+        {"TabTip.exe", "Touch Keyboard and Handwriting"},
+        {"osk.exe", "On-Screen Keyboard"},
+        {"SynTPEnh.exe", "Synaptics TouchPad"},
+        {"ETDCtrl.exe", "ELAN TouchPad"},
+        {"", "Unknown System Process (Possible USB/Keyboard Event)"},
+    };
+    
+    // Special handling for empty process name (system sounds)
+    if (processName.empty() || processName == "Unknown") {
+        out += "System Sound (Check USB/Keyboard/Input Devices)";
+        return;
+    }
+    
+    // Check for keyboard-related processes
+    if (processName.find("TabTip") != std::string::npos ||
+        processName.find("TextInput") != std::string::npos ||
+        processName.find("ctfmon") != std::string::npos ||
+        processName.find("osk") != std::string::npos) {
+        out += processName;
+        out += " (Keyboard/Input Related)";
+        return;
+    }
+    
+    auto it = knownApps.find(processName);
+    if (it != knownApps.end()) {
+        out += it->second;
+        return;
+    }
+    
+    out += processName;
+    out += " Audio";
+}
+
+AudioEvent EventEnricher::Enrich(DWORD processId, float volume, float peak, const std::string& sessionName,
+                                 const std::chrono::system_clock::time_point& timestamp) const {
+    AudioEvent event;
+    Enrich(processId, volume, peak, sessionName, timestamp, event);
+    return event;
+}
+
+void EventEnricher::Enrich(DWORD processId, float volume, float peak, const std::string& sessionName,
+                           const std::chrono::system_clock::time_point& timestamp, AudioEvent& event) const {
+    TRACE_SPAN_ARG("Enrich", "pid", processId);
+    event.timestamp = timestamp;
+    event.processId = processId;
+    METRICS_TIMER_START(nameStart);
+    m_provider.GetProcessNameFromPID(processId, event.processName);
+    METRICS_TIMER_RECORD(EnrichProcessName, nameStart);
+    METRICS_TIMER_START(pathStart);
+    m_provider.GetProcessPathFromPID(processId, event.processPath);
+    METRICS_TIMER_RECORD(EnrichProcessPath, pathStart);
+    METRICS_TIMER_START(descriptionStart);
+    event.soundDescription.clear();
+    AppendSoundDescription(processId, event.processName, event.soundDescription);
+    METRICS_TIMER_RECORD(EnrichDescription, descriptionStart);
+    
+    // Get USB device info if applicable
+    METRICS_TIMER_START(usbStart);
+    m_provider.GetUSBDeviceInfo(processId, event.processName, event.usbDeviceInfo);
+    METRICS_TIMER_RECORD(EnrichUsb, usbStart);
+    
+    // Get browser tab info if applicable
+    METRICS_TIMER_START(tabStart);
+    m_provider.GetBrowserTabInfo(processId, event.processName, event.browserTabInfo);
+    METRICS_TIMER_RECORD(EnrichBrowserTab, tabStart);
+    
+    // Add session name to description if available; appended piecewise so
+    // no temporary strings are built
+    event.sessionDisplayName.assign(sessionName);
+    if (!sessionName.empty()) {
+        event.soundDescription += " [";
+        event.soundDescription += sessionName;
+        event.soundDescription += "]";
+    }
+    
+    // Add USB info to description if available
+    if (!event.usbDeviceInfo.empty()) {
+        event.soundDescription += " - ";
+        event.soundDescription += event.usbDeviceInfo;
+    }
+    
+    // Add browser tab info to description if available
+    if (!event.browserTabInfo.empty()) {
+        event.soundDescription += " - ";
+        event.soundDescription += event.browserTabInfo;
+    }
+    
+    event.volumeLevel = volume;
+    event.peakLevel = peak;
+    event.isSystemSound = (processId == 0 || processId == 4 || event.processName == "svchost.exe");
+    event.duration_ms = 0;  // Will be calculated based on continuous events
+    event.eventCount = 1;  // Default count
+}
@@ -0,0 +1,531 @@
+#include "../include/EventQuery.h"
+#include "../include/EventStore.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <thread>
+#include <unordered_map>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define QUERY_USE_SSE2
+#include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define QUERY_USE_NEON
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+// Past this many groups per row a batch's dense table is compacted first
+const size_t SPARSE_GROUPS_PER_ROW = 4;
+
+char ToLowerAscii(char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+bool EqualsFolded(std::string_view text, const std::string& folded) {
+    return text.size() == folded.size() &&
+           std::equal(text.begin(), text.end(), folded.begin(), [](char a, char b) { return ToLowerAscii(a) == b; });
+}
+
+int64_t FloorDivide(int64_t value, int64_t divisor) {
+    int64_t quotient = value / divisor;
+    return (value % divisor != 0 && (value < 0) != (divisor < 0)) ? quotient - 1 : quotient;
+}
+
+// selection[i] &= low <= ticks[i] <= high
+void AndTimeRange(const int64_t* ticks, size_t count, int64_t low, int64_t high, uint8_t* selection) {
+    for (size_t i = 0; i < count; ++i) {
+        selection[i] &= static_cast<uint8_t>((ticks[i] >= low) & (ticks[i] <= high));
+    }
+}
+
+// selection[i] &= low <= values[i] <= high, sixteen rows a step
+void AndValueRange(const float* values, size_t count, float low, float high, uint8_t* selection) {
+    size_t i = 0;
+#if defined(QUERY_USE_SSE2)
+    const __m128 lows = _mm_set1_ps(low), highs = _mm_set1_ps(high);
+    for (; i + 16 <= count; i += 16) {
+        __m128i in[4];
+        for (int lane = 0; lane < 4; ++lane) {
+            __m128 x = _mm_loadu_ps(values + i + lane * 4);
+            in[lane] = _mm_castps_si128(_mm_and_ps(_mm_cmpge_ps(x, lows), _mm_cmple_ps(x, highs)));
+        }
+        __m128i mask = _mm_packs_epi16(_mm_packs_epi32(in[0], in[1]), _mm_packs_epi32(in[2], in[3]));
+        __m128i selected = _mm_loadu_si128(reinterpret_cast<const __m128i*>(selection + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(selection + i), _mm_and_si128(selected, mask));
+    }
+#elif defined(QUERY_USE_NEON)
+    const float32x4_t lows = vdupq_n_f32(low), highs = vdupq_n_f32(high);
+    for (; i + 16 <= count; i += 16) {
+        uint16x8_t halves[2];
+        for (int half = 0; half < 2; ++half) {
+            float32x4_t a = vld1q_f32(values + i + half * 8), b = vld1q_f32(values + i + half * 8 + 4);
+            uint32x4_t inA = vandq_u32(vcgeq_f32(a, lows), vcleq_f32(a, highs));
+            uint32x4_t inB = vandq_u32(vcgeq_f32(b, lows), vcleq_f32(b, highs));
+            halves[half] = vcombine_u16(vmovn_u32(inA), vmovn_u32(inB));
+        }
+        uint8x16_t mask = vcombine_u8(vmovn_u16(halves[0]), vmovn_u16(halves[1]));
+        vst1q_u8(selection + i, vandq_u8(vld1q_u8(selection + i), mask));
+    }
+#endif
+    for (; i < count; ++i) {
+        selection[i] &= static_cast<uint8_t>((values[i] >= low) & (values[i] <= high));
+    }
+}
+
+// selection[i] &= !flags[i], for 0/1 bytes
+void AndNot(const uint8_t* flags, size_t count, uint8_t* selection) {
+    size_t i = 0;
+#if defined(QUERY_USE_SSE2)
+    for (; i + 16 <= count; i += 16) {
+        __m128i set = _mm_loadu_si128(reinterpret_cast<const __m128i*>(flags + i));
+        __m128i selected = _mm_loadu_si128(reinterpret_cast<const __m128i*>(selection + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(selection + i), _mm_andnot_si128(set, selected));
+    }
+#elif defined(QUERY_USE_NEON)
+    for (; i + 16 <= count; i += 16) {
+        vst1q_u8(selection + i, vbicq_u8(vld1q_u8(selection + i), vld1q_u8(flags + i)));
+    }
+#endif
+    for (; i < count; ++i) {
+        selection[i] &= static_cast<uint8_t>(flags[i] ^ 1);
+    }
+}
+
+// selection[i] &= allowed[codes[i]]
+void AndCodeIn(const uint32_t* codes, size_t count, const uint8_t* allowed, uint8_t* selection) {
+    for (size_t i = 0; i < count; ++i) {
+        selection[i] &= allowed[codes[i]];
+    }
+}
+
+struct Accumulator {
+    uint64_t count = 0;
+    std::vector<double> sums;   // Per value column the query reads
+    std::vector<float> minima;
+    std::vector<float> maxima;
+    std::vector<std::vector<float>> samples;  // Per quantile column
+
+    void Merge(const Accumulator& other) {
+        count += other.count;
+        for (size_t c = 0; c < sums.size(); ++c) {
+            sums[c] += other.sums[c];
+            minima[c] = (std::min)(minima[c], other.minima[c]);
+            maxima[c] = (std::max)(maxima[c], other.maxima[c]);
+        }
+        for (size_t q = 0; q < samples.size(); ++q) {
+            samples[q].insert(samples[q].end(), other.samples[q].begin(), other.samples[q].end());
+        }
+    }
+};
+
+struct Partial {
+    int64_t bucket;
+    std::string group;
+    double order;  // Sorts pids, levels and flags as numbers
+    Accumulator values;
+};
+
+// One thread's share of a run
+struct Worker {
+    std::unordered_map<std::string, size_t> index;  // Bucket bytes and group -> partials
+    std::vector<Partial> partials;
+    uint64_t scanned = 0;
+    uint64_t matched = 0;
+    uint64_t skipped = 0;
+
+    // Scratch reused from batch to batch
+    EventColumns columns;
+    std::vector<uint8_t> selection;
+    std::vector<uint8_t> allowed;
+    std::vector<uint32_t> dims;
+    std::vector<uint32_t> groups;
+    std::vector<uint32_t> counts;
+    std::vector<double> sums;
+    std::vector<float> minima;
+    std::vector<float> maxima;
+    std::vector<uint64_t> denseIds;   // Compact id -> dense id
+    std::unordered_map<uint64_t, uint32_t> compact;
+    std::vector<size_t> targets;  // Batch group -> partials
+    std::string key;
+};
+
+}  // namespace
+
+EventQueryExecutor::EventQueryExecutor(const EventQuery& query) : m_query(query) {
+}
+
+void EventQueryExecutor::AddChunk(const EventChunk& chunk) {
+    m_sources.push_back({ &chunk, nullptr, chunk.GetCount() });
+}
+
+void EventQueryExecutor::AddRows(const AudioEvent* events, size_t count) {
+    const size_t slice = EventStore::CHUNK_EVENTS;
+    for (size_t at = 0; at < count; at += slice) {
+        m_sources.push_back({ nullptr, events + at, (std::min)(count - at, slice) });
+    }
+}
+
+QueryResult EventQueryExecutor::Run() const {
+    const EventQuery& query = m_query;
+    typedef std::chrono::system_clock::time_point TimePoint;
+    const int64_t startTicks = query.start == (TimePoint::min)() ? INT64_MIN : query.start.time_since_epoch().count();
+    const int64_t endTicks = query.end == (TimePoint::max)() ? INT64_MAX : query.end.time_since_epoch().count();
+    const int64_t bucketTicks = std::chrono::duration_cast<std::chrono::system_clock::duration>(query.bucket).count();
+    const float binWidth = query.binWidth > 0.0f ? query.binWidth : 0.1f;
+    const uint32_t levelBins = static_cast<uint32_t>(std::floor(1.0f / binWidth + 1e-4f)) + 1;
+    std::vector<std::string> processes;
+    for (const std::string& process : query.processes) {
+        processes.emplace_back(process);
+        std::transform(processes.back().begin(), processes.back().end(), processes.back().begin(), ToLowerAscii);
+    }
+
+    // Each value column the measures read is swept once per batch
+    std::vector<size_t> columns;
+    std::vector<size_t> quantileColumns;
+    std::vector<size_t> slots(query.measures.size());
+    for (size_t m = 0; m < query.measures.size(); ++m) {
+        size_t column = static_cast<size_t>(query.measures[m].column);
+        std::vector<size_t>& list = query.measures[m].aggregate == QueryAggregate::Quantile ? quantileColumns : columns;
+        if (query.measures[m].aggregate == QueryAggregate::Count) {
+            continue;
+        }
+        auto it = std::find(list.begin(), list.end(), column);
+        slots[m] = static_cast<size_t>(it - list.begin());
+        if (it == list.end()) {
+            list.push_back(column);
+        }
+    }
+    auto newAccumulator = [&]() {
+        Accumulator accumulator;
+        accumulator.sums.assign(columns.size(), 0.0);
+        accumulator.minima.assign(columns.size(), (std::numeric_limits<float>::max)());
+        accumulator.maxima.assign(columns.size(), std::numeric_limits<float>::lowest());
+        accumulator.samples.resize(quantileColumns.size());
+        return accumulator;
+    };
+
+    auto runBatch = [&](Worker& worker, const Source& source) {
+        EventColumns& batch = worker.columns;
+        if (source.chunk) {
+            int64_t first = source.chunk->GetFirstTime().time_since_epoch().count();
+            int64_t last = source.chunk->GetLastTime().time_since_epoch().count();
+            if (last < startTicks || first > endTicks) {
+                ++worker.skipped;
+                return;
+            }
+            source.chunk->DecodeColumns(batch);
+        } else {
+            batch.FromRows(source.rows, source.count);
+        }
+        worker.scanned += batch.count;
+        size_t count = batch.count;
+        if (count == 0) {
+            return;
+        }
+
+        // Filters, each a pass over one column into the selection
+        std::vector<uint8_t>& selection = worker.selection;
+        selection.assign(count, 1);
+        if (batch.firstTicks < startTicks || batch.lastTicks > endTicks) {
+            AndTimeRange(batch.ticks.data(), count, startTicks, endTicks, selection.data());
+        }
+        if (!processes.empty()) {
+            const auto& names = batch.dictionaries[static_cast<size_t>(EventColumns::Text::Process)];
+            worker.allowed.assign(names.size(), 0);
+            bool any = false;
+            for (size_t code = 0; code < names.size(); ++code) {
+                for (const std::string& process : processes) {
+                    if (EqualsFolded(names[code], process)) {
+                        worker.allowed[code] = 1;
+                        any = true;
+                    }
+                }
+            }
+            if (!any) {
+                return;
+            }
+            AndCodeIn(batch.codes[static_cast<size_t>(EventColumns::Text::Process)].data(), count,
+                      worker.allowed.data(), selection.data());
+        }
+        if (query.minPeak > 0.0f || query.maxPeak < 1.0f) {
+            AndValueRange(batch.Get(EventColumns::Value::Peak).data(), count, query.minPeak, query.maxPeak,
+                          selection.data());
+        }
+        if (query.excludeSystemSounds) {
+            AndNot(batch.systemSound.data(), count, selection.data());
+        }
+
+        // Group ids: the row's bucket within the batch times the groups in
+        // the dimension, plus its group
+        size_t dimCount = 1;
+        const uint32_t* dims = nullptr;
+        std::vector<uint32_t>& dimScratch = worker.dims;
+        switch (query.group) {
+            case QueryGroup::None:
+                break;
+            case QueryGroup::Process:
+            case QueryGroup::Sound:
+            case QueryGroup::Endpoint: {
+                size_t text = static_cast<size_t>(query.group == QueryGroup::Process ? EventColumns::Text::Process :
+                                                  query.group == QueryGroup::Sound ? EventColumns::Text::Sound :
+                                                  EventColumns::Text::Endpoint);
+                dimCount = (std::max)(batch.dictionaries[text].size(), size_t(1));
+                dims = batch.codes[text].data();
+                break;
+            }
+            case QueryGroup::Pid:
+                dimCount = (std::max)(batch.pids.size(), size_t(1));
+                dims = batch.pidCodes.data();
+                break;
+            case QueryGroup::SystemSound:
+                dimCount = 2;
+                dimScratch.assign(batch.systemSound.begin(), batch.systemSound.begin() + static_cast<ptrdiff_t>(count));
+                dims = dimScratch.data();
+                break;
+            default: {
+                // Levels are stored to 1/10000; the nudge keeps 0.15 out of the 0.10 bin
+                const float* values = batch.Get(query.group == QueryGroup::PeakLevel ? EventColumns::Value::Peak :
+                                                EventColumns::Value::Volume).data();
+                const float inverse = 1.0f / binWidth;
+                dimScratch.resize(count);
+                for (size_t i = 0; i < count; ++i) {
+                    float bin = (std::max)(values[i], 0.0f) * inverse + 1e-4f;
+                    dimScratch[i] = (std::min)(static_cast<uint32_t>(bin), levelBins - 1);
+                }
+                dimCount = levelBins;
+                dims = dimScratch.data();
+                break;
+            }
+        }
+        int64_t firstBucket = bucketTicks > 0 ? FloorDivide(batch.firstTicks, bucketTicks) : 0;
+        size_t bucketCount = bucketTicks > 0
+                                 ? static_cast<size_t>(FloorDivide(batch.lastTicks, bucketTicks) - firstBucket + 1) : 1;
+        std::vector<uint32_t>& groups = worker.groups;
+        groups.resize(count);
+
+        // Sparse batches (fine buckets over a long span) get compact ids
+        // so the dense table stays the size of the batch. Their dense ids
+        // can pass 2^32, so they are formed in 64 bits and only the
+        // compact id is narrowed
+        uint64_t spanGroups = static_cast<uint64_t>(bucketCount) * dimCount;
+        bool compacted = spanGroups > static_cast<uint64_t>(count) * SPARSE_GROUPS_PER_ROW;
+        size_t groupCount = static_cast<size_t>(spanGroups);
+        if (compacted) {
+            worker.compact.clear();
+            worker.denseIds.clear();
+            for (size_t i = 0; i < count; ++i) {
+                uint64_t bucket = bucketTicks > 0 ? static_cast<uint64_t>(FloorDivide(batch.ticks[i], bucketTicks) -
+                                                                          firstBucket) : 0;
+                uint64_t dense = bucket * dimCount + (dims ? dims[i] : 0);
+                auto inserted = worker.compact.try_emplace(dense, static_cast<uint32_t>(worker.denseIds.size()));
+                if (inserted.second) {
+                    worker.denseIds.push_back(dense);
+                }
+                groups[i] = inserted.first->second;
+            }
+            groupCount = worker.denseIds.size();
+        } else {
+            // At most SPARSE_GROUPS_PER_ROW per row, so these fit
+            if (bucketTicks > 0) {
+                for (size_t i = 0; i < count; ++i) {
+                    groups[i] = static_cast<uint32_t>(FloorDivide(batch.ticks[i], bucketTicks) - firstBucket);
+                }
+            } else {
+                std::fill(groups.begin(), groups.end(), 0u);
+            }
+            if (dims) {
+                const uint32_t width = static_cast<uint32_t>(dimCount);
+                for (size_t i = 0; i < count; ++i) {
+                    groups[i] = groups[i] * width + dims[i];
+                }
+            }
+        }
+
+        // Aggregates, a column at a time into the batch's dense table
+        std::vector<uint32_t>& counts = worker.counts;
+        counts.assign(groupCount, 0);
+        const uint8_t* selected = selection.data();
+        for (size_t i = 0; i < count; ++i) {
+            counts[groups[i]] += selected[i];
+        }
+        size_t columnCount = columns.size();
+        worker.sums.assign(groupCount * columnCount, 0.0);
+        worker.minima.assign(groupCount * columnCount, (std::numeric_limits<float>::max)());
+        worker.maxima.assign(groupCount * columnCount, std::numeric_limits<float>::lowest());
+        for (size_t c = 0; c < columnCount; ++c) {
+            const float* values = batch.values[columns[c]].data();
+            double* sums = worker.sums.data() + c * groupCount;
+            float* minima = worker.minima.data() + c * groupCount;
+            float* maxima = worker.maxima.data() + c * groupCount;
+            if (groupCount == 1) {
+                // Branch-free reductions, which compilers vectorize
+                double sum = 0.0;
+                float low = minima[0], high = maxima[0];
+                for (size_t i = 0; i < count; ++i) {
+                    float value = selected[i] ? values[i] : 0.0f;
+                    sum += value;
+                    low = (std::min)(low, selected[i] ? values[i] : low);
+                    high = (std::max)(high, selected[i] ? values[i] : high);
+                }
+                sums[0] = sum;
+                minima[0] = low;
+                maxima[0] = high;
+                continue;
+            }
+            for (size_t i = 0; i < count; ++i) {
+                if (selected[i]) {
+                    uint32_t group = groups[i];
+                    sums[group] += values[i];
+                    minima[group] = (std::min)(minima[group], values[i]);
+                    maxima[group] = (std::max)(maxima[group], values[i]);
+                }
+            }
+        }
+
+        // Fold the batch's groups into the thread's results
+        worker.targets.assign(groupCount, 0);
+        for (size_t g = 0; g < groupCount; ++g) {
+            if (counts[g] == 0) {
+                continue;
+            }
+            uint64_t dense = compacted ? worker.denseIds[g] : g;
+            int64_t bucket = firstBucket + static_cast<int64_t>(dense / dimCount);
+            size_t dim = static_cast<size_t>(dense % dimCount);
+            worker.key.assign(reinterpret_cast<const char*>(&bucket), sizeof(bucket));
+            double order = 0.0;
+            switch (query.group) {
+                case QueryGroup::None:
+                    break;
+                case QueryGroup::Process:
+                case QueryGroup::Sound:
+                case QueryGroup::Endpoint: {
+                    size_t text = static_cast<size_t>(query.group == QueryGroup::Process ? EventColumns::Text::Process :
+                                                      query.group == QueryGroup::Sound ? EventColumns::Text::Sound :
+                                                      EventColumns::Text::Endpoint);
+                    worker.key.append(batch.dictionaries[text][dim]);
+                    break;
+                }
+                case QueryGroup::Pid:
+                    order = batch.pids[dim];
+                    worker.key += std::to_string(batch.pids[dim]);
+                    break;
+                case QueryGroup::SystemSound:
+                    order = static_cast<double>(dim);
+                    worker.key += dim ? "yes" : "no";
+                    break;
+                default: {
+                    order = static_cast<double>(dim);
+                    char bin[16];
+                    std::snprintf(bin, sizeof(bin), "%.4f", static_cast<double>(dim) * binWidth);
+                    worker.key += bin;
+                    break;
+                }
+            }
+            auto inserted = worker.index.try_emplace(worker.key, worker.partials.size());
+            if (inserted.second) {
+                worker.partials.push_back({ bucket, worker.key.substr(sizeof(bucket)), order, newAccumulator() });
+            }
+            Accumulator& target = worker.partials[inserted.first->second].values;
+            target.count += counts[g];
+            for (size_t c = 0; c < columnCount; ++c) {
+                target.sums[c] += worker.sums[c * groupCount + g];
+                target.minima[c] = (std::min)(target.minima[c], worker.minima[c * groupCount + g]);
+                target.maxima[c] = (std::max)(target.maxima[c], worker.maxima[c * groupCount + g]);
+            }
+            worker.matched += counts[g];
+            worker.targets[g] = inserted.first->second;
+        }
+        for (size_t q = 0; q < quantileColumns.size(); ++q) {
+            const float* values = batch.values[quantileColumns[q]].data();
+            for (size_t i = 0; i < count; ++i) {
+                if (selected[i]) {
+                    worker.partials[worker.targets[groups[i]]].values.samples[q].push_back(values[i]);
+                }
+            }
+        }
+    };
+
+    // Sources are handed out one at a time, so a slow one only holds its thread
+    size_t threadCount = query.threads ? query.threads : (std::max)(std::thread::hardware_concurrency(), 1u);
+    threadCount = (std::max)((std::min)(threadCount, m_sources.size()), size_t(1));
+    std::vector<Worker> workers(threadCount);
+    std::atomic<size_t> next{ 0 };
+    auto work = [&](Worker& worker) {
+        for (size_t i = next++; i < m_sources.size(); i = next++) {
+            runBatch(worker, m_sources[i]);
+        }
+    };
+    std::vector<std::thread> threads;
+    for (size_t t = 1; t < threadCount; ++t) {
+        threads.emplace_back(work, std::ref(workers[t]));
+    }
+    work(workers[0]);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    Worker& merged = workers[0];
+    for (size_t t = 1; t < threadCount; ++t) {
+        for (Partial& partial : workers[t].partials) {
+            merged.key.assign(reinterpret_cast<const char*>(&partial.bucket), sizeof(partial.bucket));
+            merged.key += partial.group;
+            auto inserted = merged.index.try_emplace(merged.key, merged.partials.size());
+            if (inserted.second) {
+                merged.partials.push_back(std::move(partial));
+            } else {
+                merged.partials[inserted.first->second].values.Merge(partial.values);
+            }
+        }
+        merged.scanned += workers[t].scanned;
+        merged.matched += workers[t].matched;
+        merged.skipped += workers[t].skipped;
+    }
+
+    std::sort(merged.partials.begin(), merged.partials.end(), [](const Partial& a, const Partial& b) {
+        if (a.bucket != b.bucket) return a.bucket < b.bucket;
+        if (a.order != b.order) return a.order < b.order;
+        return a.group < b.group;
+    });
+    QueryResult result;
+    result.rowsScanned = merged.scanned;
+    result.rowsMatched = merged.matched;
+    result.chunksSkipped = merged.skipped;
+    result.rows.reserve(merged.partials.size());
+    for (Partial& partial : merged.partials) {
+        QueryRow row;
+        row.bucket = bucketTicks > 0
+                         ? TimePoint(std::chrono::system_clock::duration(partial.bucket * bucketTicks)) : (TimePoint::min)();
+        row.group = std::move(partial.group);
+        const Accumulator& values = partial.values;
+        for (size_t m = 0; m < query.measures.size(); ++m) {
+            const QueryMeasure& measure = query.measures[m];
+            size_t slot = slots[m];
+            double value = 0.0;
+            switch (measure.aggregate) {
+                case QueryAggregate::Count: value = static_cast<double>(values.count); break;
+                case QueryAggregate::Sum: value = values.sums[slot]; break;
+                case QueryAggregate::Min: value = values.minima[slot]; break;
+                case QueryAggregate::Max: value = values.maxima[slot]; break;
+                case QueryAggregate::Mean: value = values.sums[slot] / static_cast<double>(values.count); break;
+                case QueryAggregate::Quantile: {
+                    // Nearest rank
+                    std::vector<float>& samples = partial.values.samples[slot];
+                    double q = (std::min)((std::max)(measure.quantile, 0.0), 1.0);
+                    size_t rank = static_cast<size_t>(std::ceil(q * static_cast<double>(samples.size())));
+                    size_t at = rank > 0 ? rank - 1 : 0;
+                    std::nth_element(samples.begin(), samples.begin() + static_cast<ptrdiff_t>(at), samples.end());
+                    value = samples[at];
+                    break;
+                }
+            }
+            row.values.push_back(value);
+        }
+        result.rows.push_back(std::move(row));
+    }
+    return result;
+}
@@ -0,0 +1,573 @@
+#include "../include/EventRing.h"
+#include <filesystem>
+#include <cstring>
+#include <cstddef>
+#include <algorithm>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const char RING_MAGIC[8] = { 'S', 'T', 'R', 'I', 'N', 'G', '0', '1' };
+const uint32_t RING_VERSION = 2;  // 2: strings stored as UTF-8
+const uint64_t HEADER_SIZE = 64;
+
+const uint16_t RECORD_EVENT = 1;
+const uint16_t RECORD_PAD = 2;
+
+// The length is the last field so that a header-only pad record still ends
+// with its length; every record ends with one, which lets recovery walk
+// backwards from the write cursor and touch only the newest records.
+struct RecordHeader {
+    uint16_t type;
+    uint16_t reserved;
+    uint32_t payloadSize;
+    uint32_t checksum;     // CRC32 of type, payloadSize, length and the payload
+    uint32_t length;       // Whole record including header and trailing length
+};
+
+const uint64_t RECORD_ALIGN = 16;
+
+uint64_t AlignRecord(uint64_t value) {
+    return (value + RECORD_ALIGN - 1) & ~(RECORD_ALIGN - 1);
+}
+
+uint64_t RecordLength(size_t payloadSize) {
+    return AlignRecord(sizeof(RecordHeader) + payloadSize + sizeof(uint32_t));
+}
+
+// Slice-by-8 CRC32 (IEEE polynomial); recovery checksums each record it loads
+uint32_t Crc32(const uint8_t* data, size_t length, uint32_t crc = 0) {
+    static uint32_t table[8][256];
+    static bool initialized = [] {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+            }
+            table[0][i] = c;
+        }
+        for (uint32_t i = 0; i < 256; ++i) {
+            for (int t = 1; t < 8; ++t) {
+                table[t][i] = (table[t - 1][i] >> 8) ^ table[0][table[t - 1][i] & 0xFF];
+            }
+        }
+        return true;
+    }();
+    (void)initialized;
+
+    crc = ~crc;
+    while (length >= 8) {
+        uint32_t lo, hi;
+        std::memcpy(&lo, data, 4);
+        std::memcpy(&hi, data + 4, 4);
+        lo ^= crc;
+        crc = table[7][lo & 0xFF] ^ table[6][(lo >> 8) & 0xFF] ^
+              table[5][(lo >> 16) & 0xFF] ^ table[4][lo >> 24] ^
+              table[3][hi & 0xFF] ^ table[2][(hi >> 8) & 0xFF] ^
+              table[1][(hi >> 16) & 0xFF] ^ table[0][hi >> 24];
+        data += 8;
+        length -= 8;
+    }
+    while (length--) {
+        crc = table[0][(crc ^ *data++) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+uint32_t RecordChecksum(const RecordHeader& record, const uint8_t* payload) {
+    uint32_t crc = Crc32(reinterpret_cast<const uint8_t*>(&record), offsetof(RecordHeader, checksum));
+    crc = Crc32(reinterpret_cast<const uint8_t*>(&record.length), sizeof(record.length), crc);
+    return Crc32(payload, record.payloadSize, crc);
+}
+
+template <typename T>
+void Put(std::vector<uint8_t>& out, T value) {
+    size_t at = out.size();
+    out.resize(at + sizeof(T));
+    std::memcpy(&out[at], &value, sizeof(T));
+}
+
+void PutString(std::vector<uint8_t>& out, const std::string& value) {
+    Put<uint32_t>(out, static_cast<uint32_t>(value.size()));
+    size_t at = out.size();
+    out.resize(at + value.size());
+    if (!value.empty()) {
+        std::memcpy(&out[at], value.data(), value.size());
+    }
+}
+
+// Bounds-checked reader over a record payload
+struct PayloadReader {
+    const uint8_t* data;
+    size_t size;
+    size_t pos;
+
+    template <typename T>
+    bool Get(T& value) {
+        if (size - pos < sizeof(T)) return false;
+        std::memcpy(&value, data + pos, sizeof(T));
+        pos += sizeof(T);
+        return true;
+    }
+
+    bool GetString(std::string& value) {
+        uint32_t length = 0;
+        if (!Get(length) || size - pos < length) return false;
+        value.assign(reinterpret_cast<const char*>(data + pos), length);
+        pos += length;
+        return true;
+    }
+};
+
+// Features, the sound label, the loudness and then the endpoint id, when
+// present, trail the strings; older readers stop before them. Each needs the
+// ones before it, empty (frames = 0, "", LOUDNESS_FLOOR_LUFS) if need be.
+// withCapture = false leaves out what loopback capture measured, features
+// and loudness.
+void EncodeEvent(const AudioEvent& event, std::vector<uint8_t>& out, bool withCapture = true) {
+    out.clear();
+    Put<int64_t>(out, std::chrono::duration_cast<std::chrono::microseconds>(
+        event.timestamp.time_since_epoch()).count());
+    Put<uint32_t>(out, event.processId);
+    Put<uint32_t>(out, event.eventCount);
+    Put<uint32_t>(out, event.duration_ms);
+    Put<float>(out, event.volumeLevel);
+    Put<float>(out, event.peakLevel);
+    Put<uint8_t>(out, event.isSystemSound ? 1 : 0);
+    PutString(out, event.processName);
+    PutString(out, event.processPath);
+    PutString(out, event.soundDescription);
+    PutString(out, event.sessionDisplayName);
+    PutString(out, event.usbDeviceInfo);
+    PutString(out, event.browserTabInfo);
+    bool hasFeatures = withCapture && event.features.frames > 0;
+    bool hasLoudness = withCapture && HasLoudness(event);
+    bool hasEndpoint = !event.endpointId.empty();
+    if (hasFeatures || !event.soundLabel.empty() || hasLoudness || hasEndpoint) {
+        const SoundFeatures& features = hasFeatures ? event.features : SoundFeatures();
+        Put<uint32_t>(out, features.frames);
+        Put<float>(out, features.rms);
+        Put<float>(out, features.centroidHz);
+        Put<float>(out, features.flux);
+        Put<float>(out, features.zeroCrossingRate);
+        for (float value : features.mfcc) {
+            Put<float>(out, value);
+        }
+    }
+    if (!event.soundLabel.empty() || hasLoudness || hasEndpoint) {
+        PutString(out, event.soundLabel);
+    }
+    if (hasLoudness || hasEndpoint) {
+        Put<float>(out, hasLoudness ? event.momentaryLoudness : LOUDNESS_FLOOR_LUFS);
+        Put<float>(out, hasLoudness ? event.shortTermLoudness : LOUDNESS_FLOOR_LUFS);
+    }
+    if (hasEndpoint) {
+        PutString(out, event.endpointId);
+    }
+}
+
+bool DecodeEvent(const uint8_t* data, size_t size, AudioEvent& event) {
+    PayloadReader reader = { data, size, 0 };
+    int64_t micros = 0;
+    uint32_t processId = 0, eventCount = 0, duration = 0;
+    uint8_t isSystem = 0;
+
+    if (!reader.Get(micros) || !reader.Get(processId) || !reader.Get(eventCount) ||
+        !reader.Get(duration) || !reader.Get(event.volumeLevel) ||
+        !reader.Get(event.peakLevel) || !reader.Get(isSystem)) {
+        return false;
+    }
+    event.timestamp = std::chrono::system_clock::time_point(
+        std::chrono::duration_cast<std::chrono::system_clock::duration>(
+            std::chrono::microseconds(micros)));
+    event.processId = processId;
+    event.eventCount = eventCount;
+    event.duration_ms = duration;
+    event.isSystemSound = isSystem != 0;
+
+    if (!reader.GetString(event.processName) ||
+        !reader.GetString(event.processPath) ||
+        !reader.GetString(event.soundDescription) ||
+        !reader.GetString(event.sessionDisplayName) ||
+        !reader.GetString(event.usbDeviceInfo) ||
+        !reader.GetString(event.browserTabInfo)) {
+        return false;
+    }
+
+    SoundFeatures& features = event.features;
+    features = SoundFeatures();
+    if (reader.Get(features.frames)) {
+        bool complete = reader.Get(features.rms) && reader.Get(features.centroidHz) &&
+                        reader.Get(features.flux) && reader.Get(features.zeroCrossingRate);
+        for (float& value : features.mfcc) {
+            complete = complete && reader.Get(value);
+        }
+        if (!complete) {
+            features = SoundFeatures();
+        }
+    }
+    event.soundLabel.clear();
+    if (reader.pos < reader.size) {
+        reader.GetString(event.soundLabel);
+    }
+    event.momentaryLoudness = LOUDNESS_FLOOR_LUFS;
+    event.shortTermLoudness = LOUDNESS_FLOOR_LUFS;
+    float momentary = 0.0f, shortTerm = 0.0f;
+    if (reader.Get(momentary) && reader.Get(shortTerm)) {
+        event.momentaryLoudness = momentary;
+        event.shortTermLoudness = shortTerm;
+    }
+    event.endpointId.clear();
+    if (reader.pos < reader.size) {
+        reader.GetString(event.endpointId);
+    }
+    return true;
+}
+
+// Steps back from a record boundary to the start of the record ending
+// there, or returns UINT64_MAX if the chain is broken
+uint64_t PreviousRecord(const uint8_t* data, uint64_t capacity, uint64_t head,
+                        uint64_t end, RecordHeader& record) {
+    if (end <= head) {
+        return UINT64_MAX;
+    }
+
+    // Physical end of the record (1..capacity), then its trailing length
+    uint64_t physicalEnd = (end - 1) % capacity + 1;
+    uint32_t length = 0;
+    std::memcpy(&length, data + physicalEnd - sizeof(length), sizeof(length));
+    if (length < sizeof(RecordHeader) || length % RECORD_ALIGN != 0 ||
+        length > physicalEnd || length > end - head) {
+        return UINT64_MAX;
+    }
+
+    std::memcpy(&record, data + physicalEnd - length, sizeof(record));
+    if (record.length != length || (record.type != RECORD_EVENT && record.type != RECORD_PAD)) {
+        return UINT64_MAX;
+    }
+    return end - length;
+}
+
+} // namespace
+
+struct EventRing::Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved0;
+    uint64_t capacity;      // Bytes in the data area
+    uint64_t head;          // Logical position of the oldest record
+    uint64_t tail;          // Logical write cursor; positions never wrap
+    uint64_t recordCount;
+    uint64_t reserved[2];
+};
+
+static_assert(sizeof(RecordHeader) == RECORD_ALIGN, "Record header must fill one alignment unit");
+
+EventRing::EventRing()
+#ifdef _WIN32
+    : m_file(INVALID_HANDLE_VALUE), m_mapping(nullptr),
+#else
+    : m_file(-1),
+#endif
+      m_view(nullptr), m_mappedSize(0), m_header(nullptr), m_data(nullptr),
+      m_lastRecord(UINT64_MAX) {
+    static_assert(sizeof(Header) <= HEADER_SIZE, "Ring header too large");
+}
+
+EventRing::~EventRing() {
+    Close();
+}
+
+bool EventRing::Open(const std::wstring& path, uint64_t capacityBytes) {
+    Close();
+
+    uint64_t capacity = AlignRecord((std::max)(capacityBytes, static_cast<uint64_t>(64 * 1024)));
+    if (!Map(path, HEADER_SIZE + capacity)) {
+        return false;
+    }
+
+    m_header = reinterpret_cast<Header*>(m_view);
+    m_data = m_view + HEADER_SIZE;
+
+    bool compatible = std::memcmp(m_header->magic, RING_MAGIC, sizeof(RING_MAGIC)) == 0 &&
+                      m_header->version == RING_VERSION &&
+                      m_header->capacity == capacity &&
+                      m_header->head <= m_header->tail &&
+                      m_header->tail - m_header->head <= capacity &&
+                      m_header->tail % RECORD_ALIGN == 0;
+    if (!compatible) {
+        Reset(capacity);
+        return true;
+    }
+
+    // Find the newest event so batched updates can keep rewriting it
+    RecordHeader record;
+    uint64_t pos = m_header->tail;
+    while ((pos = PreviousRecord(m_data, m_header->capacity, m_header->head,
+                                 pos, record)) != UINT64_MAX) {
+        if (record.type == RECORD_EVENT) {
+            // A header-only event is corrupt; the next update appends instead
+            if (record.length >= RecordLength(0)) {
+                m_lastRecord = pos;
+            }
+            break;
+        }
+    }
+    return true;
+}
+
+void EventRing::Close() {
+    m_lastRecord = UINT64_MAX;
+    Unmap();
+}
+
+bool EventRing::Map(const std::wstring& path, uint64_t size) {
+#ifdef _WIN32
+    m_file = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ,
+                         NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (m_file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    // A file of the wrong size is shrunk/grown; the header check then resets it
+    LARGE_INTEGER fileSize = {};
+    GetFileSizeEx(m_file, &fileSize);
+    if (static_cast<uint64_t>(fileSize.QuadPart) != size) {
+        LARGE_INTEGER target;
+        target.QuadPart = static_cast<LONGLONG>(size);
+        SetFilePointerEx(m_file, target, NULL, FILE_BEGIN);
+        SetEndOfFile(m_file);
+    }
+
+    m_mapping = CreateFileMappingW(m_file, NULL, PAGE_READWRITE,
+                                   static_cast<DWORD>(size >> 32), static_cast<DWORD>(size), NULL);
+    if (!m_mapping) {
+        Unmap();
+        return false;
+    }
+
+    m_view = static_cast<uint8_t*>(MapViewOfFile(m_mapping, FILE_MAP_ALL_ACCESS, 0, 0, static_cast<SIZE_T>(size)));
+#else
+    m_file = open(std::filesystem::path(path).string().c_str(), O_RDWR | O_CREAT, 0644);
+    if (m_file < 0) {
+        return false;
+    }
+
+    struct stat st = {};
+    if (fstat(m_file, &st) != 0 ||
+        (static_cast<uint64_t>(st.st_size) != size && ftruncate(m_file, static_cast<off_t>(size)) != 0)) {
+        Unmap();
+        return false;
+    }
+
+    void* view = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, m_file, 0);
+    m_view = view == MAP_FAILED ? nullptr : static_cast<uint8_t*>(view);
+#endif
+    if (!m_view) {
+        Unmap();
+        return false;
+    }
+    m_mappedSize = size;
+    return true;
+}
+
+void EventRing::Unmap() {
+#ifdef _WIN32
+    if (m_view) {
+        FlushViewOfFile(m_view, 0);
+        UnmapViewOfFile(m_view);
+    }
+    if (m_mapping) {
+        CloseHandle(m_mapping);
+        m_mapping = nullptr;
+    }
+    if (m_file != INVALID_HANDLE_VALUE) {
+        CloseHandle(m_file);
+        m_file = INVALID_HANDLE_VALUE;
+    }
+#else
+    if (m_view) {
+        msync(m_view, m_mappedSize, MS_ASYNC);
+        munmap(m_view, m_mappedSize);
+    }
+    if (m_file >= 0) {
+        close(m_file);
+        m_file = -1;
+    }
+#endif
+    m_view = nullptr;
+    m_header = nullptr;
+    m_data = nullptr;
+    m_mappedSize = 0;
+}
+
+void EventRing::Reset(uint64_t capacity) {
+    std::memset(m_header, 0, HEADER_SIZE);
+    std::memcpy(m_header->magic, RING_MAGIC, sizeof(RING_MAGIC));
+    m_header->version = RING_VERSION;
+    m_header->capacity = capacity;
+    m_lastRecord = UINT64_MAX;
+}
+
+std::vector<AudioEvent> EventRing::Recover(size_t maxBytes) {
+    std::vector<AudioEvent> events;
+    size_t bytes = 0;
+    if (!IsOpen()) {
+        return events;
+    }
+
+    // Walk back from the write cursor; only the records handed out are
+    // checksummed, so a warm start costs O(events recovered) regardless of file size
+    RecordHeader record;
+    uint64_t pos = m_header->tail;
+    while ((pos = PreviousRecord(m_data, m_header->capacity, m_header->head,
+                                 pos, record)) != UINT64_MAX) {
+        if (record.type != RECORD_EVENT) {
+            continue;
+        }
+
+        // Corrupt records (e.g. an in-place update torn by a crash) are
+        // skipped; the length is checked first so the payload bound cannot wrap
+        const uint8_t* payload = m_data + pos % m_header->capacity + sizeof(RecordHeader);
+        AudioEvent event;
+        if (record.length >= RecordLength(0) &&
+            record.payloadSize <= record.length - sizeof(RecordHeader) - sizeof(uint32_t) &&
+            RecordChecksum(record, payload) == record.checksum &&
+            DecodeEvent(payload, record.payloadSize, event)) {
+            bytes += AudioEventBytes(event);
+            if (bytes > maxBytes) {
+                break;
+            }
+            events.push_back(std::move(event));
+        }
+    }
+
+    std::reverse(events.begin(), events.end());
+    return events;
+}
+
+void EventRing::EvictUntil(uint64_t newTail) {
+    const uint64_t capacity = m_header->capacity;
+
+    // Advance the head (published before the space is reused) until the new
+    // record fits
+    while (newTail - m_header->head > capacity) {
+        uint64_t offset = m_header->head % capacity;
+        uint64_t room = capacity - offset;
+        RecordHeader record;
+        std::memcpy(&record, m_data + offset, sizeof(record));
+        if (record.length < sizeof(RecordHeader) || record.length % RECORD_ALIGN != 0 || record.length > room) {
+            m_header->head += room;
+            continue;
+        }
+        if (record.type == RECORD_EVENT && m_header->recordCount > 0) {
+            m_header->recordCount--;
+        }
+        m_header->head += record.length;
+    }
+}
+
+void EventRing::WriteRecord(uint64_t position, uint16_t type, const std::vector<uint8_t>& payload,
+                            uint64_t length) {
+    RecordHeader record = {};
+    record.type = type;
+    record.payloadSize = static_cast<uint32_t>(payload.size());
+    record.length = static_cast<uint32_t>(length);
+    record.checksum = RecordChecksum(record, payload.data());
+
+    // Payload and trailing length first, header last
+    uint8_t* target = m_data + position % m_header->capacity;
+    if (!payload.empty()) {
+        std::memcpy(target + sizeof(RecordHeader), payload.data(), payload.size());
+    }
+    std::memcpy(target + length - sizeof(record.length), &record.length, sizeof(record.length));
+    std::memcpy(target, &record, sizeof(record));
+}
+
+void EventRing::Append(const AudioEvent& event) {
+    if (!IsOpen()) {
+        return;
+    }
+
+    EncodeEvent(event, m_scratch);
+    const uint64_t capacity = m_header->capacity;
+    uint64_t need = RecordLength(m_scratch.size());
+    if (need > capacity / 4) {
+        return;  // Pathologically large event; not worth evicting a quarter of history
+    }
+
+    uint64_t tail = m_header->tail;
+    uint64_t room = capacity - tail % capacity;
+    if (room < need) {
+        // Pad out to the end of the ring so records never wrap. Room is a
+        // multiple of the alignment, so even a header-only pad fits.
+        EvictUntil(tail + room);
+        std::vector<uint8_t> padding(room >= RecordLength(0) ? room - RecordLength(0) : 0, 0);
+        WriteRecord(tail, RECORD_PAD, padding, room);
+        tail += room;
+        m_header->tail = tail;
+    }
+
+    // The cursor is published only after the record is complete, so a crash
+    // mid-append leaves the previous tail intact
+    EvictUntil(tail + need);
+    WriteRecord(tail, RECORD_EVENT, m_scratch, need);
+    m_lastRecord = tail;
+    m_header->recordCount++;
+    m_header->tail = tail + need;
+}
+
+void EventRing::UpdateLast(const AudioEvent& event) {
+    if (!IsOpen()) {
+        return;
+    }
+    if (m_lastRecord == UINT64_MAX || m_lastRecord < m_header->head) {
+        Append(event);
+        return;
+    }
+
+    // Count and level updates keep the payload size, so rewrite in place.
+    // Features or loudness first captured mid-batch would grow it; those stay in memory only.
+    // The label is the same for the whole batch.
+    EncodeEvent(event, m_scratch);
+    RecordHeader record;
+    std::memcpy(&record, m_data + m_lastRecord % m_header->capacity, sizeof(record));
+    if (record.payloadSize != m_scratch.size()) {
+        EncodeEvent(event, m_scratch, false);
+    }
+    if (record.payloadSize == m_scratch.size()) {
+        WriteRecord(m_lastRecord, RECORD_EVENT, m_scratch, record.length);
+        return;
+    }
+
+    // Otherwise the new copy is appended and the old record, unless the
+    // append evicted it, is turned into padding so recovery loads it once
+    uint64_t old = m_lastRecord;
+    Append(event);
+    if (m_lastRecord != old && old >= m_header->head) {
+        std::vector<uint8_t> padding(record.length - RecordLength(0), 0);
+        WriteRecord(old, RECORD_PAD, padding, record.length);
+        if (m_header->recordCount > 0) {
+            m_header->recordCount--;
+        }
+    }
+}
+
+void EventRing::Clear() {
+    if (IsOpen()) {
+        Reset(m_header->capacity);
+    }
+}
+
+uint64_t EventRing::GetRecordCount() const {
+    return m_header ? m_header->recordCount : 0;
+}
+
+uint64_t EventRing::GetCapacity() const {
+    return m_header ? m_header->capacity : 0;
+}
\ No newline at end of file
@@ -0,0 +1,146 @@
+#include "../include/EventSpill.h"
+#include <filesystem>
+#include <fstream>
+#include <cstring>
+#include <cstdio>
+#include <iterator>
+
+namespace {
+
+const char SPILL_MAGIC[8] = { 'S', 'T', 'S', 'P', 'I', 'L', 'L', '1' };
+const uint32_t SPILL_VERSION = 5;  // 3: sound label field, 4: loudness, 5: endpoint id
+const size_t HEADER_SIZE = 12;  // Magic, version; an EventChunk follows
+const wchar_t SEGMENT_EXTENSION[] = L".spill";
+
+} // namespace
+
+EventSpill::EventSpill()
+    : m_maxBytes(0), m_diskBytes(0), m_eventCount(0), m_nextSegment(0), m_open(false) {
+}
+
+EventSpill::~EventSpill() {
+    Close();
+}
+
+bool EventSpill::Open(const std::wstring& directory, uint64_t maxBytes) {
+    Close();
+
+    std::error_code ec;
+    std::filesystem::path path(directory);
+    std::filesystem::create_directories(path, ec);
+    if (!std::filesystem::is_directory(path, ec)) {
+        return false;
+    }
+    for (const auto& entry : std::filesystem::directory_iterator(path, ec)) {
+        if (entry.path().extension() == SEGMENT_EXTENSION) {
+            std::filesystem::remove(entry.path(), ec);
+        }
+    }
+
+    m_directory = directory;
+    m_maxBytes = maxBytes;
+    m_open = true;
+    return true;
+}
+
+void EventSpill::Close() {
+    Clear();
+    m_open = false;
+}
+
+void EventSpill::Clear() {
+    while (!m_segments.empty()) {
+        RemoveOldest();
+    }
+}
+
+void EventSpill::RemoveOldest() {
+    const Segment& segment = m_segments.front();
+    std::error_code ec;
+    std::filesystem::remove(std::filesystem::path(segment.path), ec);
+    m_diskBytes -= segment.bytes;
+    m_eventCount -= segment.events;
+    m_segments.pop_front();
+}
+
+bool EventSpill::Write(const EventChunk& chunk) {
+    if (!m_open || chunk.GetCount() == 0) {
+        return false;
+    }
+
+    const std::vector<uint8_t>& data = chunk.GetData();
+    uint32_t version = SPILL_VERSION;
+    wchar_t name[32];
+    std::swprintf(name, sizeof(name) / sizeof(name[0]), L"%08llu%ls",
+                  static_cast<unsigned long long>(m_nextSegment++), SEGMENT_EXTENSION);
+    std::filesystem::path path = std::filesystem::path(m_directory) / name;
+    {
+        std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+        file.write(SPILL_MAGIC, sizeof(SPILL_MAGIC));
+        file.write(reinterpret_cast<const char*>(&version), sizeof(version));
+        file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+        if (!file.good()) {
+            file.close();
+            std::error_code ec;
+            std::filesystem::remove(path, ec);
+            return false;
+        }
+    }
+
+    Segment segment;
+    segment.path = path.wstring();
+    segment.first = chunk.GetFirstTime();
+    segment.last = chunk.GetLastTime();
+    segment.events = chunk.GetCount();
+    segment.bytes = HEADER_SIZE + data.size();
+    m_diskBytes += segment.bytes;
+    m_eventCount += segment.events;
+    m_segments.push_back(std::move(segment));
+    while (m_diskBytes > m_maxBytes && m_segments.size() > 1) {
+        RemoveOldest();
+    }
+    return true;
+}
+
+bool EventSpill::LoadSegment(const Segment& segment, EventChunk& chunk) const {
+    std::ifstream file(std::filesystem::path(segment.path), std::ios::in | std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    char magic[sizeof(SPILL_MAGIC)] = {};
+    uint32_t version = 0;
+    file.read(magic, sizeof(magic));
+    file.read(reinterpret_cast<char*>(&version), sizeof(version));
+    if (!file.good() || std::memcmp(magic, SPILL_MAGIC, sizeof(SPILL_MAGIC)) != 0 || version != SPILL_VERSION) {
+        return false;
+    }
+    return chunk.Load(std::vector<uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()));
+}
+
+void EventSpill::Read(const std::chrono::system_clock::time_point& startTime,
+                      const std::chrono::system_clock::time_point& endTime, std::vector<AudioEvent>& out) const {
+    for (const Segment& segment : m_segments) {
+        if (segment.last < startTime || segment.first > endTime) {
+            continue;
+        }
+
+        // Only events inside the range are decoded into strings
+        EventChunk chunk;
+        if (LoadSegment(segment, chunk)) {
+            chunk.Decode(startTime, endTime, out);
+        }
+    }
+}
+
+void EventSpill::ReadChunks(const std::chrono::system_clock::time_point& startTime,
+                            const std::chrono::system_clock::time_point& endTime, std::vector<EventChunk>& out) const {
+    for (const Segment& segment : m_segments) {
+        if (segment.last < startTime || segment.first > endTime) {
+            continue;
+        }
+        EventChunk chunk;
+        if (LoadSegment(segment, chunk)) {
+            out.push_back(std::move(chunk));
+        }
+    }
+}
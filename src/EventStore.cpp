@@ -0,0 +1,414 @@
+#include "../include/EventStore.h"
+#include "../include/Metrics.h"
+#include "../include/SpanTracer.h"
+#include "../include/TimestampClock.h"
+#include <algorithm>
+#include <ctime>
+#include <filesystem>
+#include <iterator>
+
+EventStore::EventStore(size_t maxBytes)
+    : m_maxBytes(maxBytes), m_bytes(0), m_sealedBytes(0), m_sealedEvents(0), m_sealing(true), m_nextSequence(0),
+      m_epoch(0), m_revision(0) {
+}
+
+// Called with m_mutex held, so revisions reach the feed in order
+void EventStore::Changed() {
+    ++m_revision;
+    m_changes.Publish(m_revision);
+}
+
+// Called with m_mutex held, after m_nextSequence counts every event. Seals
+// the oldest events once there are twice CHUNK_EVENTS uncompressed, then
+// evicts down to nine tenths of the budget, sealed chunks first, so this
+// runs once per tenth rather than on every Add. The newest event always
+// stays: batching updates it in place.
+void EventStore::Trim() {
+    // Events before removed have left m_events; they go in one Recycle, as
+    // an import can seal thousands of chunks at once
+    size_t removed = 0;
+    while (m_sealing && m_events.size() - removed >= 2 * CHUNK_EVENTS) {
+        Seal(removed);
+        removed += CHUNK_EVENTS;
+    }
+
+    size_t evicted = 0;
+    if (m_bytes + m_sealedBytes > m_maxBytes) {
+        size_t target = m_maxBytes - m_maxBytes / 10;
+        while (m_bytes + m_sealedBytes > target && !m_sealed.empty()) {
+            EventChunk& chunk = m_sealed.front().chunk;
+            evicted += chunk.GetCount();
+            m_sealedEvents -= chunk.GetCount();
+            m_sealedBytes -= chunk.GetMemoryUsage();
+            if (m_spill.IsOpen()) {
+                m_spillQueue.push_back(std::move(chunk));
+            }
+            m_sealed.pop_front();
+        }
+
+        // A budget too small for the uncompressed events evicts those too
+        size_t chunkBytes = (std::max)(m_maxBytes / 10, static_cast<size_t>(1));
+        while (m_bytes > target && removed + 1 < m_events.size()) {
+            // One spill segment per chunk, so a large import is not one huge file
+            size_t first = removed;
+            size_t bytes = 0;
+            while (m_bytes > target && bytes < chunkBytes && removed + 1 < m_events.size()) {
+                size_t eventBytes = AudioEventBytes(m_events[removed]);
+                bytes += eventBytes;
+                m_bytes -= eventBytes;
+                ++removed;
+            }
+            if (m_spill.IsOpen()) {
+                m_spillQueue.push_back(EventChunk::Encode(&m_events[first], removed - first));
+            }
+            evicted += removed - first;
+        }
+        METRICS_COUNT(EventsEvicted, evicted);
+    }
+    if (removed > 0) {
+        Recycle(removed);
+    }
+}
+
+// Called without either lock, after Trim queued chunks. Holding
+// m_spillMutex across the swap and the writes keeps segments in eviction
+// order, and readers never see queued events twice or not at all.
+void EventStore::WriteSpill() {
+    std::lock_guard<std::mutex> spillLock(m_spillMutex);
+    std::vector<EventChunk> chunks;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        chunks.swap(m_spillQueue);
+    }
+    for (const auto& chunk : chunks) {
+        if (m_spill.Write(chunk)) {
+            METRICS_COUNT(EventsSpilled, chunk.GetCount());
+        }
+    }
+}
+
+// Called with m_mutex held. Compresses the CHUNK_EVENTS events from index on.
+void EventStore::Seal(size_t index) {
+    SealedChunk sealed = { m_nextSequence - m_events.size() + index,
+                           EventChunk::Encode(&m_events[index], CHUNK_EVENTS) };
+    for (size_t i = index; i < index + CHUNK_EVENTS; ++i) {
+        m_bytes -= AudioEventBytes(m_events[i]);
+    }
+    m_sealedBytes += sealed.chunk.GetMemoryUsage();
+    m_sealedEvents += CHUNK_EVENTS;
+    m_sealed.push_back(std::move(sealed));
+    METRICS_COUNT(EventsSealed, CHUNK_EVENTS);
+}
+
+// Called with m_mutex held. Removes the oldest count events, keeping enough
+// as spares for the Adds until the next Seal or Trim: a chunk's worth once
+// there are that many uncompressed, else about two trims' worth, since
+// trims remove more or fewer events as their sizes vary. A big
+// import removes far more than Add will ever reuse. Add takes spares from
+// the back, so new ones go in front: every spare keeps circulating and its
+// buffers soon grow to fit any event, where a stack would leave the deepest
+// ones small.
+void EventStore::Recycle(size_t count) {
+    size_t remaining = m_events.size() - count;
+    size_t limit = remaining >= CHUNK_EVENTS ? remaining : remaining / 4 + 1;
+    if (limit > CHUNK_EVENTS) {
+        limit = CHUNK_EVENTS;
+    }
+    size_t spares = limit > m_spare.size() ? (std::min)(count, limit - m_spare.size()) : 0;
+    m_spare.insert(m_spare.begin(), std::make_move_iterator(m_events.begin() + (count - spares)),
+                   std::make_move_iterator(m_events.begin() + count));
+    m_events.erase(m_events.begin(), m_events.begin() + count);
+    // An import or a lowered budget can leave far more capacity than the
+    // budget needs. The margin keeps Add's normal growth from ever shrinking.
+    if (m_events.capacity() > 4 * m_events.size() + 64) {
+        m_events.shrink_to_fit();
+    }
+}
+
+void EventStore::SetMaxBytes(size_t maxBytes) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_maxBytes = maxBytes;
+        Trim();
+    }
+    WriteSpill();
+}
+
+size_t EventStore::GetMaxBytes() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_maxBytes;
+}
+
+void EventStore::SetSealing(bool enabled) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_sealing = enabled;
+        Trim();
+    }
+    WriteSpill();
+}
+
+bool EventStore::OpenRing(const std::wstring& path, uint64_t capacityBytes) {
+    std::error_code ec;
+    std::filesystem::path ringPath(path);
+    if (ringPath.has_parent_path()) {
+        std::filesystem::create_directories(ringPath.parent_path(), ec);
+    }
+
+    auto ring = std::make_unique<EventRing>();
+    if (!ring->Open(path, capacityBytes)) {
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_events = ring->Recover(m_maxBytes);
+        m_bytes = 0;
+        for (const auto& event : m_events) {
+            m_bytes += AudioEventBytes(event);
+        }
+        m_nextSequence += m_events.size();
+        Trim();
+        ++m_epoch;
+        m_ring = std::move(ring);
+        Changed();
+    }
+    WriteSpill();
+    return true;
+}
+
+void EventStore::CloseRing() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_ring.reset();
+}
+
+bool EventStore::OpenSpill(const std::wstring& directory, uint64_t maxDiskBytes) {
+    std::lock_guard<std::mutex> spillLock(m_spillMutex);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_spill.Open(directory, maxDiskBytes);
+}
+
+void EventStore::CloseSpill() {
+    std::lock_guard<std::mutex> spillLock(m_spillMutex);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_spillQueue.clear();
+    m_spill.Close();
+}
+
+bool EventStore::Add(const AudioEvent& event) {
+    TRACE_SPAN("EventStore.Add");
+    METRICS_TIMER_START(lockStart);
+    TracedLock lock(m_mutex, "EventStore lock");
+    METRICS_TIMER_RECORD(StoreLockWait, lockStart);
+    
+    // Check if we should batch with the last event
+    if (!m_events.empty()) {
+        auto& lastEvent = m_events.back();
+        
+        // Compare local hour and minute of both timestamps
+        std::tm lastTm, currentTm;
+        TimestampClock::Instance().ToLocalTime(lastEvent.timestamp, lastTm);
+        TimestampClock::Instance().ToLocalTime(event.timestamp, currentTm);
+        
+        // If same minute (hour and minute match) AND same process on the same
+        // endpoint AND same recognized sound, add its count (coalesced
+        // samples carry several)
+        if (lastTm.tm_hour == currentTm.tm_hour && 
+            lastTm.tm_min == currentTm.tm_min && 
+            lastEvent.processId == event.processId &&
+            lastEvent.endpointId == event.endpointId &&
+            lastEvent.soundLabel == event.soundLabel) {
+            lastEvent.eventCount += event.eventCount > 0 ? event.eventCount : 1;
+            // Update peak/volume/loudness to max values
+            lastEvent.peakLevel = (std::max)(lastEvent.peakLevel, event.peakLevel);
+            lastEvent.volumeLevel = (std::max)(lastEvent.volumeLevel, event.volumeLevel);
+            lastEvent.momentaryLoudness = (std::max)(lastEvent.momentaryLoudness, event.momentaryLoudness);
+            lastEvent.shortTermLoudness = (std::max)(lastEvent.shortTermLoudness, event.shortTermLoudness);
+            MergeSoundFeatures(lastEvent.features, event.features);
+            if (m_ring) {
+                m_ring->UpdateLast(lastEvent);
+            }
+            Changed();
+            METRICS_COUNT(EventsBatched, 1);
+            return false;  // Don't add new event, just increment count
+        }
+    }
+    
+    if (m_spare.empty()) {
+        m_events.push_back(event);
+    } else {
+        // Copy-assigning into a recycled event reuses its string buffers
+        m_events.push_back(std::move(m_spare.back()));
+        m_spare.pop_back();
+        m_events.back() = event;
+    }
+    m_bytes += AudioEventBytes(m_events.back());
+    ++m_nextSequence;
+    Trim();
+    if (m_ring) {
+        m_ring->Append(event);
+    }
+    Changed();
+    METRICS_COUNT(EventsAdded, 1);
+    bool spill = !m_spillQueue.empty();
+    lock.unlock();
+    if (spill) {
+        WriteSpill();
+    }
+    return true;
+}
+
+void EventStore::Import(std::vector<AudioEvent> events) {
+    auto byTime = [](const AudioEvent& a, const AudioEvent& b) { return a.timestamp < b.timestamp; };
+    if (!std::is_sorted(events.begin(), events.end(), byTime)) {
+        std::stable_sort(events.begin(), events.end(), byTime);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (const auto& event : events) {
+            m_bytes += AudioEventBytes(event);
+        }
+        size_t middle = m_events.size();
+        m_events.insert(m_events.end(), std::make_move_iterator(events.begin()),
+                        std::make_move_iterator(events.end()));
+        std::inplace_merge(m_events.begin(), m_events.begin() + middle, m_events.end(), byTime);
+        m_nextSequence += events.size();
+        Trim();
+        ++m_epoch;
+        Changed();
+    }
+    WriteSpill();
+}
+
+void EventStore::Clear() {
+    std::lock_guard<std::mutex> spillLock(m_spillMutex);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_events.clear();
+    m_sealed.clear();
+    m_spare.clear();
+    m_bytes = 0;
+    m_sealedBytes = 0;
+    m_sealedEvents = 0;
+    m_spillQueue.clear();
+    m_spill.Clear();
+    ++m_epoch;
+    if (m_ring) {
+        m_ring->Clear();
+    }
+    Changed();
+}
+
+std::vector<AudioEvent> EventStore::GetEvents(const std::chrono::system_clock::time_point& startTime,
+                                              const std::chrono::system_clock::time_point& endTime) const {
+    std::lock_guard<std::mutex> spillLock(m_spillMutex);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<AudioEvent> filtered;
+    m_spill.Read(startTime, endTime, filtered);
+    for (const auto& chunk : m_spillQueue) {
+        chunk.Decode(startTime, endTime, filtered);
+    }
+    for (const auto& sealed : m_sealed) {
+        sealed.chunk.Decode(startTime, endTime, filtered);
+    }
+    size_t older = filtered.size();
+    
+    for (const auto& event : m_events) {
+        if (event.timestamp >= startTime && event.timestamp <= endTime) {
+            filtered.push_back(event);
+        }
+    }
+    
+    // Imports can merge events older than what was already sealed or spilled
+    auto byTime = [](const AudioEvent& a, const AudioEvent& b) { return a.timestamp < b.timestamp; };
+    if (older > 0 && !std::is_sorted(filtered.begin(), filtered.end(), byTime)) {
+        std::stable_sort(filtered.begin(), filtered.end(), byTime);
+    }
+    return filtered;
+}
+
+// The scan runs on copies, so Add is never held up by it: segments are
+// read under m_spillMutex alone, which keeps queued chunks from being
+// written meanwhile, and m_mutex is held only to copy the queue, the
+// sealed chunks (which share their bytes) and the hot rows in range
+QueryResult EventStore::Query(const EventQuery& query) const {
+    std::vector<EventChunk> chunks;
+    std::vector<AudioEvent> hot;
+    {
+        std::lock_guard<std::mutex> spillLock(m_spillMutex);
+        m_spill.ReadChunks(query.start, query.end, chunks);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        chunks.reserve(chunks.size() + m_spillQueue.size() + m_sealed.size());
+        chunks.insert(chunks.end(), m_spillQueue.begin(), m_spillQueue.end());
+        for (const auto& sealed : m_sealed) {
+            chunks.push_back(sealed.chunk);
+        }
+        for (const auto& event : m_events) {
+            if (event.timestamp >= query.start && event.timestamp <= query.end) {
+                hot.push_back(event);
+            }
+        }
+    }
+
+    EventQueryExecutor executor(query);
+    for (const auto& chunk : chunks) {
+        executor.AddChunk(chunk);
+    }
+    executor.AddRows(hot.data(), hot.size());
+    return executor.Run();
+}
+
+EventDelta EventStore::ReadSince(uint64_t sequence, const std::chrono::system_clock::time_point& notBefore) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    uint64_t hotFirst = m_nextSequence - m_events.size();
+    uint64_t first = m_sealed.empty() ? hotFirst : m_sealed.front().firstSequence;
+    EventDelta delta;
+    delta.epoch = m_epoch;
+    delta.firstSequence = (std::min)((std::max)(sequence, first), m_nextSequence);
+    delta.nextSequence = m_nextSequence;
+    for (const auto& sealed : m_sealed) {
+        uint64_t end = sealed.firstSequence + sealed.chunk.GetCount();
+        if (end <= delta.firstSequence) {
+            continue;
+        }
+        if (delta.events.empty() && sealed.chunk.GetLastTime() < notBefore) {
+            delta.firstSequence = end;
+            continue;
+        }
+        size_t index = delta.firstSequence > sealed.firstSequence
+                           ? static_cast<size_t>(delta.firstSequence - sealed.firstSequence) : 0;
+        sealed.chunk.DecodeFrom(index, delta.events);
+    }
+    size_t hotIndex = delta.firstSequence > hotFirst ? static_cast<size_t>(delta.firstSequence - hotFirst) : 0;
+    delta.events.insert(delta.events.end(), m_events.begin() + static_cast<ptrdiff_t>(hotIndex), m_events.end());
+    return delta;
+}
+
+size_t EventStore::GetEventCount() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_sealedEvents + m_events.size();
+}
+size_t EventStore::GetMemoryUsage() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    size_t bytes = m_bytes + m_sealedBytes + (m_events.capacity() - m_events.size() + m_spare.capacity() - m_spare.size()) *
+                             sizeof(AudioEvent);
+    for (const auto& event : m_spare) {
+        bytes += AudioEventBytes(event);
+    }
+    return bytes;
+}
+
+size_t EventStore::GetSpilledEventCount() const {
+    std::lock_guard<std::mutex> spillLock(m_spillMutex);
+    return m_spill.GetEventCount();
+}
+
+uint64_t EventStore::GetSpillDiskUsage() const {
+    std::lock_guard<std::mutex> spillLock(m_spillMutex);
+    return m_spill.GetDiskUsage();
+}
+
+uint64_t EventStore::GetRevision() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_revision;
+}
\ No newline at end of file
@@ -0,0 +1,153 @@
+#include "../include/EventViewModel.h"
+#include <algorithm>
+
+namespace {
+
+// Extends the previous diff when the new one continues it
+void PushDiff(std::vector<RowDiff>& diffs, RowDiff::Kind kind, size_t index, size_t count) {
+    if (count == 0) {
+        return;
+    }
+    if (!diffs.empty()) {
+        RowDiff& last = diffs.back();
+        if (last.kind == kind && kind == RowDiff::Kind::Insert && last.index == index) {
+            last.count += count;
+            return;
+        }
+        if (last.kind == kind && kind == RowDiff::Kind::Remove && last.index == index + count) {
+            last.index = index;
+            last.count += count;
+            return;
+        }
+    }
+    diffs.push_back({ kind, index, count });
+}
+
+bool SameFeatures(const SoundFeatures& a, const SoundFeatures& b) {
+    return a.frames == b.frames && a.rms == b.rms && a.centroidHz == b.centroidHz && a.flux == b.flux &&
+           a.zeroCrossingRate == b.zeroCrossingRate &&
+           std::equal(a.mfcc, a.mfcc + SoundFeatures::MFCC_COUNT, b.mfcc);
+}
+
+// Every field a row can show, so any change the store made is redrawn
+bool SameEvent(const AudioEvent& a, const AudioEvent& b) {
+    return a.timestamp == b.timestamp && a.processId == b.processId && a.eventCount == b.eventCount &&
+           a.volumeLevel == b.volumeLevel && a.peakLevel == b.peakLevel &&
+           a.momentaryLoudness == b.momentaryLoudness && a.shortTermLoudness == b.shortTermLoudness &&
+           a.isSystemSound == b.isSystemSound && a.duration_ms == b.duration_ms &&
+           a.processName == b.processName && a.processPath == b.processPath &&
+           a.soundDescription == b.soundDescription && a.sessionDisplayName == b.sessionDisplayName &&
+           a.usbDeviceInfo == b.usbDeviceInfo && a.browserTabInfo == b.browserTabInfo &&
+           a.soundLabel == b.soundLabel && a.endpointId == b.endpointId && SameFeatures(a.features, b.features);
+}
+
+} // namespace
+
+EventViewModel::EventViewModel()
+    : m_epoch(0), m_nextSequence(0), m_firstVisible(0), m_synced(false), m_resetPending(false),
+      m_index(nullptr) {
+}
+
+void EventViewModel::Rebuild(const EventStore& store, const std::chrono::system_clock::time_point& windowStart,
+                             std::vector<RowDiff>& diffs) {
+    // Sealed chunks wholly before the window are not decoded
+    EventDelta delta = store.ReadSince(m_firstVisible, windowStart);
+    m_rows.clear();
+
+    // The index can answer for the whole delta only if it has seen exactly it
+    bool useIndex = m_index && !m_query.IsEmpty() && m_index->GetEpoch() == delta.epoch &&
+                    m_index->GetFirstSequence() <= delta.firstSequence &&
+                    m_index->GetNextSequence() == delta.nextSequence;
+    std::vector<uint64_t> matches;
+    if (useIndex) {
+        matches = m_index->Find(m_query, delta.firstSequence);
+    }
+    auto match = matches.begin();
+
+    uint64_t sequence = delta.firstSequence;
+    for (auto& event : delta.events) {
+        bool matched;
+        if (useIndex) {
+            while (match != matches.end() && *match < sequence) {
+                ++match;
+            }
+            matched = match != matches.end() && *match == sequence;
+        } else {
+            matched = m_query.Matches(event);
+        }
+        if (matched && event.timestamp >= windowStart) {
+            m_rows.push_back({ sequence, std::move(event) });
+        }
+        ++sequence;
+    }
+    m_epoch = delta.epoch;
+    m_nextSequence = delta.nextSequence;
+    m_synced = true;
+    m_resetPending = false;
+    diffs.push_back({ RowDiff::Kind::Reset, 0, m_rows.size() });
+}
+
+void EventViewModel::Sync(const EventStore& store, const std::chrono::system_clock::time_point& windowStart,
+                          std::vector<RowDiff>& diffs) {
+    if (!m_synced || m_resetPending) {
+        Rebuild(store, windowStart, diffs);
+        return;
+    }
+
+    // Re-read the newest event already seen; batching may have bumped it
+    uint64_t from = m_nextSequence > 0 ? m_nextSequence - 1 : 0;
+    EventDelta delta = store.ReadSince(from);
+    if (delta.epoch != m_epoch) {
+        Rebuild(store, windowStart, diffs);
+        return;
+    }
+
+    uint64_t sequence = delta.firstSequence;
+    size_t next = 0;
+    if (sequence == from && from < m_nextSequence && !delta.events.empty()) {
+        const AudioEvent& event = delta.events[0];
+        if (!m_rows.empty() && m_rows.back().sequence == from) {
+            AudioEvent& shown = m_rows.back().event;
+            if (!SameEvent(shown, event)) {
+                shown = event;
+                PushDiff(diffs, RowDiff::Kind::Update, 0, 1);
+            }
+        }
+        next = 1;
+        ++sequence;
+    }
+
+    for (; next < delta.events.size(); ++next, ++sequence) {
+        AudioEvent& event = delta.events[next];
+        if (event.timestamp >= windowStart && m_query.Matches(event)) {
+            m_rows.push_back({ sequence, std::move(event) });
+            PushDiff(diffs, RowDiff::Kind::Insert, 0, 1);
+        }
+    }
+    m_nextSequence = delta.nextSequence;
+
+    // Expire from the oldest end, which is the bottom of the view
+    size_t expired = 0;
+    while (expired < m_rows.size() && m_rows[expired].event.timestamp < windowStart) {
+        ++expired;
+    }
+    if (expired > 0) {
+        m_rows.erase(m_rows.begin(), m_rows.begin() + static_cast<ptrdiff_t>(expired));
+        PushDiff(diffs, RowDiff::Kind::Remove, m_rows.size(), expired);
+    }
+}
+
+void EventViewModel::SetFilter(const std::string& filter) {
+    if (filter != m_filterText) {
+        m_filterText = filter;
+        m_query.Parse(filter);
+        m_resetPending = true;
+    }
+}
+
+void EventViewModel::Clear(std::vector<RowDiff>& diffs) {
+    size_t count = m_rows.size();
+    m_rows.clear();
+    m_firstVisible = m_nextSequence;
+    PushDiff(diffs, RowDiff::Kind::Remove, 0, count);
+}
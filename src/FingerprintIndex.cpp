@@ -0,0 +1,190 @@
+#include "../include/FingerprintIndex.h"
+#include "../include/WavFile.h"
+#include "../include/Utf8.h"
+#include <filesystem>
+#include <algorithm>
+#include <cwctype>
+
+namespace {
+
+// Octave bands of FFT bins at 16 kHz: 16 Hz - 250 Hz, then doubling to 8 kHz.
+// Bins stay below 512, so each fits in 9 bits of a hash.
+const uint32_t BAND_EDGES[] = { 1, 16, 32, 64, 128, 256, 512 };
+const size_t BAND_COUNT = sizeof(BAND_EDGES) / sizeof(BAND_EDGES[0]) - 1;
+const float PEAK_FLOOR = 1e-3f;   // -60 dBFS; quieter peaks are noise
+const uint32_t MAX_GAP = 63;      // Frames between paired landmarks, 6 bits
+const size_t FAN_OUT = 8;         // Pairs per landmark
+
+uint32_t LandmarkHash(uint32_t anchorBin, uint32_t targetBin, uint32_t gap) {
+    return (anchorBin << 15) | (targetBin << 6) | gap;
+}
+
+// Linear interpolation going up; going down, each output averages the input
+// samples it spans, a box filter that keeps most aliasing out of the peaks
+void Resample(const float* in, size_t count, uint32_t rate, uint32_t targetRate, std::vector<float>& out) {
+    if (rate == targetRate) {
+        out.assign(in, in + count);
+        return;
+    }
+    double step = static_cast<double>(rate) / targetRate;
+    size_t outCount = static_cast<size_t>(count / step);
+    out.resize(outCount);
+    size_t width = step > 1.0 ? static_cast<size_t>(step) : 1;
+    for (size_t n = 0; n < outCount; ++n) {
+        double position = n * step;
+        size_t i = static_cast<size_t>(position);
+        if (width == 1) {
+            float fraction = static_cast<float>(position - i);
+            float next = i + 1 < count ? in[i + 1] : in[i];
+            out[n] = in[i] + (next - in[i]) * fraction;
+        } else {
+            size_t end = (std::min)(i + width, count);
+            float sum = 0.0f;
+            for (size_t k = i; k < end; ++k) {
+                sum += in[k];
+            }
+            out[n] = sum / static_cast<float>(end - i);
+        }
+    }
+}
+
+} // namespace
+
+FingerprintIndex::FingerprintIndex() : m_analyzer(SAMPLE_RATE), m_postingCount(0) {
+}
+
+void FingerprintIndex::Extract(const float* samples, size_t count, uint32_t sampleRate) {
+    m_peaks.clear();
+    m_landmarks.clear();
+    if (sampleRate == 0) {
+        return;
+    }
+    Resample(samples, count, sampleRate, SAMPLE_RATE, m_resampled);
+
+    // The strongest bin of each band, kept if it stands out from the other bands
+    const size_t frameSize = SpectralAnalyzer::FRAME_SIZE;
+    for (size_t start = 0; start + frameSize <= m_resampled.size(); start += HOP_SIZE) {
+        const std::vector<float>& spectrum = m_analyzer.ComputeSpectrum(&m_resampled[start]);
+        float strongest[BAND_COUNT];
+        uint32_t strongestBin[BAND_COUNT];
+        float mean = 0.0f;
+        for (size_t band = 0; band < BAND_COUNT; ++band) {
+            strongest[band] = 0.0f;
+            strongestBin[band] = BAND_EDGES[band];
+            for (uint32_t bin = BAND_EDGES[band]; bin < BAND_EDGES[band + 1]; ++bin) {
+                if (spectrum[bin] > strongest[band]) {
+                    strongest[band] = spectrum[bin];
+                    strongestBin[band] = bin;
+                }
+            }
+            mean += strongest[band] / BAND_COUNT;
+        }
+        uint32_t frame = static_cast<uint32_t>(start / HOP_SIZE);
+        for (size_t band = 0; band < BAND_COUNT; ++band) {
+            if (strongest[band] > PEAK_FLOOR && strongest[band] >= mean) {
+                m_peaks.push_back({ frame, strongestBin[band] });
+            }
+        }
+    }
+
+    // Peaks are in frame order, so the targets of each anchor follow it
+    for (size_t i = 0; i < m_peaks.size(); ++i) {
+        const Peak& anchor = m_peaks[i];
+        size_t pairs = 0;
+        for (size_t j = i + 1; j < m_peaks.size() && pairs < FAN_OUT; ++j) {
+            uint32_t gap = m_peaks[j].frame - anchor.frame;
+            if (gap > MAX_GAP) {
+                break;
+            }
+            if (gap > 0) {
+                m_landmarks.push_back({ LandmarkHash(anchor.bin, m_peaks[j].bin, gap), anchor.frame });
+                ++pairs;
+            }
+        }
+    }
+}
+
+uint32_t FingerprintIndex::AddSound(const std::string& name, const float* samples, size_t count,
+                                    uint32_t sampleRate) {
+    uint32_t soundId = static_cast<uint32_t>(m_names.size());
+    m_names.push_back(name);
+    Extract(samples, count, sampleRate);
+    for (const Landmark& landmark : m_landmarks) {
+        m_postings[landmark.hash].push_back({ soundId, landmark.frame });
+    }
+    m_postingCount += m_landmarks.size();
+    return soundId;
+}
+
+size_t FingerprintIndex::AddDirectory(const std::wstring& directory) {
+    std::error_code ec;
+    std::vector<std::filesystem::path> files;
+    for (const auto& entry : std::filesystem::directory_iterator(std::filesystem::path(directory), ec)) {
+        std::wstring extension = entry.path().extension().wstring();
+        std::transform(extension.begin(), extension.end(), extension.begin(), towlower);
+        if (entry.is_regular_file(ec) && extension == L".wav") {
+            files.push_back(entry.path());
+        }
+    }
+    // Directory order is unspecified; sorting keeps sound ids stable
+    std::sort(files.begin(), files.end());
+
+    size_t added = 0;
+    std::vector<float> samples;
+    for (const auto& file : files) {
+        uint32_t sampleRate = 0;
+        if (ReadWavFile(file.wstring(), samples, sampleRate)) {
+            AddSound(WideToUtf8(file.stem().wstring()), samples.data(), samples.size(), sampleRate);
+            ++added;
+        }
+    }
+    return added;
+}
+
+bool FingerprintIndex::Match(const float* samples, size_t count, uint32_t sampleRate, FingerprintMatch& match) {
+    Extract(samples, count, sampleRate);
+    m_votes.clear();
+    for (const Landmark& landmark : m_landmarks) {
+        auto it = m_postings.find(landmark.hash);
+        if (it == m_postings.end()) {
+            continue;
+        }
+        for (const Posting& posting : it->second) {
+            // The offset wraps for snippets that start before the sound; it only has to be distinct
+            m_votes.push_back((static_cast<uint64_t>(posting.soundId) << 32) | (posting.frame - landmark.frame));
+        }
+    }
+
+    // Sorting groups the votes; a map would allocate a node per distinct one
+    std::sort(m_votes.begin(), m_votes.end());
+    uint64_t bestKey = 0;
+    uint32_t bestVotes = 0;
+    for (size_t i = 0; i < m_votes.size();) {
+        size_t run = i + 1;
+        while (run < m_votes.size() && m_votes[run] == m_votes[i]) {
+            ++run;
+        }
+        if (run - i > bestVotes) {
+            bestVotes = static_cast<uint32_t>(run - i);
+            bestKey = m_votes[i];
+        }
+        i = run;
+    }
+    if (bestVotes < MIN_MATCHES) {
+        return false;
+    }
+
+    match.soundId = static_cast<uint32_t>(bestKey >> 32);
+    match.name = m_names[match.soundId];
+    match.matchedHashes = bestVotes;
+    match.queryHashes = static_cast<uint32_t>(m_landmarks.size());
+    int32_t offsetFrames = static_cast<int32_t>(static_cast<uint32_t>(bestKey));
+    match.offsetSeconds = static_cast<float>(offsetFrames) * HOP_SIZE / SAMPLE_RATE;
+    return true;
+}
+
+void FingerprintIndex::Clear() {
+    m_names.clear();
+    m_postings.clear();
+    m_postingCount = 0;
+}
@@ -0,0 +1,107 @@
+#include "../include/LevelHistory.h"
+
+LevelHistory::LevelHistory(size_t maxBytes) : m_maxBytes(maxBytes), m_bytes(0) {
+}
+
+// Called with m_mutex held. Blocks are a few KB, so this runs about once
+// per block appended once the budget is reached.
+void LevelHistory::Trim() {
+    while (m_bytes > m_maxBytes && !m_series.empty()) {
+        auto oldest = m_series.begin();
+        for (auto it = m_series.begin(); it != m_series.end(); ++it) {
+            if (it->second.GetOldestTime() < oldest->second.GetOldestTime()) {
+                oldest = it;
+            }
+        }
+        m_bytes -= oldest->second.DropOldestBlock();
+        if (oldest->second.IsEmpty()) {
+            m_bytes -= oldest->second.GetMemoryUsage();
+            m_series.erase(oldest);
+        }
+    }
+}
+
+void LevelHistory::SetMaxBytes(size_t maxBytes) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_maxBytes = maxBytes;
+    Trim();
+}
+
+bool LevelHistory::Append(DWORD processId, const std::chrono::system_clock::time_point& time, float volume,
+                          float peak) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto inserted = m_series.try_emplace(processId);
+    LevelSeries& series = inserted.first->second;
+    size_t before = inserted.second ? 0 : series.GetMemoryUsage();
+    bool appended = series.Append(time, volume, peak);
+    m_bytes += series.GetMemoryUsage() - before;
+    Trim();
+    return appended;
+}
+
+bool LevelHistory::AppendSilence(DWORD processId, const std::chrono::system_clock::time_point& time) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_series.find(processId);
+    if (it == m_series.end()) {
+        return false;
+    }
+    LevelSeries& series = it->second;
+    size_t before = series.GetMemoryUsage();
+    bool appended = series.Append(time, series.GetLastVolume(), 0.0f);
+    m_bytes += series.GetMemoryUsage() - before;
+    Trim();
+    return appended;
+}
+
+bool LevelHistory::Read(DWORD processId, const std::chrono::system_clock::time_point& startTime,
+                        const std::chrono::system_clock::time_point& endTime, std::vector<LevelSample>& out) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_series.find(processId);
+    if (it == m_series.end()) {
+        return false;
+    }
+    it->second.Read(startTime, endTime, out);
+    return true;
+}
+
+bool LevelHistory::ReadDownsampled(DWORD processId, const std::chrono::system_clock::time_point& startTime,
+                                   const std::chrono::system_clock::time_point& endTime, size_t bucketCount,
+                                   std::vector<LevelBucket>& out) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_series.find(processId);
+    if (it == m_series.end()) {
+        return false;
+    }
+    it->second.ReadDownsampled(startTime, endTime, bucketCount, out);
+    return true;
+}
+
+std::vector<DWORD> LevelHistory::GetProcessIds() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<DWORD> processIds;
+    processIds.reserve(m_series.size());
+    for (const auto& series : m_series) {
+        processIds.push_back(series.first);
+    }
+    return processIds;
+}
+
+size_t LevelHistory::GetSampleCount() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    size_t samples = 0;
+    for (const auto& series : m_series) {
+        samples += series.second.GetSampleCount();
+    }
+    return samples;
+}
+
+size_t LevelHistory::GetMemoryUsage() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_bytes;
+}
+
+void LevelHistory::Clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_series.clear();
+    m_bytes = 0;
+}
@@ -0,0 +1,347 @@
+#include "../include/LevelSeries.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// Delta-of-delta classes, as in the Gorilla paper: a '0' for no change,
+// else a unary prefix picking the width of a two's complement value
+struct DodClass {
+    uint64_t prefix;
+    int prefixBits;
+    int valueBits;
+};
+const DodClass DOD_CLASSES[] = {
+    { 0x2, 2, 7 },   // '10'   [-64, 63]
+    { 0x6, 3, 9 },   // '110'  [-256, 255]
+    { 0xE, 4, 12 },  // '1110' [-2048, 2047]
+    { 0xF, 4, 32 },  // '1111' anything a block holds
+};
+
+int64_t ToMilliseconds(const std::chrono::system_clock::time_point& time) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(time.time_since_epoch()).count();
+}
+
+std::chrono::system_clock::time_point FromMilliseconds(int64_t milliseconds) {
+    return std::chrono::system_clock::time_point(
+        std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::milliseconds(milliseconds)));
+}
+
+uint32_t FloatBits(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+float BitsFloat(uint32_t bits) {
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// x must not be zero
+int LeadingZeros(uint32_t x) {
+    int count = 0;
+    while (!(x & 0x80000000u)) {
+        x <<= 1;
+        ++count;
+    }
+    return count;
+}
+
+int TrailingZeros(uint32_t x) {
+    int count = 0;
+    while (!(x & 1)) {
+        x >>= 1;
+        ++count;
+    }
+    return count;
+}
+
+// Appends the low bits of value, most significant first; bits <= 32
+void WriteBits(std::vector<uint64_t>& words, size_t& bitCount, uint64_t value, int bits) {
+    value &= (uint64_t(1) << bits) - 1;
+    size_t offset = bitCount % 64;
+    if (offset == 0) {
+        words.push_back(0);
+    }
+    int free = 64 - static_cast<int>(offset);
+    if (bits <= free) {
+        words.back() |= value << (free - bits);
+    } else {
+        words.back() |= value >> (bits - free);
+        words.push_back(value << (64 - (bits - free)));
+    }
+    bitCount += static_cast<size_t>(bits);
+}
+
+void WriteXor(std::vector<uint64_t>& words, size_t& bitCount, uint32_t value, uint32_t previous,
+              int& leading, int& trailing) {
+    uint32_t x = value ^ previous;
+    if (x == 0) {
+        WriteBits(words, bitCount, 0, 1);
+        return;
+    }
+    int newLeading = LeadingZeros(x);
+    int newTrailing = TrailingZeros(x);
+    if (leading >= 0 && newLeading >= leading && newTrailing >= trailing) {
+        // Fits the previous window: '10' and the window's bits
+        WriteBits(words, bitCount, 0x2, 2);
+        WriteBits(words, bitCount, x >> trailing, 32 - leading - trailing);
+        return;
+    }
+    // '11', the new window as 5 bits of leading zeros and 5 of length - 1, then its bits
+    int length = 32 - newLeading - newTrailing;
+    WriteBits(words, bitCount, 0x3, 2);
+    WriteBits(words, bitCount, static_cast<uint64_t>(newLeading), 5);
+    WriteBits(words, bitCount, static_cast<uint64_t>(length - 1), 5);
+    WriteBits(words, bitCount, x >> newTrailing, length);
+    leading = newLeading;
+    trailing = newTrailing;
+}
+
+// Reads a block's bit stream; blocks are only written by Append, so there
+// is no bounds checking beyond the block's own bit count
+struct BitReader {
+    const uint64_t* words;
+    size_t pos;
+
+    uint64_t Read(int bits) {
+        size_t word = pos / 64;
+        int offset = static_cast<int>(pos % 64);
+        pos += static_cast<size_t>(bits);
+        int available = 64 - offset;
+        uint64_t mask = (uint64_t(1) << bits) - 1;
+        if (bits <= available) {
+            return (words[word] >> (available - bits)) & mask;
+        }
+        int rest = bits - available;
+        uint64_t high = words[word] & ((uint64_t(1) << available) - 1);
+        return ((high << rest) | (words[word + 1] >> (64 - rest))) & mask;
+    }
+
+    bool ReadBit() {
+        bool bit = ((words[pos / 64] >> (63 - pos % 64)) & 1) != 0;
+        ++pos;
+        return bit;
+    }
+
+    uint32_t ReadXor(uint32_t previous, int& leading, int& trailing) {
+        if (!ReadBit()) {
+            return previous;
+        }
+        if (ReadBit()) {
+            leading = static_cast<int>(Read(5));
+            int length = static_cast<int>(Read(5)) + 1;
+            trailing = 32 - leading - length;
+        }
+        int length = 32 - leading - trailing;
+        return previous ^ (static_cast<uint32_t>(Read(length)) << trailing);
+    }
+};
+
+} // namespace
+
+LevelSeries::LevelSeries() : m_sampleCount(0), m_bytes(0) {
+}
+
+bool LevelSeries::Append(const std::chrono::system_clock::time_point& time, float volume, float peak) {
+    int64_t milliseconds = ToMilliseconds(time);
+    if (m_sampleCount > 0 && milliseconds < m_encoder.time) {
+        return false;
+    }
+
+    // A gap too long for the widest delta-of-delta class starts a new block
+    int64_t delta = milliseconds - m_encoder.time;
+    int64_t deltaOfDelta = delta - m_encoder.delta;
+    if (!m_blocks.empty() && m_blocks.back().count > 0 &&
+        (deltaOfDelta < INT32_MIN || deltaOfDelta > INT32_MAX)) {
+        Seal();
+    }
+    if (m_blocks.empty() || m_blocks.back().sealed) {
+        m_blocks.emplace_back();
+        m_bytes += sizeof(Block);
+    }
+
+    Block& block = m_blocks.back();
+    size_t capacity = block.words.capacity();
+    uint32_t volumeBits = FloatBits(volume);
+    uint32_t peakBits = FloatBits(peak);
+    if (block.count == 0) {
+        // The first sample is written in full
+        block.firstTime = milliseconds;
+        WriteBits(block.words, block.bitCount, volumeBits, 32);
+        WriteBits(block.words, block.bitCount, peakBits, 32);
+        m_encoder = Encoder();
+    } else {
+        if (deltaOfDelta == 0) {
+            WriteBits(block.words, block.bitCount, 0, 1);
+        } else {
+            for (const DodClass& dodClass : DOD_CLASSES) {
+                int64_t limit = int64_t(1) << (dodClass.valueBits - 1);
+                if (deltaOfDelta >= -limit && deltaOfDelta < limit) {
+                    WriteBits(block.words, block.bitCount, dodClass.prefix, dodClass.prefixBits);
+                    WriteBits(block.words, block.bitCount, static_cast<uint64_t>(deltaOfDelta), dodClass.valueBits);
+                    break;
+                }
+            }
+        }
+        WriteXor(block.words, block.bitCount, volumeBits, m_encoder.volume, m_encoder.volumeLeading,
+                 m_encoder.volumeTrailing);
+        WriteXor(block.words, block.bitCount, peakBits, m_encoder.peak, m_encoder.peakLeading,
+                 m_encoder.peakTrailing);
+        m_encoder.delta = delta;
+    }
+    m_encoder.time = milliseconds;
+    m_encoder.volume = volumeBits;
+    m_encoder.peak = peakBits;
+    block.lastTime = milliseconds;
+    ++block.count;
+    ++m_sampleCount;
+    m_bytes += (block.words.capacity() - capacity) * sizeof(uint64_t);
+    if (block.count == BLOCK_SAMPLES) {
+        Seal();
+    }
+    return true;
+}
+
+// Closes the newest block to appends, giving back its spare capacity
+void LevelSeries::Seal() {
+    Block& block = m_blocks.back();
+    m_bytes -= (block.words.capacity() - block.words.size()) * sizeof(uint64_t);
+    block.words.shrink_to_fit();
+    block.sealed = true;
+}
+
+// Calls visit(milliseconds, volumeBits, peakBits) for each sample in order
+// until it returns false
+template <typename Visit>
+void LevelSeries::DecodeBlock(const Block& block, Visit&& visit) const {
+    if (block.count == 0) {
+        return;
+    }
+    BitReader reader = { block.words.data(), 0 };
+    int64_t time = block.firstTime;
+    int64_t delta = 0;
+    uint32_t volume = static_cast<uint32_t>(reader.Read(32));
+    uint32_t peak = static_cast<uint32_t>(reader.Read(32));
+    int volumeLeading = 0, volumeTrailing = 0, peakLeading = 0, peakTrailing = 0;
+    if (!visit(time, volume, peak)) {
+        return;
+    }
+    for (uint32_t i = 1; i < block.count; ++i) {
+        if (reader.ReadBit()) {
+            const DodClass* dodClass = &DOD_CLASSES[0];
+            while (dodClass < &DOD_CLASSES[3] && reader.ReadBit()) {
+                ++dodClass;
+            }
+            // Sign-extend the two's complement value
+            uint64_t value = reader.Read(dodClass->valueBits);
+            uint64_t sign = uint64_t(1) << (dodClass->valueBits - 1);
+            delta += static_cast<int64_t>((value ^ sign) - sign);
+        }
+        time += delta;
+        volume = reader.ReadXor(volume, volumeLeading, volumeTrailing);
+        peak = reader.ReadXor(peak, peakLeading, peakTrailing);
+        if (!visit(time, volume, peak)) {
+            return;
+        }
+    }
+}
+
+void LevelSeries::Read(const std::chrono::system_clock::time_point& startTime,
+                       const std::chrono::system_clock::time_point& endTime, std::vector<LevelSample>& out) const {
+    for (const Block& block : m_blocks) {
+        if (FromMilliseconds(block.lastTime) < startTime || FromMilliseconds(block.firstTime) > endTime) {
+            continue;
+        }
+        DecodeBlock(block, [&](int64_t milliseconds, uint32_t volume, uint32_t peak) {
+            auto time = FromMilliseconds(milliseconds);
+            if (time > endTime) {
+                return false;
+            }
+            if (time >= startTime) {
+                out.push_back({ time, BitsFloat(volume), BitsFloat(peak) });
+            }
+            return true;
+        });
+    }
+}
+
+void LevelSeries::ReadDownsampled(const std::chrono::system_clock::time_point& startTime,
+                                  const std::chrono::system_clock::time_point& endTime, size_t bucketCount,
+                                  std::vector<LevelBucket>& out) const {
+    if (bucketCount == 0 || endTime <= startTime) {
+        return;
+    }
+    double span = static_cast<double>((endTime - startTime).count());
+    size_t first = out.size();
+    out.resize(first + bucketCount);
+    for (size_t i = 0; i < bucketCount; ++i) {
+        LevelBucket& bucket = out[first + i];
+        bucket.start = startTime + std::chrono::system_clock::duration(
+                                       static_cast<std::chrono::system_clock::rep>(span * i / bucketCount));
+        bucket.samples = 0;
+        bucket.maxVolume = 0.0f;
+        bucket.minPeak = 0.0f;
+        bucket.maxPeak = 0.0f;
+        bucket.meanPeak = 0.0f;  // Sum of peaks until the end
+    }
+
+    for (const Block& block : m_blocks) {
+        if (FromMilliseconds(block.lastTime) < startTime || FromMilliseconds(block.firstTime) >= endTime) {
+            continue;
+        }
+        DecodeBlock(block, [&](int64_t milliseconds, uint32_t volumeBits, uint32_t peakBits) {
+            auto time = FromMilliseconds(milliseconds);
+            if (time >= endTime) {
+                return false;
+            }
+            if (time < startTime) {
+                return true;
+            }
+            size_t index = static_cast<size_t>(static_cast<double>((time - startTime).count()) / span * bucketCount);
+            LevelBucket& bucket = out[first + (std::min)(index, bucketCount - 1)];
+            float volume = BitsFloat(volumeBits);
+            float peak = BitsFloat(peakBits);
+            if (bucket.samples == 0) {
+                bucket.maxVolume = volume;
+                bucket.minPeak = peak;
+                bucket.maxPeak = peak;
+            } else {
+                bucket.maxVolume = (std::max)(bucket.maxVolume, volume);
+                bucket.minPeak = (std::min)(bucket.minPeak, peak);
+                bucket.maxPeak = (std::max)(bucket.maxPeak, peak);
+            }
+            bucket.meanPeak += peak;
+            ++bucket.samples;
+            return true;
+        });
+    }
+
+    for (size_t i = first; i < out.size(); ++i) {
+        if (out[i].samples > 0) {
+            out[i].meanPeak /= static_cast<float>(out[i].samples);
+        }
+    }
+}
+
+size_t LevelSeries::DropOldestBlock() {
+    if (m_blocks.empty()) {
+        return 0;
+    }
+    const Block& block = m_blocks.front();
+    size_t bytes = sizeof(Block) + block.words.capacity() * sizeof(uint64_t);
+    m_sampleCount -= block.count;
+    m_bytes -= bytes;
+    m_blocks.pop_front();
+    return bytes;
+}
+
+float LevelSeries::GetLastVolume() const {
+    return BitsFloat(m_encoder.volume);
+}
+
+std::chrono::system_clock::time_point LevelSeries::GetOldestTime() const {
+    return m_blocks.empty() ? std::chrono::system_clock::time_point() : FromMilliseconds(m_blocks.front().firstTime);
+}
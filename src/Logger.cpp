@@ -1,12 +1,19 @@
 #include "../include/Logger.h"
-#define NOMINMAX  // Prevent Windows.h from defining min/max macros
-#include <windows.h>
+#include "../include/ArrowWriter.h"
+#include "../include/Utf8.h"
+#include "../include/Metrics.h"
+#include "../include/SpanTracer.h"
+#include "../include/TimestampClock.h"
 #include <sstream>
+#include <cstdio>
 #include <iomanip>
 #include <chrono>
 #include <ctime>
+#include <algorithm>
+#include <filesystem>
 
-Logger::Logger(const std::wstring& logDirectory) : m_basePath(logDirectory) {
+Logger::Logger(const std::wstring& logDirectory)
+    : m_basePath(logDirectory), m_arrowBatchRows(ArrowWriter::DEFAULT_BATCH_ROWS) {
 }
 
 Logger::~Logger() {
@@ -15,22 +22,21 @@ Logger::~Logger() {
 
 bool Logger::Initialize() {
     // Create log directory if it doesn't exist
-    CreateDirectoryW(m_basePath.c_str(), NULL);
+    std::error_code ec;
+    std::filesystem::create_directories(std::filesystem::path(m_basePath), ec);
     
     // Create log filename with timestamp
     auto now = std::chrono::system_clock::now();
-    std::wstring filename = m_basePath + L"\\sound_log_" + FormatTimestamp(now) + L".csv";
+    std::wstring filename = L"sound_log_" + Utf8ToWide(FormatTimestamp(now)) + L".csv";
     filename.erase(std::remove(filename.begin(), filename.end(), L':'), filename.end());
     filename.erase(std::remove(filename.begin(), filename.end(), L' '), filename.end());
+    std::filesystem::path logPath = std::filesystem::path(m_basePath) / filename;
     
     // Store filename for status display
-    m_currentLogPath = filename;
-    
-    // Convert wide filename to narrow for ofstream
-    std::string narrowFilename = WideToUTF8(filename);
+    m_currentLogPath = logPath.wstring();
     
     // Open file for UTF-8 output
-    m_currentLog.open(narrowFilename, std::ios::out | std::ios::binary);
+    m_currentLog.open(logPath, std::ios::out | std::ios::binary);
     if (!m_currentLog.is_open()) {
         return false;
     }
@@ -47,78 +53,126 @@ bool Logger::Initialize() {
     return true;
 }
 
-std::wstring Logger::FormatTimestamp(const std::chrono::system_clock::time_point& time) {
-    auto time_t = std::chrono::system_clock::to_time_t(time);
+std::string Logger::FormatTimestamp(const std::chrono::system_clock::time_point& time) {
+    std::string text;
+    AppendTimestamp(text, time);
+    return text;
+}
+
+void Logger::AppendTimestamp(std::string& out, const std::chrono::system_clock::time_point& time) {
     auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
         time.time_since_epoch()) % 1000;
     
-    std::tm tm = {};
-    if (localtime_s(&tm, &time_t) != 0) {
-        // Fallback to current time if conversion fails
-        auto now = std::chrono::system_clock::now();
-        time_t = std::chrono::system_clock::to_time_t(now);
-        localtime_s(&tm, &time_t);
-    }
-    
-    std::wostringstream oss;
-    oss << std::put_time(&tm, L"%Y-%m-%d %H:%M:%S");
-    oss << L"." << std::setfill(L'0') << std::setw(3) << ms.count();
+    std::tm tm;
+    TimestampClock::Instance().ToLocalTime(time, tm);
     
-    return oss.str();
+    char buffer[40];
+    size_t length = std::strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", &tm);
+    length += std::snprintf(buffer + length, sizeof(buffer) - length, ".%03d", static_cast<int>(ms.count()));
+    out.append(buffer, length);
 }
 
-std::wstring Logger::SanitizeForCSV(const std::wstring& input) {
-    std::wstring output = input;
-    
+std::string Logger::SanitizeForCSV(const std::string& input) {
+    std::string output;
+    AppendCsvField(output, input);
+    return output;
+}
+
+void Logger::AppendCsvField(std::string& out, const std::string& value) {
     // If contains comma, quote, or newline, wrap in quotes and escape quotes
-    if (output.find_first_of(L",\"\n\r") != std::wstring::npos) {
-        // Escape quotes
-        size_t pos = 0;
-        while ((pos = output.find(L"\"", pos)) != std::wstring::npos) {
-            output.replace(pos, 1, L"\"\"");
-            pos += 2;
+    if (value.find_first_of(",\"\n\r") == std::string::npos) {
+        out += value;
+        return;
+    }
+    out += '"';
+    for (char c : value) {
+        if (c == '"') {
+            out += '"';
         }
-        // Wrap in quotes
-        output = L"\"" + output + L"\"";
+        out += c;
     }
-    
-    return output;
+    out += '"';
+}
+
+std::string Logger::QuoteForJSON(const std::string& value) {
+    std::string out;
+    out.reserve(value.size() + 2);
+    out += '"';
+    for (char c : value) {
+        unsigned char byte = static_cast<unsigned char>(c);
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (byte < 0x20) {
+                    char escaped[8];
+                    std::snprintf(escaped, sizeof(escaped), "\\u%04x", byte);
+                    out += escaped;
+                } else {
+                    out += c;  // UTF-8 passes through
+                }
+        }
+    }
+    out += '"';
+    return out;
+}
+
+void Logger::AppendCsvRow(std::string& out, const AudioEvent& event) {
+    char number[32];
+    AppendTimestamp(out, event.timestamp);
+    out += ',';
+    out.append(number, std::snprintf(number, sizeof(number), "%lu,%lu,",
+                                     static_cast<unsigned long>(event.eventCount > 0 ? event.eventCount : 1),
+                                     static_cast<unsigned long>(event.processId)));
+    AppendCsvField(out, event.processName);
+    out += ',';
+    AppendCsvField(out, event.processPath);
+    out += ',';
+    AppendCsvField(out, event.soundDescription);
+    out += ',';
+    AppendCsvField(out, event.sessionDisplayName);
+    out += ',';
+    out.append(number, std::snprintf(number, sizeof(number), "%.2f%%,%.2f%%,",
+                                     static_cast<double>(event.volumeLevel * 100),
+                                     static_cast<double>(event.peakLevel * 100)));
+    out += event.isSystemSound ? "Yes," : "No,";
+    AppendCsvField(out, event.usbDeviceInfo);
+    out += ',';
+    AppendCsvField(out, event.browserTabInfo);
 }
 
 void Logger::LogEvent(const AudioEvent& event) {
-    std::lock_guard<std::mutex> lock(m_fileMutex);
+    TRACE_SPAN("LogEvent");
+    METRICS_GAUGE_ADD(LoggerQueueDepth, 1);
+    METRICS_TIMER_START(lockStart);
+    TracedLock lock(m_fileMutex, "Logger lock");
+    METRICS_TIMER_RECORD(LoggerLockWait, lockStart);
+    METRICS_TIMER_START(writeStart);
     
     if (!m_currentLog.is_open()) {
         Initialize();
     }
     
-    // Build the CSV line as a wide string first
-    std::wostringstream line;
-    line << FormatTimestamp(event.timestamp) << L","
-         << (event.eventCount > 0 ? event.eventCount : 1) << L","
-         << event.processId << L","
-         << SanitizeForCSV(event.processName) << L","
-         << SanitizeForCSV(event.processPath) << L","
-         << SanitizeForCSV(event.soundDescription) << L","
-         << SanitizeForCSV(event.sessionDisplayName) << L","
-         << std::fixed << std::setprecision(2) << (event.volumeLevel * 100) << L"%,"
-         << std::fixed << std::setprecision(2) << (event.peakLevel * 100) << L"%,"
-         << (event.isSystemSound ? L"Yes" : L"No") << L","
-         << SanitizeForCSV(event.usbDeviceInfo) << L","
-         << SanitizeForCSV(event.browserTabInfo) << L"\n";
+    // Strings are already UTF-8, so the line is written without conversion
+    m_line.clear();
+    AppendCsvRow(m_line, event);
+    m_line += '\n';
     
-    // Convert to UTF-8 and write
-    std::string utf8Line = WideToUTF8(line.str());
-    m_currentLog << utf8Line;
+    m_currentLog.write(m_line.data(), static_cast<std::streamsize>(m_line.size()));
     m_currentLog.flush();
+    METRICS_TIMER_RECORD(LoggerWrite, writeStart);
+    METRICS_COUNT(EventsLogged, 1);
+    METRICS_GAUGE_ADD(LoggerQueueDepth, -1);
 }
 
-void Logger::LogRawData(const std::wstring& data) {
+void Logger::LogRawData(const std::string& data) {
     std::lock_guard<std::mutex> lock(m_fileMutex);
     
     if (m_currentLog.is_open()) {
-        std::string utf8Data = WideToUTF8(data + L"\n");
-        m_currentLog << utf8Data;
+        m_currentLog << data << "\n";
         m_currentLog.flush();
     }
 }
@@ -126,7 +180,14 @@ void Logger::LogRawData(const std::wstring& data) {
 bool Logger::ExportEvents(const std::vector<AudioEvent>& events, 
                          const std::wstring& outputPath,
                          LogFormat format) {
-    std::wofstream output(outputPath);
+    TRACE_SPAN_ARG("ExportEvents", "events", events.size());
+    // Arrow is a binary format with its own writer
+    if (format == LogFormat::ARROW) {
+        ArrowWriter writer(m_arrowBatchRows);
+        return writer.WriteFile(events, outputPath);
+    }
+    
+    std::ofstream output{std::filesystem::path(outputPath)};
     if (!output.is_open()) {
         return false;
     }
@@ -134,9 +195,10 @@ bool Logger::ExportEvents(const std::vector<AudioEvent>& events,
     switch (format) {
         case LogFormat::CSV: {
             // Write header
-            output << L"Timestamp,EventCount,ProcessID,ProcessName,ProcessPath,Description,SessionName,VolumeLevel,PeakLevel,IsSystemSound,USBDevice,BrowserTab,Duration(ms)\n";
+            output << "Timestamp,EventCount,ProcessID,ProcessName,ProcessPath,Description,SessionName,VolumeLevel,PeakLevel,IsSystemSound,USBDevice,BrowserTab,Duration(ms)\n";
             
             // Calculate durations
+            std::string line;
             for (size_t i = 0; i < events.size(); ++i) {
                 const auto& event = events[i];
                 DWORD duration = 0;
@@ -153,70 +215,89 @@ bool Logger::ExportEvents(const std::vector<AudioEvent>& events,
                     }
                 }
                 
-                output << FormatTimestamp(event.timestamp) << L","
-                      << (event.eventCount > 0 ? event.eventCount : 1) << L","
-                      << event.processId << L","
-                      << SanitizeForCSV(event.processName) << L","
-                      << SanitizeForCSV(event.processPath) << L","
-                      << SanitizeForCSV(event.soundDescription) << L","
-                      << SanitizeForCSV(event.sessionDisplayName) << L","
-                      << std::fixed << std::setprecision(2) << (event.volumeLevel * 100) << L"%,"
-                      << std::fixed << std::setprecision(2) << (event.peakLevel * 100) << L"%,"
-                      << (event.isSystemSound ? L"Yes" : L"No") << L","
-                      << SanitizeForCSV(event.usbDeviceInfo) << L","
-                      << SanitizeForCSV(event.browserTabInfo) << L","
-                      << duration << L"\n";
+                line.clear();
+                AppendCsvRow(line, event);
+                line += ',';
+                line += std::to_string(duration);
+                line += '\n';
+                output.write(line.data(), static_cast<std::streamsize>(line.size()));
             }
             break;
         }
         
         case LogFormat::JSON: {
-            output << L"{\n  \"events\": [\n";
+            output << "{\n  \"events\": [\n";
             
             for (size_t i = 0; i < events.size(); ++i) {
                 const auto& event = events[i];
-                output << L"    {\n"
-                      << L"      \"timestamp\": \"" << FormatTimestamp(event.timestamp) << L"\",\n"
-                      << L"      \"eventCount\": " << (event.eventCount > 0 ? event.eventCount : 1) << L",\n"
-                      << L"      \"processId\": " << event.processId << L",\n"
-                      << L"      \"processName\": \"" << event.processName << L"\",\n"
-                      << L"      \"processPath\": \"" << event.processPath << L"\",\n"
-                      << L"      \"description\": \"" << event.soundDescription << L"\",\n"
-                      << L"      \"volumeLevel\": " << (event.volumeLevel * 100) << L",\n"
-                      << L"      \"peakLevel\": " << (event.peakLevel * 100) << L",\n"
-                      << L"      \"isSystemSound\": " << (event.isSystemSound ? L"true" : L"false") << L"\n"
-                      << L"    }";
+                output << "    {\n"
+                      << "      \"timestamp\": \"" << FormatTimestamp(event.timestamp) << "\",\n"
+                      << "      \"eventCount\": " << (event.eventCount > 0 ? event.eventCount : 1) << ",\n"
+                      << "      \"processId\": " << event.processId << ",\n"
+                      << "      \"processName\": " << QuoteForJSON(event.processName) << ",\n"
+                      << "      \"processPath\": " << QuoteForJSON(event.processPath) << ",\n"
+                      << "      \"description\": " << QuoteForJSON(event.soundDescription) << ",\n"
+                      << "      \"volumeLevel\": " << (event.volumeLevel * 100) << ",\n"
+                      << "      \"peakLevel\": " << (event.peakLevel * 100) << ",\n"
+                      << "      \"isSystemSound\": " << (event.isSystemSound ? "true" : "false");
+                if (!event.soundLabel.empty()) {
+                    output << ",\n      \"soundLabel\": " << QuoteForJSON(event.soundLabel);
+                }
+                if (!event.endpointId.empty()) {
+                    output << ",\n      \"endpointId\": " << QuoteForJSON(event.endpointId);
+                }
+                if (HasLoudness(event)) {
+                    output << ",\n      \"loudness\": { \"momentaryLufs\": " << event.momentaryLoudness
+                           << ", \"shortTermLufs\": " << event.shortTermLoudness << " }";
+                }
+                if (event.features.frames > 0) {
+                    const SoundFeatures& features = event.features;
+                    output << ",\n      \"features\": { \"frames\": " << features.frames
+                           << ", \"rms\": " << features.rms
+                           << ", \"centroidHz\": " << features.centroidHz
+                           << ", \"flux\": " << features.flux
+                           << ", \"zeroCrossingRate\": " << features.zeroCrossingRate
+                           << ", \"mfcc\": [";
+                    for (size_t m = 0; m < SoundFeatures::MFCC_COUNT; ++m) {
+                        output << (m > 0 ? ", " : "") << features.mfcc[m];
+                    }
+                    output << "] }";
+                }
+                output << "\n    }";
                 
                 if (i < events.size() - 1) {
-                    output << L",";
+                    output << ",";
                 }
-                output << L"\n";
+                output << "\n";
             }
             
-            output << L"  ]\n}\n";
+            output << "  ]\n}\n";
             break;
         }
         
         case LogFormat::TEXT: {
-            output << L"Windows Sound Tracker Log\n";
-            output << L"=========================\n\n";
+            output << "Windows Sound Tracker Log\n";
+            output << "=========================\n\n";
             
             for (const auto& event : events) {
-                output << L"Time: " << FormatTimestamp(event.timestamp);
+                output << "Time: " << FormatTimestamp(event.timestamp);
                 if (event.eventCount > 1) {
-                    output << L" (" << event.eventCount << L" events)";
+                    output << " (" << event.eventCount << " events)";
                 }
-                output << L"\n"
-                      << L"Process: " << event.processName << L" (PID: " << event.processId << L")\n"
-                      << L"Path: " << event.processPath << L"\n"
-                      << L"Description: " << event.soundDescription << L"\n"
-                      << L"Volume: " << std::fixed << std::setprecision(1) << (event.volumeLevel * 100) << L"%"
-                      << L" | Peak: " << (event.peakLevel * 100) << L"%\n"
-                      << L"System Sound: " << (event.isSystemSound ? L"Yes" : L"No") << L"\n"
-                      << L"---\n\n";
+                output << "\n"
+                      << "Process: " << event.processName << " (PID: " << event.processId << ")\n"
+                      << "Path: " << event.processPath << "\n"
+                      << "Description: " << event.soundDescription << "\n"
+                      << "Volume: " << std::fixed << std::setprecision(1) << (event.volumeLevel * 100) << "%"
+                      << " | Peak: " << (event.peakLevel * 100) << "%\n"
+                      << "System Sound: " << (event.isSystemSound ? "Yes" : "No") << "\n"
+                      << "---\n\n";
             }
             break;
         }
+        
+        case LogFormat::ARROW:
+            break;  // Handled above
     }
     
     output.close();
@@ -229,17 +310,3 @@ void Logger::Close() {
         m_currentLog.close();
     }
 }
-
-std::string Logger::WideToUTF8(const std::wstring& wide) {
-    if (wide.empty()) return std::string();
-    
-    // Get required buffer size
-    int size = WideCharToMultiByte(CP_UTF8, 0, wide.c_str(), -1, nullptr, 0, nullptr, nullptr);
-    if (size <= 0) return std::string();
-    
-    // Convert
-    std::string utf8(size - 1, 0);
-    WideCharToMultiByte(CP_UTF8, 0, wide.c_str(), -1, &utf8[0], size, nullptr, nullptr);
-    
-    return utf8;
-}
\ No newline at end of file
@@ -0,0 +1,302 @@
+#include "../include/LoopbackCapture.h"
+#include "../include/SpanTracer.h"
+#include <mmdeviceapi.h>
+#include <audioclient.h>
+#include <mmreg.h>
+#include <ks.h>
+#include <ksmedia.h>
+#include <cmath>
+
+namespace {
+
+const REFERENCE_TIME BUFFER_DURATION = 10000000;  // 1 s in 100 ns units
+const DWORD POLL_MS = 10;
+const std::chrono::milliseconds HISTORY(1000);
+const std::chrono::milliseconds RECENT(250);
+const float SILENCE_RMS = 1e-4f;  // Quieter frames are not merged into features
+const unsigned MATCHES_PER_SECOND = 4;
+const std::chrono::milliseconds LABEL_LIFETIME(1000);
+
+// Wall-clock time of a packet's first frame from its QPC position (100 ns
+// units), or of its arrival if the position is unreliable
+std::chrono::system_clock::time_point PacketTime(UINT64 qpcPosition, DWORD flags) {
+    auto now = std::chrono::system_clock::now();
+    LARGE_INTEGER counter, frequency;
+    if ((flags & AUDCLNT_BUFFERFLAGS_TIMESTAMP_ERROR) || qpcPosition == 0 ||
+        !QueryPerformanceCounter(&counter) || !QueryPerformanceFrequency(&frequency)) {
+        return now;
+    }
+    // Split to keep counter * 10^7 from overflowing
+    int64_t counterUnits = counter.QuadPart / frequency.QuadPart * 10000000 +
+                           counter.QuadPart % frequency.QuadPart * 10000000 / frequency.QuadPart;
+    int64_t age = counterUnits - static_cast<int64_t>(qpcPosition);
+    if (age <= 0) {
+        return now;
+    }
+    return now - std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::nanoseconds(age * 100));
+}
+
+} // namespace
+
+LoopbackCapture::LoopbackCapture()
+    : m_running(false), m_momentaryLoudness(LOUDNESS_FLOOR_LUFS), m_shortTermLoudness(LOUDNESS_FLOOR_LUFS) {
+}
+
+LoopbackCapture::~LoopbackCapture() {
+    Stop();
+}
+
+bool LoopbackCapture::Start() {
+    if (m_running) {
+        return true;
+    }
+    std::promise<bool> started;
+    std::future<bool> result = started.get_future();
+    m_running = true;
+    m_thread = std::thread(&LoopbackCapture::CaptureLoop, this, &started);
+    if (!result.get()) {
+        m_thread.join();
+        m_running = false;
+        return false;
+    }
+    return true;
+}
+
+void LoopbackCapture::Stop() {
+    m_running = false;
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_frames.clear();
+    m_label.clear();
+    m_onsets.clear();
+    m_momentaryLoudness = LOUDNESS_FLOOR_LUFS;
+    m_shortTermLoudness = LOUDNESS_FLOOR_LUFS;
+}
+
+void LoopbackCapture::CaptureLoop(std::promise<bool>* started) {
+    SpanTracer::SetThreadName("Loopback");
+    HRESULT hr = CoInitializeEx(NULL, COINIT_MULTITHREADED);
+    bool comInitialized = SUCCEEDED(hr);
+
+    IMMDeviceEnumerator* pEnumerator = nullptr;
+    IMMDevice* pDevice = nullptr;
+    IAudioClient* pClient = nullptr;
+    IAudioCaptureClient* pCapture = nullptr;
+    WAVEFORMATEX* pFormat = nullptr;
+    bool isFloat = false;
+
+    hr = CoCreateInstance(__uuidof(MMDeviceEnumerator), NULL, CLSCTX_ALL,
+                          __uuidof(IMMDeviceEnumerator), (void**)&pEnumerator);
+    if (SUCCEEDED(hr)) {
+        hr = pEnumerator->GetDefaultAudioEndpoint(eRender, eConsole, &pDevice);
+    }
+    if (SUCCEEDED(hr)) {
+        hr = pDevice->Activate(__uuidof(IAudioClient), CLSCTX_ALL, NULL, (void**)&pClient);
+    }
+    if (SUCCEEDED(hr)) {
+        hr = pClient->GetMixFormat(&pFormat);
+    }
+    if (SUCCEEDED(hr)) {
+        // The shared-mode mix format is float in practice; 16-bit PCM is handled too
+        const WAVEFORMATEXTENSIBLE* pExtensible = reinterpret_cast<const WAVEFORMATEXTENSIBLE*>(pFormat);
+        bool extensible = pFormat->wFormatTag == WAVE_FORMAT_EXTENSIBLE && pFormat->cbSize >= 22;
+        isFloat = pFormat->wFormatTag == WAVE_FORMAT_IEEE_FLOAT ||
+                  (extensible && IsEqualGUID(pExtensible->SubFormat, KSDATAFORMAT_SUBTYPE_IEEE_FLOAT));
+        bool isPcm = pFormat->wFormatTag == WAVE_FORMAT_PCM ||
+                     (extensible && IsEqualGUID(pExtensible->SubFormat, KSDATAFORMAT_SUBTYPE_PCM));
+        if (!(isFloat && pFormat->wBitsPerSample == 32) && !(isPcm && pFormat->wBitsPerSample == 16)) {
+            hr = E_FAIL;
+        }
+    }
+    if (SUCCEEDED(hr)) {
+        hr = pClient->Initialize(AUDCLNT_SHAREMODE_SHARED, AUDCLNT_STREAMFLAGS_LOOPBACK,
+                                 BUFFER_DURATION, 0, pFormat, NULL);
+    }
+    if (SUCCEEDED(hr)) {
+        hr = pClient->GetService(__uuidof(IAudioCaptureClient), (void**)&pCapture);
+    }
+    if (SUCCEEDED(hr)) {
+        hr = pClient->Start();
+    }
+    started->set_value(SUCCEEDED(hr));
+
+    if (SUCCEEDED(hr)) {
+        const WORD channels = pFormat->nChannels;
+        const uint32_t sampleRate = pFormat->nSamplesPerSec;
+        SpectralAnalyzer analyzer(sampleRate);
+        OnsetDetector onsetDetector(sampleRate);
+        LoudnessMeter loudness(sampleRate, channels);
+        std::vector<float> interleaved;
+        std::vector<float> mono;
+        std::vector<SoundFeatures> frames;
+        std::vector<uint64_t> onsets;
+        // The last second of audio, a circular buffer, and the same in order for matching
+        std::vector<float> history(sampleRate, 0.0f);
+        std::vector<float> recent;
+        size_t historyPosition = 0;
+        size_t sinceMatch = 0;
+
+        while (m_running) {
+            Sleep(POLL_MS);
+            UINT32 packetFrames = 0;
+            while (m_running && SUCCEEDED(pCapture->GetNextPacketSize(&packetFrames)) && packetFrames > 0) {
+                BYTE* pData = nullptr;
+                UINT32 frameCount = 0;
+                DWORD flags = 0;
+                UINT64 qpcPosition = 0;
+                if (FAILED(pCapture->GetBuffer(&pData, &frameCount, &flags, NULL, &qpcPosition))) {
+                    break;
+                }
+                auto packetTime = PacketTime(qpcPosition, flags);
+
+                // A silent packet's buffer is to be ignored
+                size_t sampleCount = static_cast<size_t>(frameCount) * channels;
+                interleaved.assign(sampleCount, 0.0f);
+                if (!(flags & AUDCLNT_BUFFERFLAGS_SILENT)) {
+                    for (size_t i = 0; i < sampleCount; ++i) {
+                        interleaved[i] = isFloat ? reinterpret_cast<const float*>(pData)[i]
+                                                 : reinterpret_cast<const int16_t*>(pData)[i] / 32768.0f;
+                    }
+                }
+                pCapture->ReleaseBuffer(frameCount);
+                loudness.Push(interleaved.data(), frameCount);
+
+                // Everything else runs on a mono downmix
+                mono.assign(frameCount, 0.0f);
+                for (UINT32 i = 0; i < frameCount; ++i) {
+                    float sum = 0.0f;
+                    for (WORD c = 0; c < channels; ++c) {
+                        sum += interleaved[i * channels + c];
+                    }
+                    mono[i] = sum / channels;
+                }
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    m_momentaryLoudness = loudness.GetMomentary();
+                    m_shortTermLoudness = loudness.GetShortTerm();
+                }
+
+                for (float sample : mono) {
+                    history[historyPosition] = sample;
+                    historyPosition = historyPosition + 1 == history.size() ? 0 : historyPosition + 1;
+                }
+                sinceMatch += mono.size();
+                if (sinceMatch >= sampleRate / MATCHES_PER_SECOND) {
+                    sinceMatch = 0;
+                    auto split = history.begin() + static_cast<ptrdiff_t>(historyPosition);
+                    recent.assign(split, history.end());
+                    recent.insert(recent.end(), history.begin(), split);
+                    Recognize(recent, sampleRate);
+                }
+
+                // Onsets may lie a hop back, in the previous packet
+                uint64_t packetStart = onsetDetector.GetPosition();
+                onsets.clear();
+                onsetDetector.Push(mono.data(), mono.size(), onsets);
+                frames.clear();
+                analyzer.Push(mono.data(), mono.size(), frames);
+                if (frames.empty() && onsets.empty()) {
+                    continue;
+                }
+                auto now = std::chrono::steady_clock::now();
+                auto wallNow = std::chrono::system_clock::now();
+                std::lock_guard<std::mutex> lock(m_mutex);
+                for (const SoundFeatures& features : frames) {
+                    m_frames.push_back({ now, features });
+                }
+                while (!m_frames.empty() && now - m_frames.front().time > HISTORY) {
+                    m_frames.pop_front();
+                }
+                for (uint64_t onset : onsets) {
+                    int64_t offset = static_cast<int64_t>(onset) - static_cast<int64_t>(packetStart);
+                    m_onsets.push_back(packetTime + std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                        std::chrono::nanoseconds(offset * 1000000000 / sampleRate)));
+                }
+                while (!m_onsets.empty() && wallNow - m_onsets.front() > HISTORY) {
+                    m_onsets.pop_front();
+                }
+            }
+        }
+        pClient->Stop();
+    }
+
+    if (pCapture) pCapture->Release();
+    if (pFormat) CoTaskMemFree(pFormat);
+    if (pClient) pClient->Release();
+    if (pDevice) pDevice->Release();
+    if (pEnumerator) pEnumerator->Release();
+    if (comInitialized) {
+        CoUninitialize();
+    }
+}
+
+void LoopbackCapture::Recognize(const std::vector<float>& recent, uint32_t sampleRate) {
+    float energy = 0.0f;
+    for (float sample : recent) {
+        energy += sample * sample;
+    }
+    if (recent.empty() || std::sqrt(energy / recent.size()) < SILENCE_RMS) {
+        return;
+    }
+
+    FingerprintMatch match;
+    {
+        std::lock_guard<std::mutex> lock(m_libraryMutex);
+        if (!m_library || !m_library->Match(recent.data(), recent.size(), sampleRate, match)) {
+            return;
+        }
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_label = match.name;
+    m_labelTime = std::chrono::steady_clock::now();
+}
+
+void LoopbackCapture::SetSoundLibrary(std::unique_ptr<FingerprintIndex> library) {
+    std::lock_guard<std::mutex> lock(m_libraryMutex);
+    m_library = std::move(library);
+}
+
+bool LoopbackCapture::GetRecentSoundLabel(std::string& label) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_label.empty() || std::chrono::steady_clock::now() - m_labelTime > LABEL_LIFETIME) {
+        return false;
+    }
+    label = m_label;
+    return true;
+}
+
+bool LoopbackCapture::GetRecentFeatures(SoundFeatures& features) const {
+    auto since = std::chrono::steady_clock::now() - RECENT;
+    SoundFeatures recent;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto it = m_frames.rbegin(); it != m_frames.rend() && it->time >= since; ++it) {
+        if (it->features.rms >= SILENCE_RMS) {
+            MergeSoundFeatures(recent, it->features);
+        }
+    }
+    if (recent.frames == 0) {
+        return false;
+    }
+    features = recent;
+    return true;
+}
+
+bool LoopbackCapture::GetFirstOnsetSince(std::chrono::system_clock::time_point since,
+                                         std::chrono::system_clock::time_point& onset) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto time : m_onsets) {
+        if (time >= since) {
+            onset = time;
+            return true;
+        }
+    }
+    return false;
+}
+
+void LoopbackCapture::GetLoudness(float& momentary, float& shortTerm) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    momentary = m_momentaryLoudness;
+    shortTerm = m_shortTermLoudness;
+}
@@ -0,0 +1,325 @@
+#include "../include/LoudnessMeter.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LOUDNESS_USE_SSE2
+#include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define LOUDNESS_USE_NEON
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+const double PI = 3.14159265358979323846;
+const float BIN_WIDTH = 0.1f;            // LU
+const double ABSOLUTE_GATE_OFFSET = 0.691;  // BS.1770's -0.691 dB calibration
+const double INTEGRATED_GATE = 10.0;     // LU below the ungated mean
+const double RANGE_GATE = 20.0;
+const double RANGE_LOW = 0.10;           // Percentiles of the range
+const double RANGE_HIGH = 0.95;
+const double DENORMAL = 1e-30;           // Filter state this small is flushed to zero
+
+float PowerToLufs(double power) {
+    if (!(power > 0.0)) {
+        return LOUDNESS_FLOOR_LUFS;
+    }
+    double lufs = -ABSOLUTE_GATE_OFFSET + 10.0 * std::log10(power);
+    return lufs > LOUDNESS_FLOOR_LUFS ? static_cast<float>(lufs) : LOUDNESS_FLOOR_LUFS;
+}
+
+double LufsToPower(float lufs) {
+    return std::pow(10.0, (lufs + ABSOLUTE_GATE_OFFSET) / 10.0);
+}
+
+// Histogram bin of a value above the floor; louder than the top bin lands in it
+size_t Bin(float lufs) {
+    size_t bin = static_cast<size_t>((lufs - LOUDNESS_FLOOR_LUFS) / BIN_WIDTH);
+    return bin < LoudnessStats::BINS ? bin : LoudnessStats::BINS - 1;
+}
+
+float BinCenter(size_t bin) {
+    return LOUDNESS_FLOOR_LUFS + (static_cast<float>(bin) + 0.5f) * BIN_WIDTH;
+}
+
+// Mean-square loudness of the bins from first on
+float GatedMean(const std::vector<uint32_t>& counts, const std::vector<double>& energy, size_t first,
+                uint64_t& count) {
+    double total = 0.0;
+    count = 0;
+    for (size_t bin = first; bin < counts.size(); ++bin) {
+        total += energy[bin];
+        count += counts[bin];
+    }
+    return count > 0 ? PowerToLufs(total / static_cast<double>(count)) : LOUDNESS_FLOOR_LUFS;
+}
+
+// First bin a relative gate keeps: the one holding the gate and all above
+size_t GateBin(float gate) {
+    return gate > LOUDNESS_FLOOR_LUFS ? Bin(gate) : 0;
+}
+
+// BS.1770 channel weights; 5.1 and 7.1 in WAVEFORMATEXTENSIBLE order are
+// L R C LFE and then the surrounds
+double ChannelWeight(uint32_t channel, uint32_t channels) {
+    if (channels == 6 || channels == 8) {
+        if (channel == 3) return 0.0;
+        if (channel >= 4) return 1.41;
+    }
+    return 1.0;
+}
+
+// Runs count frames of lane-interleaved input through both K-weighting
+// stages (biquads in transposed direct form II), adding each lane's squared
+// output to energy. c holds b0, b1, b2, a1, a2 per stage; state holds z1
+// and z2 of each stage for each pair of lanes.
+void KWeight(const double* input, size_t count, size_t lanes, const double* c, double* state, double* energy) {
+#if defined(LOUDNESS_USE_SSE2)
+    const __m128d b10 = _mm_set1_pd(c[0]), b11 = _mm_set1_pd(c[1]), b12 = _mm_set1_pd(c[2]);
+    const __m128d a11 = _mm_set1_pd(c[3]), a12 = _mm_set1_pd(c[4]);
+    const __m128d b20 = _mm_set1_pd(c[5]), b21 = _mm_set1_pd(c[6]), b22 = _mm_set1_pd(c[7]);
+    const __m128d a21 = _mm_set1_pd(c[8]), a22 = _mm_set1_pd(c[9]);
+    for (size_t lane = 0; lane < lanes; lane += 2) {
+        double* s = state + lane * 4;
+        __m128d z11 = _mm_loadu_pd(s), z12 = _mm_loadu_pd(s + 2);
+        __m128d z21 = _mm_loadu_pd(s + 4), z22 = _mm_loadu_pd(s + 6);
+        __m128d e = _mm_loadu_pd(energy + lane);
+        for (size_t f = 0; f < count; ++f) {
+            __m128d x = _mm_loadu_pd(input + f * lanes + lane);
+            __m128d y = _mm_add_pd(_mm_mul_pd(b10, x), z11);
+            z11 = _mm_add_pd(_mm_sub_pd(_mm_mul_pd(b11, x), _mm_mul_pd(a11, y)), z12);
+            z12 = _mm_sub_pd(_mm_mul_pd(b12, x), _mm_mul_pd(a12, y));
+            __m128d w = _mm_add_pd(_mm_mul_pd(b20, y), z21);
+            z21 = _mm_add_pd(_mm_sub_pd(_mm_mul_pd(b21, y), _mm_mul_pd(a21, w)), z22);
+            z22 = _mm_sub_pd(_mm_mul_pd(b22, y), _mm_mul_pd(a22, w));
+            e = _mm_add_pd(e, _mm_mul_pd(w, w));
+        }
+        _mm_storeu_pd(s, z11);
+        _mm_storeu_pd(s + 2, z12);
+        _mm_storeu_pd(s + 4, z21);
+        _mm_storeu_pd(s + 6, z22);
+        _mm_storeu_pd(energy + lane, e);
+    }
+#elif defined(LOUDNESS_USE_NEON)
+    const float64x2_t b10 = vdupq_n_f64(c[0]), b11 = vdupq_n_f64(c[1]), b12 = vdupq_n_f64(c[2]);
+    const float64x2_t a11 = vdupq_n_f64(c[3]), a12 = vdupq_n_f64(c[4]);
+    const float64x2_t b20 = vdupq_n_f64(c[5]), b21 = vdupq_n_f64(c[6]), b22 = vdupq_n_f64(c[7]);
+    const float64x2_t a21 = vdupq_n_f64(c[8]), a22 = vdupq_n_f64(c[9]);
+    for (size_t lane = 0; lane < lanes; lane += 2) {
+        double* s = state + lane * 4;
+        float64x2_t z11 = vld1q_f64(s), z12 = vld1q_f64(s + 2);
+        float64x2_t z21 = vld1q_f64(s + 4), z22 = vld1q_f64(s + 6);
+        float64x2_t e = vld1q_f64(energy + lane);
+        for (size_t f = 0; f < count; ++f) {
+            float64x2_t x = vld1q_f64(input + f * lanes + lane);
+            float64x2_t y = vaddq_f64(vmulq_f64(b10, x), z11);
+            z11 = vaddq_f64(vsubq_f64(vmulq_f64(b11, x), vmulq_f64(a11, y)), z12);
+            z12 = vsubq_f64(vmulq_f64(b12, x), vmulq_f64(a12, y));
+            float64x2_t w = vaddq_f64(vmulq_f64(b20, y), z21);
+            z21 = vaddq_f64(vsubq_f64(vmulq_f64(b21, y), vmulq_f64(a21, w)), z22);
+            z22 = vsubq_f64(vmulq_f64(b22, y), vmulq_f64(a22, w));
+            e = vaddq_f64(e, vmulq_f64(w, w));
+        }
+        vst1q_f64(s, z11);
+        vst1q_f64(s + 2, z12);
+        vst1q_f64(s + 4, z21);
+        vst1q_f64(s + 6, z22);
+        vst1q_f64(energy + lane, e);
+    }
+#else
+    for (size_t lane = 0; lane < lanes; ++lane) {
+        double* s = state + (lane / 2) * 8 + lane % 2;
+        double z11 = s[0], z12 = s[2], z21 = s[4], z22 = s[6];
+        double e = energy[lane];
+        for (size_t f = 0; f < count; ++f) {
+            double x = input[f * lanes + lane];
+            double y = c[0] * x + z11;
+            z11 = c[1] * x - c[3] * y + z12;
+            z12 = c[2] * x - c[4] * y;
+            double w = c[5] * y + z21;
+            z21 = c[6] * y - c[8] * w + z22;
+            z22 = c[7] * y - c[9] * w;
+            e += w * w;
+        }
+        s[0] = z11;
+        s[2] = z12;
+        s[4] = z21;
+        s[6] = z22;
+        energy[lane] = e;
+    }
+#endif
+}
+
+} // namespace
+
+LoudnessStats::LoudnessStats()
+    : m_blockCounts(BINS), m_blockEnergy(BINS), m_shortTermCounts(BINS), m_shortTermEnergy(BINS) {
+}
+
+void LoudnessStats::AddBlock(float lufs) {
+    if (lufs > LOUDNESS_FLOOR_LUFS) {
+        size_t bin = Bin(lufs);
+        ++m_blockCounts[bin];
+        m_blockEnergy[bin] += LufsToPower(lufs);
+    }
+}
+
+void LoudnessStats::AddShortTerm(float lufs) {
+    if (lufs > LOUDNESS_FLOOR_LUFS) {
+        size_t bin = Bin(lufs);
+        ++m_shortTermCounts[bin];
+        m_shortTermEnergy[bin] += LufsToPower(lufs);
+    }
+}
+
+void LoudnessStats::Clear() {
+    std::fill(m_blockCounts.begin(), m_blockCounts.end(), 0u);
+    std::fill(m_blockEnergy.begin(), m_blockEnergy.end(), 0.0);
+    std::fill(m_shortTermCounts.begin(), m_shortTermCounts.end(), 0u);
+    std::fill(m_shortTermEnergy.begin(), m_shortTermEnergy.end(), 0.0);
+}
+
+float LoudnessStats::GetIntegrated() const {
+    uint64_t count = 0;
+    float ungated = GatedMean(m_blockCounts, m_blockEnergy, 0, count);
+    if (count == 0) {
+        return LOUDNESS_FLOOR_LUFS;
+    }
+    return GatedMean(m_blockCounts, m_blockEnergy, GateBin(ungated - static_cast<float>(INTEGRATED_GATE)), count);
+}
+
+float LoudnessStats::GetRange() const {
+    uint64_t count = 0;
+    float ungated = GatedMean(m_shortTermCounts, m_shortTermEnergy, 0, count);
+    if (count == 0) {
+        return 0.0f;
+    }
+    size_t first = GateBin(ungated - static_cast<float>(RANGE_GATE));
+    GatedMean(m_shortTermCounts, m_shortTermEnergy, first, count);
+
+    // Values at these ranks, counting from 0, in loudness order
+    uint64_t lowRank = static_cast<uint64_t>(std::llround((count - 1) * RANGE_LOW));
+    uint64_t highRank = static_cast<uint64_t>(std::llround((count - 1) * RANGE_HIGH));
+    float low = 0.0f, high = 0.0f;
+    uint64_t seen = 0;
+    for (size_t bin = first; bin < BINS; ++bin) {
+        uint64_t next = seen + m_shortTermCounts[bin];
+        if (seen <= lowRank && lowRank < next) low = BinCenter(bin);
+        if (seen <= highRank && highRank < next) {
+            high = BinCenter(bin);
+            break;
+        }
+        seen = next;
+    }
+    return high - low;
+}
+
+LoudnessMeter::LoudnessMeter(uint32_t sampleRate, uint32_t channels)
+    : m_sampleRate(sampleRate), m_channels(channels), m_lanes((channels + 1) / 2 * 2),
+      m_stepSize(sampleRate / STEPS_PER_SECOND > 0 ? sampleRate / STEPS_PER_SECOND : 1) {
+    m_state.resize(m_lanes * 4);
+    m_energy.resize(m_lanes);
+    m_input.resize(m_stepSize * m_lanes);
+    m_weights.resize(m_lanes);
+    for (uint32_t channel = 0; channel < channels; ++channel) {
+        m_weights[channel] = ChannelWeight(channel, channels);
+    }
+
+    // BS.1770 gives the filters at 48 kHz; these are the same analog
+    // prototypes through the bilinear transform at any rate. Stage 1 is the
+    // high shelf modeling the head, stage 2 the RLB high-pass.
+    double rate = sampleRate > 0 ? sampleRate : 48000;
+    double k = std::tan(PI * 1681.974450955533 / rate);
+    double q = 0.7071752369554196;
+    double vh = std::pow(10.0, 3.999843853973347 / 20.0);
+    double vb = std::pow(vh, 0.4996667741545416);
+    double a0 = 1.0 + k / q + k * k;
+    m_coefficients[0] = (vh + vb * k / q + k * k) / a0;
+    m_coefficients[1] = 2.0 * (k * k - vh) / a0;
+    m_coefficients[2] = (vh - vb * k / q + k * k) / a0;
+    m_coefficients[3] = 2.0 * (k * k - 1.0) / a0;
+    m_coefficients[4] = (1.0 - k / q + k * k) / a0;
+
+    k = std::tan(PI * 38.13547087602444 / rate);
+    q = 0.5003270373238773;
+    a0 = 1.0 + k / q + k * k;
+    m_coefficients[5] = 1.0;
+    m_coefficients[6] = -2.0;
+    m_coefficients[7] = 1.0;
+    m_coefficients[8] = 2.0 * (k * k - 1.0) / a0;
+    m_coefficients[9] = (1.0 - k / q + k * k) / a0;
+
+    Reset();
+}
+
+void LoudnessMeter::Reset() {
+    std::fill(m_state.begin(), m_state.end(), 0.0);
+    std::fill(m_energy.begin(), m_energy.end(), 0.0);
+    std::fill(m_input.begin(), m_input.end(), 0.0);
+    for (size_t i = 0; i < SHORT_TERM_STEPS; ++i) {
+        m_steps[i] = 0.0;
+    }
+    m_stepFilled = 0;
+    m_nextStep = 0;
+    m_stepCount = 0;
+    m_momentary = LOUDNESS_FLOOR_LUFS;
+    m_shortTerm = LOUDNESS_FLOOR_LUFS;
+    m_stats.Clear();
+}
+
+void LoudnessMeter::Push(const float* interleaved, size_t frames) {
+    while (frames > 0) {
+        size_t take = (std::min)(frames, m_stepSize - m_stepFilled);
+        // Padding lanes are never written and stay zero
+        for (size_t f = 0; f < take; ++f) {
+            for (uint32_t channel = 0; channel < m_channels; ++channel) {
+                m_input[f * m_lanes + channel] = interleaved[f * m_channels + channel];
+            }
+        }
+        KWeight(m_input.data(), take, m_lanes, m_coefficients, m_state.data(), m_energy.data());
+        interleaved += take * m_channels;
+        frames -= take;
+        m_stepFilled += take;
+        if (m_stepFilled == m_stepSize) {
+            FinishStep();
+        }
+    }
+}
+
+void LoudnessMeter::FinishStep() {
+    double power = 0.0;
+    for (size_t lane = 0; lane < m_lanes; ++lane) {
+        power += m_weights[lane] * m_energy[lane];
+        m_energy[lane] = 0.0;
+    }
+    m_steps[m_nextStep] = power / static_cast<double>(m_stepSize);
+    m_nextStep = (m_nextStep + 1) % SHORT_TERM_STEPS;
+    m_stepFilled = 0;
+    ++m_stepCount;
+
+    // Steps before the stream started count as silence
+    double momentary = 0.0, shortTerm = 0.0;
+    for (size_t i = 0; i < SHORT_TERM_STEPS; ++i) {
+        double step = m_steps[(m_nextStep + SHORT_TERM_STEPS - 1 - i) % SHORT_TERM_STEPS];
+        shortTerm += step;
+        if (i < MOMENTARY_STEPS) {
+            momentary += step;
+        }
+    }
+    m_momentary = PowerToLufs(momentary / MOMENTARY_STEPS);
+    m_shortTerm = PowerToLufs(shortTerm / SHORT_TERM_STEPS);
+    if (m_stepCount >= MOMENTARY_STEPS) {
+        m_stats.AddBlock(m_momentary);
+    }
+    if (m_stepCount >= SHORT_TERM_STEPS) {
+        m_stats.AddShortTerm(m_shortTerm);
+    }
+
+    // A decaying filter would otherwise crawl through denormals in silence
+    for (double& z : m_state) {
+        if (std::fabs(z) < DENORMAL) {
+            z = 0.0;
+        }
+    }
+}
@@ -0,0 +1,47 @@
+#include "../include/MeterGate.h"
+#include "../include/Metrics.h"
+#include <algorithm>
+
+MeterGate::MeterGate(float threshold, uint32_t holdOffMilliseconds)
+    : m_threshold(threshold), m_holdOff(holdOffMilliseconds), m_open(true), m_reads(0), m_skipped(0),
+      m_endpointReads(0) {
+}
+
+void MeterGate::BeginTick(float endpointPeak, TimestampClock::Tick now) {
+    ++m_endpointReads;
+    m_open = endpointPeak > m_threshold;
+    m_held.erase(std::remove_if(m_held.begin(), m_held.end(),
+                                [now](const std::pair<DWORD, TimestampClock::Tick>& held) {
+                                    return held.second <= now;
+                                }),
+                 m_held.end());
+}
+
+bool MeterGate::ShouldRead(DWORD processId, TimestampClock::Tick now) {
+    bool read = m_open || std::any_of(m_held.begin(), m_held.end(),
+                                      [&](const std::pair<DWORD, TimestampClock::Tick>& held) {
+                                          return held.first == processId && held.second > now;
+                                      });
+    if (read) {
+        ++m_reads;
+        METRICS_COUNT(SessionMetersRead, 1);
+    } else {
+        ++m_skipped;
+        METRICS_COUNT(SessionMetersSkipped, 1);
+    }
+    return read;
+}
+
+void MeterGate::Report(DWORD processId, float peak, TimestampClock::Tick now) {
+    if (!(peak > m_threshold)) {
+        return;
+    }
+    auto until = now + m_holdOff;
+    for (auto& held : m_held) {
+        if (held.first == processId) {
+            held.second = until;
+            return;
+        }
+    }
+    m_held.push_back(std::make_pair(processId, until));
+}
@@ -0,0 +1,359 @@
+#include "../include/Metrics.h"
+#include "../include/SpanTracer.h"
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <ctime>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace {
+
+const size_t COUNTER_COUNT = static_cast<size_t>(MetricCounter::Count);
+const size_t HISTOGRAM_COUNT = static_cast<size_t>(MetricHistogram::Count);
+const size_t GAUGE_COUNT = static_cast<size_t>(MetricGauge::Count);
+
+const char* const COUNTER_NAMES[COUNTER_COUNT] = {
+    "samples_received", "samples_coalesced", "events_added", "events_batched", "events_dropped", "events_evicted",
+    "events_spilled", "events_sealed", "events_logged", "session_meters_read", "session_meters_skipped",
+    "events_ignored", "rule_alerts"
+};
+const char* const HISTOGRAM_NAMES[HISTOGRAM_COUNT] = {
+    "callback_to_store_ns", "enrich_process_name_ns", "enrich_process_path_ns", "enrich_description_ns",
+    "enrich_usb_ns", "enrich_browser_tab_ns", "store_lock_wait_ns", "logger_lock_wait_ns", "logger_write_ns",
+    "endpoint_poll_ns"
+};
+const char* const GAUGE_NAMES[GAUGE_COUNT] = {
+    "store_events", "store_memory_bytes", "store_spilled_events", "store_spill_bytes",
+    "level_samples", "level_memory_bytes", "logger_queue_depth"
+};
+
+int HighestBit(uint64_t value) {
+#ifdef _MSC_VER
+    unsigned long index = 0;
+    _BitScanReverse64(&index, value);
+    return static_cast<int>(index);
+#else
+    return 63 - __builtin_clzll(value);
+#endif
+}
+
+// Only the owning thread writes its block, so plain load/store pairs suffice
+void Bump(std::atomic<uint64_t>& slot, uint64_t amount) {
+    slot.store(slot.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+void RaiseMaximum(std::atomic<int64_t>& maximum, int64_t value) {
+    int64_t current = maximum.load(std::memory_order_relaxed);
+    while (value > current && !maximum.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+
+} // namespace
+
+struct MetricsRegistry::ThreadMetrics {
+    struct Histogram {
+        std::atomic<uint64_t> buckets[BUCKET_COUNT];
+        std::atomic<uint64_t> count;
+        std::atomic<uint64_t> sum;
+        std::atomic<uint64_t> max;
+    };
+
+    std::atomic<uint64_t> counters[COUNTER_COUNT];
+    Histogram histograms[HISTOGRAM_COUNT];
+};
+
+namespace {
+
+// Hands the thread's block back to the registry when the thread exits
+struct LocalMetrics {
+    MetricsRegistry::ThreadMetrics* metrics = nullptr;
+
+    ~LocalMetrics() {
+        if (metrics) {
+            MetricsRegistry::Instance().Retire(metrics);
+        }
+    }
+};
+
+thread_local LocalMetrics t_metrics;
+
+} // namespace
+
+MetricsRegistry::MetricsRegistry() : m_retired(new ThreadMetrics()), m_nextCollector(1) {
+    for (size_t i = 0; i < GAUGE_COUNT; ++i) {
+        m_gauges[i] = 0;
+        m_gaugeMaxima[i] = 0;
+    }
+}
+
+MetricsRegistry::~MetricsRegistry() {
+    delete m_retired;
+}
+
+MetricsRegistry& MetricsRegistry::Instance() {
+    static MetricsRegistry registry;
+    return registry;
+}
+
+MetricsRegistry::ThreadMetrics& MetricsRegistry::Local() {
+    if (!t_metrics.metrics) {
+        t_metrics.metrics = new ThreadMetrics();  // Value-initialized: all zero
+        Instance().Register(t_metrics.metrics);
+    }
+    return *t_metrics.metrics;
+}
+
+void MetricsRegistry::Register(ThreadMetrics* metrics) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_threads.push_back(metrics);
+}
+
+void MetricsRegistry::Retire(ThreadMetrics* metrics) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (size_t i = 0; i < COUNTER_COUNT; ++i) {
+        Bump(m_retired->counters[i], metrics->counters[i].load(std::memory_order_relaxed));
+    }
+    for (size_t h = 0; h < HISTOGRAM_COUNT; ++h) {
+        auto& from = metrics->histograms[h];
+        auto& to = m_retired->histograms[h];
+        for (size_t b = 0; b < BUCKET_COUNT; ++b) {
+            Bump(to.buckets[b], from.buckets[b].load(std::memory_order_relaxed));
+        }
+        Bump(to.count, from.count.load(std::memory_order_relaxed));
+        Bump(to.sum, from.sum.load(std::memory_order_relaxed));
+        to.max = (std::max)(to.max.load(), from.max.load());
+    }
+    m_threads.erase(std::remove(m_threads.begin(), m_threads.end(), metrics), m_threads.end());
+    delete metrics;
+}
+
+void MetricsRegistry::Count(MetricCounter counter, uint64_t amount) {
+    Bump(Local().counters[static_cast<size_t>(counter)], amount);
+}
+
+void MetricsRegistry::Record(MetricHistogram histogram, uint64_t value) {
+    auto& slot = Local().histograms[static_cast<size_t>(histogram)];
+    Bump(slot.buckets[BucketIndex(value)], 1);
+    Bump(slot.count, 1);
+    Bump(slot.sum, value);
+    if (value > slot.max.load(std::memory_order_relaxed)) {
+        slot.max.store(value, std::memory_order_relaxed);
+    }
+}
+
+void MetricsRegistry::SetGauge(MetricGauge gauge, int64_t value) {
+    auto& registry = Instance();
+    size_t index = static_cast<size_t>(gauge);
+    registry.m_gauges[index].store(value, std::memory_order_relaxed);
+    RaiseMaximum(registry.m_gaugeMaxima[index], value);
+}
+
+void MetricsRegistry::AddGauge(MetricGauge gauge, int64_t delta) {
+    auto& registry = Instance();
+    size_t index = static_cast<size_t>(gauge);
+    int64_t value = registry.m_gauges[index].fetch_add(delta, std::memory_order_relaxed) + delta;
+    RaiseMaximum(registry.m_gaugeMaxima[index], value);
+}
+
+size_t MetricsRegistry::BucketIndex(uint64_t value) {
+    const uint64_t subBuckets = uint64_t(1) << SUB_BUCKET_BITS;
+    if (value < subBuckets) {
+        return static_cast<size_t>(value);
+    }
+    int shift = HighestBit(value) - static_cast<int>(SUB_BUCKET_BITS);
+    size_t index = static_cast<size_t>(shift) * subBuckets + static_cast<size_t>(value >> shift);
+    return (std::min)(index, BUCKET_COUNT - 1);
+}
+
+uint64_t MetricsRegistry::BucketValue(size_t index) {
+    const size_t subBuckets = size_t(1) << SUB_BUCKET_BITS;
+    if (index < subBuckets) {
+        return index;
+    }
+    size_t shift = index / subBuckets - 1;
+    uint64_t sub = index % subBuckets + subBuckets;
+    return ((sub + 1) << shift) - 1;
+}
+
+uint64_t MetricsRegistry::AddCollector(std::function<void()> collector) {
+    std::lock_guard<std::mutex> lock(m_collectorMutex);
+    uint64_t id = m_nextCollector++;
+    m_collectors.emplace_back(id, std::move(collector));
+    return id;
+}
+
+void MetricsRegistry::RemoveCollector(uint64_t id) {
+    std::lock_guard<std::mutex> lock(m_collectorMutex);
+    m_collectors.erase(std::remove_if(m_collectors.begin(), m_collectors.end(),
+                                      [id](const auto& entry) { return entry.first == id; }),
+                       m_collectors.end());
+}
+
+MetricsSnapshot MetricsRegistry::Snapshot() {
+    {
+        std::lock_guard<std::mutex> lock(m_collectorMutex);
+        for (auto& collector : m_collectors) {
+            collector.second();
+        }
+    }
+
+    MetricsSnapshot snapshot;
+    snapshot.time = std::chrono::system_clock::now();
+    for (size_t i = 0; i < GAUGE_COUNT; ++i) {
+        snapshot.gauges[i] = m_gauges[i].load(std::memory_order_relaxed);
+        snapshot.gaugeMaxima[i] = m_gaugeMaxima[i].load(std::memory_order_relaxed);
+    }
+
+    std::vector<uint64_t> buckets(BUCKET_COUNT);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<ThreadMetrics*> blocks(m_threads);
+    blocks.push_back(m_retired);
+
+    for (size_t i = 0; i < COUNTER_COUNT; ++i) {
+        for (auto* block : blocks) {
+            snapshot.counters[i] += block->counters[i].load(std::memory_order_relaxed);
+        }
+    }
+
+    for (size_t h = 0; h < HISTOGRAM_COUNT; ++h) {
+        std::fill(buckets.begin(), buckets.end(), 0);
+        uint64_t sum = 0;
+        HistogramSummary& summary = snapshot.histograms[h];
+        for (auto* block : blocks) {
+            auto& histogram = block->histograms[h];
+            for (size_t b = 0; b < BUCKET_COUNT; ++b) {
+                buckets[b] += histogram.buckets[b].load(std::memory_order_relaxed);
+            }
+            sum += histogram.sum.load(std::memory_order_relaxed);
+            summary.max = (std::max)(summary.max, histogram.max.load(std::memory_order_relaxed));
+        }
+
+        // Count from the buckets so percentiles agree with a torn concurrent update
+        for (uint64_t count : buckets) {
+            summary.count += count;
+        }
+        if (summary.count == 0) {
+            continue;
+        }
+        summary.mean = static_cast<double>(sum) / static_cast<double>(summary.count);
+
+        const double quantiles[] = { 0.5, 0.9, 0.99, 0.999 };
+        uint64_t* targets[] = { &summary.p50, &summary.p90, &summary.p99, &summary.p999 };
+        uint64_t seen = 0;
+        size_t q = 0;
+        for (size_t b = 0; b < BUCKET_COUNT && q < 4; ++b) {
+            seen += buckets[b];
+            while (q < 4 && seen >= static_cast<uint64_t>(std::ceil(quantiles[q] * summary.count))) {
+                *targets[q++] = (std::min)(BucketValue(b), summary.max);
+            }
+        }
+    }
+    return snapshot;
+}
+
+std::string MetricsSnapshot::ToJson() const {
+    std::time_t seconds = std::chrono::system_clock::to_time_t(time);
+    std::tm tm = {};
+#ifdef _WIN32
+    gmtime_s(&tm, &seconds);
+#else
+    gmtime_r(&seconds, &tm);
+#endif
+    char date[32];
+    std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", &tm);
+
+    std::ostringstream json;
+    json << "{\n  \"time\": \"" << date << "\",\n";
+#ifndef SOUNDTRACKER_METRICS
+    json << "  \"disabled\": true,\n";
+#endif
+    json << "  \"counters\": {";
+    for (size_t i = 0; i < COUNTER_COUNT; ++i) {
+        json << (i ? ", " : "") << "\"" << COUNTER_NAMES[i] << "\": " << counters[i];
+    }
+    json << "},\n  \"gauges\": {";
+    for (size_t i = 0; i < GAUGE_COUNT; ++i) {
+        json << (i ? ", " : "") << "\"" << GAUGE_NAMES[i] << "\": {\"value\": " << gauges[i]
+             << ", \"max\": " << gaugeMaxima[i] << "}";
+    }
+    json << "},\n  \"histograms\": {\n";
+    for (size_t i = 0; i < HISTOGRAM_COUNT; ++i) {
+        const HistogramSummary& h = histograms[i];
+        json << "    \"" << HISTOGRAM_NAMES[i] << "\": {\"count\": " << h.count << ", \"mean\": "
+             << static_cast<uint64_t>(h.mean) << ", \"p50\": " << h.p50 << ", \"p90\": " << h.p90
+             << ", \"p99\": " << h.p99 << ", \"p999\": " << h.p999 << ", \"max\": " << h.max << "}"
+             << (i + 1 < HISTOGRAM_COUNT ? ",\n" : "\n");
+    }
+    json << "  }\n}\n";
+    return json.str();
+}
+
+MetricsReporter::MetricsReporter() : m_interval(0), m_running(false) {
+}
+
+MetricsReporter::~MetricsReporter() {
+    Stop();
+}
+
+bool MetricsReporter::Start(const std::wstring& path, std::chrono::milliseconds interval) {
+    Stop();
+    m_path = path;
+    m_interval = interval;
+    if (!WriteSnapshot()) {
+        return false;
+    }
+    m_running = true;
+    m_thread = std::thread(&MetricsReporter::ReportThreadProc, this);
+    return true;
+}
+
+void MetricsReporter::Stop() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_running = false;
+    }
+    m_wake.notify_all();
+    if (m_thread.joinable()) {
+        m_thread.join();
+        WriteSnapshot();  // Final totals
+    }
+}
+
+bool MetricsReporter::WriteSnapshot() {
+    std::string json = MetricsRegistry::Instance().Snapshot().ToJson();
+
+    // Write beside the target and rename, so readers never see half a file
+    std::filesystem::path target(m_path);
+    std::filesystem::path temporary = target;
+    temporary += L".tmp";
+    {
+        std::ofstream file(temporary, std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            return false;
+        }
+        file << json;
+        if (!file.good()) {
+            return false;
+        }
+    }
+    std::error_code ec;
+    std::filesystem::rename(temporary, target, ec);
+    return !ec;
+}
+
+void MetricsReporter::ReportThreadProc() {
+    SpanTracer::SetThreadName("MetricsReporter");
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (m_running) {
+        if (m_wake.wait_for(lock, m_interval, [this] { return !m_running; })) {
+            break;
+        }
+        lock.unlock();
+        WriteSnapshot();
+        lock.lock();
+    }
+}
@@ -0,0 +1,102 @@
+#include "../include/OnsetDetector.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+const float SILENCE_DB = -120.0f;     // Level of an empty stream; the history starts here
+const float AMPLITUDE_FLOOR = 1e-6f;  // Keeps log10() of silence finite
+const float RELEASE_MS = 30.0f;       // Envelope decay; slow enough to ride over bass cycles
+const float BACKGROUND_FACTOR = 2.0f; // A sample this far over the background peak has started
+const float PEAK_FRACTION = 0.1f;     // ...and so has one at a tenth of the rising hop's peak
+
+} // namespace
+
+OnsetDetector::OnsetDetector(uint32_t sampleRate)
+    : m_sampleRate(sampleRate), m_hopSize(sampleRate / HOPS_PER_SECOND > 0 ? sampleRate / HOPS_PER_SECOND : 1) {
+    m_hop.resize(m_hopSize);
+    m_previous.resize(m_hopSize);
+    m_release = std::exp(-1000.0f * m_hopSize / (RELEASE_MS * (sampleRate > 0 ? sampleRate : 1)));
+    Reset();
+}
+
+void OnsetDetector::Reset() {
+    std::fill(m_previous.begin(), m_previous.end(), 0.0f);
+    m_filled = 0;
+    for (size_t i = 0; i < HISTORY_HOPS; ++i) {
+        m_levels[i] = SILENCE_DB;
+    }
+    m_nextLevel = 0;
+    m_envelope = 0.0f;
+    m_position = 0;
+    m_lastOnset = 0;
+    m_hasOnset = false;
+}
+
+void OnsetDetector::Push(const float* samples, size_t count, std::vector<uint64_t>& onsets) {
+    while (count > 0) {
+        size_t take = m_hopSize - m_filled < count ? m_hopSize - m_filled : count;
+        std::copy(samples, samples + take, m_hop.begin() + static_cast<ptrdiff_t>(m_filled));
+        m_filled += take;
+        m_position += take;
+        samples += take;
+        count -= take;
+        if (m_filled == m_hopSize) {
+            AnalyzeHop(onsets);
+            m_previous.swap(m_hop);
+            m_filled = 0;
+        }
+    }
+}
+
+void OnsetDetector::AnalyzeHop(std::vector<uint64_t>& onsets) {
+    // Peak envelope: rises with the signal at once, decays over RELEASE_MS
+    float peak = 0.0f;
+    for (float sample : m_hop) {
+        float magnitude = std::fabs(sample);
+        peak = magnitude > peak ? magnitude : peak;
+    }
+    m_envelope = peak > m_envelope * m_release ? peak : m_envelope * m_release;
+    float level = 20.0f * std::log10(m_envelope + AMPLITUDE_FLOOR);
+
+    float background = 0.0f;
+    for (size_t i = 0; i < HISTORY_HOPS; ++i) {
+        background += m_levels[i];
+    }
+    background /= HISTORY_HOPS;
+    m_levels[m_nextLevel] = level;
+    m_nextLevel = (m_nextLevel + 1) % HISTORY_HOPS;
+
+    uint64_t hopStart = m_position - m_hopSize;
+    uint64_t minGap = static_cast<uint64_t>(m_sampleRate) * MIN_GAP_MS / 1000;
+    if (level < FLOOR_DB || level - background < RISE_DB ||
+        (m_hasOnset && hopStart < m_lastOnset + minGap)) {
+        return;
+    }
+
+    // The hop rose; the sound starts at its first sample clear of the
+    // background, which may be late in the hop before
+    float threshold = BACKGROUND_FACTOR * std::pow(10.0f, background / 20.0f);
+    if (threshold < PEAK_FRACTION * peak) {
+        threshold = PEAK_FRACTION * peak;
+    }
+    uint64_t onset = hopStart;
+    bool found = false;
+    if (hopStart >= m_hopSize && (!m_hasOnset || hopStart - m_hopSize >= m_lastOnset + minGap)) {
+        for (size_t i = 0; i < m_hopSize && !found; ++i) {
+            if (std::fabs(m_previous[i]) > threshold) {
+                onset = hopStart - m_hopSize + i;
+                found = true;
+            }
+        }
+    }
+    for (size_t i = 0; i < m_hopSize && !found; ++i) {
+        if (std::fabs(m_hop[i]) > threshold) {
+            onset = hopStart + i;
+            found = true;
+        }
+    }
+    onsets.push_back(onset);
+    m_lastOnset = onset;
+    m_hasOnset = true;
+}
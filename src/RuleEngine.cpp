@@ -0,0 +1,698 @@
+#include "../include/RuleEngine.h"
+#include "../include/Metrics.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <map>
+
+namespace {
+
+const size_t STRING_FIELDS = static_cast<size_t>(RuleEngine::Field::Pid);
+
+// Per-process windows a count rule holds before it first drops idle ones
+const size_t MIN_WINDOW_SWEEP = 64;
+
+struct FieldName {
+    const char* name;
+    RuleEngine::Field field;
+};
+
+const FieldName FIELD_NAMES[] = {
+    { "process", RuleEngine::Field::Process }, { "path", RuleEngine::Field::Path },
+    { "desc", RuleEngine::Field::Description }, { "session", RuleEngine::Field::Session },
+    { "sound", RuleEngine::Field::Sound }, { "endpoint", RuleEngine::Field::Endpoint },
+    { "usb", RuleEngine::Field::Usb }, { "tab", RuleEngine::Field::Tab },
+    { "pid", RuleEngine::Field::Pid }, { "volume", RuleEngine::Field::Volume },
+    { "peak", RuleEngine::Field::Peak }, { "momentary", RuleEngine::Field::Momentary },
+    { "shortterm", RuleEngine::Field::ShortTerm }, { "duration", RuleEngine::Field::Duration },
+    { "events", RuleEngine::Field::Events }, { "system", RuleEngine::Field::System }
+};
+
+char ToLowerAscii(char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+// Folds into a reused buffer, ASCII only as in SearchQuery
+void FoldInto(const std::string& text, std::string& folded) {
+    folded.resize(text.size());
+    std::transform(text.begin(), text.end(), folded.begin(), ToLowerAscii);
+}
+
+const std::string& StringField(const AudioEvent& event, RuleEngine::Field field) {
+    switch (field) {
+        case RuleEngine::Field::Process: return event.processName;
+        case RuleEngine::Field::Path: return event.processPath;
+        case RuleEngine::Field::Description: return event.soundDescription;
+        case RuleEngine::Field::Session: return event.sessionDisplayName;
+        case RuleEngine::Field::Sound: return event.soundLabel;
+        case RuleEngine::Field::Endpoint: return event.endpointId;
+        case RuleEngine::Field::Usb: return event.usbDeviceInfo;
+        default: return event.browserTabInfo;
+    }
+}
+
+double NumberField(const AudioEvent& event, RuleEngine::Field field) {
+    switch (field) {
+        case RuleEngine::Field::Pid: return event.processId;
+        case RuleEngine::Field::Volume: return event.volumeLevel;
+        case RuleEngine::Field::Peak: return event.peakLevel;
+        case RuleEngine::Field::Momentary: return event.momentaryLoudness;
+        case RuleEngine::Field::ShortTerm: return event.shortTermLoudness;
+        case RuleEngine::Field::Duration: return event.duration_ms;
+        case RuleEngine::Field::Events: return event.eventCount;
+        default: return event.isSystemSound ? 1.0 : 0.0;
+    }
+}
+
+struct Token {
+    enum Kind { Word, Quoted, Symbol, End } kind;
+    std::string text;
+};
+
+// Words run to whitespace, a quote or an operator; what a word means
+// (field, number, bare string) is up to the parser
+std::vector<Token> Tokenize(const std::string& line, std::string& error) {
+    std::vector<Token> tokens;
+    size_t i = 0;
+    while (i < line.size()) {
+        char c = line[i];
+        if (c == ' ' || c == '\t' || c == '\r') {
+            ++i;
+        } else if (c == '#') {
+            break;
+        } else if (c == '"') {
+            size_t close = line.find('"', i + 1);
+            if (close == std::string::npos) {
+                error = "unterminated quote";
+                return tokens;
+            }
+            tokens.push_back({ Token::Quoted, line.substr(i + 1, close - i - 1) });
+            i = close + 1;
+        } else if (c == '(' || c == ')') {
+            tokens.push_back({ Token::Symbol, std::string(1, c) });
+            ++i;
+        } else if (c == '=' || c == '!' || c == '<' || c == '>') {
+            size_t length = i + 1 < line.size() && line[i + 1] == '=' ? 2 : 1;
+            if (c == '!' && length == 1) {
+                error = "expected !=";
+                return tokens;
+            }
+            tokens.push_back({ Token::Symbol, line.substr(i, length) });
+            i += length;
+        } else {
+            size_t end = i;
+            while (end < line.size() && std::string(" \t\r\"()=!<>#").find(line[end]) == std::string::npos) {
+                ++end;
+            }
+            tokens.push_back({ Token::Word, line.substr(i, end - i) });
+            i = end;
+        }
+    }
+    tokens.push_back({ Token::End, std::string() });
+    return tokens;
+}
+
+bool ParseNumber(const std::string& text, double& value) {
+    if (text.empty()) {
+        return false;
+    }
+    char* end = nullptr;
+    value = std::strtod(text.c_str(), &end);
+    if (*end == '%' && end[1] == '\0') {
+        value /= 100.0;
+        return true;
+    }
+    return end != text.c_str() && *end == '\0';
+}
+
+bool ParseDuration(const std::string& text, int64_t& milliseconds) {
+    char* end = nullptr;
+    double value = std::strtod(text.c_str(), &end);
+    std::string unit(end);
+    double scale = unit == "ms" ? 1.0 : unit == "s" || unit == "sec" ? 1000.0 :
+                   unit == "m" || unit == "min" ? 60000.0 : unit == "h" ? 3600000.0 : 0.0;
+    if (end == text.c_str() || scale == 0.0 || !(value > 0.0)) {
+        return false;
+    }
+    milliseconds = static_cast<int64_t>(value * scale);
+    return milliseconds > 0;
+}
+
+}  // namespace
+
+// Parses rule lines into a RuleEngine's node table, interning every node
+class RuleCompiler {
+private:
+    RuleEngine& m_engine;
+    std::map<std::string, uint32_t> m_interned;
+    std::vector<Token> m_tokens;
+    size_t m_pos;
+    std::string m_error;
+
+    typedef RuleEngine::Op Op;
+    typedef RuleEngine::Field Field;
+
+    const Token& Peek() const { return m_tokens[m_pos]; }
+    bool IsWord(const char* text) const { return Peek().kind == Token::Word && Peek().text == text; }
+    bool IsSymbol(const char* text) const { return Peek().kind == Token::Symbol && Peek().text == text; }
+
+    bool Fail(const std::string& message) {
+        if (m_error.empty()) {
+            m_error = message;
+        }
+        return false;
+    }
+
+    uint32_t Intern(RuleEngine::Node node, std::vector<uint32_t> children) {
+        bool logical = node.op == Op::And || node.op == Op::Or;
+        if (logical) {
+            // a and (b and c) is a and b and c; order does not matter, so
+            // sorted children let the same terms written differently share
+            std::vector<uint32_t> flat;
+            for (uint32_t child : children) {
+                const RuleEngine::Node& inner = m_engine.m_nodes[child];
+                if (inner.op == node.op) {
+                    flat.insert(flat.end(), m_engine.m_children.begin() + inner.first,
+                                m_engine.m_children.begin() + inner.first + inner.count);
+                } else {
+                    flat.push_back(child);
+                }
+            }
+            std::sort(flat.begin(), flat.end());
+            flat.erase(std::unique(flat.begin(), flat.end()), flat.end());
+            if (flat.size() == 1) {
+                return flat[0];
+            }
+            children.swap(flat);
+        } else if (node.op == Op::Not && m_engine.m_nodes[children[0]].op == Op::Not) {
+            return m_engine.m_children[m_engine.m_nodes[children[0]].first];
+        }
+
+        char number[32];
+        std::snprintf(number, sizeof(number), "%.17g", node.number);
+        std::string key = std::to_string(static_cast<int>(node.op)) + ":" +
+                          std::to_string(static_cast<int>(node.field)) + ":" + number + ":" + node.text;
+        for (uint32_t child : children) {
+            key += "," + std::to_string(child);
+        }
+        auto it = m_interned.find(key);
+        if (it != m_interned.end()) {
+            return it->second;
+        }
+        node.first = static_cast<uint32_t>(m_engine.m_children.size());
+        node.count = static_cast<uint32_t>(children.size());
+        m_engine.m_children.insert(m_engine.m_children.end(), children.begin(), children.end());
+        uint32_t id = static_cast<uint32_t>(m_engine.m_nodes.size());
+        m_engine.m_nodes.push_back(node);
+        m_interned.emplace(key, id);
+        return id;
+    }
+
+    uint32_t Leaf(Op op, Field field, double number, const std::string& text) {
+        RuleEngine::Node node = { op, field, 0, 0, number, text };
+        return Intern(node, std::vector<uint32_t>());
+    }
+
+    uint32_t Logical(Op op, std::vector<uint32_t> children) {
+        RuleEngine::Node node = { op, Field::Count, 0, 0, 0.0, std::string() };
+        return Intern(node, std::move(children));
+    }
+
+    bool ParseComparisonOp(Op& op, bool& negate) {
+        negate = false;
+        const std::string& text = Peek().text;
+        if (Peek().kind != Token::Symbol || text == "(" || text == ")") {
+            return Fail("expected a comparison after a field");
+        }
+        op = text == "<" ? Op::Less : text == "<=" ? Op::LessEqual : text == ">" ? Op::Greater :
+             text == ">=" ? Op::GreaterEqual : Op::NumberEqual;
+        negate = text == "!=";
+        ++m_pos;
+        return true;
+    }
+
+    bool ParseComparison(uint32_t& node) {
+        const Token& name = Peek();
+        auto it = std::find_if(std::begin(FIELD_NAMES), std::end(FIELD_NAMES),
+                               [&](const FieldName& field) { return name.kind == Token::Word && name.text == field.name; });
+        if (it == std::end(FIELD_NAMES)) {
+            return Fail(name.kind == Token::End ? "expected a term" : "unknown field '" + name.text + "'");
+        }
+        Field field = it->field;
+        ++m_pos;
+        m_engine.m_terms++;
+
+        if (field == Field::System) {
+            node = Leaf(Op::IsTrue, field, 0.0, std::string());
+            return true;
+        }
+        Op op;
+        bool negate = false;
+        if (static_cast<size_t>(field) < STRING_FIELDS) {
+            if (IsWord("contains")) {
+                op = Op::Contains;
+                ++m_pos;
+            } else if (IsSymbol("=") || IsSymbol("!=")) {
+                op = Op::Equal;
+                negate = IsSymbol("!=");
+                ++m_pos;
+            } else {
+                return Fail("expected =, != or contains after '" + std::string(it->name) + "'");
+            }
+            if (Peek().kind != Token::Word && Peek().kind != Token::Quoted) {
+                return Fail("expected text after '" + std::string(it->name) + "'");
+            }
+            std::string folded;
+            FoldInto(Peek().text, folded);
+            ++m_pos;
+            node = Leaf(op, field, 0.0, folded);
+        } else {
+            if (!ParseComparisonOp(op, negate)) {
+                return false;
+            }
+            double value = 0.0;
+            if (Peek().kind != Token::Word || !ParseNumber(Peek().text, value)) {
+                return Fail("expected a number after '" + std::string(it->name) + "'");
+            }
+            ++m_pos;
+            node = Leaf(op, field, value, std::string());
+        }
+        if (negate) {
+            node = Logical(Op::Not, { node });
+        }
+        return true;
+    }
+
+    bool ParseCount(RuleEngine::Rule& rule) {
+        ++m_pos;
+        if (rule.counted) {
+            return Fail("only one count per rule");
+        }
+        bool negate = false;
+        double limit = 0.0;
+        if (!ParseComparisonOp(rule.countOp, negate)) {
+            return false;
+        }
+        if (negate) {
+            return Fail("count cannot use !=");
+        }
+        if (Peek().kind != Token::Word || !ParseNumber(Peek().text, limit) || limit < 0.0) {
+            return Fail("expected a number of events after count");
+        }
+        ++m_pos;
+        if (!IsWord("in")) {
+            return Fail("expected 'in WINDOW' after count");
+        }
+        ++m_pos;
+        if (Peek().kind != Token::Word) {
+            return Fail("expected a window such as 10s after 'in'");
+        }
+        // 10s, or 10 s
+        std::string window = Peek().text;
+        ++m_pos;
+        if (window.find_first_not_of("0123456789.") == std::string::npos && Peek().kind == Token::Word &&
+            !IsWord("and") && !IsWord("or")) {
+            window += Peek().text;
+            ++m_pos;
+        }
+        if (!ParseDuration(window, rule.windowMs)) {
+            return Fail("expected a window such as 10s after 'in'");
+        }
+        rule.counted = true;
+        rule.countLimit = static_cast<uint32_t>(limit);
+        m_engine.m_terms++;
+        return true;
+    }
+
+    bool ParseUnary(uint32_t& node) {
+        if (IsWord("not")) {
+            ++m_pos;
+            m_engine.m_terms++;
+            if (!ParseUnary(node)) {
+                return false;
+            }
+            node = Logical(Op::Not, { node });
+            return true;
+        }
+        if (IsSymbol("(")) {
+            ++m_pos;
+            if (!ParseOr(nullptr, node)) {
+                return false;
+            }
+            if (!IsSymbol(")")) {
+                return Fail("expected )");
+            }
+            ++m_pos;
+            return true;
+        }
+        if (IsWord("count")) {
+            return Fail("count may only be and-ed at the top of a rule");
+        }
+        return ParseComparison(node);
+    }
+
+    // rule is set only at the top, where a count may appear
+    bool ParseAnd(RuleEngine::Rule* rule, uint32_t& node) {
+        std::vector<uint32_t> terms;
+        for (;;) {
+            if (rule && IsWord("count")) {
+                if (!ParseCount(*rule)) {
+                    return false;
+                }
+            } else {
+                uint32_t term = 0;
+                if (!ParseUnary(term)) {
+                    return false;
+                }
+                terms.push_back(term);
+            }
+            if (!IsWord("and")) {
+                break;
+            }
+            ++m_pos;
+            m_engine.m_terms++;
+        }
+        // A count alone matches every event it counts
+        node = Logical(Op::And, terms);
+        return true;
+    }
+
+    bool ParseOr(RuleEngine::Rule* rule, uint32_t& node) {
+        std::vector<uint32_t> terms;
+        uint32_t term = 0;
+        if (!ParseAnd(rule, term)) {
+            return false;
+        }
+        terms.push_back(term);
+        while (IsWord("or")) {
+            if (rule && rule->counted) {
+                return Fail("count may only be and-ed at the top of a rule");
+            }
+            ++m_pos;
+            m_engine.m_terms++;
+            if (!ParseAnd(nullptr, term)) {
+                return false;
+            }
+            terms.push_back(term);
+        }
+        node = terms.size() == 1 ? terms[0] : Logical(Op::Or, terms);
+        return true;
+    }
+
+public:
+    explicit RuleCompiler(RuleEngine& engine) : m_engine(engine), m_pos(0) {}
+
+    const std::string& GetError() const { return m_error; }
+
+    // False on a syntax error; true with rule untouched for a blank line
+    bool ParseLine(const std::string& line, std::vector<RuleEngine::Rule>& rules) {
+        m_tokens = Tokenize(line, m_error);
+        m_pos = 0;
+        if (!m_error.empty()) {
+            return false;
+        }
+        if (Peek().kind == Token::End) {
+            return true;
+        }
+        RuleEngine::Rule rule;
+        rule.counted = false;
+        rule.countOp = Op::Greater;
+        rule.countLimit = 0;
+        rule.windowMs = 0;
+        rule.perProcess = true;
+        rule.fires = 0;
+        rule.sweepAt = MIN_WINDOW_SWEEP;
+        if (IsWord("ignore") || IsWord("notify")) {
+            rule.action = IsWord("ignore") ? RuleAction::Ignore : RuleAction::Notify;
+        } else {
+            return Fail("a rule starts with ignore or notify");
+        }
+        ++m_pos;
+        if (Peek().kind == Token::Quoted) {
+            rule.name = Peek().text;
+            ++m_pos;
+        }
+        if (!IsWord("when")) {
+            return Fail("expected 'when' after the action");
+        }
+        ++m_pos;
+        if (!ParseOr(&rule, rule.root)) {
+            return false;
+        }
+        if (Peek().kind != Token::End) {
+            return Fail("unexpected '" + Peek().text + "'");
+        }
+        if (rule.name.empty()) {
+            // The rule as written, less its comment
+            size_t comment = line.find('#');
+            rule.name = line.substr(0, comment);
+            rule.name.erase(rule.name.find_last_not_of(" \t\r") + 1);
+            rule.name.erase(0, rule.name.find_first_not_of(" \t"));
+        }
+        rules.push_back(std::move(rule));
+        return true;
+    }
+};
+
+RuleEngine::RuleEngine() : m_terms(0), m_event(nullptr), m_generation(0) {
+    std::fill(std::begin(m_foldedGeneration), std::end(m_foldedGeneration), 0u);
+}
+
+bool RuleEngine::Load(const std::string& text, std::string& error) {
+    RuleEngine compiled;
+    RuleCompiler compiler(compiled);
+    std::vector<Rule> rules;
+    size_t lineNumber = 0;
+    for (size_t start = 0; start < text.size();) {
+        size_t end = text.find('\n', start);
+        if (end == std::string::npos) {
+            end = text.size();
+        }
+        ++lineNumber;
+        if (!compiler.ParseLine(text.substr(start, end - start), rules)) {
+            error = "line " + std::to_string(lineNumber) + ": " + compiler.GetError();
+            return false;
+        }
+        start = end + 1;
+    }
+
+    // Ignore rules first, so an event is known to be kept before any notify counts it
+    std::stable_partition(rules.begin(), rules.end(),
+                          [](const Rule& rule) { return rule.action == RuleAction::Ignore; });
+    compiled.m_rules = std::move(rules);
+
+    // Index each rule by a string it requires to be equal, process first. A
+    // rule anchored on a process only ever counts that process's events.
+    for (uint32_t i = 0; i < compiled.m_rules.size(); ++i) {
+        const Node& root = compiled.m_nodes[compiled.m_rules[i].root];
+        const Node* anchor = nullptr;
+        if (root.op == Op::Equal) {
+            anchor = &root;
+        } else if (root.op == Op::And) {
+            for (uint32_t c = root.first; c < root.first + root.count; ++c) {
+                const Node& child = compiled.m_nodes[compiled.m_children[c]];
+                if (child.op == Op::Equal && (!anchor || child.field == Field::Process)) {
+                    anchor = &child;
+                }
+            }
+        }
+        compiled.m_rules[i].perProcess = !anchor || anchor->field != Field::Process;
+        if (anchor) {
+            compiled.m_anchors[static_cast<size_t>(anchor->field)][anchor->text].push_back(i);
+        } else {
+            compiled.m_unanchored.push_back(i);
+        }
+    }
+    compiled.m_nodeGeneration.assign(compiled.m_nodes.size(), 0);
+    compiled.m_nodeValue.assign(compiled.m_nodes.size(), 0);
+    *this = std::move(compiled);
+    return true;
+}
+
+bool RuleEngine::LoadFile(const std::wstring& path, std::string& error) {
+    std::ifstream file(std::filesystem::path(path), std::ios::in | std::ios::binary);
+    if (!file) {
+        error = "cannot open " + std::filesystem::path(path).string();
+        return false;
+    }
+    std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    return Load(text, error);
+}
+
+const std::string& RuleEngine::Folded(Field field) {
+    size_t index = static_cast<size_t>(field);
+    if (m_foldedGeneration[index] != m_generation) {
+        FoldInto(StringField(*m_event, field), m_folded[index]);
+        m_foldedGeneration[index] = m_generation;
+    }
+    return m_folded[index];
+}
+
+bool RuleEngine::EvaluateNode(uint32_t index) {
+    if (m_nodeGeneration[index] == m_generation) {
+        return m_nodeValue[index] != 0;
+    }
+    const Node& node = m_nodes[index];
+    bool value = false;
+    switch (node.op) {
+        case Op::Equal:
+            value = Folded(node.field) == node.text;
+            break;
+        case Op::Contains:
+            value = Folded(node.field).find(node.text) != std::string::npos;
+            break;
+        case Op::Less:
+            value = NumberField(*m_event, node.field) < node.number;
+            break;
+        case Op::LessEqual:
+            value = NumberField(*m_event, node.field) <= node.number;
+            break;
+        case Op::Greater:
+            value = NumberField(*m_event, node.field) > node.number;
+            break;
+        case Op::GreaterEqual:
+            value = NumberField(*m_event, node.field) >= node.number;
+            break;
+        case Op::NumberEqual:
+            value = NumberField(*m_event, node.field) == node.number;
+            break;
+        case Op::IsTrue:
+            value = m_event->isSystemSound;
+            break;
+        case Op::And:
+            value = true;
+            for (uint32_t c = node.first; value && c < node.first + node.count; ++c) {
+                value = EvaluateNode(m_children[c]);
+            }
+            break;
+        case Op::Or:
+            for (uint32_t c = node.first; !value && c < node.first + node.count; ++c) {
+                value = EvaluateNode(m_children[c]);
+            }
+            break;
+        case Op::Not:
+            value = !EvaluateNode(m_children[node.first]);
+            break;
+    }
+    m_nodeGeneration[index] = m_generation;
+    m_nodeValue[index] = value ? 1 : 0;
+    return value;
+}
+
+bool RuleEngine::Fire(Rule& rule) {
+    if (!rule.counted) {
+        return true;
+    }
+    int64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(m_event->timestamp.time_since_epoch()).count();
+    if (rule.perProcess && rule.windows.size() >= rule.sweepAt) {
+        // Processes whose newest sound has left the window count nothing
+        // and have re-armed, so dropping them changes no result
+        for (auto it = rule.windows.begin(); it != rule.windows.end();) {
+            const auto& times = it->second.times;
+            it = !times.empty() && times.back() <= now - rule.windowMs ? rule.windows.erase(it) : std::next(it);
+        }
+        rule.sweepAt = (std::max)(rule.windows.size() * 2, MIN_WINDOW_SWEEP);
+    }
+    Window& window = rule.perProcess ? rule.windows[m_event->processName] : rule.window;
+    if (!window.times.empty() && now < window.times.back()) {
+        // The clock stepped back; start the window over
+        window.times.clear();
+        window.counts.clear();
+        window.head = 0;
+        window.total = 0;
+        window.lastFired = INT64_MIN;
+    }
+    // A burst coalesced into one event counts as the sounds in it
+    uint32_t sounds = (std::max)(static_cast<uint32_t>(m_event->eventCount), 1u);
+    window.times.push_back(now);
+    window.counts.push_back(sounds);
+    window.total += sounds;
+    while (window.times[window.head] <= now - rule.windowMs) {
+        window.total -= window.counts[window.head];
+        ++window.head;
+    }
+    if (window.head > 32 && window.head * 2 > window.times.size()) {
+        window.times.erase(window.times.begin(), window.times.begin() + static_cast<ptrdiff_t>(window.head));
+        window.counts.erase(window.counts.begin(), window.counts.begin() + static_cast<ptrdiff_t>(window.head));
+        window.head = 0;
+    }
+    double count = static_cast<double>(window.total);
+    double limit = rule.countLimit;
+    bool over = rule.countOp == Op::Less ? count < limit : rule.countOp == Op::LessEqual ? count <= limit :
+                rule.countOp == Op::Greater ? count > limit : rule.countOp == Op::GreaterEqual ? count >= limit :
+                count == limit;
+    if (!over || rule.action == RuleAction::Ignore) {
+        return over;
+    }
+    // An alert re-arms once its window has passed
+    if (window.lastFired != INT64_MIN && now - window.lastFired < rule.windowMs) {
+        return false;
+    }
+    window.lastFired = now;
+    return true;
+}
+
+bool RuleEngine::Evaluate(const AudioEvent& event, std::vector<uint32_t>& fired) {
+    if (m_rules.empty()) {
+        return true;
+    }
+    m_event = &event;
+    if (++m_generation == 0) {
+        std::fill(m_nodeGeneration.begin(), m_nodeGeneration.end(), 0u);
+        std::fill(std::begin(m_foldedGeneration), std::end(m_foldedGeneration), 0u);
+        m_generation = 1;
+    }
+
+    // Rules in index order: the unanchored merged with those anchored on
+    // this event's strings, all of them sorted already
+    m_candidates.assign(m_unanchored.begin(), m_unanchored.end());
+    for (size_t field = 0; field < STRING_FIELDS; ++field) {
+        if (m_anchors[field].empty()) {
+            continue;
+        }
+        auto it = m_anchors[field].find(Folded(static_cast<Field>(field)));
+        if (it != m_anchors[field].end()) {
+            m_merged.resize(m_candidates.size() + it->second.size());
+            std::merge(m_candidates.begin(), m_candidates.end(), it->second.begin(), it->second.end(),
+                       m_merged.begin());
+            m_candidates.swap(m_merged);
+        }
+    }
+
+    bool ignored = false;
+    size_t alerts = 0;
+    for (uint32_t index : m_candidates) {
+        Rule& rule = m_rules[index];
+        if (rule.action == RuleAction::Notify && ignored) {
+            break;
+        }
+        if (EvaluateNode(rule.root) && Fire(rule)) {
+            ++rule.fires;
+            if (rule.action == RuleAction::Ignore) {
+                ignored = true;
+            } else {
+                fired.push_back(index);
+                ++alerts;
+            }
+        }
+    }
+    m_event = nullptr;
+    if (ignored) {
+        METRICS_COUNT(EventsIgnored, 1);
+    }
+    if (alerts) {
+        METRICS_COUNT(RuleAlerts, alerts);
+    }
+    return !ignored;
+}
+
+size_t RuleEngine::GetWindowCount() const {
+    size_t windows = 0;
+    for (const Rule& rule : m_rules) {
+        windows += rule.windows.size();
+    }
+    return windows;
+}
@@ -0,0 +1,480 @@
+#include "../include/SearchIndex.h"
+#include <algorithm>
+#include <charconv>
+#include <ctime>
+#include <iterator>
+
+namespace {
+
+char ToLowerAscii(char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+// Only ASCII is folded, as towlower does in the C locale; UTF-8 continuation
+// bytes are never in A-Z so multi-byte characters compare exactly
+std::string Fold(const std::string& text) {
+    std::string folded(text);
+    std::transform(folded.begin(), folded.end(), folded.begin(), ToLowerAscii);
+    return folded;
+}
+
+bool ContainsFolded(const std::string& text, const std::string& foldedNeedle) {
+    auto it = std::search(text.begin(), text.end(), foldedNeedle.begin(), foldedNeedle.end(),
+                          [](char a, char b) { return ToLowerAscii(a) == b; });
+    return it != text.end();
+}
+
+bool MatchesText(const std::string& text, const SearchQuery::Term& term) {
+    return term.regex ? std::regex_search(text, *term.regex) : ContainsFolded(text, term.text);
+}
+
+uint32_t Trigram(const std::string& folded, size_t i) {
+    return (static_cast<uint32_t>(static_cast<unsigned char>(folded[i])) << 16) |
+           (static_cast<uint32_t>(static_cast<unsigned char>(folded[i + 1])) << 8) |
+           static_cast<uint32_t>(static_cast<unsigned char>(folded[i + 2]));
+}
+
+std::vector<uint32_t> Trigrams(const std::string& folded) {
+    std::vector<uint32_t> grams;
+    for (size_t i = 0; i + 3 <= folded.size(); ++i) {
+        grams.push_back(Trigram(folded, i));
+    }
+    std::sort(grams.begin(), grams.end());
+    grams.erase(std::unique(grams.begin(), grams.end()), grams.end());
+    return grams;
+}
+
+std::tm ToLocalTime(const std::chrono::system_clock::time_point& time) {
+    auto timeT = std::chrono::system_clock::to_time_t(time);
+    std::tm tm = {};
+#ifdef _WIN32
+    localtime_s(&tm, &timeT);
+#else
+    localtime_r(&timeT, &tm);
+#endif
+    return tm;
+}
+
+bool ParseNumber(const std::string& text, size_t pos, size_t length, int& value) {
+    if (pos + length > text.size()) {
+        return false;
+    }
+    const char* begin = text.data() + pos;
+    auto result = std::from_chars(begin, begin + length, value);
+    return result.ec == std::errc() && result.ptr == begin + length;
+}
+
+// "HH:MM" or "HH:MM:SS" starting at pos, ending the string
+bool ParseClock(const std::string& text, size_t pos, std::tm& tm) {
+    size_t length = text.size() - pos;
+    if ((length != 5 && length != 8) || text[pos + 2] != ':' || (length == 8 && text[pos + 5] != ':')) {
+        return false;
+    }
+    tm.tm_sec = 0;
+    return ParseNumber(text, pos, 2, tm.tm_hour) && ParseNumber(text, pos + 3, 2, tm.tm_min) &&
+           (length == 5 || ParseNumber(text, pos + 6, 2, tm.tm_sec));
+}
+
+// Appends the postings at or after from; postings are ascending
+void AppendFrom(const std::vector<uint64_t>& postings, uint64_t from, std::vector<uint64_t>& out) {
+    out.insert(out.end(), std::lower_bound(postings.begin(), postings.end(), from), postings.end());
+}
+
+void SortUnique(std::vector<uint64_t>& values) {
+    std::sort(values.begin(), values.end());
+    values.erase(std::unique(values.begin(), values.end()), values.end());
+}
+
+} // namespace
+
+SearchQuery::SearchQuery()
+    : m_after((std::chrono::system_clock::time_point::min)()),
+      m_before((std::chrono::system_clock::time_point::max)()) {
+}
+
+void SearchQuery::Parse(const std::string& text, const std::chrono::system_clock::time_point& now) {
+    m_terms.clear();
+    m_after = (std::chrono::system_clock::time_point::min)();
+    m_before = (std::chrono::system_clock::time_point::max)();
+
+    // Split on whitespace outside double quotes; the quotes themselves go
+    std::string token;
+    bool inQuotes = false;
+    for (size_t i = 0; i <= text.size(); ++i) {
+        char c = i < text.size() ? text[i] : ' ';
+        if (c == '"') {
+            inQuotes = !inQuotes;
+        } else if (!inQuotes && (c == ' ' || c == '\t' || c == '\r' || c == '\n')) {
+            if (!token.empty()) {
+                AddTerm(token, now);
+                token.clear();
+            }
+        } else {
+            token += c;
+        }
+    }
+    if (!token.empty()) {
+        AddTerm(token, now);
+    }
+}
+
+bool SearchQuery::ParseTime(const std::string& value, const std::chrono::system_clock::time_point& now,
+                            std::chrono::system_clock::time_point& time) const {
+    std::tm tm = ToLocalTime(now);
+    if (value.size() >= 10 && value[4] == '-' && value[7] == '-') {
+        int year, month, day;
+        if (!ParseNumber(value, 0, 4, year) || !ParseNumber(value, 5, 2, month) ||
+            !ParseNumber(value, 8, 2, day)) {
+            return false;
+        }
+        tm.tm_year = year - 1900;
+        tm.tm_mon = month - 1;
+        tm.tm_mday = day;
+        tm.tm_hour = tm.tm_min = tm.tm_sec = 0;
+        if (value.size() > 10 && (value[10] != 'T' || !ParseClock(value, 11, tm))) {
+            return false;
+        }
+    } else if (!ParseClock(value, 0, tm)) {
+        return false;
+    }
+
+    tm.tm_isdst = -1;
+    std::time_t local = std::mktime(&tm);
+    if (local == static_cast<std::time_t>(-1)) {
+        return false;
+    }
+    time = std::chrono::system_clock::from_time_t(local);
+    return true;
+}
+
+void SearchQuery::AddTerm(const std::string& token, const std::chrono::system_clock::time_point& now) {
+    Term term = { Field::Any, std::string(), nullptr, 0 };
+    std::string value = token;
+
+    size_t colon = token.find(':');
+    if (colon != std::string::npos && colon > 0 && colon + 1 < token.size()) {
+        std::string prefix = Fold(token.substr(0, colon));
+        std::string rest = token.substr(colon + 1);
+        std::chrono::system_clock::time_point time;
+
+        if (prefix == "process" || prefix == "path" || prefix == "desc" || prefix == "sound") {
+            term.field = prefix == "process" ? Field::Process : prefix == "path" ? Field::Path :
+                         prefix == "desc" ? Field::Description : Field::Sound;
+            value = rest;
+        } else if (prefix == "pid") {
+            auto result = std::from_chars(rest.data(), rest.data() + rest.size(), term.pid);
+            if (result.ec == std::errc() && result.ptr == rest.data() + rest.size()) {
+                term.field = Field::Pid;
+                m_terms.push_back(term);
+                return;
+            }
+        } else if ((prefix == "after" || prefix == "before") && ParseTime(rest, now, time)) {
+            if (prefix == "after") {
+                m_after = (std::max)(m_after, time);
+            } else {
+                m_before = (std::min)(m_before, time);
+            }
+            return;
+        } else if (prefix == "last" && rest.size() >= 2) {
+            long long amount = 0;
+            auto result = std::from_chars(rest.data(), rest.data() + rest.size() - 1, amount);
+            char unit = rest.back();
+            long long seconds = unit == 's' ? 1 : unit == 'm' ? 60 : unit == 'h' ? 3600 : unit == 'd' ? 86400 : 0;
+            if (result.ec == std::errc() && result.ptr == rest.data() + rest.size() - 1 && seconds > 0) {
+                m_after = (std::max)(m_after, now - std::chrono::seconds(amount * seconds));
+                return;
+            }
+        }
+    }
+
+    if (value.size() >= 2 && value.front() == '/' && value.back() == '/') {
+        try {
+            term.regex = std::make_shared<const std::regex>(value.substr(1, value.size() - 2),
+                                                            std::regex::ECMAScript | std::regex::icase);
+            m_terms.push_back(term);
+            return;
+        } catch (const std::regex_error&) {
+            // Fall back to matching the text literally
+        }
+    }
+    term.text = Fold(value);
+    m_terms.push_back(term);
+}
+
+bool SearchQuery::IsEmpty() const {
+    return m_terms.empty() &&
+           m_after == (std::chrono::system_clock::time_point::min)() &&
+           m_before == (std::chrono::system_clock::time_point::max)();
+}
+
+bool SearchQuery::Matches(const AudioEvent& event) const {
+    if (event.timestamp < m_after || event.timestamp >= m_before) {
+        return false;
+    }
+    for (const auto& term : m_terms) {
+        bool matched = false;
+        switch (term.field) {
+            case Field::Any:
+                matched = MatchesText(event.processName, term) || MatchesText(event.soundDescription, term) ||
+                          MatchesText(event.soundLabel, term);
+                break;
+            case Field::Process:
+                matched = MatchesText(event.processName, term);
+                break;
+            case Field::Path:
+                matched = MatchesText(event.processPath, term);
+                break;
+            case Field::Description:
+                matched = MatchesText(event.soundDescription, term);
+                break;
+            case Field::Sound:
+                matched = MatchesText(event.soundLabel, term);
+                break;
+            case Field::Pid:
+                matched = event.processId == term.pid;
+                break;
+        }
+        if (!matched) {
+            return false;
+        }
+    }
+    return true;
+}
+
+uint32_t SearchIndex::FieldIndex::Intern(const std::string& text) {
+    auto it = ids.find(text);
+    if (it != ids.end()) {
+        return it->second;
+    }
+
+    uint32_t id = static_cast<uint32_t>(originals.size());
+    ids.emplace(text, id);
+    originals.push_back(text);
+    folded.push_back(Fold(text));
+    postings.emplace_back();
+    // Ids only grow, so every trigram's id list stays sorted
+    for (uint32_t gram : Trigrams(folded.back())) {
+        trigrams[gram].push_back(id);
+    }
+    return id;
+}
+
+void SearchIndex::FieldIndex::Compact() {
+    size_t live = 0;
+    for (const auto& list : postings) {
+        live += list.empty() ? 0 : 1;
+    }
+    // Waiting until half are unused keeps the rebuild amortized
+    if (postings.size() - live <= live) {
+        return;
+    }
+
+    // Live strings keep their order, so trigram id lists stay sorted
+    FieldIndex compacted;
+    for (uint32_t id = 0; id < originals.size(); ++id) {
+        if (!postings[id].empty()) {
+            compacted.postings[compacted.Intern(originals[id])] = std::move(postings[id]);
+        }
+    }
+    *this = std::move(compacted);
+}
+
+SearchIndex::SearchIndex(size_t maxEvents)
+    : m_firstSequence(0), m_nextSequence(0), m_epoch(0), m_synced(false), m_maxEvents(maxEvents) {
+}
+
+void SearchIndex::Reset() {
+    m_process = FieldIndex();
+    m_path = FieldIndex();
+    m_description = FieldIndex();
+    m_sound = FieldIndex();
+    m_pids.clear();
+    m_timestamps.clear();
+}
+
+void SearchIndex::Add(uint64_t sequence, const AudioEvent& event) {
+    m_timestamps.push_back(std::chrono::duration_cast<std::chrono::milliseconds>(
+        event.timestamp.time_since_epoch()).count());
+    m_process.postings[m_process.Intern(event.processName)].push_back(sequence);
+    m_path.postings[m_path.Intern(event.processPath)].push_back(sequence);
+    m_description.postings[m_description.Intern(event.soundDescription)].push_back(sequence);
+    m_sound.postings[m_sound.Intern(event.soundLabel)].push_back(sequence);
+    m_pids[event.processId].push_back(sequence);
+}
+
+void SearchIndex::Evict() {
+    if (m_timestamps.size() <= m_maxEvents) {
+        return;
+    }
+
+    // Same policy as EventStore: drop the oldest tenth at once
+    size_t drop = m_timestamps.size() - m_maxEvents + m_maxEvents / 10;
+    drop = (std::min)(drop, m_timestamps.size());
+    m_timestamps.erase(m_timestamps.begin(), m_timestamps.begin() + static_cast<ptrdiff_t>(drop));
+    m_firstSequence += drop;
+
+    auto prune = [this](std::vector<uint64_t>& postings) {
+        postings.erase(postings.begin(), std::lower_bound(postings.begin(), postings.end(), m_firstSequence));
+    };
+    for (FieldIndex* field : { &m_process, &m_path, &m_description, &m_sound }) {
+        for (auto& postings : field->postings) {
+            prune(postings);
+        }
+        field->Compact();
+    }
+    for (auto it = m_pids.begin(); it != m_pids.end();) {
+        prune(it->second);
+        it = it->second.empty() ? m_pids.erase(it) : std::next(it);
+    }
+}
+
+void SearchIndex::Sync(const EventStore& store) {
+    EventDelta delta = store.ReadSince(m_synced ? m_nextSequence : 0);
+
+    // A gap means the store dropped events before they were read; rebuild
+    // rather than leave holes in the sequence numbering
+    if (!m_synced || delta.epoch != m_epoch ||
+        (delta.firstSequence > m_nextSequence && !m_timestamps.empty())) {
+        if (m_synced) {
+            delta = store.ReadSince(0);
+        }
+        Reset();
+        m_firstSequence = delta.firstSequence;
+        m_epoch = delta.epoch;
+        m_synced = true;
+    } else if (m_timestamps.empty()) {
+        m_firstSequence = delta.firstSequence;
+    }
+
+    uint64_t sequence = delta.firstSequence;
+    for (const auto& event : delta.events) {
+        Add(sequence++, event);
+    }
+    m_nextSequence = delta.nextSequence;
+    Evict();
+}
+
+void SearchIndex::FindText(const FieldIndex& field, const SearchQuery::Term& term, uint64_t from,
+                           std::vector<uint64_t>& out) const {
+    auto append = [&](uint32_t id) {
+        AppendFrom(field.postings[id], from, out);
+    };
+
+    if (term.regex) {
+        // Distinct strings only; a regex cannot use the trigram index
+        for (uint32_t id = 0; id < field.originals.size(); ++id) {
+            if (std::regex_search(field.originals[id], *term.regex)) {
+                append(id);
+            }
+        }
+        return;
+    }
+
+    if (term.text.size() < 3) {
+        for (uint32_t id = 0; id < field.folded.size(); ++id) {
+            if (field.folded[id].find(term.text) != std::string::npos) {
+                append(id);
+            }
+        }
+        return;
+    }
+
+    // Intersect the id lists of the needle's trigrams, shortest first
+    std::vector<const std::vector<uint32_t>*> lists;
+    for (uint32_t gram : Trigrams(term.text)) {
+        auto it = field.trigrams.find(gram);
+        if (it == field.trigrams.end()) {
+            return;
+        }
+        lists.push_back(&it->second);
+    }
+    std::sort(lists.begin(), lists.end(),
+              [](const std::vector<uint32_t>* a, const std::vector<uint32_t>* b) { return a->size() < b->size(); });
+
+    std::vector<uint32_t> candidates(*lists[0]);
+    std::vector<uint32_t> narrowed;
+    for (size_t i = 1; i < lists.size() && !candidates.empty(); ++i) {
+        narrowed.clear();
+        std::set_intersection(candidates.begin(), candidates.end(), lists[i]->begin(), lists[i]->end(),
+                              std::back_inserter(narrowed));
+        candidates.swap(narrowed);
+    }
+
+    // Trigrams can all occur without the needle itself; confirm each one
+    for (uint32_t id : candidates) {
+        if (field.folded[id].find(term.text) != std::string::npos) {
+            append(id);
+        }
+    }
+}
+
+std::vector<uint64_t> SearchIndex::Find(const SearchQuery& query, uint64_t fromSequence) const {
+    uint64_t from = (std::max)(fromSequence, m_firstSequence);
+    std::vector<uint64_t> result;
+    bool first = true;
+
+    for (const auto& term : query.GetTerms()) {
+        std::vector<uint64_t> matches;
+        switch (term.field) {
+            case SearchQuery::Field::Any:
+                FindText(m_process, term, from, matches);
+                FindText(m_description, term, from, matches);
+                FindText(m_sound, term, from, matches);
+                break;
+            case SearchQuery::Field::Process:
+                FindText(m_process, term, from, matches);
+                break;
+            case SearchQuery::Field::Path:
+                FindText(m_path, term, from, matches);
+                break;
+            case SearchQuery::Field::Description:
+                FindText(m_description, term, from, matches);
+                break;
+            case SearchQuery::Field::Sound:
+                FindText(m_sound, term, from, matches);
+                break;
+            case SearchQuery::Field::Pid: {
+                auto it = m_pids.find(term.pid);
+                if (it != m_pids.end()) {
+                    AppendFrom(it->second, from, matches);
+                }
+                break;
+            }
+        }
+        SortUnique(matches);
+
+        if (first) {
+            result.swap(matches);
+            first = false;
+        } else {
+            std::vector<uint64_t> both;
+            std::set_intersection(result.begin(), result.end(), matches.begin(), matches.end(),
+                                  std::back_inserter(both));
+            result.swap(both);
+        }
+        if (result.empty()) {
+            return result;
+        }
+    }
+
+    if (first) {
+        for (uint64_t sequence = from; sequence < m_nextSequence; ++sequence) {
+            result.push_back(sequence);
+        }
+    }
+
+    // Time bounds are checked per event, so out-of-order clocks stay correct
+    int64_t after = query.GetAfter() == (std::chrono::system_clock::time_point::min)()
+        ? INT64_MIN
+        : std::chrono::duration_cast<std::chrono::milliseconds>(query.GetAfter().time_since_epoch()).count();
+    int64_t before = query.GetBefore() == (std::chrono::system_clock::time_point::max)()
+        ? INT64_MAX
+        : std::chrono::duration_cast<std::chrono::milliseconds>(query.GetBefore().time_since_epoch()).count();
+    if (after != INT64_MIN || before != INT64_MAX) {
+        result.erase(std::remove_if(result.begin(), result.end(), [&](uint64_t sequence) {
+            int64_t time = m_timestamps[sequence - m_firstSequence];
+            return time < after || time >= before;
+        }), result.end());
+    }
+    return result;
+}
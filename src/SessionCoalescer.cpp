@@ -0,0 +1,107 @@
+#include "../include/SessionCoalescer.h"
+#include "../include/Metrics.h"
+#include <algorithm>
+
+namespace {
+
+const uint32_t DEFAULT_WINDOW_MS = 100;  // Under the 250 ms poll, so polls stay apart
+
+} // namespace
+
+SessionCoalescer::SessionCoalescer()
+    : m_window(DEFAULT_WINDOW_MS), m_stopped(false), m_observed(0), m_delivered(0) {
+}
+
+void SessionCoalescer::SetWindow(uint32_t milliseconds) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_window = std::chrono::milliseconds(milliseconds);
+}
+
+uint32_t SessionCoalescer::GetWindow() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return static_cast<uint32_t>(m_window.count());
+}
+
+void SessionCoalescer::Observe(DWORD processId, uint32_t endpoint, bool hasVolume, float volume, float peak,
+                               TraceSource source, TimestampClock::Tick captured) {
+    ++m_observed;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_stopped) {
+        return;
+    }
+    for (SessionBurst& burst : m_open) {
+        if (burst.processId == processId && burst.endpoint == endpoint && m_window.count() > 0) {
+            METRICS_COUNT(SamplesCoalesced, 1);
+            if (hasVolume) {
+                burst.volume = volume;
+            }
+            burst.peak = (std::max)(burst.peak, peak);
+            ++burst.count;
+            if (burst.source != TraceSource::Poll) {
+                burst.source = source;
+            }
+            return;
+        }
+    }
+
+    SessionBurst burst;
+    burst.processId = processId;
+    burst.endpoint = endpoint;
+    burst.volume = hasVolume ? volume : 0.0f;
+    burst.peak = peak;
+    burst.count = 1;
+    burst.source = source;
+    burst.captured = captured;
+    burst.due = captured + m_window;
+    m_open.push_back(burst);
+    m_wake.notify_one();
+}
+
+void SessionCoalescer::Drain(std::chrono::steady_clock::time_point now, std::vector<SessionBurst>& out) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    // Bursts leave in the order they opened, even across a window change
+    size_t kept = 0;
+    for (size_t i = 0; i < m_open.size(); ++i) {
+        if (m_open[i].due <= now) {
+            out.push_back(m_open[i]);
+            ++m_delivered;
+        } else {
+            m_open[kept++] = m_open[i];
+        }
+    }
+    m_open.resize(kept);
+}
+
+std::chrono::steady_clock::time_point SessionCoalescer::EarliestDue() const {
+    auto due = m_open.front().due;
+    for (const SessionBurst& burst : m_open) {
+        due = (std::min)(due, burst.due);
+    }
+    return due;
+}
+
+bool SessionCoalescer::Wait(std::vector<SessionBurst>& out) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_stopped) {
+        if (m_open.empty()) {
+            m_wake.wait(lock);
+        } else if (m_wake.wait_until(lock, EarliestDue()) == std::cv_status::timeout) {
+            break;
+        }
+    }
+    bool stopped = m_stopped;
+    lock.unlock();
+    Drain(stopped ? std::chrono::steady_clock::time_point::max() : std::chrono::steady_clock::now(), out);
+    return !stopped;
+}
+
+void SessionCoalescer::Stop() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stopped = true;
+    m_wake.notify_all();
+}
+
+void SessionCoalescer::Restart() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stopped = false;
+}
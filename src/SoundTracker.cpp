@@ -1,6 +1,9 @@
 #define NOMINMAX  // Prevent Windows.h from defining min/max macros
 #include "../include/SoundTracker.h"
 #include "../include/Logger.h"
+#include "../include/Utf8.h"
+#include "../include/CsvReader.h"
+#include "../include/Metrics.h"
 #include <psapi.h>
 #include <audioclient.h>
 #include <iostream>
@@ -16,13 +19,36 @@
 #pragma comment(lib, "setupapi.lib")
 #pragma comment(lib, "cfgmgr32.lib")
 
+// Size of the persistent event ring (logs\events.ring)
+static const uint64_t EVENT_RING_BYTES = 64ull * 1024 * 1024;
+
+// Memory for recent events; older ones spill to logs\spill\recent
+static const size_t STORE_MAX_BYTES = 16 * 1024 * 1024;
+
+// Memory for imported CSV rows; older rows spill to logs\spill\history
+static const size_t HISTORY_MAX_BYTES = 64 * 1024 * 1024;
+
+// Memory for per-session volume and peak samples; a steady poll costs a few
+// bytes per sample, so this holds days of history for a handful of sessions
+static const size_t LEVEL_HISTORY_BYTES = 8 * 1024 * 1024;
+
+// Disk for each store's spill segments; the oldest are deleted past this
+static const uint64_t SPILL_MAX_BYTES = 512ull * 1024 * 1024;
+
+// How often logs\metrics.json is rewritten while tracking
+static const std::chrono::seconds METRICS_INTERVAL(10);
+
+// Time between session polls; a polled event started at most this long ago
+static const std::chrono::milliseconds POLL_INTERVAL(250);
+
 // Define USB device class GUID if not already defined
 #ifndef GUID_DEVCLASS_USB
 DEFINE_GUID(GUID_DEVCLASS_USB, 0x36fc9e60, 0xc465, 0x11cf, 0x80, 0x56, 0x44, 0x45, 0x53, 0x54, 0x00, 0x00);
 #endif
 
-CSoundTrackerAudioSessionEvents::CSoundTrackerAudioSessionEvents(SoundTracker* pTracker, DWORD processId) 
-    : _cRef(1), _pTracker(pTracker), _processId(processId) {
+CSoundTrackerAudioSessionEvents::CSoundTrackerAudioSessionEvents(SoundTracker* pTracker, DWORD processId,
+                                                                 uint32_t endpoint)
+    : _cRef(1), _pTracker(pTracker), _processId(processId), _endpoint(endpoint) {
 }
 
 CSoundTrackerAudioSessionEvents::~CSoundTrackerAudioSessionEvents() {
@@ -58,14 +84,14 @@ HRESULT STDMETHODCALLTYPE CSoundTrackerAudioSessionEvents::QueryInterface(REFIID
 
 HRESULT STDMETHODCALLTYPE CSoundTrackerAudioSessionEvents::OnSimpleVolumeChanged(float NewVolume, BOOL NewMute, LPCGUID EventContext) {
     if (!NewMute && NewVolume > 0.0f) {
-        _pTracker->AddAudioEvent(_processId, NewVolume, 0.0f);
+        _pTracker->AddAudioEvent(_processId, NewVolume, 0.0f, TraceSource::VolumeChanged, _endpoint);
     }
     return S_OK;
 }
 
 HRESULT STDMETHODCALLTYPE CSoundTrackerAudioSessionEvents::OnStateChanged(AudioSessionState NewState) {
     if (NewState == AudioSessionStateActive) {
-        _pTracker->AddAudioEvent(_processId, 0.0f, 0.0f);
+        _pTracker->AddAudioEvent(_processId, 0.0f, 0.0f, TraceSource::StateChanged, _endpoint);
     }
     return S_OK;
 }
@@ -91,27 +117,28 @@ HRESULT STDMETHODCALLTYPE CSoundTrackerAudioSessionEvents::OnSessionDisconnected
 }
 
 SoundTracker::SoundTracker() 
-    : m_running(false), m_pEnumerator(nullptr), m_logger(nullptr) {
+    : m_running(false),
+      m_endpoints([this](const std::string& endpointId) { return OpenEndpoint(endpointId); }, POLL_INTERVAL),
+      m_endpointIds(1), m_store(STORE_MAX_BYTES), m_history(HISTORY_MAX_BYTES), m_levels(LEVEL_HISTORY_BYTES),
+      m_pEnumerator(nullptr), m_logger(nullptr),
+      m_enricher(*this), m_metricsCollector(0) {
     m_startTime = std::chrono::system_clock::now();
     m_logFilePath = L"logs\\sound_tracker.log";
+    
+    // Store size is cheaper to read at snapshot time than to track per event
+    m_metricsCollector = MetricsRegistry::Instance().AddCollector([this]() {
+        METRICS_GAUGE_SET(StoreEvents, static_cast<int64_t>(m_store.GetEventCount()));
+        METRICS_GAUGE_SET(StoreMemoryBytes, static_cast<int64_t>(m_store.GetMemoryUsage()));
+        METRICS_GAUGE_SET(StoreSpilledEvents, static_cast<int64_t>(m_store.GetSpilledEventCount()));
+        METRICS_GAUGE_SET(StoreSpillBytes, static_cast<int64_t>(m_store.GetSpillDiskUsage()));
+        METRICS_GAUGE_SET(LevelSamples, static_cast<int64_t>(m_levels.GetSampleCount()));
+        METRICS_GAUGE_SET(LevelMemoryBytes, static_cast<int64_t>(m_levels.GetMemoryUsage()));
+    });
 }
 
 SoundTracker::~SoundTracker() {
     Stop();
-    
-    // Clean up all registered audio session events
-    {
-        std::lock_guard<std::mutex> lock(m_eventsMutex);
-        for (auto& pair : m_activeEvents) {
-            // Unregister the event notification
-            pair.first->UnregisterAudioSessionNotification(pair.second);
-            // Release the event object
-            pair.second->Release();
-            // Release the session control
-            pair.first->Release();
-        }
-        m_activeEvents.clear();
-    }
+    MetricsRegistry::Instance().RemoveCollector(m_metricsCollector);
     
     if (m_pEnumerator) {
         m_pEnumerator->Release();
@@ -128,6 +155,15 @@ bool SoundTracker::Initialize() {
     hr = CoCreateInstance(__uuidof(MMDeviceEnumerator), NULL, CLSCTX_ALL,
                          __uuidof(IMMDeviceEnumerator), (void**)&m_pEnumerator);
     
+    // Events past the memory budget go to disk instead of being dropped.
+    // Without a spill directory the oldest events are simply evicted.
+    m_store.OpenSpill(L"logs\\spill\\recent", SPILL_MAX_BYTES);
+    m_history.OpenSpill(L"logs\\spill\\history", SPILL_MAX_BYTES);
+    
+    // Restore the previous history from the persistent ring (warm restart).
+    // Failure only costs persistence, tracking still works.
+    m_store.OpenRing(L"logs\\events.ring", EVENT_RING_BYTES);
+    
     // Logger will be created when tracking starts
     
     return SUCCEEDED(hr);
@@ -136,11 +172,7 @@ bool SoundTracker::Initialize() {
 void SoundTracker::Start() {
     if (m_running) return;
     
-    // Clear previous events for new session
-    {
-        std::lock_guard<std::mutex> lock(m_logMutex);
-        m_events.clear();
-    }
+    // Events are kept across sessions; the ring-backed store is the history
     
     // Create a new logger for this tracking session
     m_logger = std::make_unique<Logger>(L"logs");
@@ -152,7 +184,12 @@ void SoundTracker::Start() {
     m_startTime = std::chrono::system_clock::now();
     
     m_running = true;
+    m_coalescer.Restart();
+    m_coalesceThread = std::thread(&SoundTracker::DeliverCoalesced, this);
     m_monitorThread = std::thread(&SoundTracker::MonitorAudioSessions, this);
+    
+    // The logger has created logs\ by now
+    m_metricsReporter.Start(L"logs\\metrics.json", METRICS_INTERVAL);
 }
 
 void SoundTracker::Stop() {
@@ -161,9 +198,91 @@ void SoundTracker::Stop() {
         m_monitorThread.join();
     }
     
-    // Clean up all registered audio session events when stopping
-    {
-        std::lock_guard<std::mutex> lock(m_eventsMutex);
+    // Each endpoint's worker unregisters its sessions' events as it stops
+    m_endpoints.Clear();
+    
+    // Nothing observes any more; deliver what is still open
+    m_coalescer.Stop();
+    if (m_coalesceThread.joinable()) {
+        m_coalesceThread.join();
+    }
+    
+    // Close the logger
+    if (m_logger) {
+        m_logger->Close();
+    }
+    
+    // Writes the final totals
+    m_metricsReporter.Stop();
+}
+
+// Owns one endpoint's device, session manager and session event
+// registrations; lives on its EndpointPool worker's thread
+class SoundTracker::EndpointSessionPoller : public EndpointPoller {
+private:
+    SoundTracker* m_tracker;
+    uint32_t m_endpoint;
+    bool m_comInitialized;
+    IAudioSessionManager2* m_pSessionManager;
+    IAudioMeterInformation* m_pEndpointMeter;  // The device's own peak, read before any session's
+    MeterGate m_gate;
+    // Sessions registered for events, released with the poller
+    std::vector<std::pair<IAudioSessionControl2*, CSoundTrackerAudioSessionEvents*>> m_activeEvents;
+    std::vector<std::wstring> m_registeredSessions;  // Instance ids of sessions in m_activeEvents
+
+    // Register for events once per session. The poll meets every session
+    // again on each tick; registering each time allocated a new callback
+    // object per session per tick and multiplied the callbacks.
+    void Register(IAudioSessionControl2* pSessionControl) {
+        DWORD processId = 0;
+        LPWSTR pInstanceId = nullptr;
+        if (FAILED(pSessionControl->GetProcessId(&processId)) ||
+            FAILED(pSessionControl->GetSessionInstanceIdentifier(&pInstanceId)) || !pInstanceId) {
+            return;
+        }
+        bool registered = std::any_of(m_registeredSessions.begin(), m_registeredSessions.end(),
+                                      [pInstanceId](const std::wstring& id) { return id == pInstanceId; });
+        if (!registered) {
+            CSoundTrackerAudioSessionEvents* pEvents = new CSoundTrackerAudioSessionEvents(m_tracker, processId, m_endpoint);
+            if (SUCCEEDED(pSessionControl->RegisterAudioSessionNotification(pEvents))) {
+                // Store for cleanup - AddRef the session control
+                pSessionControl->AddRef();
+                m_activeEvents.push_back(std::make_pair(pSessionControl, pEvents));
+                m_registeredSessions.push_back(pInstanceId);
+            } else {
+                // Registration failed, clean up
+                pEvents->Release();
+            }
+        }
+        CoTaskMemFree(pInstanceId);
+    }
+
+public:
+    EndpointSessionPoller(SoundTracker* tracker, const std::string& endpointId)
+        : m_tracker(tracker), m_endpoint(tracker->InternEndpoint(endpointId)), m_comInitialized(false),
+          m_pSessionManager(nullptr), m_pEndpointMeter(nullptr) {
+        m_comInitialized = SUCCEEDED(CoInitializeEx(NULL, COINIT_MULTITHREADED));
+        IMMDeviceEnumerator* pEnumerator = nullptr;
+        IMMDevice* pDevice = nullptr;
+        HRESULT hr = CoCreateInstance(__uuidof(MMDeviceEnumerator), NULL, CLSCTX_ALL,
+                                      __uuidof(IMMDeviceEnumerator), (void**)&pEnumerator);
+        if (SUCCEEDED(hr)) {
+            hr = pEnumerator->GetDevice(Utf8ToWide(endpointId).c_str(), &pDevice);
+        }
+        if (SUCCEEDED(hr)) {
+            pDevice->Activate(__uuidof(IAudioSessionManager2), CLSCTX_ALL, NULL, (void**)&m_pSessionManager);
+            // Without it the gate stays open and every session is read
+            pDevice->Activate(__uuidof(IAudioMeterInformation), CLSCTX_ALL, NULL, (void**)&m_pEndpointMeter);
+        }
+        if (pDevice) {
+            pDevice->Release();
+        }
+        if (pEnumerator) {
+            pEnumerator->Release();
+        }
+    }
+
+    ~EndpointSessionPoller() {
         for (auto& pair : m_activeEvents) {
             // Unregister the event notification
             pair.first->UnregisterAudioSessionNotification(pair.second);
@@ -172,69 +291,113 @@ void SoundTracker::Stop() {
             // Release the session control
             pair.first->Release();
         }
-        m_activeEvents.clear();
+        if (m_pEndpointMeter) {
+            m_pEndpointMeter->Release();
+        }
+        if (m_pSessionManager) {
+            m_pSessionManager->Release();
+        }
+        if (m_comInitialized) {
+            CoUninitialize();
+        }
     }
-    
-    // Close the logger
-    if (m_logger) {
-        m_logger->Close();
+
+    bool IsOpen() const { return m_pSessionManager != nullptr; }
+
+    void Poll() override {
+        TRACE_SPAN_ARG("PollEndpoint", "endpoint", m_endpoint);
+        TimestampClock::Tick now = TimestampClock::Capture();
+        float endpointPeak = 1.0f;
+        if (m_pEndpointMeter && FAILED(m_pEndpointMeter->GetPeakValue(&endpointPeak))) {
+            endpointPeak = 1.0f;
+        }
+        m_gate.BeginTick(endpointPeak, now);
+        
+        IAudioSessionEnumerator* pSessionEnumerator = nullptr;
+        if (FAILED(m_pSessionManager->GetSessionEnumerator(&pSessionEnumerator))) {
+            return;
+        }
+        int sessionCount = 0;
+        pSessionEnumerator->GetCount(&sessionCount);
+        
+        for (int i = 0; i < sessionCount; i++) {
+            IAudioSessionControl* pSessionControl = nullptr;
+            if (SUCCEEDED(pSessionEnumerator->GetSession(i, &pSessionControl))) {
+                IAudioSessionControl2* pSessionControl2 = nullptr;
+                pSessionControl->QueryInterface(__uuidof(IAudioSessionControl2), (void**)&pSessionControl2);
+                
+                if (pSessionControl2) {
+                    m_tracker->ProcessAudioSession(pSessionControl2, m_endpoint, m_gate, now);
+                    Register(pSessionControl2);
+                    pSessionControl2->Release();
+                }
+                pSessionControl->Release();
+            }
+        }
+        pSessionEnumerator->Release();
     }
-}
+};
 
 void SoundTracker::MonitorAudioSessions() {
+    SpanTracer::SetThreadName("Monitor");
+    std::vector<std::string> endpointIds;
     while (m_running) {
-        // Get ALL audio endpoints, not just the default
+        auto tickStart = std::chrono::steady_clock::now();
+        
+        // Get ALL active render endpoints, not just the default; each is
+        // polled by a worker of its own
         IMMDeviceCollection* pCollection = nullptr;
         HRESULT hr = m_pEnumerator->EnumAudioEndpoints(eRender, DEVICE_STATE_ACTIVE, &pCollection);
         
         if (SUCCEEDED(hr)) {
+            endpointIds.clear();
             UINT deviceCount = 0;
             pCollection->GetCount(&deviceCount);
-            
-            // Monitor all active audio devices
             for (UINT deviceIdx = 0; deviceIdx < deviceCount; deviceIdx++) {
                 IMMDevice* pDevice = nullptr;
                 if (SUCCEEDED(pCollection->Item(deviceIdx, &pDevice))) {
-                    IAudioSessionManager2* pSessionManager = nullptr;
-                    hr = pDevice->Activate(__uuidof(IAudioSessionManager2), CLSCTX_ALL, NULL, (void**)&pSessionManager);
-                    
-                    if (SUCCEEDED(hr)) {
-                        IAudioSessionEnumerator* pSessionEnumerator = nullptr;
-                        hr = pSessionManager->GetSessionEnumerator(&pSessionEnumerator);
-                        
-                        if (SUCCEEDED(hr)) {
-                            int sessionCount = 0;
-                            pSessionEnumerator->GetCount(&sessionCount);
-                            
-                            for (int i = 0; i < sessionCount; i++) {
-                                IAudioSessionControl* pSessionControl = nullptr;
-                                if (SUCCEEDED(pSessionEnumerator->GetSession(i, &pSessionControl))) {
-                                    IAudioSessionControl2* pSessionControl2 = nullptr;
-                                    pSessionControl->QueryInterface(__uuidof(IAudioSessionControl2), (void**)&pSessionControl2);
-                                    
-                                    if (pSessionControl2) {
-                                        ProcessAudioSession(pSessionControl2);
-                                        pSessionControl2->Release();
-                                    }
-                                    pSessionControl->Release();
-                                }
-                            }
-                            pSessionEnumerator->Release();
-                        }
-                        pSessionManager->Release();
+                    LPWSTR pDeviceId = nullptr;
+                    if (SUCCEEDED(pDevice->GetId(&pDeviceId)) && pDeviceId) {
+                        endpointIds.push_back(WideToUtf8(pDeviceId));
+                        CoTaskMemFree(pDeviceId);
                     }
                     pDevice->Release();
                 }
             }
             pCollection->Release();
+            m_endpoints.Sync(endpointIds);
+        }
+        
+        if (SpanTracer::IsEnabled()) {
+            SpanTracer::Record("MonitorTick", tickStart, std::chrono::steady_clock::now());
         }
         
-        // Reduced polling interval for better performance with multiple devices
-        std::this_thread::sleep_for(std::chrono::milliseconds(250));
+        // New and removed endpoints are picked up within a poll interval
+        std::this_thread::sleep_for(POLL_INTERVAL);
     }
 }
 
-void SoundTracker::ProcessAudioSession(IAudioSessionControl2* pSessionControl) {
+std::unique_ptr<EndpointPoller> SoundTracker::OpenEndpoint(const std::string& endpointId) {
+    std::unique_ptr<EndpointSessionPoller> poller(new EndpointSessionPoller(this, endpointId));
+    if (!poller->IsOpen()) {
+        return nullptr;
+    }
+    return poller;
+}
+
+uint32_t SoundTracker::InternEndpoint(const std::string& endpointId) {
+    std::lock_guard<std::mutex> lock(m_endpointMutex);
+    auto it = std::find(m_endpointIds.begin(), m_endpointIds.end(), endpointId);
+    if (it != m_endpointIds.end()) {
+        return static_cast<uint32_t>(it - m_endpointIds.begin());
+    }
+    m_endpointIds.push_back(endpointId);
+    return static_cast<uint32_t>(m_endpointIds.size() - 1);
+}
+
+void SoundTracker::ProcessAudioSession(IAudioSessionControl2* pSessionControl, uint32_t endpoint, MeterGate& gate,
+                                       TimestampClock::Tick now) {
+    TRACE_SPAN("ProcessAudioSession");
     DWORD processId = 0;
     HRESULT hr = pSessionControl->GetProcessId(&processId);
     
@@ -243,7 +406,13 @@ void SoundTracker::ProcessAudioSession(IAudioSessionControl2* pSessionControl) {
         AudioSessionState state;
         pSessionControl->GetState(&state);
         
-        if (state == AudioSessionStateActive) {
+        // A silent endpoint has no audible sessions; only those heard
+        // within the hold-off are still read. The rest still get a
+        // zero-peak level sample, so their history has no gaps.
+        bool active = state == AudioSessionStateActive;
+        if (active && !gate.ShouldRead(processId, now)) {
+            m_levels.AppendSilence(processId, TimestampClock::Instance().Now());
+        } else if (active) {
             ISimpleAudioVolume* pVolume = nullptr;
             hr = pSessionControl->QueryInterface(__uuidof(ISimpleAudioVolume), (void**)&pVolume);
             
@@ -255,8 +424,12 @@ void SoundTracker::ProcessAudioSession(IAudioSessionControl2* pSessionControl) {
                 
                 if (!mute && volume > 0.0f) {
                     float peak = GetPeakMeterValue(pSessionControl);
+                    gate.Report(processId, peak, now);
+                    // Every poll is kept for plotting, quiet ones included;
+                    // only audible peaks become events
+                    m_levels.Append(processId, TimestampClock::Instance().Now(), volume, peak);
                     if (peak > 0.001f) {  // Lower threshold to catch quiet system sounds
-                        AddAudioEvent(processId, volume, peak);
+                        AddAudioEvent(processId, volume, peak, TraceSource::Poll, endpoint);
                     }
                 }
                 
@@ -267,29 +440,18 @@ void SoundTracker::ProcessAudioSession(IAudioSessionControl2* pSessionControl) {
         // Get session display name for more info
         LPWSTR pDisplayName = nullptr;
         pSessionControl->GetDisplayName(&pDisplayName);
-        std::wstring sessionName;
+        std::string sessionName;
         if (pDisplayName) {
-            sessionName = pDisplayName;
+            sessionName = WideToUtf8(pDisplayName);
             CoTaskMemFree(pDisplayName);
         }
         
         // Store session name for event creation
         if (!sessionName.empty() && processId == 0) {
             // For system sounds, use session name as hint
+            std::lock_guard<std::mutex> lock(m_cacheMutex);
             m_sessionNames[0] = sessionName;
         }
-        
-        // Register for events and store for cleanup
-        CSoundTrackerAudioSessionEvents* pEvents = new CSoundTrackerAudioSessionEvents(this, processId);
-        if (SUCCEEDED(pSessionControl->RegisterAudioSessionNotification(pEvents))) {
-            // Store for cleanup - AddRef the session control
-            pSessionControl->AddRef();
-            std::lock_guard<std::mutex> lock(m_eventsMutex);
-            m_activeEvents.push_back(std::make_pair(pSessionControl, pEvents));
-        } else {
-            // Registration failed, clean up
-            pEvents->Release();
-        }
     }
 }
 
@@ -306,119 +468,61 @@ float SoundTracker::GetPeakMeterValue(IAudioSessionControl2* pSessionControl) {
     return peak;
 }
 
-std::wstring SoundTracker::GetProcessNameFromPID(DWORD processId) {
+void SoundTracker::GetProcessNameFromPID(DWORD processId, std::string& name) {
     // Check cache first with dedicated mutex to avoid deadlock
     {
-        std::lock_guard<std::mutex> lock(m_cacheMutex);
-        if (m_processCache.find(processId) != m_processCache.end()) {
-            return m_processCache[processId];
+        TracedLock lock(m_cacheMutex, "ProcessCache lock");
+        auto it = m_processCache.find(processId);
+        if (it != m_processCache.end()) {
+            name.assign(it->second);
+            return;
         }
     }
     
-    std::wstring processName = L"Unknown";
+    TRACE_SPAN_ARG("OpenProcess/GetModuleBaseName", "pid", processId);
+    name.assign("Unknown");
     HANDLE hProcess = OpenProcess(PROCESS_QUERY_INFORMATION | PROCESS_VM_READ, FALSE, processId);
     
     if (hProcess) {
         WCHAR szProcessName[MAX_PATH] = L"";
-        if (GetModuleBaseNameW(hProcess, NULL, szProcessName, sizeof(szProcessName) / sizeof(WCHAR))) {
-            processName = szProcessName;
+        DWORD length = GetModuleBaseNameW(hProcess, NULL, szProcessName, sizeof(szProcessName) / sizeof(WCHAR));
+        if (length) {
+            name.clear();
+            AppendUtf8(name, szProcessName, length);
             // Cache the result with dedicated mutex
             {
                 std::lock_guard<std::mutex> lock(m_cacheMutex);
-                m_processCache[processId] = processName;
+                m_processCache[processId] = name;
             }
         }
         CloseHandle(hProcess);
     }
-    
-    return processName;
 }
 
-std::wstring SoundTracker::GetProcessPathFromPID(DWORD processId) {
-    std::wstring processPath = L"";
+void SoundTracker::GetProcessPathFromPID(DWORD processId, std::string& path) {
+    TRACE_SPAN_ARG("OpenProcess/QueryFullProcessImageName", "pid", processId);
+    path.clear();
     HANDLE hProcess = OpenProcess(PROCESS_QUERY_INFORMATION | PROCESS_VM_READ, FALSE, processId);
     
     if (hProcess) {
         WCHAR szProcessPath[MAX_PATH] = L"";
         DWORD size = MAX_PATH;
         if (QueryFullProcessImageNameW(hProcess, 0, szProcessPath, &size)) {
-            processPath = szProcessPath;
+            AppendUtf8(path, szProcessPath, size);
         }
         CloseHandle(hProcess);
     }
-    
-    return processPath;
 }
 
-std::wstring SoundTracker::GetSoundDescription(DWORD processId, const std::wstring& processName) {
-    // System sounds - including USB device sounds
-    if (processId == 0) {
-        return L"Windows System Sound (USB/Device Connect)";
-    }
-    if (processId == 4) {
-        return L"Windows Kernel System Sound";
-    }
-    
-    // Common applications and system processes
-    std::unordered_map<std::wstring, std::wstring> knownApps = {
-        {L"chrome.exe", L"Google Chrome Browser"},
-        {L"firefox.exe", L"Mozilla Firefox Browser"},
-        {L"msedge.exe", L"Microsoft Edge Browser"},
-        {L"Discord.exe", L"Discord Voice/Message"},
-        {L"Teams.exe", L"Microsoft Teams"},
-        {L"Spotify.exe", L"Spotify Music"},
-        {L"slack.exe", L"Slack Notification"},
-        {L"outlook.exe", L"Outlook Email Notification"},
-        {L"explorer.exe", L"Windows Explorer/System Sound"},
-        {L"svchost.exe", L"Windows Service/System Sound"},
-        {L"audiodg.exe", L"Windows Audio Device Graph"},
-        {L"RuntimeBroker.exe", L"Windows Runtime Broker"},
-        {L"SearchApp.exe", L"Windows Search"},
-        {L"ShellExperienceHost.exe", L"Windows Shell Experience"},
-        {L"SystemSettings.exe", L"Windows Settings"},
-        {L"UserNotificationBroker.exe", L"Windows Notifications"},
-        {L"csrss.exe", L"Windows Client/Server Runtime"},
-        {L"dwm.exe", L"Desktop Window Manager"},
-        {L"winlogon.exe", L"Windows Logon Process"},
-        {L"services.exe", L"Windows Services Controller"},
-        {L"lsass.exe", L"Local Security Authority"},
-        {L"System", L"Windows System Process"},
-        {L"TextInputHost.exe", L"Windows Text Input (Keyboard)"},
-        {L"ctfmon.exe", L"CTF Loader (Keyboard/Language)"},
-        {L"TabTip.exe", L"Touch Keyboard and Handwriting"},
-        {L"osk.exe", L"On-Screen Keyboard"},
-        {L"SynTPEnh.exe", L"Synaptics TouchPad"},
-        {L"ETDCtrl.exe", L"ELAN TouchPad"},
-        {L"", L"Unknown System Process (Possible USB/Keyboard Event)"},
-    };
-    
-    // Special handling for empty process name (system sounds)
-    if (processName.empty() || processName == L"Unknown") {
-        return L"System Sound (Check USB/Keyboard/Input Devices)";
-    }
-    
-    // Check for keyboard-related processes
-    if (processName.find(L"TabTip") != std::wstring::npos ||
-        processName.find(L"TextInput") != std::wstring::npos ||
-        processName.find(L"ctfmon") != std::wstring::npos ||
-        processName.find(L"osk") != std::wstring::npos) {
-        return processName + L" (Keyboard/Input Related)";
-    }
-    
-    auto it = knownApps.find(processName);
-    if (it != knownApps.end()) {
-        return it->second;
-    }
+void SoundTracker::GetUSBDeviceInfo(DWORD processId, const std::string& processName, std::string& result) {
+    result.clear();
     
-    return processName + L" Audio";
-}
-
-std::wstring SoundTracker::GetUSBDeviceInfo(DWORD processId, const std::wstring& processName) {
     // Check if this might be USB-related
-    if (processId == 0 || processId == 4 || processName == L"svchost.exe" || 
-        processName == L"System" || processName.empty()) {
+    if (processId == 0 || processId == 4 || processName == "svchost.exe" || 
+        processName == "System" || processName.empty()) {
         
         // Enumerate USB devices to find recently connected ones
+        TRACE_SPAN_ARG("SetupAPI USB scan", "pid", processId);
         HDEVINFO hDevInfo = SetupDiGetClassDevs(&GUID_DEVCLASS_USB, NULL, NULL, DIGCF_PRESENT);
         if (hDevInfo != INVALID_HANDLE_VALUE) {
             SP_DEVINFO_DATA deviceData;
@@ -480,22 +584,23 @@ std::wstring SoundTracker::GetUSBDeviceInfo(DWORD processId, const std::wstring&
                         }
                         
                         SetupDiDestroyDeviceInfoList(hDevInfo);
-                        return info;
+                        AppendUtf8(result, info.c_str(), info.length());
+                        return;
                     }
                 }
             }
             SetupDiDestroyDeviceInfoList(hDevInfo);
         }
     }
-    
-    return L"";
 }
 
-std::wstring SoundTracker::GetBrowserTabInfo(DWORD processId, const std::wstring& processName) {
+void SoundTracker::GetBrowserTabInfo(DWORD processId, const std::string& processName, std::string& info) {
+    info.clear();
+    
     // Check if this is a browser process
-    if (processName == L"chrome.exe" || processName == L"msedge.exe" || 
-        processName == L"firefox.exe" || processName == L"opera.exe" ||
-        processName == L"brave.exe" || processName == L"vivaldi.exe") {
+    if (processName == "chrome.exe" || processName == "msedge.exe" || 
+        processName == "firefox.exe" || processName == "opera.exe" ||
+        processName == "brave.exe" || processName == "vivaldi.exe") {
         
         // Find all windows for this process
         struct EnumData {
@@ -503,6 +608,7 @@ std::wstring SoundTracker::GetBrowserTabInfo(DWORD processId, const std::wstring
             std::wstring title;
         } enumData = { processId, L"" };
         
+        TRACE_SPAN_ARG("EnumWindows", "pid", processId);
         EnumWindows([](HWND hwnd, LPARAM lParam) -> BOOL {
             EnumData* pData = reinterpret_cast<EnumData*>(lParam);
             
@@ -544,84 +650,127 @@ std::wstring SoundTracker::GetBrowserTabInfo(DWORD processId, const std::wstring
         }, reinterpret_cast<LPARAM>(&enumData));
         
         if (!enumData.title.empty()) {
-            return L"Tab: \"" + enumData.title + L"\"";
+            info += "Tab: \"";
+            AppendUtf8(info, enumData.title.c_str(), enumData.title.length());
+            info += "\"";
         }
     }
-    
-    return L"";
 }
 
-void SoundTracker::AddAudioEvent(DWORD processId, float volume, float peak) {
+void SoundTracker::AddAudioEvent(DWORD processId, float volume, float peak, TraceSource source, uint32_t endpoint) {
+    METRICS_COUNT(SamplesReceived, 1);
+    // State callbacks carry no volume; everything else does, muted included
+    m_coalescer.Observe(processId, endpoint, source != TraceSource::StateChanged, volume, peak, source,
+                        TimestampClock::Capture());
+}
+
+void SoundTracker::DeliverCoalesced() {
+    SpanTracer::SetThreadName("Coalescer");
+    std::vector<SessionBurst> bursts;
+    bool running = true;
+    while (running) {
+        bursts.clear();
+        running = m_coalescer.Wait(bursts);
+        for (const SessionBurst& burst : bursts) {
+            DeliverBurst(burst);
+        }
+    }
+}
+
+void SoundTracker::DeliverBurst(const SessionBurst& burst) {
+    TRACE_SPAN_ARG("DeliverBurst", "pid", burst.processId);
+    METRICS_TIMER_START(callbackStart);
+    DWORD processId = burst.processId;
+    TraceSource source = burst.source;
     try {
-        AudioEvent event;
-        event.timestamp = std::chrono::system_clock::now();
-        event.processId = processId;
-        event.processName = GetProcessNameFromPID(processId);
-        event.processPath = GetProcessPathFromPID(processId);
-        event.soundDescription = GetSoundDescription(processId, event.processName);
+        auto enrichStart = std::chrono::steady_clock::now();
         
-        // Get USB device info if applicable
-        event.usbDeviceInfo = GetUSBDeviceInfo(processId, event.processName);
+        // Only the coalescer thread delivers, so one event's string buffers
+        // are reused from burst to burst instead of being allocated every time
+        static thread_local AudioEvent event;
+        static thread_local std::string sessionName;
         
-        // Get browser tab info if applicable
-        event.browserTabInfo = GetBrowserTabInfo(processId, event.processName);
-        
-        // Add session name to description if available
-        auto sessionIt = m_sessionNames.find(processId);
-        if (sessionIt != m_sessionNames.end() && !sessionIt->second.empty()) {
-            event.sessionDisplayName = sessionIt->second;
-            event.soundDescription += L" [" + sessionIt->second + L"]";
+        // Session display names are only known for sessions seen by the poll loop
+        sessionName.clear();
+        {
+            std::lock_guard<std::mutex> lock(m_cacheMutex);
+            auto sessionIt = m_sessionNames.find(processId);
+            if (sessionIt != m_sessionNames.end()) {
+                sessionName.assign(sessionIt->second);
+            }
         }
-        
-        // Add USB info to description if available
-        if (!event.usbDeviceInfo.empty()) {
-            event.soundDescription += L" - " + event.usbDeviceInfo;
+        // A poll sees a sound up to a poll interval after it started; with
+        // loopback capture running, the onset heard in that interval is the
+        // better timestamp
+        auto timestamp = TimestampClock::Instance().ToWall(burst.captured);
+        std::chrono::system_clock::time_point onset;
+        if (source == TraceSource::Poll && m_loopback.IsRunning() &&
+            m_loopback.GetFirstOnsetSince(timestamp - POLL_INTERVAL, onset) && onset <= timestamp) {
+            timestamp = onset;
         }
-        
-        // Add browser tab info to description if available
-        if (!event.browserTabInfo.empty()) {
-            event.soundDescription += L" - " + event.browserTabInfo;
+        m_enricher.Enrich(processId, burst.volume, burst.peak, sessionName, timestamp, event);
+        event.eventCount = burst.count;
+        {
+            std::lock_guard<std::mutex> lock(m_endpointMutex);
+            event.endpointId.assign(m_endpointIds[burst.endpoint < m_endpointIds.size() ? burst.endpoint : 0]);
+        }
+        event.features = SoundFeatures();
+        event.soundLabel.clear();
+        event.momentaryLoudness = LOUDNESS_FLOOR_LUFS;
+        event.shortTermLoudness = LOUDNESS_FLOOR_LUFS;
+        if (m_loopback.IsRunning()) {
+            m_loopback.GetRecentFeatures(event.features);
+            m_loopback.GetRecentSoundLabel(event.soundLabel);
+            m_loopback.GetLoudness(event.momentaryLoudness, event.shortTermLoudness);
+        }
+        // Polls are evenly spaced, so their loudness serves as the process's gating blocks
+        if (source == TraceSource::Poll && HasLoudness(event)) {
+            std::lock_guard<std::mutex> lock(m_loudnessMutex);
+            LoudnessStats& stats = m_processLoudness[processId];
+            stats.AddBlock(event.momentaryLoudness);
+            stats.AddShortTerm(event.shortTermLoudness);
         }
         
-        event.volumeLevel = volume;
-        event.peakLevel = peak;
-        event.isSystemSound = (processId == 0 || processId == 4 || event.processName == L"svchost.exe");
-        event.duration_ms = 0;  // Will be calculated based on continuous events
-        event.eventCount = 1;  // Default count
+        if (m_trace.IsOpen()) {
+            TraceSample sample;
+            sample.source = source;
+            sample.event = event;
+            sample.enrichMicros = static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - enrichStart).count());
+            m_trace.Record(sample);
+        }
         
-        // Thread-safe addition to events vector
+        // Rules run after recording, so a replay of the trace with the same
+        // rules sees what they saw
+        static thread_local std::vector<uint32_t> fired;
+        static thread_local std::vector<std::string> alerts;
+        std::function<void(const std::string& rule, const AudioEvent& event)> alert;
+        fired.clear();
         {
-            std::lock_guard<std::mutex> lock(m_logMutex);
-            
-            // Check if we should batch with the last event
-            if (!m_events.empty()) {
-                auto& lastEvent = m_events.back();
-                
-                // Get time_t for both timestamps to compare minutes
-                auto lastTime = std::chrono::system_clock::to_time_t(lastEvent.timestamp);
-                auto currentTime = std::chrono::system_clock::to_time_t(event.timestamp);
-                
-                std::tm lastTm = {}, currentTm = {};
-                localtime_s(&lastTm, &lastTime);
-                localtime_s(&currentTm, &currentTime);
-                
-                // If same minute (hour and minute match) AND same process, increment count
-                if (lastTm.tm_hour == currentTm.tm_hour && 
-                    lastTm.tm_min == currentTm.tm_min && 
-                    lastEvent.processId == event.processId) {
-                    lastEvent.eventCount++;
-                    // Update peak/volume to max values
-                    lastEvent.peakLevel = (std::max)(lastEvent.peakLevel, event.peakLevel);
-                    lastEvent.volumeLevel = (std::max)(lastEvent.volumeLevel, event.volumeLevel);
-                    return;  // Don't add new event, just increment count
+            std::lock_guard<std::mutex> lock(m_rulesMutex);
+            if (!m_rules.Evaluate(event, fired)) {
+                return;
+            }
+            // Copied out, so the callback runs unlocked and may reload rules
+            if (m_alertCallback && !fired.empty()) {
+                alert = m_alertCallback;
+                alerts.resize(fired.size());
+                for (size_t i = 0; i < fired.size(); ++i) {
+                    alerts[i].assign(m_rules.GetRuleName(fired[i]));
                 }
             }
-            
-            // Limit memory usage - keep only last 10000 events
-            if (m_events.size() > 10000) {
-                m_events.erase(m_events.begin(), m_events.begin() + 1000);
+        }
+        if (alert) {
+            for (size_t i = 0; i < fired.size(); ++i) {
+                alert(alerts[i], event);
             }
-            m_events.push_back(event);
+        }
+        
+        // Thread-safe addition to the store; batched repeats are not logged again
+        bool added = m_store.Add(event);
+        METRICS_TIMER_RECORD(CallbackToStore, callbackStart);
+        if (!added) {
+            return;
         }
         
         // Log to file (non-blocking)
@@ -629,8 +778,52 @@ void SoundTracker::AddAudioEvent(DWORD processId, float volume, float peak) {
     }
     catch (const std::exception&) {
         // Silently ignore exceptions to keep monitoring running
-        // Could add debug logging here if needed
+        METRICS_COUNT(EventsDropped, 1);
+    }
+}
+
+bool SoundTracker::EnableFeatureCapture(bool enable) {
+    if (!enable) {
+        m_loopback.Stop();
+        return true;
+    }
+    return m_loopback.Start();
+}
+
+bool SoundTracker::LoadSoundLibrary(const std::wstring& directory) {
+    auto library = std::make_unique<FingerprintIndex>();
+    if (library->AddDirectory(directory) == 0) {
+        return false;
     }
+    m_loopback.SetSoundLibrary(std::move(library));
+    return true;
+}
+
+bool SoundTracker::LoadRules(const std::wstring& path, std::string& error) {
+    // Compiled outside the lock, so the pipeline only waits for the swap
+    RuleEngine rules;
+    if (!rules.LoadFile(path, error)) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(m_rulesMutex);
+    m_rules = std::move(rules);
+    return true;
+}
+
+void SoundTracker::SetAlertCallback(std::function<void(const std::string& rule, const AudioEvent& event)> callback) {
+    std::lock_guard<std::mutex> lock(m_rulesMutex);
+    m_alertCallback = std::move(callback);
+}
+
+bool SoundTracker::GetProcessLoudness(DWORD processId, float& integrated, float& range) const {
+    std::lock_guard<std::mutex> lock(m_loudnessMutex);
+    auto it = m_processLoudness.find(processId);
+    if (it == m_processLoudness.end()) {
+        return false;
+    }
+    integrated = it->second.GetIntegrated();
+    range = it->second.GetRange();
+    return true;
 }
 
 void SoundTracker::LogEvent(const AudioEvent& event) {
@@ -642,29 +835,31 @@ void SoundTracker::LogEvent(const AudioEvent& event) {
 
 bool SoundTracker::ExportLogs(const std::wstring& outputPath, 
                              const std::chrono::system_clock::time_point& startTime,
-                             const std::chrono::system_clock::time_point& endTime) {
+                             const std::chrono::system_clock::time_point& endTime,
+                             LogFormat format) {
     std::vector<AudioEvent> filteredEvents = GetEvents(startTime, endTime);
     // Use the existing logger instance if available, otherwise create temporary one
     if (m_logger) {
-        return m_logger->ExportEvents(filteredEvents, outputPath, LogFormat::CSV);
+        return m_logger->ExportEvents(filteredEvents, outputPath, format);
     } else {
         Logger tempLogger(L"logs");
-        return tempLogger.ExportEvents(filteredEvents, outputPath, LogFormat::CSV);
+        return tempLogger.ExportEvents(filteredEvents, outputPath, format);
     }
 }
 
 std::vector<AudioEvent> SoundTracker::GetEvents(const std::chrono::system_clock::time_point& startTime,
                                                const std::chrono::system_clock::time_point& endTime) {
-    std::lock_guard<std::mutex> lock(m_logMutex);
-    std::vector<AudioEvent> filtered;
-    
-    for (const auto& event : m_events) {
-        if (event.timestamp >= startTime && event.timestamp <= endTime) {
-            filtered.push_back(event);
-        }
-    }
-    
-    return filtered;
+    return m_store.GetEvents(startTime, endTime);
+}
+
+bool SoundTracker::ImportLog(const std::wstring& logPath) {
+    CsvReader reader;
+    return reader.ReadFile(logPath, m_history);
+}
+
+std::vector<AudioEvent> SoundTracker::GetHistoricalEvents(const std::chrono::system_clock::time_point& startTime,
+                                                          const std::chrono::system_clock::time_point& endTime) {
+    return m_history.GetEvents(startTime, endTime);
 }
 
 std::wstring SoundTracker::GetCurrentLogPath() const {
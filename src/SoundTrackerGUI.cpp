@@ -1,5 +1,7 @@
 #include "../include/SoundTrackerGUI.h"
 #include "../include/Logger.h"
+#include "../include/Utf8.h"
+#include "../include/TimestampClock.h"
 #include "../resource.h"
 #include <sstream>
 #include <iomanip>
@@ -13,10 +15,11 @@ SoundTrackerGUI::SoundTrackerGUI()
       m_hButtonClear(nullptr), m_hStatusBar(nullptr),
       m_hFilterCheckbox(nullptr), m_hFilterEdit(nullptr), m_hFont(nullptr),
       m_hBoldFont(nullptr), m_hIcon(nullptr), m_trayIcon({}), m_inTray(false),
-      m_isTracking(false), m_updateThreadRunning(false),
+      m_isTracking(false), m_subscription(0), m_updatePosted(false), m_pendingAlerts(0),
       m_lastEventCount(0), m_filterEnabled(false), m_originalStatusProc(nullptr) {
     m_tracker = std::make_unique<SoundTracker>();
     m_lastUpdateTime = std::chrono::system_clock::now();
+    m_viewModel.AttachIndex(&m_searchIndex);
 }
 
 SoundTrackerGUI::~SoundTrackerGUI() {
@@ -42,9 +45,24 @@ bool SoundTrackerGUI::Initialize(HINSTANCE hInstance) {
         return false;
     }
     
-    // Start update thread
-    m_updateThreadRunning = true;
-    m_updateThread = std::thread(&SoundTrackerGUI::UpdateThreadProc, this);
+    // Show the history recovered from the persistent event ring
+    ShowRecoveredEvents();
+    
+    // Redraw only when the store changes; one queued update absorbs a burst
+    m_subscription = m_tracker->Subscribe([this](uint64_t) {
+        if (!m_updatePosted.exchange(true)) {
+            PostMessage(m_hWnd, WM_EVENTS_CHANGED, 0, 0);
+        }
+    });
+    
+    // Alerts show as tray balloons; a burst of them shows the latest
+    m_tracker->SetAlertCallback([this](const std::string& rule, const AudioEvent& event) {
+        std::lock_guard<std::mutex> lock(m_alertMutex);
+        m_pendingAlert = Utf8ToWide(rule) + L"\n" + Utf8ToWide(event.processName);
+        if (m_pendingAlerts++ == 0) {
+            PostMessage(m_hWnd, WM_RULE_ALERT, 0, 0);
+        }
+    });
     
     return true;
 }
@@ -160,7 +178,7 @@ void SoundTrackerGUI::CreateListView() {
         WS_EX_CLIENTEDGE,
         WC_LISTVIEW, L"",
         WS_CHILD | WS_VISIBLE | LVS_REPORT | LVS_SINGLESEL | 
-        LVS_SHOWSELALWAYS | LVS_AUTOARRANGE,
+        LVS_SHOWSELALWAYS | LVS_AUTOARRANGE | LVS_OWNERDATA,  // Rows come from m_viewModel
         10, 60, 0, 0,  // Size will be set in WM_SIZE
         m_hWnd, (HMENU)ID_LISTVIEW,
         GetModuleHandle(nullptr), nullptr
@@ -240,14 +258,15 @@ void SoundTrackerGUI::CreateStatusBar() {
     );
     
     // Set parts
-    int parts[] = { 200, 400, 600, -1 };
-    SendMessage(m_hStatusBar, SB_SETPARTS, 4, (LPARAM)parts);
+    int parts[] = { 160, 300, 460, 760, -1 };
+    SendMessage(m_hStatusBar, SB_SETPARTS, 5, (LPARAM)parts);
     
     // Initial text
     SendMessage(m_hStatusBar, SB_SETTEXT, 0, (LPARAM)L"Status: Ready");
     SendMessage(m_hStatusBar, SB_SETTEXT, 1, (LPARAM)L"Events: 0");
     SendMessage(m_hStatusBar, SB_SETTEXT, 2, (LPARAM)L"Duration: 00:00:00");
-    SendMessage(m_hStatusBar, SB_SETTEXT, 3, (LPARAM)L"Logs saved to: logs\\");
+    SendMessage(m_hStatusBar, SB_SETTEXT, 3, (LPARAM)L"Latency: -");
+    SendMessage(m_hStatusBar, SB_SETTEXT, 4, (LPARAM)L"Logs saved to: logs\\");
     
     // Subclass the status bar to handle clicks
     SetWindowLongPtr(m_hStatusBar, GWLP_USERDATA, (LONG_PTR)this);
@@ -290,11 +309,11 @@ LRESULT CALLBACK SoundTrackerGUI::StatusBarProc(HWND hWnd, UINT uMsg, WPARAM wPa
         int xPos = GET_X_LPARAM(lParam);
         
         // Get status bar part boundaries
-        int parts[4];
-        SendMessage(hWnd, SB_GETPARTS, 4, (LPARAM)parts);
+        int parts[5];
+        SendMessage(hWnd, SB_GETPARTS, 5, (LPARAM)parts);
         
-        // Check if clicked in the 4th part (log path section)
-        if (xPos > parts[2] && !pThis->m_isTracking) {
+        // Check if clicked in the 5th part (log path section)
+        if (xPos > parts[3] && !pThis->m_isTracking) {
             pThis->OnStatusBarClick();
             return 0;
         }
@@ -321,6 +340,11 @@ LRESULT SoundTrackerGUI::HandleMessage(UINT uMsg, WPARAM wParam, LPARAM lParam)
                 case ID_CHECKBOX_FILTER:
                     OnFilterChanged();
                     break;
+                case ID_EDIT_FILTER:
+                    if (HIWORD(wParam) == EN_CHANGE) {
+                        UpdateListView();
+                    }
+                    break;
                 case ID_MENU_RESTORE:
                     RestoreFromTray();
                     break;
@@ -330,6 +354,9 @@ LRESULT SoundTrackerGUI::HandleMessage(UINT uMsg, WPARAM wParam, LPARAM lParam)
                 case ID_MENU_START_STOP:
                     OnStartStop();
                     break;
+                case ID_MENU_SAVE_SPANS:
+                    SaveSpanTrace();
+                    break;
             }
             break;
             
@@ -338,6 +365,8 @@ LRESULT SoundTrackerGUI::HandleMessage(UINT uMsg, WPARAM wParam, LPARAM lParam)
                 LPNMHDR pnmh = (LPNMHDR)lParam;
                 if (pnmh->idFrom == ID_LISTVIEW && pnmh->code == NM_CLICK) {
                     OnListViewClick();
+                } else if (pnmh->idFrom == ID_LISTVIEW && pnmh->code == LVN_GETDISPINFO) {
+                    OnGetDispInfo(reinterpret_cast<NMLVDISPINFO*>(lParam));
                 }
             }
             break;
@@ -365,7 +394,18 @@ LRESULT SoundTrackerGUI::HandleMessage(UINT uMsg, WPARAM wParam, LPARAM lParam)
             OnTrayIcon(lParam);
             break;
             
+        case WM_RULE_ALERT:
+            OnRuleAlert();
+            break;
+            
+        case WM_EVENTS_CHANGED:
+            m_updatePosted = false;
+            UpdateListView();
+            UpdateStatusBar();
+            break;
+            
         case WM_TIMER:
+            // Ticks the duration clock and ages rows out of the 30 second window
             if (wParam == ID_TIMER_UPDATE) {
                 UpdateListView();
                 UpdateStatusBar();
@@ -388,9 +428,8 @@ LRESULT SoundTrackerGUI::HandleMessage(UINT uMsg, WPARAM wParam, LPARAM lParam)
             break;
             
         case WM_DESTROY:
-            if (m_inTray) {
-                Shell_NotifyIcon(NIM_DELETE, &m_trayIcon);
-            }
+            // Also shown for rule alerts outside the tray
+            Shell_NotifyIcon(NIM_DELETE, &m_trayIcon);
             PostQuitMessage(0);
             break;
             
@@ -406,19 +445,24 @@ void SoundTrackerGUI::OnStartStop() {
         // Stop tracking and auto-save
         m_tracker->Stop();
         m_isTracking = false;
+        KillTimer(m_hWnd, ID_TIMER_UPDATE);
+        UpdateStatusBar();
         SetWindowText(m_hButtonStartStop, L"Start Tracking");
         SendMessage(m_hStatusBar, SB_SETTEXT, 0, (LPARAM)L"Status: Stopped");
     } else {
         // Start tracking
         m_tracker->Start();
         m_isTracking = true;
+        SetTimer(m_hWnd, ID_TIMER_UPDATE, 1000, nullptr);
         SetWindowText(m_hButtonStartStop, L"Stop Tracking");
         SendMessage(m_hStatusBar, SB_SETTEXT, 0, (LPARAM)L"Status: Recording");
     }
 }
 
 void SoundTrackerGUI::OnClear() {
-    ClearListView();
+    m_rowDiffs.clear();
+    m_viewModel.Clear(m_rowDiffs);
+    ApplyRowDiffs();
     m_lastEventCount = m_tracker->GetEventCount();
 }
 
@@ -467,7 +511,7 @@ void SoundTrackerGUI::OnListViewClick() {
         CloseClipboard();
         
         // Brief visual feedback in status bar
-        SendMessage(m_hStatusBar, SB_SETTEXT, 3, (LPARAM)L"Row copied to clipboard!");
+        SendMessage(m_hStatusBar, SB_SETTEXT, 4, (LPARAM)L"Row copied to clipboard!");
         
         // The status will be updated on next timer tick
     }
@@ -493,110 +537,157 @@ void SoundTrackerGUI::OnStatusBarClick() {
 }
 
 void SoundTrackerGUI::UpdateListView() {
-    // Get current events
+    TRACE_SPAN("UpdateListView");
+    // Show the last 30 seconds
     auto now = std::chrono::system_clock::now();
     auto thirtySecondsAgo = now - std::chrono::seconds(30);
-    auto events = m_tracker->GetEvents(thirtySecondsAgo, now);
     
     // Apply filter if enabled
+    std::string filter;
     if (m_filterEnabled) {
         WCHAR filterText[256];
         GetWindowText(m_hFilterEdit, filterText, 256);
-        m_filterText = filterText;
-        
-        // Convert to lowercase for case-insensitive search
-        std::transform(m_filterText.begin(), m_filterText.end(), m_filterText.begin(), ::towlower);
-        
-        events.erase(std::remove_if(events.begin(), events.end(),
-            [this](const AudioEvent& event) {
-                std::wstring processLower = event.processName;
-                std::transform(processLower.begin(), processLower.end(), processLower.begin(), ::towlower);
-                
-                std::wstring descLower = event.soundDescription;
-                std::transform(descLower.begin(), descLower.end(), descLower.begin(), ::towlower);
-                
-                return processLower.find(m_filterText) == std::wstring::npos &&
-                       descLower.find(m_filterText) == std::wstring::npos;
-            }), events.end());
+        filter = WideToUtf8(filterText);
     }
+    m_viewModel.SetFilter(filter);
     
-    // Only update if there are new events - compare actual content, not just count
-    static size_t lastEventHash = 0;
-    size_t currentHash = 0;
-    for (const auto& event : events) {
-        currentHash ^= std::hash<DWORD>()(event.processId) + 
-                      std::hash<std::wstring>()(event.processName);
-    }
+    // Only what changed since the last tick reaches the ListView
+    m_searchIndex.Sync(m_tracker->GetEventStore());
+    m_rowDiffs.clear();
+    m_viewModel.Sync(m_tracker->GetEventStore(), thirtySecondsAgo, m_rowDiffs);
+    ApplyRowDiffs();
+}
+
+void SoundTrackerGUI::ShowRecoveredEvents() {
+    // Show everything recovered; the 30 second window applies once tracking starts
+    m_searchIndex.Sync(m_tracker->GetEventStore());
+    m_rowDiffs.clear();
+    m_viewModel.Sync(m_tracker->GetEventStore(), (std::chrono::system_clock::time_point::min)(), m_rowDiffs);
+    ApplyRowDiffs();
     
-    if (currentHash != lastEventHash || events.size() != ListView_GetItemCount(m_hListView)) {
-        lastEventHash = currentHash;
-        
-        // Use SetRedraw to prevent flashing
-        SendMessage(m_hListView, WM_SETREDRAW, FALSE, 0);
-        
-        ClearListView();
-        
-        // Add events in reverse order (newest first)
-        for (auto it = events.rbegin(); it != events.rend(); ++it) {
-            AddEventToListView(*it);
-        }
-        
-        // Re-enable drawing and refresh
-        SendMessage(m_hListView, WM_SETREDRAW, TRUE, 0);
-        InvalidateRect(m_hListView, NULL, FALSE);
-    }
-}
-
-void SoundTrackerGUI::AddEventToListView(const AudioEvent& event) {
-    LVITEM lvi = { 0 };
-    lvi.mask = LVIF_TEXT;
-    lvi.iItem = 0;  // Insert at top
-    
-    // Format time with only hours and minutes
-    auto time_t = std::chrono::system_clock::to_time_t(event.timestamp);
-    std::tm tm;
-    localtime_s(&tm, &time_t);
-    WCHAR timeStr[32];
-    swprintf_s(timeStr, L"%02d:%02d", tm.tm_hour, tm.tm_min);
-    
-    // Add item
-    lvi.pszText = timeStr;
-    int index = ListView_InsertItem(m_hListView, &lvi);
-    
-    // Set subitems
-    // Count column - only show if > 1
-    if (event.eventCount > 1) {
-        WCHAR countStr[16];
-        swprintf_s(countStr, L"%d", event.eventCount);
-        ListView_SetItemText(m_hListView, index, 1, countStr);
-    } else {
-        ListView_SetItemText(m_hListView, index, 1, L"");
+    size_t count = m_viewModel.GetRowCount();
+    if (count == 0) {
+        return;
     }
     
-    ListView_SetItemText(m_hListView, index, 2, (LPWSTR)event.processName.c_str());
-    
-    WCHAR pidStr[16];
-    swprintf_s(pidStr, L"%d", event.processId);
-    ListView_SetItemText(m_hListView, index, 3, pidStr);
-    
-    ListView_SetItemText(m_hListView, index, 4, (LPWSTR)event.soundDescription.c_str());
+    WCHAR countStr[64];
+    swprintf_s(countStr, L"Events: %zu", count);
+    SendMessage(m_hStatusBar, SB_SETTEXT, 0, (LPARAM)L"Status: Restored");
+    SendMessage(m_hStatusBar, SB_SETTEXT, 1, (LPARAM)countStr);
+}
+
+void SoundTrackerGUI::ApplyRowDiffs() {
+    if (m_rowDiffs.empty()) {
+        return;
+    }
     
-    WCHAR volumeStr[16];
-    swprintf_s(volumeStr, L"%.0f%%", event.volumeLevel * 100);
-    ListView_SetItemText(m_hListView, index, 5, volumeStr);
+    // Follow the selected event as rows are inserted above or removed below it
+    int selected = ListView_GetNextItem(m_hListView, -1, LVNI_SELECTED);
+    int originalSelection = selected;
+    bool shifted = false;
+    for (const auto& diff : m_rowDiffs) {
+        int index = static_cast<int>(diff.index);
+        int count = static_cast<int>(diff.count);
+        switch (diff.kind) {
+            case RowDiff::Kind::Insert:
+                if (selected >= index) selected += count;
+                shifted = true;
+                break;
+            case RowDiff::Kind::Remove:
+                if (selected >= index + count) selected -= count;
+                else if (selected >= index) selected = -1;
+                shifted = true;
+                break;
+            case RowDiff::Kind::Reset:
+                selected = -1;
+                shifted = true;
+                break;
+            case RowDiff::Kind::Update:
+                break;
+        }
+    }
     
-    WCHAR peakStr[16];
-    swprintf_s(peakStr, L"%.0f%%", event.peakLevel * 100);
-    ListView_SetItemText(m_hListView, index, 6, peakStr);
+    if (!shifted) {
+        // Count bumps only; no rows moved, so the indices are current
+        for (const auto& diff : m_rowDiffs) {
+            ListView_RedrawItems(m_hListView, static_cast<int>(diff.index),
+                                 static_cast<int>(diff.index + diff.count) - 1);
+        }
+        return;
+    }
     
-    ListView_SetItemText(m_hListView, index, 7, (LPWSTR)event.processPath.c_str());
+    // Rows are virtual: only the visible ones are asked for their text again
+    ListView_SetItemCountEx(m_hListView, static_cast<int>(m_viewModel.GetRowCount()),
+                            LVSICF_NOSCROLL | LVSICF_NOINVALIDATEALL);
+    if (selected != originalSelection) {
+        ListView_SetItemState(m_hListView, -1, 0, LVIS_SELECTED | LVIS_FOCUSED);
+        if (selected >= 0) {
+            ListView_SetItemState(m_hListView, selected, LVIS_SELECTED | LVIS_FOCUSED,
+                                  LVIS_SELECTED | LVIS_FOCUSED);
+        }
+    }
+    InvalidateRect(m_hListView, NULL, FALSE);
+}
+
+void SoundTrackerGUI::OnGetDispInfo(NMLVDISPINFO* info) {
+    LVITEM& item = info->item;
+    if (!(item.mask & LVIF_TEXT) || item.iItem < 0 ||
+        static_cast<size_t>(item.iItem) >= m_viewModel.GetRowCount()) {
+        return;
+    }
+    FormatCell(m_viewModel.GetRow(item.iItem), item.iSubItem, item.pszText, item.cchTextMax);
 }
 
-void SoundTrackerGUI::ClearListView() {
-    ListView_DeleteAllItems(m_hListView);
+void SoundTrackerGUI::FormatCell(const AudioEvent& event, int column, LPWSTR text, int maxLength) {
+    if (!text || maxLength <= 0) {
+        return;
+    }
+    text[0] = L'\0';
+    
+    switch (column) {
+        case 0: {
+            // Format time with only hours and minutes
+            std::tm tm;
+            TimestampClock::Instance().ToLocalTime(event.timestamp, tm);
+            swprintf_s(text, maxLength, L"%02d:%02d", tm.tm_hour, tm.tm_min);
+            break;
+        }
+        case 1:
+            // Count column - only show if > 1
+            if (event.eventCount > 1) {
+                swprintf_s(text, maxLength, L"%d", event.eventCount);
+            }
+            break;
+        case 2:
+            // ListView wants wide text; events hold UTF-8
+            wcsncpy_s(text, maxLength, Utf8ToWide(event.processName).c_str(), _TRUNCATE);
+            break;
+        case 3:
+            swprintf_s(text, maxLength, L"%d", event.processId);
+            break;
+        case 4:
+            // A recognized sound names the clip ahead of the generic description
+            if (!event.soundLabel.empty()) {
+                _snwprintf_s(text, maxLength, _TRUNCATE, L"%ls (%ls)", Utf8ToWide(event.soundLabel).c_str(),
+                             Utf8ToWide(event.soundDescription).c_str());
+            } else {
+                wcsncpy_s(text, maxLength, Utf8ToWide(event.soundDescription).c_str(), _TRUNCATE);
+            }
+            break;
+        case 5:
+            swprintf_s(text, maxLength, L"%.0f%%", event.volumeLevel * 100);
+            break;
+        case 6:
+            swprintf_s(text, maxLength, L"%.0f%%", event.peakLevel * 100);
+            break;
+        case 7:
+            wcsncpy_s(text, maxLength, Utf8ToWide(event.processPath).c_str(), _TRUNCATE);
+            break;
+    }
 }
 
 void SoundTrackerGUI::UpdateStatusBar() {
+    TRACE_SPAN("UpdateStatusBar");
     // Update event count
     size_t eventCount = m_tracker->GetEventCount();
     WCHAR countStr[64];
@@ -616,6 +707,16 @@ void SoundTrackerGUI::UpdateStatusBar() {
     swprintf_s(durationStr, L"Duration: %02d:%02d:%02d", hours, minutes, seconds);
     SendMessage(m_hStatusBar, SB_SETTEXT, 2, (LPARAM)durationStr);
     
+#ifdef SOUNDTRACKER_METRICS
+    // Pipeline health: sample-to-store latency and samples lost to errors
+    MetricsSnapshot metrics = MetricsRegistry::Instance().Snapshot();
+    const HistogramSummary& latency = metrics.Get(MetricHistogram::CallbackToStore);
+    WCHAR metricsStr[96];
+    swprintf_s(metricsStr, L"Latency p99: %.1f ms, dropped: %llu", latency.p99 / 1e6,
+               static_cast<unsigned long long>(metrics.Get(MetricCounter::EventsDropped)));
+    SendMessage(m_hStatusBar, SB_SETTEXT, 3, (LPARAM)metricsStr);
+#endif
+    
     // Show current log file path
     std::wstring logPath = m_tracker->GetCurrentLogPath();
     if (!logPath.empty()) {
@@ -626,7 +727,7 @@ void SoundTrackerGUI::UpdateStatusBar() {
         } else {
             statusText = L"Log: " + logPath;
         }
-        SendMessage(m_hStatusBar, SB_SETTEXT, 3, (LPARAM)statusText.c_str());
+        SendMessage(m_hStatusBar, SB_SETTEXT, 4, (LPARAM)statusText.c_str());
     }
 }
 
@@ -643,6 +744,32 @@ void SoundTrackerGUI::RestoreFromTray() {
     m_inTray = false;
 }
 
+void SoundTrackerGUI::OnRuleAlert() {
+    std::wstring text;
+    unsigned count = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_alertMutex);
+        text.swap(m_pendingAlert);
+        count = m_pendingAlerts;
+        m_pendingAlerts = 0;
+    }
+    if (count > 1) {
+        text += L" (+" + std::to_wstring(count - 1) + L" more)";
+    }
+    
+    // A balloon needs the tray icon; shown for it, the icon stays until the
+    // window is next restored from the tray or closed
+    NOTIFYICONDATA balloon = m_trayIcon;
+    balloon.uFlags |= NIF_INFO;
+    balloon.dwInfoFlags = NIIF_WARNING;
+    wcscpy_s(balloon.szInfoTitle, L"Sound rule");
+    wcsncpy_s(balloon.szInfo, text.c_str(), _TRUNCATE);
+    if (!m_inTray) {
+        Shell_NotifyIcon(NIM_ADD, &m_trayIcon);
+    }
+    Shell_NotifyIcon(NIM_MODIFY, &balloon);
+}
+
 void SoundTrackerGUI::OnTrayIcon(LPARAM lParam) {
     switch (lParam) {
         case WM_LBUTTONDBLCLK:
@@ -663,6 +790,9 @@ void SoundTrackerGUI::ShowTrayMenu() {
     AppendMenu(hMenu, MF_STRING, ID_MENU_RESTORE, L"Restore");
     AppendMenu(hMenu, MF_STRING, ID_MENU_START_STOP, 
                m_isTracking ? L"Stop Tracking" : L"Start Tracking");
+    if (!m_spanTracePath.empty()) {
+        AppendMenu(hMenu, MF_STRING, ID_MENU_SAVE_SPANS, L"Save Span Trace");
+    }
     AppendMenu(hMenu, MF_SEPARATOR, 0, nullptr);
     AppendMenu(hMenu, MF_STRING, ID_MENU_EXIT, L"Exit");
     
@@ -671,13 +801,20 @@ void SoundTrackerGUI::ShowTrayMenu() {
     DestroyMenu(hMenu);
 }
 
-void SoundTrackerGUI::UpdateThreadProc() {
-    while (m_updateThreadRunning) {
-        if (m_isTracking) {
-            // Post message to update UI in main thread
-            PostMessage(m_hWnd, WM_TIMER, ID_TIMER_UPDATE, 0);
-        }
-        std::this_thread::sleep_for(std::chrono::milliseconds(250)); // Faster updates
+void SoundTrackerGUI::StartSpanTracing(const std::wstring& tracePath) {
+    m_spanTracePath = tracePath;
+    SpanTracer::SetThreadName("GUI");
+    SpanTracer::Instance().Enable();
+}
+
+void SoundTrackerGUI::SaveSpanTrace() {
+    if (m_spanTracePath.empty()) {
+        return;
+    }
+    if (SpanTracer::Instance().WriteChromeTrace(m_spanTracePath)) {
+        SendMessage(m_hStatusBar, SB_SETTEXT, 4, (LPARAM)(L"Spans saved to: " + m_spanTracePath).c_str());
+    } else {
+        MessageBox(m_hWnd, L"Failed to save the span trace.", L"Error", MB_ICONERROR);
     }
 }
 
@@ -705,10 +842,16 @@ void SoundTrackerGUI::Cleanup() {
         m_tracker->Stop();
     }
     
-    // Stop update thread
-    m_updateThreadRunning = false;
-    if (m_updateThread.joinable()) {
-        m_updateThread.join();
+    // Stop change notifications
+    if (m_subscription != 0) {
+        m_tracker->Unsubscribe(m_subscription);
+        m_subscription = 0;
+    }
+    m_tracker->SetAlertCallback(nullptr);
+    
+    // Keep the spans leading up to exit
+    if (!m_spanTracePath.empty()) {
+        SpanTracer::Instance().WriteChromeTrace(m_spanTracePath);
     }
     
     // Clean up fonts
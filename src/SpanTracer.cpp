@@ -0,0 +1,181 @@
+#include "../include/SpanTracer.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+
+// Fields are atomics only so a concurrent dump is well defined; the owning
+// thread is the only writer and uses relaxed stores
+struct SpanTracer::ThreadRing {
+    struct Span {
+        std::atomic<const char*> name;
+        std::atomic<const char*> argName;
+        std::atomic<int64_t> arg;
+        std::atomic<int64_t> begin;  // ns since the tracer origin
+        std::atomic<int64_t> duration;
+    };
+
+    uint32_t id = 0;
+    std::string name;            // Guarded by SpanTracer::m_mutex
+    std::atomic<uint64_t> head;  // Spans ever written; published with release
+    Span spans[RING_SPANS];
+};
+
+namespace {
+
+struct LocalRing {
+    SpanTracer::ThreadRing* ring = nullptr;
+    std::string name;  // Applied when the ring is created
+
+    ~LocalRing() {
+        if (ring) {
+            SpanTracer::Instance().Retire(ring);
+        }
+    }
+};
+
+thread_local LocalRing t_ring;
+
+void WriteJsonString(std::ostream& out, const std::string& text) {
+    out << '"';
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            out << '\\' << c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c)
+                << std::dec << std::setfill(' ');
+        } else {
+            out << c;
+        }
+    }
+    out << '"';
+}
+
+} // namespace
+
+SpanTracer::SpanTracer() : m_nextThreadId(1), m_origin(std::chrono::steady_clock::now()) {
+}
+
+SpanTracer::~SpanTracer() {
+    for (auto* ring : m_retired) {
+        delete ring;
+    }
+}
+
+SpanTracer& SpanTracer::Instance() {
+    static SpanTracer tracer;
+    return tracer;
+}
+
+void SpanTracer::Enable() {
+    s_enabled.store(true, std::memory_order_relaxed);
+}
+
+void SpanTracer::Disable() {
+    s_enabled.store(false, std::memory_order_relaxed);
+}
+
+SpanTracer::ThreadRing* SpanTracer::Local() {
+    if (!t_ring.ring) {
+        // Value-initialized, so every slot starts zeroed; rings are only
+        // allocated by threads that record while the tracer is enabled
+        t_ring.ring = new ThreadRing();
+        t_ring.ring->name = t_ring.name;
+        Instance().Register(t_ring.ring);
+    }
+    return t_ring.ring;
+}
+
+void SpanTracer::Register(ThreadRing* ring) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ring->id = m_nextThreadId++;
+    m_threads.push_back(ring);
+}
+
+void SpanTracer::Retire(ThreadRing* ring) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_threads.erase(std::remove(m_threads.begin(), m_threads.end(), ring), m_threads.end());
+    m_retired.push_back(ring);
+    if (m_retired.size() > MAX_RETIRED_THREADS) {
+        delete m_retired.front();
+        m_retired.erase(m_retired.begin());
+    }
+}
+
+void SpanTracer::Record(const char* name, std::chrono::steady_clock::time_point begin,
+                        std::chrono::steady_clock::time_point end, const char* argName, int64_t arg) {
+    ThreadRing* ring = Local();
+    uint64_t head = ring->head.load(std::memory_order_relaxed);
+    ThreadRing::Span& span = ring->spans[head % RING_SPANS];
+    // Orders the previous head store before the overwrite, for the dump's lap check
+    std::atomic_thread_fence(std::memory_order_release);
+    span.name.store(name, std::memory_order_relaxed);
+    span.argName.store(argName, std::memory_order_relaxed);
+    span.arg.store(arg, std::memory_order_relaxed);
+    span.begin.store(std::chrono::duration_cast<std::chrono::nanoseconds>(begin - Instance().m_origin).count(),
+                     std::memory_order_relaxed);
+    span.duration.store(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count(),
+                        std::memory_order_relaxed);
+    ring->head.store(head + 1, std::memory_order_release);
+}
+
+void SpanTracer::SetThreadName(const std::string& name) {
+    t_ring.name = name;
+    if (t_ring.ring) {
+        std::lock_guard<std::mutex> lock(Instance().m_mutex);
+        t_ring.ring->name = name;
+    }
+}
+
+bool SpanTracer::WriteChromeTrace(const std::wstring& path) {
+    std::ostringstream json;
+    json << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+    json << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"SoundTracker\"}}";
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<ThreadRing*> rings(m_retired);
+    rings.insert(rings.end(), m_threads.begin(), m_threads.end());
+
+    for (ThreadRing* ring : rings) {
+        std::string threadName = ring->name.empty() ? "Thread " + std::to_string(ring->id) : ring->name;
+        json << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << ring->id << ",\"args\":{\"name\":";
+        WriteJsonString(json, threadName);
+        json << "}}";
+
+        uint64_t end = ring->head.load(std::memory_order_acquire);
+        uint64_t start = end > RING_SPANS ? end - RING_SPANS : 0;
+        for (uint64_t i = start; i < end; ++i) {
+            const ThreadRing::Span& span = ring->spans[i % RING_SPANS];
+            const char* name = span.name.load(std::memory_order_relaxed);
+            const char* argName = span.argName.load(std::memory_order_relaxed);
+            int64_t arg = span.arg.load(std::memory_order_relaxed);
+            int64_t begin = span.begin.load(std::memory_order_relaxed);
+            int64_t duration = span.duration.load(std::memory_order_relaxed);
+
+            // The owner may have lapped us while we read; the slot being
+            // written now holds span head - RING_SPANS
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (i + RING_SPANS <= ring->head.load(std::memory_order_relaxed) || !name) {
+                continue;
+            }
+
+            // Timestamps are in microseconds; keep nanosecond precision
+            json << ",\n{\"name\":\"" << name << "\",\"cat\":\"pipeline\",\"ph\":\"X\",\"pid\":1,\"tid\":" << ring->id
+                 << ",\"ts\":" << begin / 1000 << '.' << std::setw(3) << std::setfill('0') << begin % 1000
+                 << ",\"dur\":" << duration / 1000 << '.' << std::setw(3) << duration % 1000 << std::setfill(' ');
+            if (argName) {
+                json << ",\"args\":{\"" << argName << "\":" << arg << "}";
+            }
+            json << "}";
+        }
+    }
+    json << "\n]}\n";
+
+    std::ofstream file(std::filesystem::path(path), std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        return false;
+    }
+    file << json.str();
+    return file.good();
+}
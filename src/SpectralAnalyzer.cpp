@@ -0,0 +1,262 @@
+#include "../include/SpectralAnalyzer.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SPECTRAL_USE_SSE2
+#include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define SPECTRAL_USE_NEON
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+const double PI = 3.14159265358979323846;
+const float SPECTRUM_FLOOR = 1e-10f;  // Keeps log() of silent mel bands finite
+
+double HzToMel(double hz) {
+    return 2595.0 * std::log10(1.0 + hz / 700.0);
+}
+
+double MelToHz(double mel) {
+    return 700.0 * (std::pow(10.0, mel / 2595.0) - 1.0);
+}
+
+// One radix-2 butterfly pass over count pairs: a += w * b, b = a - w * b
+void Butterflies(float* aRe, float* aIm, float* bRe, float* bIm, const float* wRe, const float* wIm, size_t count) {
+    size_t k = 0;
+#if defined(SPECTRAL_USE_SSE2)
+    for (; k + 4 <= count; k += 4) {
+        __m128 wr = _mm_loadu_ps(wRe + k);
+        __m128 wi = _mm_loadu_ps(wIm + k);
+        __m128 br = _mm_loadu_ps(bRe + k);
+        __m128 bi = _mm_loadu_ps(bIm + k);
+        __m128 tr = _mm_sub_ps(_mm_mul_ps(wr, br), _mm_mul_ps(wi, bi));
+        __m128 ti = _mm_add_ps(_mm_mul_ps(wr, bi), _mm_mul_ps(wi, br));
+        __m128 ar = _mm_loadu_ps(aRe + k);
+        __m128 ai = _mm_loadu_ps(aIm + k);
+        _mm_storeu_ps(bRe + k, _mm_sub_ps(ar, tr));
+        _mm_storeu_ps(bIm + k, _mm_sub_ps(ai, ti));
+        _mm_storeu_ps(aRe + k, _mm_add_ps(ar, tr));
+        _mm_storeu_ps(aIm + k, _mm_add_ps(ai, ti));
+    }
+#elif defined(SPECTRAL_USE_NEON)
+    for (; k + 4 <= count; k += 4) {
+        float32x4_t wr = vld1q_f32(wRe + k);
+        float32x4_t wi = vld1q_f32(wIm + k);
+        float32x4_t br = vld1q_f32(bRe + k);
+        float32x4_t bi = vld1q_f32(bIm + k);
+        float32x4_t tr = vsubq_f32(vmulq_f32(wr, br), vmulq_f32(wi, bi));
+        float32x4_t ti = vaddq_f32(vmulq_f32(wr, bi), vmulq_f32(wi, br));
+        float32x4_t ar = vld1q_f32(aRe + k);
+        float32x4_t ai = vld1q_f32(aIm + k);
+        vst1q_f32(bRe + k, vsubq_f32(ar, tr));
+        vst1q_f32(bIm + k, vsubq_f32(ai, ti));
+        vst1q_f32(aRe + k, vaddq_f32(ar, tr));
+        vst1q_f32(aIm + k, vaddq_f32(ai, ti));
+    }
+#endif
+    for (; k < count; ++k) {
+        float tr = wRe[k] * bRe[k] - wIm[k] * bIm[k];
+        float ti = wRe[k] * bIm[k] + wIm[k] * bRe[k];
+        bRe[k] = aRe[k] - tr;
+        bIm[k] = aIm[k] - ti;
+        aRe[k] += tr;
+        aIm[k] += ti;
+    }
+}
+
+// magnitude[k] = |re[k] + i im[k]| * scale
+void Magnitudes(const float* re, const float* im, float* magnitude, size_t count, float scale) {
+    size_t k = 0;
+#if defined(SPECTRAL_USE_SSE2)
+    __m128 s = _mm_set1_ps(scale);
+    for (; k + 4 <= count; k += 4) {
+        __m128 r = _mm_loadu_ps(re + k);
+        __m128 i = _mm_loadu_ps(im + k);
+        __m128 power = _mm_add_ps(_mm_mul_ps(r, r), _mm_mul_ps(i, i));
+        _mm_storeu_ps(magnitude + k, _mm_mul_ps(_mm_sqrt_ps(power), s));
+    }
+#elif defined(SPECTRAL_USE_NEON)
+    float32x4_t s = vdupq_n_f32(scale);
+    for (; k + 4 <= count; k += 4) {
+        float32x4_t r = vld1q_f32(re + k);
+        float32x4_t i = vld1q_f32(im + k);
+        float32x4_t power = vaddq_f32(vmulq_f32(r, r), vmulq_f32(i, i));
+        vst1q_f32(magnitude + k, vmulq_f32(vsqrtq_f32(power), s));
+    }
+#endif
+    for (; k < count; ++k) {
+        magnitude[k] = std::sqrt(re[k] * re[k] + im[k] * im[k]) * scale;
+    }
+}
+
+} // namespace
+
+SpectralAnalyzer::SpectralAnalyzer(uint32_t sampleRate)
+    : m_sampleRate(sampleRate), m_window(FRAME_SIZE), m_bitReverse(FRAME_SIZE), m_twiddleRe(FRAME_SIZE - 1),
+      m_twiddleIm(FRAME_SIZE - 1), m_re(FRAME_SIZE), m_im(FRAME_SIZE), m_magnitude(FRAME_SIZE / 2 + 1),
+      m_previous(FRAME_SIZE / 2 + 1), m_dct(SoundFeatures::MFCC_COUNT * MEL_BANDS) {
+    m_pending.reserve(FRAME_SIZE);
+
+    for (size_t i = 0; i < FRAME_SIZE; ++i) {
+        m_window[i] = static_cast<float>(0.5 - 0.5 * std::cos(2.0 * PI * i / FRAME_SIZE));
+    }
+
+    int bits = 0;
+    while ((size_t(1) << bits) < FRAME_SIZE) {
+        ++bits;
+    }
+    for (size_t i = 0; i < FRAME_SIZE; ++i) {
+        uint32_t reversed = 0;
+        for (int b = 0; b < bits; ++b) {
+            reversed |= static_cast<uint32_t>((i >> b) & 1) << (bits - 1 - b);
+        }
+        m_bitReverse[i] = reversed;
+    }
+
+    // The stage combining pairs of half-length transforms uses half twiddles,
+    // stored from offset half - 1, so its butterflies read them contiguously
+    for (size_t half = 1; half < FRAME_SIZE; half *= 2) {
+        for (size_t k = 0; k < half; ++k) {
+            double angle = -PI * static_cast<double>(k) / static_cast<double>(half);
+            m_twiddleRe[half - 1 + k] = static_cast<float>(std::cos(angle));
+            m_twiddleIm[half - 1 + k] = static_cast<float>(std::sin(angle));
+        }
+    }
+
+    // Triangular filters evenly spaced on the mel scale up to Nyquist
+    double binHz = static_cast<double>(sampleRate) / FRAME_SIZE;
+    double maxMel = HzToMel(sampleRate / 2.0);
+    std::vector<double> edges(MEL_BANDS + 2);
+    for (size_t i = 0; i < edges.size(); ++i) {
+        edges[i] = MelToHz(maxMel * i / (MEL_BANDS + 1)) / binHz;
+    }
+    for (size_t band = 0; band < MEL_BANDS; ++band) {
+        double left = edges[band], center = edges[band + 1], right = edges[band + 2];
+        MelFilter filter;
+        filter.firstBin = static_cast<size_t>(std::floor(left)) + 1;
+        size_t lastBin = (std::min)(static_cast<size_t>(std::ceil(right)) - 1, FRAME_SIZE / 2);
+        for (size_t bin = filter.firstBin; bin <= lastBin; ++bin) {
+            double weight = bin <= center ? (bin - left) / (center - left) : (right - bin) / (right - center);
+            filter.weights.push_back(static_cast<float>((std::max)(weight, 0.0)));
+        }
+        if (filter.weights.empty()) {
+            // Narrower than a bin: take the nearest one
+            filter.firstBin = (std::min)(static_cast<size_t>(std::lround(center)), FRAME_SIZE / 2);
+            filter.weights.push_back(1.0f);
+        }
+        m_melFilters.push_back(std::move(filter));
+    }
+
+    // Orthonormal DCT-II of the log mel energies
+    for (size_t i = 0; i < SoundFeatures::MFCC_COUNT; ++i) {
+        double scale = std::sqrt((i == 0 ? 1.0 : 2.0) / MEL_BANDS);
+        for (size_t band = 0; band < MEL_BANDS; ++band) {
+            m_dct[i * MEL_BANDS + band] = static_cast<float>(scale * std::cos(PI * i * (band + 0.5) / MEL_BANDS));
+        }
+    }
+}
+
+void SpectralAnalyzer::Reset() {
+    m_pending.clear();
+    std::fill(m_previous.begin(), m_previous.end(), 0.0f);
+}
+
+// Iterative radix-2 decimation in time over m_re/m_im, which hold the
+// input in bit-reversed order
+void SpectralAnalyzer::Fft() {
+    for (size_t half = 1; half < FRAME_SIZE; half *= 2) {
+        const float* wRe = &m_twiddleRe[half - 1];
+        const float* wIm = &m_twiddleIm[half - 1];
+        for (size_t start = 0; start < FRAME_SIZE; start += 2 * half) {
+            Butterflies(&m_re[start], &m_im[start], &m_re[start + half], &m_im[start + half], wRe, wIm, half);
+        }
+    }
+}
+
+const std::vector<float>& SpectralAnalyzer::ComputeSpectrum(const float* frame) {
+    for (size_t i = 0; i < FRAME_SIZE; ++i) {
+        m_re[m_bitReverse[i]] = frame[i] * m_window[i];
+    }
+    std::fill(m_im.begin(), m_im.end(), 0.0f);
+    Fft();
+
+    // Scaled so a full-scale sine peaks at about 1.0
+    Magnitudes(m_re.data(), m_im.data(), m_magnitude.data(), m_magnitude.size(), 4.0f / FRAME_SIZE);
+    return m_magnitude;
+}
+
+void SpectralAnalyzer::AnalyzeFrame(const float* frame, SoundFeatures& features) {
+    float energy = 0.0f;
+    size_t crossings = 0;
+    for (size_t i = 0; i < FRAME_SIZE; ++i) {
+        energy += frame[i] * frame[i];
+        if (i > 0 && (frame[i] >= 0.0f) != (frame[i - 1] >= 0.0f)) {
+            ++crossings;
+        }
+    }
+    ComputeSpectrum(frame);
+
+    const size_t bins = FRAME_SIZE / 2 + 1;
+
+    float total = 0.0f;
+    float weighted = 0.0f;
+    float binHz = static_cast<float>(m_sampleRate) / FRAME_SIZE;
+    for (size_t k = 0; k < bins; ++k) {
+        total += m_magnitude[k];
+        weighted += m_magnitude[k] * (k * binHz);
+    }
+
+    // Flux compares spectra normalized to unit sum, so loudness alone does not count
+    float inverse = total > 0.0f ? 1.0f / total : 0.0f;
+    float flux = 0.0f;
+    for (size_t k = 0; k < bins; ++k) {
+        float normalized = m_magnitude[k] * inverse;
+        float rise = normalized - m_previous[k];
+        if (rise > 0.0f) {
+            flux += rise * rise;
+        }
+        m_previous[k] = normalized;
+    }
+
+    float logMel[MEL_BANDS];
+    for (size_t band = 0; band < MEL_BANDS; ++band) {
+        const MelFilter& filter = m_melFilters[band];
+        float sum = 0.0f;
+        for (size_t i = 0; i < filter.weights.size(); ++i) {
+            float magnitude = m_magnitude[filter.firstBin + i];
+            sum += filter.weights[i] * magnitude * magnitude;
+        }
+        logMel[band] = std::log(sum + SPECTRUM_FLOOR);
+    }
+
+    features.frames = 1;
+    features.rms = std::sqrt(energy / FRAME_SIZE);
+    features.centroidHz = total > 0.0f ? weighted / total : 0.0f;
+    features.flux = std::sqrt(flux);
+    features.zeroCrossingRate = static_cast<float>(crossings) / (FRAME_SIZE - 1);
+    for (size_t i = 0; i < SoundFeatures::MFCC_COUNT; ++i) {
+        const float* row = &m_dct[i * MEL_BANDS];
+        float sum = 0.0f;
+        for (size_t band = 0; band < MEL_BANDS; ++band) {
+            sum += row[band] * logMel[band];
+        }
+        features.mfcc[i] = sum;
+    }
+}
+
+void SpectralAnalyzer::Push(const float* samples, size_t count, std::vector<SoundFeatures>& frames) {
+    while (count > 0) {
+        size_t take = (std::min)(count, FRAME_SIZE - m_pending.size());
+        m_pending.insert(m_pending.end(), samples, samples + take);
+        samples += take;
+        count -= take;
+        if (m_pending.size() == FRAME_SIZE) {
+            frames.emplace_back();
+            AnalyzeFrame(m_pending.data(), frames.back());
+            m_pending.erase(m_pending.begin(), m_pending.begin() + HOP_SIZE);
+        }
+    }
+}
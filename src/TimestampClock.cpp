@@ -0,0 +1,192 @@
+#include "../include/TimestampClock.h"
+
+namespace {
+
+typedef std::chrono::system_clock::duration WallDuration;
+
+const int64_t CALIBRATE_SECONDS = 1;
+const int CALIBRATE_TRIES = 3;           // The tightest bracket of the wall clock read wins
+const int64_t SLEW_DIVISOR = 2;          // A backward step is absorbed at half speed
+const int64_t OFFSET_SPAN_SECONDS = 900; // Time zone rules change on quarter hours
+const int64_t NO_LOCAL_OFFSET = INT64_MIN;
+
+int64_t TickCount(TimestampClock::Tick tick) {
+    return std::chrono::duration_cast<WallDuration>(tick.time_since_epoch()).count();
+}
+
+int64_t FloorDiv(int64_t value, int64_t divisor) {
+    return value / divisor - (value % divisor < 0 ? 1 : 0);
+}
+
+// Days since 1970-01-01 of a proleptic Gregorian date, and back
+int64_t DaysFromCivil(int64_t year, int month, int day) {
+    year -= month <= 2 ? 1 : 0;
+    int64_t era = FloorDiv(year, 400);
+    int64_t yearOfEra = year - era * 400;
+    int64_t dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int64_t dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + dayOfEra - 719468;
+}
+
+void CivilFromDays(int64_t days, int64_t& year, int& month, int& day) {
+    days += 719468;
+    int64_t era = FloorDiv(days, 146097);
+    int64_t dayOfEra = days - era * 146097;
+    int64_t yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    int64_t dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    int64_t monthIndex = (5 * dayOfYear + 2) / 153;
+    day = static_cast<int>(dayOfYear - (153 * monthIndex + 2) / 5 + 1);
+    month = static_cast<int>(monthIndex < 10 ? monthIndex + 3 : monthIndex - 9);
+    year = yearOfEra + era * 400 + (month <= 2 ? 1 : 0);
+}
+
+// The last local day converted on this thread; events come in runs of a day
+struct CivilDay {
+    int64_t days = INT64_MIN;
+    std::tm date = {};  // Date fields of the day
+};
+
+thread_local CivilDay t_civilDay;
+
+int64_t PackLocalOffset(int64_t key, int64_t offsetSeconds, bool dst) {
+    uint32_t low = static_cast<uint32_t>(offsetSeconds * 2 + (dst ? 1 : 0));
+    return static_cast<int64_t>((static_cast<uint64_t>(key) << 32) | low);
+}
+
+} // namespace
+
+TimestampClock& TimestampClock::Instance() {
+    static TimestampClock clock;
+    return clock;
+}
+
+TimestampClock::TimestampClock()
+    : m_sequence(0), m_anchorTick(0), m_offset(0), m_debt(0), m_localOffset(NO_LOCAL_OFFSET) {
+    Calibrate();
+}
+
+void TimestampClock::Calibrate() {
+    std::lock_guard<std::mutex> lock(m_calibrateMutex);
+    CalibrateLocked();
+}
+
+void TimestampClock::CalibrateLocked() {
+    int64_t anchorTick = 0, offset = 0;
+    int64_t bestSpan = INT64_MAX;
+    for (int i = 0; i < CALIBRATE_TRIES; ++i) {
+        int64_t before = TickCount(Capture());
+        int64_t wall = std::chrono::system_clock::now().time_since_epoch().count();
+        int64_t after = TickCount(Capture());
+        if (after - before < bestSpan) {
+            bestSpan = after - before;
+            anchorTick = before + bestSpan / 2;
+            offset = wall - anchorTick;
+        }
+    }
+
+    // Continue from where the old anchor puts the new one; behind it means
+    // the wall clock stepped back and the difference is slewed away
+    uint32_t sequence = m_sequence.load(std::memory_order_relaxed);
+    int64_t debt = 0;
+    if (sequence > 0) {
+        int64_t previous = ToWallCount(anchorTick, m_anchorTick.load(std::memory_order_relaxed),
+                                       m_offset.load(std::memory_order_relaxed),
+                                       m_debt.load(std::memory_order_relaxed));
+        debt = previous > anchorTick + offset ? previous - (anchorTick + offset) : 0;
+    }
+
+    m_sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    m_anchorTick.store(anchorTick, std::memory_order_relaxed);
+    m_offset.store(offset, std::memory_order_relaxed);
+    m_debt.store(debt, std::memory_order_relaxed);
+    m_sequence.store(sequence + 2, std::memory_order_release);
+}
+
+void TimestampClock::LoadAnchor(int64_t& anchorTick, int64_t& offset, int64_t& debt) const {
+    for (;;) {
+        uint32_t before = m_sequence.load(std::memory_order_acquire);
+        anchorTick = m_anchorTick.load(std::memory_order_relaxed);
+        offset = m_offset.load(std::memory_order_relaxed);
+        debt = m_debt.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if ((before & 1) == 0 && m_sequence.load(std::memory_order_relaxed) == before) {
+            return;
+        }
+    }
+}
+
+int64_t TimestampClock::ToWallCount(int64_t tick, int64_t anchorTick, int64_t offset, int64_t debt) const {
+    int64_t wall = tick + offset;
+    if (debt > 0) {
+        int64_t remaining = debt - (tick - anchorTick) / SLEW_DIVISOR;
+        wall += remaining > 0 ? remaining : 0;
+    }
+    return wall;
+}
+
+std::chrono::system_clock::time_point TimestampClock::ToWall(Tick tick) {
+    int64_t count = TickCount(tick);
+    int64_t anchorTick = 0, offset = 0, debt = 0;
+    LoadAnchor(anchorTick, offset, debt);
+    const int64_t calibrateAfter = std::chrono::duration_cast<WallDuration>(
+        std::chrono::seconds(CALIBRATE_SECONDS)).count();
+    if (count - anchorTick >= calibrateAfter) {
+        // One thread recalibrates; the others carry on with the old anchor
+        std::unique_lock<std::mutex> lock(m_calibrateMutex, std::try_to_lock);
+        if (lock.owns_lock()) {
+            CalibrateLocked();
+            lock.unlock();
+            LoadAnchor(anchorTick, offset, debt);
+        }
+    }
+    return std::chrono::system_clock::time_point(WallDuration(ToWallCount(count, anchorTick, offset, debt)));
+}
+
+void TimestampClock::ToLocalTime(std::chrono::system_clock::time_point time, std::tm& tm) {
+    int64_t seconds = std::chrono::floor<std::chrono::seconds>(time.time_since_epoch()).count();
+    int64_t key = FloorDiv(seconds, OFFSET_SPAN_SECONDS);
+    int64_t packed = m_localOffset.load(std::memory_order_relaxed);
+    if ((packed >> 32) != key) {
+        // The offset at the start of the quarter hour holds for all of it
+        std::time_t start = static_cast<std::time_t>(key * OFFSET_SPAN_SECONDS);
+        std::tm local = {};
+#ifdef _WIN32
+        bool converted = localtime_s(&local, &start) == 0;
+#else
+        bool converted = localtime_r(&start, &local) != nullptr;
+#endif
+        int64_t offsetSeconds = 0;
+        if (converted) {
+            offsetSeconds = DaysFromCivil(local.tm_year + 1900, local.tm_mon + 1, local.tm_mday) * 86400 +
+                            local.tm_hour * 3600 + local.tm_min * 60 + local.tm_sec - start;
+        }
+        packed = PackLocalOffset(key, offsetSeconds, converted && local.tm_isdst > 0);
+        m_localOffset.store(packed, std::memory_order_relaxed);
+    }
+    int32_t low = static_cast<int32_t>(static_cast<uint32_t>(packed));
+    int64_t offsetSeconds = (static_cast<int64_t>(low) - (low & 1)) / 2;
+
+    int64_t localSeconds = seconds + offsetSeconds;
+    int64_t days = FloorDiv(localSeconds, 86400);
+    int64_t secondOfDay = localSeconds - days * 86400;
+    CivilDay& civil = t_civilDay;
+    if (civil.days != days) {
+        int64_t year = 0;
+        int month = 0, day = 0;
+        CivilFromDays(days, year, month, day);
+        civil.days = days;
+        civil.date = std::tm();
+        civil.date.tm_year = static_cast<int>(year - 1900);
+        civil.date.tm_mon = month - 1;
+        civil.date.tm_mday = day;
+        civil.date.tm_wday = static_cast<int>(days + 4 - FloorDiv(days + 4, 7) * 7);  // 1970-01-01 was a Thursday
+        civil.date.tm_yday = static_cast<int>(days - DaysFromCivil(year, 1, 1));
+    }
+
+    tm = civil.date;
+    tm.tm_hour = static_cast<int>(secondOfDay / 3600);
+    tm.tm_min = static_cast<int>(secondOfDay / 60 % 60);
+    tm.tm_sec = static_cast<int>(secondOfDay % 60);
+    tm.tm_isdst = low & 1;
+}
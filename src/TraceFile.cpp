@@ -0,0 +1,293 @@
+#include "../include/TraceFile.h"
+#include <filesystem>
+#include <cstring>
+#include <iterator>
+
+namespace {
+
+const char TRACE_MAGIC[8] = { 'S', 'T', 'T', 'R', 'A', 'C', 'E', '1' };
+const uint32_t TRACE_VERSION = 3;      // 2 added coalesced counts, 3 the endpoint id; 1 still reads
+const uint32_t OLDEST_TRACE_VERSION = 1;
+const size_t HEADER_SIZE = 16;  // Magic, version, reserved
+
+const uint8_t RECORD_STRING = 1;  // field, length, bytes; takes the next id of that field
+const uint8_t RECORD_SAMPLE = 2;
+
+const uint8_t FLAG_SYSTEM_SOUND = 1;
+const uint8_t FLAG_COUNT = 2;  // A varint event count follows the process id
+
+const size_t FLUSH_BYTES = 64 * 1024;
+const size_t VERSION_2_FIELD_COUNT = 6;  // Before the endpoint id
+
+template <typename T>
+void Put(std::vector<uint8_t>& out, T value) {
+    size_t at = out.size();
+    out.resize(at + sizeof(T));
+    std::memcpy(&out[at], &value, sizeof(T));
+}
+
+void PutVarint(std::vector<uint8_t>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+uint64_t ZigZag(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+int64_t UnZigZag(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+// Bounds-checked reader over the trace body
+struct BodyReader {
+    const uint8_t* data;
+    size_t size;
+    size_t pos;
+
+    template <typename T>
+    bool Get(T& value) {
+        if (size - pos < sizeof(T)) return false;
+        std::memcpy(&value, data + pos, sizeof(T));
+        pos += sizeof(T);
+        return true;
+    }
+
+    bool GetVarint(uint64_t& value) {
+        value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (pos >= size) return false;
+            uint8_t byte = data[pos++];
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) return true;
+        }
+        return false;
+    }
+};
+
+// Interned fields, in the order sample records list their ids
+std::string AudioEvent::* const STRING_FIELDS[TraceWriter::FIELD_COUNT] = {
+    &AudioEvent::processName,
+    &AudioEvent::processPath,
+    &AudioEvent::soundDescription,
+    &AudioEvent::sessionDisplayName,
+    &AudioEvent::usbDeviceInfo,
+    &AudioEvent::browserTabInfo,
+    &AudioEvent::endpointId
+};
+
+} // namespace
+
+TraceWriter::TraceWriter() : m_lastMicros(0), m_sampleCount(0) {
+}
+
+TraceWriter::~TraceWriter() {
+    Close();
+}
+
+bool TraceWriter::Open(const std::wstring& path) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_file.is_open()) {
+        return false;
+    }
+
+    std::error_code ec;
+    std::filesystem::path tracePath(path);
+    if (tracePath.has_parent_path()) {
+        std::filesystem::create_directories(tracePath.parent_path(), ec);
+    }
+    m_file.open(tracePath, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!m_file.is_open()) {
+        return false;
+    }
+
+    for (auto& strings : m_strings) {
+        strings.clear();
+    }
+    m_lastMicros = 0;
+    m_sampleCount = 0;
+    m_buffer.clear();
+
+    const uint32_t versionAndReserved[2] = { TRACE_VERSION, 0 };
+    m_file.write(TRACE_MAGIC, sizeof(TRACE_MAGIC));
+    m_file.write(reinterpret_cast<const char*>(versionAndReserved), sizeof(versionAndReserved));
+    return m_file.good();
+}
+
+void TraceWriter::Close() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_file.is_open()) {
+        FlushBuffer();
+        m_file.close();
+    }
+}
+
+bool TraceWriter::IsOpen() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_file.is_open();
+}
+
+uint32_t TraceWriter::StringId(size_t field, const std::string& value) {
+    auto& strings = m_strings[field];
+    auto it = strings.find(value);
+    if (it != strings.end()) {
+        return it->second;
+    }
+
+    uint32_t id = static_cast<uint32_t>(strings.size());
+    strings.emplace(value, id);
+    m_buffer.push_back(RECORD_STRING);
+    m_buffer.push_back(static_cast<uint8_t>(field));
+    PutVarint(m_buffer, value.size());
+    m_buffer.insert(m_buffer.end(), value.begin(), value.end());
+    return id;
+}
+
+void TraceWriter::FlushBuffer() {
+    if (!m_buffer.empty()) {
+        m_file.write(reinterpret_cast<const char*>(m_buffer.data()), static_cast<std::streamsize>(m_buffer.size()));
+        m_buffer.clear();
+    }
+}
+
+void TraceWriter::Record(const TraceSample& sample) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_file.is_open()) {
+        return;
+    }
+
+    // String definitions go ahead of the sample that first uses them
+    uint32_t ids[FIELD_COUNT];
+    for (size_t field = 0; field < FIELD_COUNT; ++field) {
+        ids[field] = StringId(field, sample.event.*STRING_FIELDS[field]);
+    }
+
+    int64_t micros = std::chrono::duration_cast<std::chrono::microseconds>(
+        sample.event.timestamp.time_since_epoch()).count();
+    m_buffer.push_back(RECORD_SAMPLE);
+    PutVarint(m_buffer, ZigZag(micros - m_lastMicros));
+    m_buffer.push_back(static_cast<uint8_t>(sample.source));
+    uint8_t flags = (sample.event.isSystemSound ? FLAG_SYSTEM_SOUND : 0) |
+                    (sample.event.eventCount > 1 ? FLAG_COUNT : 0);
+    m_buffer.push_back(flags);
+    PutVarint(m_buffer, sample.event.processId);
+    if (flags & FLAG_COUNT) {
+        PutVarint(m_buffer, sample.event.eventCount);
+    }
+    Put<float>(m_buffer, sample.event.volumeLevel);
+    Put<float>(m_buffer, sample.event.peakLevel);
+    PutVarint(m_buffer, sample.enrichMicros);
+    for (uint32_t id : ids) {
+        PutVarint(m_buffer, id);
+    }
+    m_lastMicros = micros;
+    ++m_sampleCount;
+
+    if (m_buffer.size() >= FLUSH_BYTES) {
+        FlushBuffer();
+    }
+}
+
+uint64_t TraceWriter::GetSampleCount() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_sampleCount;
+}
+
+TraceReader::TraceReader() : m_pos(0), m_lastMicros(0), m_fieldCount(TraceWriter::FIELD_COUNT), m_truncated(false) {
+}
+
+bool TraceReader::Open(const std::wstring& path) {
+    std::ifstream file(std::filesystem::path(path), std::ios::in | std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    m_data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+
+    uint32_t version = 0;
+    if (m_data.size() < HEADER_SIZE || std::memcmp(m_data.data(), TRACE_MAGIC, sizeof(TRACE_MAGIC)) != 0) {
+        return false;
+    }
+    std::memcpy(&version, m_data.data() + sizeof(TRACE_MAGIC), sizeof(version));
+    if (version < OLDEST_TRACE_VERSION || version > TRACE_VERSION) {
+        return false;
+    }
+
+    for (auto& strings : m_strings) {
+        strings.clear();
+    }
+    m_fieldCount = version < 3 ? VERSION_2_FIELD_COUNT : TraceWriter::FIELD_COUNT;
+    m_pos = HEADER_SIZE;
+    m_lastMicros = 0;
+    m_truncated = false;
+    return true;
+}
+
+bool TraceReader::Next(TraceSample& sample) {
+    BodyReader reader = { m_data.data(), m_data.size(), m_pos };
+    while (reader.pos < reader.size) {
+        uint8_t type = 0;
+        reader.Get(type);
+
+        if (type == RECORD_STRING) {
+            uint8_t field = 0;
+            uint64_t length = 0;
+            if (!reader.Get(field) || field >= m_fieldCount || !reader.GetVarint(length) ||
+                reader.size - reader.pos < length) {
+                break;
+            }
+            m_strings[field].emplace_back(reinterpret_cast<const char*>(reader.data + reader.pos),
+                                          static_cast<size_t>(length));
+            reader.pos += static_cast<size_t>(length);
+            m_pos = reader.pos;
+            continue;
+        }
+        if (type != RECORD_SAMPLE) {
+            break;
+        }
+
+        uint64_t delta = 0, processId = 0, eventCount = 1, enrichMicros = 0;
+        uint8_t source = 0, flags = 0;
+        AudioEvent& event = sample.event;
+        if (!reader.GetVarint(delta) || !reader.Get(source) || !reader.Get(flags) ||
+            !reader.GetVarint(processId) || ((flags & FLAG_COUNT) && !reader.GetVarint(eventCount)) ||
+            !reader.Get(event.volumeLevel) ||
+            !reader.Get(event.peakLevel) || !reader.GetVarint(enrichMicros)) {
+            break;
+        }
+        for (size_t field = m_fieldCount; field < TraceWriter::FIELD_COUNT; ++field) {
+            (event.*STRING_FIELDS[field]).clear();
+        }
+        bool valid = true;
+        for (size_t field = 0; field < m_fieldCount && valid; ++field) {
+            uint64_t id = 0;
+            valid = reader.GetVarint(id) && id < m_strings[field].size();
+            if (valid) {
+                event.*STRING_FIELDS[field] = m_strings[field][static_cast<size_t>(id)];
+            }
+        }
+        if (!valid) {
+            break;
+        }
+
+        m_lastMicros += UnZigZag(delta);
+        event.timestamp = std::chrono::system_clock::time_point(
+            std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                std::chrono::microseconds(m_lastMicros)));
+        event.processId = static_cast<DWORD>(processId);
+        event.isSystemSound = (flags & FLAG_SYSTEM_SOUND) != 0;
+        event.eventCount = static_cast<DWORD>(eventCount);
+        event.duration_ms = 0;
+        sample.source = static_cast<TraceSource>(source);
+        sample.enrichMicros = static_cast<uint32_t>(enrichMicros);
+        m_pos = reader.pos;
+        return true;
+    }
+
+    // Anything left over is a record the recorder never finished
+    m_truncated = m_pos < m_data.size();
+    m_pos = m_data.size();
+    return false;
+}
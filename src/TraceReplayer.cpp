@@ -0,0 +1,61 @@
+#include "../include/TraceReplayer.h"
+#include <thread>
+#include <vector>
+
+TraceReplayer::TraceReplayer() : m_speed(1.0), m_logger(nullptr), m_rules(nullptr) {
+}
+
+bool TraceReplayer::Replay(const std::wstring& tracePath, EventStore& store, ReplayStats& stats) {
+    TraceReader reader;
+    if (!reader.Open(tracePath)) {
+        return false;
+    }
+
+    stats = ReplayStats();
+    TraceSample sample;
+    auto wallStart = std::chrono::steady_clock::now();
+    std::chrono::system_clock::time_point traceStart;
+    std::vector<uint32_t> fired;
+
+    while (reader.Next(sample)) {
+        if (stats.samples == 0) {
+            traceStart = sample.event.timestamp;
+        }
+
+        // Virtual time since the first sample, released at m_speed times real time
+        auto offset = std::chrono::duration_cast<std::chrono::microseconds>(sample.event.timestamp - traceStart);
+        if (m_speed > 0.0 && offset.count() > 0) {
+            auto due = wallStart + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<double, std::micro>(offset.count() / m_speed));
+            if (due > std::chrono::steady_clock::now()) {
+                std::this_thread::sleep_until(due);
+            }
+        }
+        if (offset > stats.traceSpan) {
+            stats.traceSpan = offset;
+        }
+
+        // Same path as SoundTracker::AddAudioEvent after enrichment
+        auto pipelineStart = std::chrono::steady_clock::now();
+        fired.clear();
+        if (m_rules && !m_rules->Evaluate(sample.event, fired)) {
+            ++stats.ignored;
+        } else if (store.Add(sample.event)) {
+            ++stats.added;
+            if (m_logger) {
+                m_logger->LogEvent(sample.event);
+            }
+        } else {
+            ++stats.batched;
+        }
+        stats.alerts += fired.size();
+        stats.pipelineTime += std::chrono::steady_clock::now() - pipelineStart;
+
+        ++stats.samples;
+        stats.enrichMicros += sample.enrichMicros;
+    }
+
+    stats.wallTime = std::chrono::steady_clock::now() - wallStart;
+    stats.truncated = reader.IsTruncated();
+    return true;
+}
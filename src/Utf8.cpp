@@ -0,0 +1,311 @@
+#include "../include/Utf8.h"
+#include <cstring>
+#include <cstdint>
+#include <cwchar>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define UTF8_USE_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#define UTF8_USE_NEON
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+const uint32_t REPLACEMENT_CHARACTER = 0xFFFD;
+
+// The converters are templates over the code unit, so wchar_t and the
+// explicit char16_t and char32_t entry points share one implementation
+template <typename Unit>
+struct UnitBlock {
+    static const size_t SIZE = 16 / sizeof(Unit);  // Units per 128-bit block
+};
+
+// Converts one block of UnitBlock<Unit>::SIZE units if they are all ASCII
+template <typename Unit>
+inline bool AsciiBlockToUtf8(const Unit* src, char* dst) {
+#if defined(UTF8_USE_SSE2)
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+    if (sizeof(Unit) == 2) {
+        __m128i high = _mm_and_si128(v, _mm_set1_epi16(static_cast<short>(0xFF80)));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi16(high, _mm_setzero_si128())) != 0xFFFF) {
+            return false;
+        }
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(dst), _mm_packus_epi16(v, v));
+    } else {
+        __m128i high = _mm_and_si128(v, _mm_set1_epi32(static_cast<int>(0xFFFFFF80)));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(high, _mm_setzero_si128())) != 0xFFFF) {
+            return false;
+        }
+        __m128i words = _mm_packs_epi32(v, v);
+        int32_t bytes = _mm_cvtsi128_si32(_mm_packus_epi16(words, words));
+        std::memcpy(dst, &bytes, sizeof(bytes));
+    }
+    return true;
+#elif defined(UTF8_USE_NEON)
+    if (sizeof(Unit) == 2) {
+        uint16x8_t v = vld1q_u16(reinterpret_cast<const uint16_t*>(src));
+        if (vmaxvq_u16(v) >= 0x80) {
+            return false;
+        }
+        vst1_u8(reinterpret_cast<uint8_t*>(dst), vmovn_u16(v));
+    } else {
+        uint32x4_t v = vld1q_u32(reinterpret_cast<const uint32_t*>(src));
+        if (vmaxvq_u32(v) >= 0x80) {
+            return false;
+        }
+        for (size_t i = 0; i < UnitBlock<Unit>::SIZE; ++i) {
+            dst[i] = static_cast<char>(src[i]);
+        }
+    }
+    return true;
+#else
+    for (size_t i = 0; i < UnitBlock<Unit>::SIZE; ++i) {
+        if (static_cast<uint32_t>(src[i]) >= 0x80) {
+            return false;
+        }
+    }
+    for (size_t i = 0; i < UnitBlock<Unit>::SIZE; ++i) {
+        dst[i] = static_cast<char>(src[i]);
+    }
+    return true;
+#endif
+}
+
+// Widens one block of 16 bytes if they are all ASCII
+template <typename Unit>
+inline bool AsciiBlockToWide(const char* src, Unit* dst) {
+#if defined(UTF8_USE_SSE2)
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+    if (_mm_movemask_epi8(v) != 0) {
+        return false;
+    }
+    __m128i zero = _mm_setzero_si128();
+    __m128i low = _mm_unpacklo_epi8(v, zero);
+    __m128i high = _mm_unpackhi_epi8(v, zero);
+    if (sizeof(Unit) == 2) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), low);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 8), high);
+    } else {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_unpacklo_epi16(low, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 4), _mm_unpackhi_epi16(low, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 8), _mm_unpacklo_epi16(high, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 12), _mm_unpackhi_epi16(high, zero));
+    }
+    return true;
+#elif defined(UTF8_USE_NEON)
+    uint8x16_t v = vld1q_u8(reinterpret_cast<const uint8_t*>(src));
+    if (vmaxvq_u8(v) >= 0x80) {
+        return false;
+    }
+    uint16x8_t low = vmovl_u8(vget_low_u8(v));
+    uint16x8_t high = vmovl_u8(vget_high_u8(v));
+    if (sizeof(Unit) == 2) {
+        vst1q_u16(reinterpret_cast<uint16_t*>(dst), low);
+        vst1q_u16(reinterpret_cast<uint16_t*>(dst + 8), high);
+    } else {
+        uint32_t* out = reinterpret_cast<uint32_t*>(dst);
+        vst1q_u32(out, vmovl_u16(vget_low_u16(low)));
+        vst1q_u32(out + 4, vmovl_u16(vget_high_u16(low)));
+        vst1q_u32(out + 8, vmovl_u16(vget_low_u16(high)));
+        vst1q_u32(out + 12, vmovl_u16(vget_high_u16(high)));
+    }
+    return true;
+#else
+    uint64_t words[2];
+    std::memcpy(words, src, sizeof(words));
+    if (((words[0] | words[1]) & 0x8080808080808080ull) != 0) {
+        return false;
+    }
+    for (size_t i = 0; i < 16; ++i) {
+        dst[i] = static_cast<Unit>(static_cast<unsigned char>(src[i]));
+    }
+    return true;
+#endif
+}
+
+inline char* EncodeUtf8(uint32_t cp, char* dst) {
+    if (cp < 0x80) {
+        *dst++ = static_cast<char>(cp);
+    } else if (cp < 0x800) {
+        *dst++ = static_cast<char>(0xC0 | (cp >> 6));
+        *dst++ = static_cast<char>(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        *dst++ = static_cast<char>(0xE0 | (cp >> 12));
+        *dst++ = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        *dst++ = static_cast<char>(0x80 | (cp & 0x3F));
+    } else {
+        *dst++ = static_cast<char>(0xF0 | (cp >> 18));
+        *dst++ = static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+        *dst++ = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        *dst++ = static_cast<char>(0x80 | (cp & 0x3F));
+    }
+    return dst;
+}
+
+template <typename Unit>
+inline Unit* EncodeWide(uint32_t cp, Unit* dst) {
+    if (sizeof(Unit) == 2 && cp >= 0x10000) {
+        cp -= 0x10000;
+        *dst++ = static_cast<Unit>(0xD800 + (cp >> 10));
+        *dst++ = static_cast<Unit>(0xDC00 + (cp & 0x3FF));
+    } else {
+        *dst++ = static_cast<Unit>(cp);
+    }
+    return dst;
+}
+
+// Decodes one code point starting at src[i] (known to be non-ASCII or at
+// the tail) and advances i. Malformed sequences consume one byte.
+inline uint32_t DecodeUtf8(const unsigned char* src, size_t length, size_t& i) {
+    unsigned char lead = src[i];
+    if (lead < 0x80) {
+        ++i;
+        return lead;
+    }
+
+    size_t extra;
+    uint32_t cp;
+    uint32_t minimum;
+    if (lead >= 0xC2 && lead <= 0xDF) {
+        extra = 1; cp = lead & 0x1F; minimum = 0x80;
+    } else if (lead >= 0xE0 && lead <= 0xEF) {
+        extra = 2; cp = lead & 0x0F; minimum = 0x800;
+    } else if (lead >= 0xF0 && lead <= 0xF4) {
+        extra = 3; cp = lead & 0x07; minimum = 0x10000;
+    } else {
+        ++i;
+        return REPLACEMENT_CHARACTER;
+    }
+
+    if (length - i <= extra) {
+        ++i;
+        return REPLACEMENT_CHARACTER;
+    }
+    for (size_t k = 1; k <= extra; ++k) {
+        unsigned char next = src[i + k];
+        if ((next & 0xC0) != 0x80) {
+            ++i;
+            return REPLACEMENT_CHARACTER;
+        }
+        cp = (cp << 6) | (next & 0x3F);
+    }
+    if (cp < minimum || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF)) {
+        ++i;
+        return REPLACEMENT_CHARACTER;
+    }
+
+    i += extra + 1;
+    return cp;
+}
+
+template <typename Unit>
+void AppendUtf8Units(std::string& out, const Unit* wide, size_t length) {
+    if (length == 0) {
+        return;
+    }
+
+    // Worst case: 3 bytes per UTF-16 unit (a surrogate pair makes 4 from 2)
+    // or 4 bytes per UTF-32 unit
+    const size_t WIDE_BLOCK = UnitBlock<Unit>::SIZE;
+    size_t start = out.size();
+    out.resize(start + length * (sizeof(Unit) == 2 ? 3 : 4));
+    char* dst = &out[start];
+    size_t i = 0;
+
+    while (i < length) {
+        if (length - i >= WIDE_BLOCK && AsciiBlockToUtf8(wide + i, dst)) {
+            i += WIDE_BLOCK;
+            dst += WIDE_BLOCK;
+            continue;
+        }
+
+        uint32_t cp = static_cast<uint32_t>(wide[i++]);
+        if (cp >= 0xD800 && cp <= 0xDFFF) {
+            uint32_t low = i < length ? static_cast<uint32_t>(wide[i]) : 0;
+            if (sizeof(Unit) == 2 && cp <= 0xDBFF && low >= 0xDC00 && low <= 0xDFFF) {
+                cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                ++i;
+            } else {
+                cp = REPLACEMENT_CHARACTER;
+            }
+        } else if (cp > 0x10FFFF) {
+            cp = REPLACEMENT_CHARACTER;
+        }
+        dst = EncodeUtf8(cp, dst);
+    }
+
+    out.resize(dst - out.data());
+}
+
+template <typename Unit>
+void AppendUnits(std::basic_string<Unit>& out, const char* utf8, size_t length) {
+    if (length == 0) {
+        return;
+    }
+
+    // Never more wide units than input bytes
+    size_t start = out.size();
+    out.resize(start + length);
+    Unit* dst = &out[start];
+    const unsigned char* src = reinterpret_cast<const unsigned char*>(utf8);
+    size_t i = 0;
+
+    while (i < length) {
+        if (length - i >= 16 && AsciiBlockToWide(utf8 + i, dst)) {
+            i += 16;
+            dst += 16;
+            continue;
+        }
+        dst = EncodeWide(DecodeUtf8(src, length, i), dst);
+    }
+
+    out.resize(dst - out.data());
+}
+
+} // namespace
+
+void AppendUtf8(std::string& out, const wchar_t* wide, size_t length) {
+    AppendUtf8Units(out, wide, length);
+}
+
+void AppendUtf8(std::string& out, const char16_t* utf16, size_t length) {
+    AppendUtf8Units(out, utf16, length);
+}
+
+void AppendUtf8(std::string& out, const char32_t* utf32, size_t length) {
+    AppendUtf8Units(out, utf32, length);
+}
+
+void AppendWide(std::wstring& out, const char* utf8, size_t length) {
+    AppendUnits(out, utf8, length);
+}
+
+void AppendUtf16(std::u16string& out, const char* utf8, size_t length) {
+    AppendUnits(out, utf8, length);
+}
+
+void AppendUtf32(std::u32string& out, const char* utf8, size_t length) {
+    AppendUnits(out, utf8, length);
+}
+
+std::string WideToUtf8(const std::wstring& wide) {
+    std::string utf8;
+    AppendUtf8(utf8, wide.data(), wide.size());
+    return utf8;
+}
+
+std::string WideToUtf8(const wchar_t* wide) {
+    std::string utf8;
+    if (wide) {
+        AppendUtf8(utf8, wide, std::wcslen(wide));
+    }
+    return utf8;
+}
+
+std::wstring Utf8ToWide(const std::string& utf8) {
+    std::wstring wide;
+    AppendWide(wide, utf8.data(), utf8.size());
+    return wide;
+}
\ No newline at end of file
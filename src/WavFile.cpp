@@ -0,0 +1,136 @@
+#include "../include/WavFile.h"
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <cstring>
+
+namespace {
+
+const uint16_t FORMAT_PCM = 1;
+const uint16_t FORMAT_FLOAT = 3;
+const uint16_t FORMAT_EXTENSIBLE = 0xFFFE;
+
+uint16_t ReadU16(const uint8_t* p) {
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+uint32_t ReadU32(const uint8_t* p) {
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+           (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+void PutU16(std::vector<uint8_t>& out, uint16_t value) {
+    out.push_back(static_cast<uint8_t>(value));
+    out.push_back(static_cast<uint8_t>(value >> 8));
+}
+
+void PutU32(std::vector<uint8_t>& out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+}
+
+float DecodeSample(const uint8_t* p, uint16_t format, uint16_t bits) {
+    if (format == FORMAT_FLOAT) {
+        float value;
+        std::memcpy(&value, p, sizeof(value));
+        return value;
+    }
+    switch (bits) {
+    case 16:
+        return static_cast<int16_t>(ReadU16(p)) / 32768.0f;
+    case 24:
+        return static_cast<int32_t>((static_cast<uint32_t>(p[0]) << 8) | (static_cast<uint32_t>(p[1]) << 16) |
+                                    (static_cast<uint32_t>(p[2]) << 24)) / 2147483648.0f;
+    default:
+        return static_cast<int32_t>(ReadU32(p)) / 2147483648.0f;
+    }
+}
+
+} // namespace
+
+bool ReadWavFile(const std::wstring& path, std::vector<float>& mono, uint32_t& sampleRate) {
+    std::ifstream file(std::filesystem::path(path), std::ios::in | std::ios::binary);
+    if (!file) {
+        return false;
+    }
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (data.size() < 12 || std::memcmp(data.data(), "RIFF", 4) != 0 || std::memcmp(data.data() + 8, "WAVE", 4) != 0) {
+        return false;
+    }
+
+    uint16_t format = 0, channels = 0, bits = 0;
+    uint32_t rate = 0;
+    const uint8_t* samples = nullptr;
+    size_t sampleBytes = 0;
+    size_t offset = 12;
+    while (offset + 8 <= data.size()) {
+        const uint8_t* chunk = data.data() + offset;
+        size_t size = ReadU32(chunk + 4);
+        size_t available = data.size() - offset - 8;
+        if (std::memcmp(chunk, "fmt ", 4) == 0 && size >= 16 && size <= available) {
+            format = ReadU16(chunk + 8);
+            channels = ReadU16(chunk + 10);
+            rate = ReadU32(chunk + 12);
+            bits = ReadU16(chunk + 22);
+            if (format == FORMAT_EXTENSIBLE && size >= 26) {
+                format = ReadU16(chunk + 32);  // First two bytes of the SubFormat GUID
+            }
+        } else if (std::memcmp(chunk, "data", 4) == 0) {
+            samples = chunk + 8;
+            sampleBytes = size < available ? size : available;  // Tolerate a truncated final chunk
+            break;
+        }
+        offset += 8 + size + (size & 1);
+    }
+
+    bool supported = (format == FORMAT_PCM && (bits == 16 || bits == 24 || bits == 32)) ||
+                     (format == FORMAT_FLOAT && bits == 32);
+    if (!samples || !supported || channels == 0 || rate == 0) {
+        return false;
+    }
+
+    size_t bytesPerSample = bits / 8;
+    size_t frameBytes = bytesPerSample * channels;
+    size_t frames = sampleBytes / frameBytes;
+    mono.resize(frames);
+    for (size_t i = 0; i < frames; ++i) {
+        const uint8_t* frame = samples + i * frameBytes;
+        float sum = 0.0f;
+        for (uint16_t c = 0; c < channels; ++c) {
+            sum += DecodeSample(frame + c * bytesPerSample, format, bits);
+        }
+        mono[i] = sum / channels;
+    }
+    sampleRate = rate;
+    return true;
+}
+
+bool WriteWavFile(const std::wstring& path, const float* samples, size_t count, uint32_t sampleRate) {
+    if (count > (0xFFFFFFFFu - 36) / 2) {
+        return false;
+    }
+    uint32_t dataBytes = static_cast<uint32_t>(count * 2);
+    std::vector<uint8_t> out;
+    out.reserve(44 + dataBytes);
+    out.insert(out.end(), { 'R', 'I', 'F', 'F' });
+    PutU32(out, 36 + dataBytes);
+    out.insert(out.end(), { 'W', 'A', 'V', 'E', 'f', 'm', 't', ' ' });
+    PutU32(out, 16);
+    PutU16(out, FORMAT_PCM);
+    PutU16(out, 1);
+    PutU32(out, sampleRate);
+    PutU32(out, sampleRate * 2);
+    PutU16(out, 2);
+    PutU16(out, 16);
+    out.insert(out.end(), { 'd', 'a', 't', 'a' });
+    PutU32(out, dataBytes);
+    for (size_t i = 0; i < count; ++i) {
+        float clipped = samples[i] > 1.0f ? 1.0f : (samples[i] < -1.0f ? -1.0f : samples[i]);
+        PutU16(out, static_cast<uint16_t>(static_cast<int16_t>(clipped * 32767.0f)));
+    }
+
+    std::ofstream file(std::filesystem::path(path), std::ios::out | std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(out.data()), static_cast<std::streamsize>(out.size()));
+    return static_cast<bool>(file);
+}
@@ -1,4 +1,5 @@
 #include "../include/SoundTrackerGUI.h"
+#include "../include/Utf8.h"
 #include <windows.h>
 #include <iostream>
 #include <shellapi.h>
@@ -46,6 +47,7 @@ int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPWSTR lpCmdLi
                 SHELLEXECUTEINFO sei = { sizeof(sei) };
                 sei.lpVerb = L"runas";
                 sei.lpFile = szPath;
+                sei.lpParameters = lpCmdLine;  // Keep options such as --record-trace
                 sei.hwnd = NULL;
                 sei.nShow = SW_NORMAL;
                 
@@ -81,6 +83,51 @@ int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPWSTR lpCmdLi
             return 1;
         }
         
+        // --record-trace <file> captures a trace for offline replay;
+        // --trace-spans <file.json> records a timeline for Perfetto;
+        // --store-mb <n> sets the memory budget for recent events;
+        // --coalesce-ms <n> sets the window a process's samples collapse over (0: off);
+        // --loopback-features tags events with spectral features of the output;
+        // --sound-library <dir> also labels them with the known .wav sound playing;
+        // --rules <file> loads ignore and notify rules (see RuleEngine)
+        int argc = 0;
+        LPWSTR* argv = CommandLineToArgvW(GetCommandLineW(), &argc);
+        if (argv) {
+            for (int i = 1; i < argc; i++) {
+                bool hasValue = i + 1 < argc;
+                if (hasValue && wcscmp(argv[i], L"--record-trace") == 0 && !app.StartTraceRecording(argv[i + 1])) {
+                    ShowErrorAndExit(L"Failed to open the trace file for recording.");
+                }
+                if (hasValue && wcscmp(argv[i], L"--trace-spans") == 0) {
+                    app.StartSpanTracing(argv[i + 1]);
+                }
+                if (hasValue && wcscmp(argv[i], L"--store-mb") == 0 && _wtoi(argv[i + 1]) > 0) {
+                    app.SetStoreBudget(static_cast<size_t>(_wtoi(argv[i + 1])) * 1024 * 1024);
+                }
+                if (hasValue && wcscmp(argv[i], L"--coalesce-ms") == 0 && _wtoi(argv[i + 1]) >= 0) {
+                    app.SetCoalesceWindow(static_cast<uint32_t>(_wtoi(argv[i + 1])));
+                }
+                if (wcscmp(argv[i], L"--loopback-features") == 0 && !app.EnableFeatureCapture(true)) {
+                    ShowErrorAndExit(L"Failed to start loopback capture; events will have no spectral features.");
+                }
+                if (hasValue && wcscmp(argv[i], L"--rules") == 0) {
+                    std::string error;
+                    if (!app.LoadRules(argv[i + 1], error)) {
+                        std::wstring message = L"Failed to load the rules file: " + Utf8ToWide(error);
+                        ShowErrorAndExit(message.c_str());
+                    }
+                }
+                if (hasValue && wcscmp(argv[i], L"--sound-library") == 0) {
+                    if (!app.LoadSoundLibrary(argv[i + 1])) {
+                        ShowErrorAndExit(L"No .wav sounds could be read from the sound library directory.");
+                    } else if (!app.EnableFeatureCapture(true)) {
+                        ShowErrorAndExit(L"Failed to start loopback capture; sounds will not be recognized.");
+                    }
+                }
+            }
+            LocalFree(argv);
+        }
+        
         // Run message loop
         int result = app.Run();
         
@@ -0,0 +1,157 @@
+#include "../include/TraceReplayer.h"
+#include "../include/Utf8.h"
+#include "../include/SpanTracer.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+
+// Replays a trace recorded with SoundTracker --record-trace through the
+// event pipeline and reports where the time went. Builds on any platform.
+
+static void PrintUsage() {
+    std::printf("Usage: SoundTraceReplay <trace> [--speed N] [--max-bytes N] [--spill DIR] [--log DIR]\n"
+                "                        [--export FILE --format csv|json|text|arrow] [--spans FILE] [--rules FILE]\n"
+                "  --speed N      1 = recorded pace, N = N times faster, 0 = as fast as possible (default)\n"
+                "  --max-bytes N  memory budget of the event store\n"
+                "  --spill DIR    write events past the budget to segments in DIR instead of dropping them\n"
+                "  --spans F      write a Chrome trace-event timeline of the replay (opens in Perfetto)\n"
+                "  --rules F      run ignore and notify rules on each sample and report what fired\n");
+}
+
+static bool ParseFormat(const char* name, LogFormat& format) {
+    if (std::strcmp(name, "csv") == 0) format = LogFormat::CSV;
+    else if (std::strcmp(name, "json") == 0) format = LogFormat::JSON;
+    else if (std::strcmp(name, "text") == 0) format = LogFormat::TEXT;
+    else if (std::strcmp(name, "arrow") == 0) format = LogFormat::ARROW;
+    else return false;
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        PrintUsage();
+        return 2;
+    }
+
+    std::wstring tracePath = Utf8ToWide(argv[1]);
+    double speed = 0.0;
+    size_t maxBytes = EventStore::DEFAULT_MAX_BYTES;
+    std::wstring spillDirectory;
+    std::wstring logDirectory;
+    std::wstring exportPath;
+    std::wstring spansPath;
+    std::wstring rulesPath;
+    LogFormat format = LogFormat::CSV;
+
+    for (int i = 2; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--speed") == 0 && hasValue) {
+            speed = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--max-bytes") == 0 && hasValue) {
+            maxBytes = static_cast<size_t>(std::strtoull(argv[++i], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--spill") == 0 && hasValue) {
+            spillDirectory = Utf8ToWide(argv[++i]);
+        } else if (std::strcmp(argv[i], "--log") == 0 && hasValue) {
+            logDirectory = Utf8ToWide(argv[++i]);
+        } else if (std::strcmp(argv[i], "--export") == 0 && hasValue) {
+            exportPath = Utf8ToWide(argv[++i]);
+        } else if (std::strcmp(argv[i], "--spans") == 0 && hasValue) {
+            spansPath = Utf8ToWide(argv[++i]);
+        } else if (std::strcmp(argv[i], "--rules") == 0 && hasValue) {
+            rulesPath = Utf8ToWide(argv[++i]);
+        } else if (std::strcmp(argv[i], "--format") == 0 && hasValue && ParseFormat(argv[i + 1], format)) {
+            ++i;
+        } else {
+            PrintUsage();
+            return 2;
+        }
+    }
+
+    EventStore store(maxBytes);
+    if (!spillDirectory.empty() && !store.OpenSpill(spillDirectory, UINT64_MAX)) {
+        std::fprintf(stderr, "Cannot use %s for spill segments\n", WideToUtf8(spillDirectory).c_str());
+        return 1;
+    }
+    std::unique_ptr<Logger> logger;
+    if (!logDirectory.empty()) {
+        logger = std::make_unique<Logger>(logDirectory);
+        if (!logger->Initialize()) {
+            std::fprintf(stderr, "Cannot create a log in %s\n", WideToUtf8(logDirectory).c_str());
+            return 1;
+        }
+    }
+
+    RuleEngine rules;
+    std::string rulesError;
+    if (!rulesPath.empty() && !rules.LoadFile(rulesPath, rulesError)) {
+        std::fprintf(stderr, "Cannot load rules: %s\n", rulesError.c_str());
+        return 1;
+    }
+
+    if (!spansPath.empty()) {
+        SpanTracer::SetThreadName("Replay");
+        SpanTracer::Instance().Enable();
+    }
+
+    TraceReplayer replayer;
+    replayer.SetSpeed(speed);
+    replayer.SetLogger(logger.get());
+    replayer.SetRules(rulesPath.empty() ? nullptr : &rules);
+
+    ReplayStats stats;
+    if (!replayer.Replay(tracePath, store, stats)) {
+        std::fprintf(stderr, "Cannot read trace %s\n", argv[1]);
+        return 1;
+    }
+    if (logger) {
+        logger->Close();
+    }
+
+    double wallMs = std::chrono::duration<double, std::milli>(stats.wallTime).count();
+    double pipelineMs = std::chrono::duration<double, std::milli>(stats.pipelineTime).count();
+    std::printf("samples        %llu (%llu new events, %llu batched)%s\n",
+                static_cast<unsigned long long>(stats.samples), static_cast<unsigned long long>(stats.added),
+                static_cast<unsigned long long>(stats.batched), stats.truncated ? ", trace truncated" : "");
+    std::printf("trace span     %.3f s\n", stats.traceSpan.count() / 1e6);
+    std::printf("wall time      %.3f ms\n", wallMs);
+    std::printf("pipeline time  %.3f ms (%.0f ns/sample)\n", pipelineMs,
+                stats.samples ? pipelineMs * 1e6 / stats.samples : 0.0);
+    std::printf("enrichment     %.3f ms recorded\n", stats.enrichMicros / 1e3);
+    std::printf("store          %zu events, %.1f MB in memory, %zu spilled (%.1f MB on disk)\n",
+                store.GetEventCount(), store.GetMemoryUsage() / (1024.0 * 1024.0), store.GetSpilledEventCount(),
+                store.GetSpillDiskUsage() / (1024.0 * 1024.0));
+
+    if (!rulesPath.empty()) {
+        std::printf("rules          %zu rules (%zu nodes for %zu terms), %llu samples ignored, %llu alerts\n",
+                    rules.GetRuleCount(), rules.GetNodeCount(), rules.GetTermCount(),
+                    static_cast<unsigned long long>(stats.ignored), static_cast<unsigned long long>(stats.alerts));
+        for (size_t i = 0; i < rules.GetRuleCount(); ++i) {
+            if (rules.GetFireCount(i) > 0) {
+                std::printf("  %8llu  %s\n", static_cast<unsigned long long>(rules.GetFireCount(i)),
+                            rules.GetRuleName(i).c_str());
+            }
+        }
+    }
+
+    if (!exportPath.empty()) {
+        auto exportStart = std::chrono::steady_clock::now();
+        auto events = store.GetEvents((std::chrono::system_clock::time_point::min)(),
+                                      (std::chrono::system_clock::time_point::max)());
+        Logger exporter(logDirectory.empty() ? L"logs" : logDirectory);
+        if (!exporter.ExportEvents(events, exportPath, format)) {
+            std::fprintf(stderr, "Export failed\n");
+            return 1;
+        }
+        std::printf("export         %.3f ms (%zu events)\n",
+                    std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - exportStart).count(),
+                    events.size());
+    }
+
+    if (!spansPath.empty() && !SpanTracer::Instance().WriteChromeTrace(spansPath)) {
+        std::fprintf(stderr, "Cannot write spans to %s\n", WideToUtf8(spansPath).c_str());
+        return 1;
+    }
+    return 0;
+}